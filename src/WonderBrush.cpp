@@ -19,12 +19,14 @@
 #include "FilterDropShadow.h"
 #include "FontCache.h"
 #include "FontRegistry.h"
+#include "IconCache.h"
 #include "Image.h"
 #include "Layer.h"
 #include "MessageImporter.h"
 #include "NativeSaver.h"
 #include "Rect.h"
 #include "RenderBuffer.h"
+#include "RenderTrace.h"
 #include "Shape.h"
 #include "SimpleFileSaver.h"
 #include "Text.h"
@@ -32,6 +34,7 @@
 #include "WonderBrush2Importer.h"
 
 #include "support_ui.h"
+#include "ui_defines.h"
 
 static BString sFontsDirectory;
 
@@ -245,13 +248,13 @@ WonderBrushBase::WonderBrushBase(BRect bounds)
 			| Brush::FLAG_TILT_CONTROLS_SHAPE);
 	brushStroke->SetBrush(brush);
 	brush->RemoveReference();
-	brushStroke->Stroke().AppendObject(
+	brushStroke->AppendPoint(
 		StrokePoint(BPoint(150 * s, 50 * s), 0.2f, 0.0f, 0.0f));
-	brushStroke->Stroke().AppendObject(
+	brushStroke->AppendPoint(
 		StrokePoint(BPoint(200 * s, 20 * s), 1.0f, 0.0f, 0.0f));
-	brushStroke->Stroke().AppendObject(
+	brushStroke->AppendPoint(
 		StrokePoint(BPoint(250 * s, 80 * s), 0.8f, 0.0f, 0.0f));
-	brushStroke->Stroke().AppendObject(
+	brushStroke->AppendPoint(
 		StrokePoint(BPoint(300 * s, 50 * s), 0.1f, 0.0f, 0.0f));
 	subLayer->AddObject(brushStroke);
 
@@ -374,6 +377,19 @@ WonderBrush::NewWindow(Document* document)
 {
 	fWindowFrame.OffsetBy(30, 30);
 
+	if (fWindowCount == 0) {
+		// Have the icons of the tool config views rendered in the
+		// background, while the window sets up its own icons.
+		const int32 toolConfigIcons[] = {
+			kTextAlignLeftIcon,
+			kTextAlignCenterIcon,
+			kTextAlignRightIcon,
+			kTextAlignJustifyIcon
+		};
+		IconCache::Default()->Prewarm(toolConfigIcons,
+			sizeof(toolConfigIcons) / sizeof(int32), kToolConfigIconSize);
+	}
+
 	BString windowName("WonderBrush ");
 	windowName << ++fWindowCount;
 
@@ -588,13 +604,19 @@ WonderBrush::_NotifyFontsLoaded(Layer* layer)
 int
 main(int argc, char* argv[])
 {
+	BString renderTracePath;
 	for (int i = 1; i < argc; i++) {
 		if (strcmp(argv[i], "--fonts") == 0 && i < argc - 1) {
-			sFontsDirectory = argv[i + 1];
+			sFontsDirectory = argv[++i];
 			printf("Using font folder: '%s'\n", sFontsDirectory.String());
-			break;
+		} else if (strcmp(argv[i], "--render-trace") == 0 && i < argc - 1) {
+			renderTracePath = argv[++i];
+			printf("Writing render trace to: '%s'\n",
+				renderTracePath.String());
 		}
 	}
+	if (renderTracePath.Length() > 0)
+		RenderTrace::SetEnabled(true);
 	// Create app already here. For Qt this must be the first event loop
 	// created and FontRegistry is a BLooper which uses an event loop, too.
 	WonderBrush app(argc, argv, BRect(0, 0, 799, 599));
@@ -608,5 +630,11 @@ main(int argc, char* argv[])
 	}
 
 	app.Run();
+
+	if (renderTracePath.Length() > 0
+		&& RenderTrace::WriteChromeTrace(renderTracePath.String()) != B_OK) {
+		fprintf(stderr, "Failed to write render trace to '%s'\n",
+			renderTracePath.String());
+	}
 	return 0;
 }
@@ -0,0 +1,1186 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// wb_bench times the render and I/O hot paths of WonderBrush without any
+// GUI. The results are written as JSON, so that two builds can be compared
+// by a script. Run "wb_bench --help" for the options.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <new>
+
+#include <Bitmap.h>
+#include <DataIO.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <List.h>
+#include <OS.h>
+#include <Path.h>
+#include <Region.h>
+#include <String.h>
+#include <TranslationUtils.h>
+
+#ifdef __HAIKU__
+#	include <Application.h>
+#else
+#	include <QCoreApplication>
+#endif
+
+#include "AutoDeleter.h"
+#include "Brush.h"
+#include "BrushStroke.h"
+#include "BufferPool.h"
+#include "DenoiseFilter.h"
+#include "Document.h"
+#include "Filter.h"
+#include "FilterDropShadow.h"
+#include "Font.h"
+#include "FontCache.h"
+#include "FontRegistry.h"
+#include "GaussFilter.h"
+#include "Gradient.h"
+#include "Image.h"
+#include "Interpolation.h"
+#include "Layer.h"
+#include "LayerSnapshot.h"
+#include "LayoutContext.h"
+#include "LayoutState.h"
+#include "Paint.h"
+#include "Rect.h"
+#include "RenderBuffer.h"
+#include "RenderEngine.h"
+#include "RenderTrace.h"
+#include "StackBlurFilter.h"
+#include "Style.h"
+#include "Text.h"
+#include "TextLayout.h"
+#include "TiledSurface.h"
+#include "support.h"
+
+#ifdef __HAIKU__
+#	include "MessageExporter.h"
+#	include "MessageImporter.h"
+#endif
+
+
+static const int32 kDefaultIterations = 10;
+static const bigtime_t kFontScanTimeout = 20000000;
+static const BRect kBufferBounds(0, 0, 1023, 1023);
+
+// The canvas of the stress benchmarks, and the rows of the strip rendered
+// at its bottom. At 64 pixels of 8 bytes per row, the strip takes more than
+// 4 GB, so row offsets reach beyond 2^32 bytes.
+static const int32 kHugeCanvasSize = 100000;
+static const int32 kHugeStripRows = 9 * 1024 * 1024;
+
+
+// #pragma mark - Benchmark
+
+
+// A single benchmark. Prepare() is not timed, Run() is timed for each
+// iteration.
+class Benchmark {
+public:
+	Benchmark(const char* name)
+		: fName(name)
+	{
+	}
+
+	virtual ~Benchmark()
+	{
+	}
+
+	const char* Name() const
+	{
+		return fName.String();
+	}
+
+	virtual bool Prepare()
+	{
+		return true;
+	}
+
+	virtual void Run() = 0;
+
+private:
+	BString		fName;
+};
+
+
+// #pragma mark - document rendering
+
+
+// Renders the whole document the same way a RenderThread does it.
+class DocumentRenderBenchmark : public Benchmark {
+public:
+	DocumentRenderBenchmark(const char* name, const DocumentRef& document,
+			int32 threadCount)
+		: Benchmark(name)
+		, fDocument(document)
+		, fThreadCount(threadCount)
+		, fSnapshot(NULL)
+		, fBitmap(NULL)
+	{
+	}
+
+	virtual ~DocumentRenderBenchmark()
+	{
+		delete fSnapshot;
+		delete fBitmap;
+	}
+
+	virtual bool Prepare()
+	{
+		fSnapshot = new(std::nothrow) LayerSnapshot(fDocument->RootLayer());
+		if (fSnapshot == NULL)
+			return false;
+		fSnapshot->Sync();
+
+		LayoutState initialState;
+		LayoutContext context(&initialState);
+		context.Init(1.0);
+
+		LayoutState rootLayerState(context.State());
+		context.PushState(&rootLayerState);
+		fSnapshot->Layout(context, 0);
+		context.PopState();
+
+		fBitmap = new(std::nothrow) RenderBuffer(fSnapshot->Bounds());
+		if (fBitmap == NULL || !fBitmap->IsValid())
+			return false;
+
+		fEngine.SetThreadCount(fThreadCount);
+		return true;
+	}
+
+	virtual void Run()
+	{
+		BRegion dummyRegion;
+		int32 dummyLevel;
+		fSnapshot->Render(fEngine, fBitmap->Bounds(), fBitmap, NULL,
+			dummyRegion, dummyLevel);
+		fEngine.Scratch().Reset();
+	}
+
+private:
+	DocumentRef			fDocument;
+	int32				fThreadCount;
+	LayerSnapshot*		fSnapshot;
+	RenderBuffer*		fBitmap;
+	RenderEngine		fEngine;
+};
+
+
+// #pragma mark - buffers
+
+
+// Base class for benchmarks working on a source and a target buffer.
+class BufferBenchmark : public Benchmark {
+public:
+	BufferBenchmark(const char* name)
+		: Benchmark(name)
+		, fSource(NULL)
+		, fTarget(NULL)
+	{
+	}
+
+	virtual ~BufferBenchmark()
+	{
+		if (fSource != NULL)
+			fSource->RemoveReference();
+		if (fTarget != NULL)
+			fTarget->RemoveReference();
+	}
+
+	virtual bool Prepare()
+	{
+		fSource = new(std::nothrow) RenderBuffer(kBufferBounds);
+		fTarget = new(std::nothrow) RenderBuffer(kBufferBounds);
+		if (fSource == NULL || !fSource->IsValid()
+			|| fTarget == NULL || !fTarget->IsValid()) {
+			return false;
+		}
+
+		fSource->Clear(kBufferBounds, (rgb_color){ 255, 120, 0, 160 });
+		fTarget->Clear(kBufferBounds, (rgb_color){ 40, 80, 255, 255 });
+		return true;
+	}
+
+protected:
+	RenderBuffer*		fSource;
+	RenderBuffer*		fTarget;
+};
+
+
+class BlendToBenchmark : public BufferBenchmark {
+public:
+	BlendToBenchmark()
+		: BufferBenchmark("render_buffer_blend_to")
+	{
+	}
+
+	virtual void Run()
+	{
+		fSource->BlendTo(fTarget, kBufferBounds);
+	}
+};
+
+
+class CopyToBenchmark : public BufferBenchmark {
+public:
+	CopyToBenchmark()
+		: BufferBenchmark("render_buffer_copy_to")
+	{
+	}
+
+	virtual void Run()
+	{
+		fSource->CopyTo(fTarget, kBufferBounds);
+	}
+};
+
+
+class DrawImageBenchmark : public BufferBenchmark {
+public:
+	DrawImageBenchmark(const char* name, uint32 interpolation)
+		: BufferBenchmark(name)
+		, fInterpolation(interpolation)
+	{
+	}
+
+	virtual bool Prepare()
+	{
+		if (!BufferBenchmark::Prepare())
+			return false;
+
+		Transformable transformation;
+		transformation.RotateBy(BPoint(512, 512), 10.0);
+		transformation.ScaleBy(BPoint(512, 512), 0.8, 0.8);
+
+		fEngine.AttachTo(fTarget);
+		fEngine.SetTransformation(transformation);
+		return true;
+	}
+
+	virtual void Run()
+	{
+		fEngine.DrawImage(fSource, kBufferBounds, fInterpolation, 255);
+	}
+
+private:
+	uint32				fInterpolation;
+	RenderEngine		fEngine;
+};
+
+
+class GaussFilterBenchmark : public BufferBenchmark {
+public:
+	GaussFilterBenchmark(const char* name, double radius, int32 threadCount)
+		: BufferBenchmark(name)
+		, fRadius(radius)
+		, fThreadCount(threadCount)
+		, fFilter(&fArena)
+	{
+	}
+
+	virtual void Run()
+	{
+		fFilter.FilterRGBA64(fSource, fRadius, fThreadCount);
+		fArena.Reset();
+	}
+
+private:
+	double				fRadius;
+	int32				fThreadCount;
+	ScratchArena		fArena;
+	GaussFilter			fFilter;
+};
+
+
+class DenoiseFilterBenchmark : public BufferBenchmark {
+public:
+	DenoiseFilterBenchmark(const char* name, int32 threadCount, bool cached)
+		: BufferBenchmark(name)
+		, fThreadCount(threadCount)
+		, fCached(cached)
+	{
+	}
+
+	virtual bool Prepare()
+	{
+		if (!BufferBenchmark::Prepare())
+			return false;
+
+		if (fCached)
+			Run();
+		return true;
+	}
+
+	virtual void Run()
+	{
+		// Without the cached tiles, every tile is denoised again.
+		if (!fCached)
+			fFilter.MakeEmpty();
+		fSource->CopyTo(fTarget, kBufferBounds);
+		fFilter.Filter(fTarget, kBufferBounds, fThreadCount);
+	}
+
+private:
+	int32				fThreadCount;
+	bool				fCached;
+	DenoiseFilter		fFilter;
+};
+
+
+class StackBlurBenchmark : public BufferBenchmark {
+public:
+	StackBlurBenchmark(const char* name, double radius)
+		: BufferBenchmark(name)
+		, fRadius(radius)
+	{
+	}
+
+	virtual void Run()
+	{
+		fFilter.FilterRGBA64(fSource, fRadius);
+	}
+
+private:
+	double				fRadius;
+	StackBlurFilter		fFilter;
+};
+
+
+// #pragma mark - huge canvases
+
+
+// Works on the bottom right corner of a 100000x100000 canvas. A MyPaint
+// surface with paint in the opposite corners is copied into a strip of the
+// canvas, which is 64 pixels wide and reaches far up, so that the corner
+// lies more than 4 GB into the strip. A view of the corner is then blurred
+// and blended. Only the touched pages of the strip are ever committed.
+class HugeCanvasBenchmark : public Benchmark {
+public:
+	HugeCanvasBenchmark()
+		: Benchmark("huge_canvas_100k_corner")
+		, fStrip(NULL)
+		, fOverlay(NULL)
+	{
+	}
+
+	virtual ~HugeCanvasBenchmark()
+	{
+		if (fStrip != NULL)
+			fStrip->RemoveReference();
+		if (fOverlay != NULL)
+			fOverlay->RemoveReference();
+	}
+
+	virtual bool Prepare()
+	{
+		int32 last = kHugeCanvasSize - 1;
+		fCorner = BRect(last - 63, last - 63, last, last);
+
+		fSurface.draw_dab(50.0f, 50.0f, 20.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+		fSurface.draw_dab(last - 40.0f, last - 40.0f, 20.0f, 0.0f, 0.0f, 1.0f,
+			1.0f);
+
+		fStrip = new(std::nothrow) RenderBuffer(BRect(last - 63,
+			kHugeCanvasSize - kHugeStripRows, last, last));
+		fOverlay = new(std::nothrow) RenderBuffer(fCorner);
+		if (fStrip == NULL || !fStrip->IsValid()
+			|| fOverlay == NULL || !fOverlay->IsValid()) {
+			return false;
+		}
+		fOverlay->Clear(fCorner, (rgb_color){ 255, 120, 0, 80 });
+
+		// The dab has to end up where it was painted, not at an offset
+		// which wrapped around.
+		fSurface.CopyTo(fStrip, fCorner);
+		const uint16* pixel = (const uint16*)(fStrip->Bits()
+			+ (int64)(last - 40 - fStrip->Top()) * fStrip->BytesPerRow()
+			+ (last - 40 - fStrip->Left()) * 8);
+		return pixel[0] > 0 && pixel[3] > 0;
+	}
+
+	virtual void Run()
+	{
+		fSurface.CopyTo(fStrip, fCorner);
+
+		// The view starts at the origin, its bounds are relative to the
+		// strip.
+		RenderBufferRef view = fStrip->CropUnclipped(
+			BRect(0, kHugeStripRows - 64, 59, kHugeStripRows - 5));
+		if (view.Get() != NULL)
+			fFilter.FilterRGBA64(view.Get(), 4.0, 1);
+
+		fOverlay->BlendTo(fStrip, fCorner);
+	}
+
+private:
+	TiledSurface		fSurface;
+	RenderBuffer*		fStrip;
+	RenderBuffer*		fOverlay;
+	BRect				fCorner;
+	GaussFilter			fFilter;
+};
+
+
+// Blurs the whole strip, so that the column pass of the gauss filter walks
+// more than 2^31 channels into the buffer. Only an opaque band at the very
+// bottom of the strip is painted, the blur has to spread it upwards. Unlike
+// the corner benchmark, this commits all of the strip.
+class HugeStripBlurBenchmark : public Benchmark {
+public:
+	HugeStripBlurBenchmark(int32 threadCount)
+		: Benchmark("huge_strip_gauss_filter")
+		, fThreadCount(threadCount)
+		, fStrip(NULL)
+	{
+	}
+
+	virtual ~HugeStripBlurBenchmark()
+	{
+		if (fStrip != NULL)
+			fStrip->RemoveReference();
+	}
+
+	virtual bool Prepare()
+	{
+		int32 last = kHugeCanvasSize - 1;
+		BRect bounds(last - 63, kHugeCanvasSize - kHugeStripRows, last, last);
+		fStrip = new(std::nothrow) RenderBuffer(bounds);
+		if (fStrip == NULL || !fStrip->IsValid())
+			return false;
+
+		fStrip->Clear(bounds, (rgb_color){ 0, 0, 0, 0 });
+		fStrip->Clear(BRect(bounds.left, last - 15, bounds.right, last),
+			(rgb_color){ 255, 255, 255, 255 });
+
+		Run();
+
+		const uint16* pixel = (const uint16*)(fStrip->Bits()
+			+ (int64)(last - 20 - fStrip->Top()) * fStrip->BytesPerRow());
+		return pixel[3] > 0;
+	}
+
+	virtual void Run()
+	{
+		fFilter.FilterRGBA64(fStrip, 8.0, fThreadCount);
+	}
+
+private:
+	int32				fThreadCount;
+	RenderBuffer*		fStrip;
+	GaussFilter			fFilter;
+};
+
+
+// #pragma mark - text
+
+
+static const char* kLoremIpsum
+	= "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+	"eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut enim ad "
+	"minim veniam, quis nostrud exercitation ullamco laboris nisi ut aliquip "
+	"ex ea commodo consequat. Duis aute irure dolor in reprehenderit in "
+	"voluptate velit esse cillum dolore eu fugiat nulla pariatur. Excepteur "
+	"sint occaecat cupidatat non proident, sunt in culpa qui officia "
+	"deserunt mollit anim id est laborum.\n";
+
+
+class TextLayoutBenchmark : public Benchmark {
+public:
+	TextLayoutBenchmark(const Font& font)
+		: Benchmark("text_layout")
+		, fLayout(FontCache::getInstance())
+	{
+		BString text;
+		for (int32 i = 0; i < 16; i++)
+			text << kLoremIpsum;
+
+		fLayout.setText(text.String());
+		fLayout.setFont(font);
+		fLayout.setWidth(400.0);
+		fLayout.setJustify(true);
+	}
+
+	virtual void Run()
+	{
+		fLayout.layout();
+	}
+
+private:
+	TextLayout			fLayout;
+};
+
+
+// #pragma mark - import and export
+
+
+class BitmapImportBenchmark : public Benchmark {
+public:
+	BitmapImportBenchmark(const char* path)
+		: Benchmark("import_bitmap_png")
+		, fPath(path)
+	{
+	}
+
+	virtual void Run()
+	{
+		BBitmap* bitmap = BTranslationUtils::GetBitmap(fPath.String());
+		if (bitmap == NULL)
+			return;
+		RenderBuffer* buffer = new(std::nothrow) RenderBuffer(bitmap);
+		if (buffer != NULL)
+			buffer->RemoveReference();
+		delete bitmap;
+	}
+
+private:
+	BString				fPath;
+};
+
+
+#ifdef __HAIKU__
+
+class MessageExportBenchmark : public Benchmark {
+public:
+	MessageExportBenchmark(const DocumentRef& document)
+		: Benchmark("export_native")
+		, fDocument(document)
+	{
+	}
+
+	virtual void Run()
+	{
+		BMallocIO stream;
+		MessageExporter exporter;
+		exporter.Export(fDocument, &stream);
+	}
+
+private:
+	DocumentRef			fDocument;
+};
+
+
+class MessageImportBenchmark : public Benchmark {
+public:
+	MessageImportBenchmark(const DocumentRef& document)
+		: Benchmark("import_native")
+		, fDocument(document)
+	{
+	}
+
+	virtual bool Prepare()
+	{
+		MessageExporter exporter;
+		return exporter.Export(fDocument, &fStream) == B_OK;
+	}
+
+	virtual void Run()
+	{
+		DocumentRef document(new(std::nothrow) Document(
+			fDocument->Bounds()), true);
+		if (document.Get() == NULL)
+			return;
+
+		fStream.Seek(0, SEEK_SET);
+		MessageImporter importer(document);
+		importer.Import(fStream);
+	}
+
+private:
+	DocumentRef			fDocument;
+	BMallocIO			fStream;
+};
+
+#endif // __HAIKU__
+
+
+// #pragma mark - documents
+
+
+static bool
+wait_for_fonts(const char* fontsDirectory)
+{
+	// Without any files to scan, the fonts would never show up.
+	BDirectory directory(fontsDirectory);
+	BEntry entry;
+	if (directory.InitCheck() != B_OK || directory.GetNextEntry(&entry) != B_OK)
+		return false;
+
+	FontRegistry* registry = FontRegistry::Default();
+	if (!registry->Lock())
+		return false;
+	registry->AddFontDirectory(fontsDirectory);
+	registry->Unlock();
+	registry->Scan();
+
+	// The scan runs asynchronously, the fonts are published all at once.
+	bigtime_t timeout = system_time() + kFontScanTimeout;
+	while (system_time() < timeout) {
+		if (registry->Lock()) {
+			int32 count = registry->CountFontFiles();
+			registry->Unlock();
+			if (count > 0)
+				return true;
+		}
+		snooze(20000);
+	}
+	return false;
+}
+
+
+static Image*
+load_image(const char* path)
+{
+	BBitmap* bitmap = BTranslationUtils::GetBitmap(path);
+	if (bitmap == NULL)
+		return NULL;
+
+	RenderBuffer* buffer = new(std::nothrow) RenderBuffer(bitmap);
+	delete bitmap;
+	if (buffer == NULL)
+		return NULL;
+
+	Image* image = new(std::nothrow) Image(buffer);
+	buffer->RemoveReference();
+	return image;
+}
+
+
+static void
+add_object(Layer* layer, Object* object)
+{
+	if (object == NULL)
+		return;
+	layer->AddObject(object);
+	object->RemoveReference();
+}
+
+
+// A document of the PNG layers from the data directory, each in its own
+// layer, as a painting would typically be structured.
+static DocumentRef
+create_layers_document(const char* dataDirectory)
+{
+	DocumentRef document;
+	for (int32 i = 1; ; i++) {
+		BString name;
+		name.SetToFormat("layer-%ld.png", (long)i);
+		BPath path(dataDirectory, name.String());
+
+		Image* image = load_image(path.Path());
+		if (image == NULL)
+			break;
+
+		if (document.Get() == NULL) {
+			document.SetTo(new(std::nothrow) Document(image->Bounds()), true);
+			if (document.Get() == NULL) {
+				image->RemoveReference();
+				break;
+			}
+		}
+
+		Layer* layer = new(std::nothrow) Layer(document->Bounds());
+		if (layer == NULL) {
+			image->RemoveReference();
+			break;
+		}
+		add_object(layer, image);
+		add_object(document->RootLayer(), layer);
+	}
+	return document;
+}
+
+
+// A synthetic document which contains every kind of object.
+static DocumentRef
+create_synthetic_document(bool withText)
+{
+	BRect bounds(0, 0, 1599, 1199);
+	DocumentRef document(new(std::nothrow) Document(bounds), true);
+	if (document.Get() == NULL)
+		return document;
+
+	Layer* root = document->RootLayer();
+
+	for (int32 i = 0; i < 40; i++) {
+		float x = (i % 8) * 200.0f;
+		float y = (i / 8) * 240.0f;
+		add_object(root, new(std::nothrow) Rect(
+			BRect(x, y, x + 260.0f, y + 180.0f),
+			(rgb_color){ (uint8)(i * 6), 120, (uint8)(255 - i * 6), 180 }));
+	}
+
+	Layer* strokeLayer = new(std::nothrow) Layer(bounds);
+	if (strokeLayer != NULL) {
+		for (int32 i = 0; i < 12; i++) {
+			BrushStroke* stroke = new(std::nothrow) BrushStroke();
+			if (stroke == NULL)
+				break;
+			Brush* brush = new(std::nothrow) Brush(0.0f, 1.0f, 4.0f, 24.0f,
+				0.0f, 0.7f, Brush::FLAG_PRESSURE_CONTROLS_APHLA
+					| Brush::FLAG_PRESSURE_CONTROLS_RADIUS);
+			if (brush != NULL) {
+				stroke->SetBrush(brush);
+				brush->RemoveReference();
+			}
+			for (int32 j = 0; j < 400; j++) {
+				float x = 40.0f + j * 3.8f;
+				float y = 80.0f + i * 90.0f + sinf(j / 20.0f) * 40.0f;
+				stroke->AppendPoint(StrokePoint(BPoint(x, y),
+					0.5f + 0.5f * sinf(j / 35.0f), 0.0f, 0.0f));
+			}
+			add_object(strokeLayer, stroke);
+		}
+		strokeLayer->RotateBy(BPoint(800, 600), -8.0);
+		add_object(root, strokeLayer);
+	}
+
+	add_object(root, new(std::nothrow) Filter(8.0f));
+
+	Layer* shadowLayer = new(std::nothrow) Layer(bounds);
+	if (shadowLayer != NULL) {
+		add_object(shadowLayer, new(std::nothrow) Rect(
+			BRect(300, 300, 1300, 900), (rgb_color){ 255, 215, 20, 200 }));
+
+		if (withText) {
+			Text* text = new(std::nothrow) Text((rgb_color){ 0, 0, 0, 255 });
+			if (text != NULL) {
+				text->TranslateBy(BPoint(340, 340));
+				text->SetWidth(900.0);
+				text->SetAlignment(TEXT_ALIGNMENT_JUSTIFY);
+				for (int32 i = 0; i < 4; i++) {
+					text->Append(kLoremIpsum,
+						Font("DejaVu Serif", "Book", 24.0),
+						(rgb_color){ 0, 0, 0, 255 });
+				}
+				add_object(shadowLayer, text);
+			}
+		}
+
+		FilterDropShadow* dropShadow = new(std::nothrow) FilterDropShadow(6.0f);
+		if (dropShadow != NULL) {
+			dropShadow->SetOpacity(200.0f);
+			dropShadow->SetOffsetY(4.0f);
+		}
+		add_object(shadowLayer, dropShadow);
+		add_object(root, shadowLayer);
+	}
+
+	return document;
+}
+
+
+static Rect*
+create_gradient_rect(const BRect& area, Gradient::Type type, int32 index)
+{
+	Rect* rect = new(std::nothrow) Rect(area, (rgb_color){ 0, 0, 0, 255 });
+	Gradient* gradient = new(std::nothrow) Gradient(true);
+	if (rect == NULL || gradient == NULL || rect->Style() == NULL) {
+		delete rect;
+		delete gradient;
+		return NULL;
+	}
+	GradientRef gradientRef(gradient, true);
+
+	gradient->SetType(type);
+	gradient->AddColor((rgb_color){ 255, (uint8)(index * 20), 40, 255 }, 0.0f);
+	gradient->AddColor((rgb_color){ 30, 160, 255, 160 }, 0.6f);
+	gradient->AddColor((rgb_color){ 20, 20, 60, 255 }, 1.0f);
+
+	// The gradient covers 0 to 200 units.
+	if (type == Gradient::CIRCULAR) {
+		float radius = max_c(area.Width(), area.Height()) / 2;
+		gradient->ScaleBy(B_ORIGIN, radius / 200.0, radius / 200.0);
+		gradient->TranslateBy(BPoint((area.left + area.right) / 2,
+			(area.top + area.bottom) / 2));
+	} else {
+		gradient->ScaleBy(B_ORIGIN, area.Width() / 200.0, 1.0);
+		gradient->RotateBy(B_ORIGIN, index * 15.0);
+		gradient->TranslateBy(area.LeftTop());
+	}
+
+	PaintRef paint(new(std::nothrow) Paint(gradientRef), true);
+	if (paint.Get() != NULL)
+		rect->Style()->SetFillPaint(paint);
+	return rect;
+}
+
+
+// A synthetic document of large, overlapping linear and radial gradient
+// fills, some of them semi-transparent in a rotated layer.
+static DocumentRef
+create_gradient_document()
+{
+	BRect bounds(0, 0, 1599, 1199);
+	DocumentRef document(new(std::nothrow) Document(bounds), true);
+	if (document.Get() == NULL)
+		return document;
+
+	Layer* root = document->RootLayer();
+
+	for (int32 i = 0; i < 12; i++) {
+		float x = (i % 4) * 400.0f;
+		float y = (i / 4) * 400.0f;
+		add_object(root, create_gradient_rect(
+			BRect(x, y, x + 599.0f, y + 499.0f),
+			i % 2 == 0 ? Gradient::LINEAR : Gradient::CIRCULAR, i));
+	}
+
+	Layer* layer = new(std::nothrow) Layer(bounds);
+	if (layer != NULL) {
+		for (int32 i = 0; i < 6; i++) {
+			float x = 100.0f + i * 220.0f;
+			Rect* rect = create_gradient_rect(
+				BRect(x, 200.0f, x + 399.0f, 999.0f),
+				i % 2 == 0 ? Gradient::CIRCULAR : Gradient::LINEAR, i);
+			if (rect != NULL)
+				rect->SetOpacity(200);
+			add_object(layer, rect);
+		}
+		layer->RotateBy(BPoint(800, 600), 20.0);
+		add_object(root, layer);
+	}
+
+	return document;
+}
+
+
+// A flat strip of a document, much wider than 16 bit span coordinates
+// reach, with shapes and gradients crossing the 32767 pixel mark.
+static DocumentRef
+create_wide_document()
+{
+	BRect bounds(0, 0, 99999, 63);
+	DocumentRef document(new(std::nothrow) Document(bounds), true);
+	if (document.Get() == NULL)
+		return document;
+
+	Layer* root = document->RootLayer();
+
+	add_object(root, create_gradient_rect(bounds, Gradient::LINEAR, 0));
+
+	for (int32 i = 0; i < 10; i++) {
+		float x = i * 10000.0f + 2767.0f;
+		add_object(root, new(std::nothrow) Rect(
+			BRect(x, 8.0f, x + 59999.0f - i * 5000.0f, 55.0f),
+			(rgb_color){ (uint8)(i * 25), 120, (uint8)(255 - i * 25), 120 }));
+	}
+
+	Layer* layer = new(std::nothrow) Layer(bounds);
+	if (layer != NULL) {
+		add_object(layer, create_gradient_rect(
+			BRect(20000.0f, 0.0f, 79999.0f, 63.0f), Gradient::CIRCULAR, 1));
+		add_object(layer, new(std::nothrow) Filter(4.0f));
+		add_object(root, layer);
+	}
+
+	return document;
+}
+
+
+// #pragma mark - runner
+
+
+struct bench_options {
+	const char*	dataDirectory;
+	const char*	filter;
+	int32		iterations;
+	int32		threadCount;
+	const char*	tracePath;
+	bool		list;
+	bool		stress;
+};
+
+
+static bool
+is_selected(const bench_options& options, const char* name)
+{
+	return options.filter == NULL || strstr(name, options.filter) != NULL;
+}
+
+
+static int
+compare_times(const void* a, const void* b)
+{
+	bigtime_t timeA = *(const bigtime_t*)a;
+	bigtime_t timeB = *(const bigtime_t*)b;
+	return timeA < timeB ? -1 : (timeA > timeB ? 1 : 0);
+}
+
+
+static bool
+run_benchmark(Benchmark* benchmark, const bench_options& options,
+	bool first)
+{
+	if (!benchmark->Prepare()) {
+		fprintf(stderr, "%s: failed to prepare, skipped\n", benchmark->Name());
+		return false;
+	}
+
+	// warm up caches and lazily initialized state
+	benchmark->Run();
+
+	bigtime_t* times = new(std::nothrow) bigtime_t[options.iterations];
+	if (times == NULL)
+		return false;
+	ArrayDeleter<bigtime_t> timesDeleter(times);
+
+	// Pixel memory the timed runs needed, and how often the buffer pool
+	// had to go to the heap for it.
+	BufferPool* pool = BufferPool::Default();
+	pool->ResetStatistics();
+
+	bigtime_t total = 0;
+	for (int32 i = 0; i < options.iterations; i++) {
+		bigtime_t start = system_time();
+		benchmark->Run();
+		times[i] = system_time() - start;
+		total += times[i];
+	}
+
+	qsort(times, options.iterations, sizeof(bigtime_t), &compare_times);
+
+	int32 count = options.iterations;
+	printf("%s\n    {\"name\": \"%s\", \"iterations\": %ld, \"min_us\": %lld, "
+		"\"median_us\": %lld, \"mean_us\": %lld, \"max_us\": %lld, "
+		"\"peak_pixel_bytes\": %llu, \"pixel_heap_allocations\": %ld}",
+		first ? "" : ",", benchmark->Name(), (long)count,
+		(long long)times[0], (long long)times[count / 2],
+		(long long)(total / count), (long long)times[count - 1],
+		(unsigned long long)pool->PeakLiveBytes(),
+		(long)pool->HeapAllocationCount());
+	fflush(stdout);
+
+	fprintf(stderr, "%s: %lld us (median of %ld)\n", benchmark->Name(),
+		(long long)times[count / 2], (long)count);
+	return true;
+}
+
+
+static void
+print_usage(const char* programName)
+{
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"Times the render and I/O hot paths and prints the results as JSON.\n"
+		"\n"
+		"  --data <dir>        Directory with the test data (layer-*.png and\n"
+		"                      the fonts folder). Default: data\n"
+		"  --filter <string>   Run only the benchmarks whose name contains\n"
+		"                      the string.\n"
+		"  --iterations <n>    Timed iterations per benchmark. Default: %ld\n"
+		"  --threads <n>       Threads for the multi-threaded variants.\n"
+		"                      Default: number of CPUs\n"
+		"  --trace <file>      Record a render trace of all runs and write it\n"
+		"                      to the file as Chrome trace JSON. Adds some\n"
+		"                      overhead to the timings.\n"
+		"  --stress            Also run the stress benchmarks on huge\n"
+		"                      canvases, which need more than 4 GB of\n"
+		"                      memory.\n"
+		"  --list              List the benchmarks and exit.\n",
+		programName, (long)kDefaultIterations);
+}
+
+
+static void
+add_benchmark(BList& benchmarks, Benchmark* benchmark)
+{
+	if (benchmark == NULL)
+		return;
+	if (!benchmarks.AddItem(benchmark))
+		delete benchmark;
+}
+
+
+int
+main(int argc, char* argv[])
+{
+#ifdef __HAIKU__
+	BApplication app("application/x-vnd.yellowbites-wb_bench");
+#else
+	// The FontRegistry is a BLooper, which needs an application event loop.
+	QCoreApplication app(argc, argv);
+#endif
+
+	bench_options options;
+	options.dataDirectory = "data";
+	options.filter = NULL;
+	options.iterations = kDefaultIterations;
+	options.threadCount = get_optimal_worker_thread_count();
+	options.tracePath = NULL;
+	options.list = false;
+	options.stress = false;
+
+	for (int i = 1; i < argc; i++) {
+		const char* arg = argv[i];
+		bool hasValue = i < argc - 1;
+		if (strcmp(arg, "--data") == 0 && hasValue)
+			options.dataDirectory = argv[++i];
+		else if (strcmp(arg, "--filter") == 0 && hasValue)
+			options.filter = argv[++i];
+		else if (strcmp(arg, "--iterations") == 0 && hasValue)
+			options.iterations = max_c(1, atol(argv[++i]));
+		else if (strcmp(arg, "--threads") == 0 && hasValue)
+			options.threadCount = max_c(1, atol(argv[++i]));
+		else if (strcmp(arg, "--trace") == 0 && hasValue)
+			options.tracePath = argv[++i];
+		else if (strcmp(arg, "--list") == 0)
+			options.list = true;
+		else if (strcmp(arg, "--stress") == 0)
+			options.stress = true;
+		else {
+			print_usage(argv[0]);
+			return strcmp(arg, "--help") == 0 ? 0 : 1;
+		}
+	}
+
+	BString multiThreaded;
+	multiThreaded.SetToFormat("_%ldt", (long)options.threadCount);
+	BString name;
+
+	// Only the benchmarks with text need the fonts, the others don't wait
+	// for the font scan. Listing includes the text benchmarks.
+	BString syntheticName = BString("layer_render_synthetic") << multiThreaded;
+	bool haveFonts = options.list;
+	if (!options.list && (is_selected(options, "text_layout")
+			|| is_selected(options, "layer_render_synthetic_1t")
+			|| is_selected(options, syntheticName.String()))) {
+		BPath fontsPath(options.dataDirectory, "fonts");
+		haveFonts = wait_for_fonts(fontsPath.Path());
+		if (!haveFonts)
+			fprintf(stderr, "No fonts found, text benchmarks are skipped.\n");
+	}
+
+	BList benchmarks;
+
+	DocumentRef synthetic = create_synthetic_document(haveFonts);
+	if (synthetic.Get() != NULL) {
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			"layer_render_synthetic_1t", synthetic, 1));
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			syntheticName.String(), synthetic, options.threadCount));
+	}
+
+	DocumentRef gradients = create_gradient_document();
+	if (gradients.Get() != NULL) {
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			"layer_render_gradients_1t", gradients, 1));
+	}
+
+	DocumentRef wide = create_wide_document();
+	if (wide.Get() != NULL) {
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			"layer_render_wide_strip_1t", wide, 1));
+	}
+
+	DocumentRef layers = create_layers_document(options.dataDirectory);
+	if (layers.Get() != NULL) {
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			"layer_render_png_layers_1t", layers, 1));
+		name = BString("layer_render_png_layers") << multiThreaded;
+		add_benchmark(benchmarks, new(std::nothrow) DocumentRenderBenchmark(
+			name.String(), layers, options.threadCount));
+	} else {
+		fprintf(stderr, "No layer-*.png found in '%s', the layer benchmarks "
+			"are skipped.\n", options.dataDirectory);
+	}
+
+	add_benchmark(benchmarks, new(std::nothrow) DrawImageBenchmark(
+		"draw_image_nearest_neighbor", INTERPOLATION_NEAREST_NEIGHBOR));
+	add_benchmark(benchmarks, new(std::nothrow) DrawImageBenchmark(
+		"draw_image_bilinear", INTERPOLATION_BILINEAR));
+	add_benchmark(benchmarks, new(std::nothrow) DrawImageBenchmark(
+		"draw_image_resample", INTERPOLATION_RESAMPLE));
+	add_benchmark(benchmarks, new(std::nothrow) BlendToBenchmark());
+	add_benchmark(benchmarks, new(std::nothrow) CopyToBenchmark());
+
+	add_benchmark(benchmarks, new(std::nothrow) GaussFilterBenchmark(
+		"gauss_filter_r10_1t", 10.0, 1));
+	name = BString("gauss_filter_r10") << multiThreaded;
+	add_benchmark(benchmarks, new(std::nothrow) GaussFilterBenchmark(
+		name.String(), 10.0, options.threadCount));
+	add_benchmark(benchmarks, new(std::nothrow) StackBlurBenchmark(
+		"stack_blur_filter_r10", 10.0));
+
+	add_benchmark(benchmarks, new(std::nothrow) DenoiseFilterBenchmark(
+		"denoise_filter_1t", 1, false));
+	name = BString("denoise_filter") << multiThreaded;
+	add_benchmark(benchmarks, new(std::nothrow) DenoiseFilterBenchmark(
+		name.String(), options.threadCount, false));
+	add_benchmark(benchmarks, new(std::nothrow) DenoiseFilterBenchmark(
+		"denoise_filter_cached_1t", 1, true));
+
+	if (haveFonts) {
+		add_benchmark(benchmarks, new(std::nothrow) TextLayoutBenchmark(
+			Font("DejaVu Serif", "Book", 14.0)));
+	}
+
+	if (options.stress) {
+		add_benchmark(benchmarks, new(std::nothrow) HugeCanvasBenchmark());
+		add_benchmark(benchmarks, new(std::nothrow) HugeStripBlurBenchmark(
+			options.threadCount));
+	}
+
+	BPath firstLayer(options.dataDirectory, "layer-1.png");
+	add_benchmark(benchmarks, new(std::nothrow) BitmapImportBenchmark(
+		firstLayer.Path()));
+
+#ifdef __HAIKU__
+	if (synthetic.Get() != NULL) {
+		add_benchmark(benchmarks,
+			new(std::nothrow) MessageExportBenchmark(synthetic));
+		add_benchmark(benchmarks,
+			new(std::nothrow) MessageImportBenchmark(synthetic));
+	}
+#endif
+
+	if (options.tracePath != NULL && !options.list)
+		RenderTrace::SetEnabled(true);
+
+	int32 failed = 0;
+	bool first = true;
+	if (!options.list)
+		printf("{\n  \"benchmarks\": [");
+
+	for (int32 i = 0; i < benchmarks.CountItems(); i++) {
+		Benchmark* benchmark = (Benchmark*)benchmarks.ItemAtFast(i);
+		if (!is_selected(options, benchmark->Name()))
+			continue;
+
+		if (options.list) {
+			printf("%s\n", benchmark->Name());
+			continue;
+		}
+
+		if (run_benchmark(benchmark, options, first))
+			first = false;
+		else
+			failed++;
+	}
+
+	if (!options.list)
+		printf("\n  ]\n}\n");
+
+	if (RenderTrace::IsEnabled()) {
+		RenderTrace::SetEnabled(false);
+		if (RenderTrace::WriteChromeTrace(options.tracePath) != B_OK) {
+			fprintf(stderr, "Failed to write the trace to '%s'\n",
+				options.tracePath);
+			failed++;
+		}
+	}
+
+	for (int32 i = benchmarks.CountItems() - 1; i >= 0; i--)
+		delete (Benchmark*)benchmarks.ItemAtFast(i);
+
+	return failed == 0 ? 0 : 1;
+}
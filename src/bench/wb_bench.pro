@@ -0,0 +1,39 @@
+# The shared platform layer (BApplication, BView, support_ui) is built on
+# QtWidgets, even though the bench itself opens no windows.
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+TARGET = wb_bench
+TEMPLATE = app
+CONFIG += console
+
+include (../src_common.pro)
+
+
+INCLUDEPATH += /usr/include/freetype2
+INCLUDEPATH += ../agg/font_freetype
+INCLUDEPATH += ../agg/include
+INCLUDEPATH += ../cimg
+
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/brushlib
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/document
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/fills
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/objects
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/property
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/property/specific_properties
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/snapshots
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/model/text
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/render
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/render/text
+QMAKE_CXXFLAGS += -iquote $$SOURCE_ROOT/support
+
+LIBS += -L../agg -lagg -ldl -lfreetype
+
+TARGETDEPS += ../agg/libagg.a
+
+SOURCES += \
+	wb_bench.cpp
+
+include (../render_core.pri)
@@ -16,9 +16,8 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <glib.h>
 #include <math.h>
-#include "Python.h"
+#include "glib_compat.h"
 
 #include "brushsettings.hpp"
 #include "mapping.hpp"
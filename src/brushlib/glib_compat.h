@@ -0,0 +1,84 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef GLIB_COMPAT_H
+#define GLIB_COMPAT_H
+
+// The few parts of glib which brushlib uses, so that it can be built
+// without glib. The random numbers are not the ones glib would produce,
+// but they are just as reproducible from a given seed.
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef int gint;
+typedef double gdouble;
+typedef uint32_t guint32;
+
+#ifndef MAX
+#	define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef MIN
+#	define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef ABS
+#	define ABS(a) (((a) < 0) ? -(a) : (a))
+#endif
+#ifndef CLAMP
+#	define CLAMP(x, low, high) \
+		(((x) > (high)) ? (high) : (((x) < (low)) ? (low) : (x)))
+#endif
+
+#define g_print printf
+
+
+struct GRand {
+	guint32	state;
+};
+
+
+static inline void
+g_rand_set_seed(GRand* rand, guint32 seed)
+{
+	// xorshift gets stuck at zero
+	rand->state = seed != 0 ? seed : 0x9e3779b9;
+}
+
+
+static inline GRand*
+g_rand_new()
+{
+	GRand* rand = new GRand;
+	g_rand_set_seed(rand, 0);
+	return rand;
+}
+
+
+static inline void
+g_rand_free(GRand* rand)
+{
+	delete rand;
+}
+
+
+static inline guint32
+g_rand_int(GRand* rand)
+{
+	guint32 x = rand->state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rand->state = x;
+	return x;
+}
+
+
+// Returns a value in [0, 1).
+static inline double
+g_rand_double(GRand* rand)
+{
+	return g_rand_int(rand) * (1.0 / 4294967296.0);
+}
+
+#endif // GLIB_COMPAT_H
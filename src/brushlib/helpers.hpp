@@ -17,7 +17,7 @@
 #ifndef __helpers_h__
 #define __helpers_h__
 
-#include <glib.h>
+#include "glib_compat.h"
 #include <assert.h>
 
 // MAX, MIN, ABS, CLAMP are already available from gmacros.h
@@ -147,7 +147,8 @@ CanvasView::MessageReceived(BMessage* message)
 			}
 #endif
 			BRect area;
-			if (message->FindRect("area", &area) == B_OK) {
+			for (int32 i = 0;
+				message->FindRect("area", i, &area) == B_OK; i++) {
 				ConvertFromCanvas(&area);
 				area.left = floorf(area.left);
 				area.top = floorf(area.top);
@@ -510,6 +511,7 @@ CanvasView::ScrollOffsetChanged(BPoint oldOffset, BPoint newOffset)
 #endif
 	// TODO: Move delayed scrolling stuff into this method:
 	fRenderManager->SetCanvasLayout(DataRect(), VisibleRect());
+	_SetRenderManagerVisibleArea();
 }
 
 // VisibleSizeChanged
@@ -521,6 +523,7 @@ CanvasView::VisibleSizeChanged(float oldWidth, float oldHeight,
 	SetDataRect(dataRect);
 
 	fRenderManager->SetCanvasLayout(dataRect, VisibleRect());
+	_SetRenderManagerVisibleArea();
 }
 
 // #pragma mark -
@@ -783,6 +786,9 @@ CanvasView::_LayoutCanvas()
 void
 CanvasView::_SetRenderManagerZoom()
 {
+	// The new zoom level renders the visible area first.
+	_SetRenderManagerVisibleArea();
+
 	if (fZoomLevel <= 1.0)
 		fRenderManager->SetZoomLevel(fZoomLevel);
 	else {
@@ -794,6 +800,15 @@ CanvasView::_SetRenderManagerZoom()
 	}
 }
 
+// _SetRenderManagerVisibleArea
+void
+CanvasView::_SetRenderManagerVisibleArea()
+{
+	BRect area(Bounds());
+	ConvertToCanvas(&area);
+	fRenderManager->SetVisibleArea(area);
+}
+
 // #pragma mark -
 
 // _UpdateToolCursor
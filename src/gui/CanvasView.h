@@ -117,6 +117,7 @@ private:
 			BRect				_LayoutCanvas();
 
 			void				_SetRenderManagerZoom();
+			void				_SetRenderManagerVisibleArea();
 
 			void				_UpdateToolCursor();
 
@@ -37,6 +37,7 @@
 #include "Filter.h"
 #include "FilterBrightness.h"
 #include "FilterContrast.h"
+#include "FilterDenoise.h"
 #include "FilterDropShadow.h"
 #include "FilterSaturation.h"
 #include "IconButton.h"
@@ -93,6 +94,7 @@ enum {
 	FILTER_SATURATION				= 'srtn',
 	FILTER_BRIGHTNESS				= 'brtn',
 	FILTER_CONTRAST					= 'crst',
+	FILTER_DENOISE					= 'dnse',
 };
 
 class Window::SelectionListener : public Selection::Listener {
@@ -1064,6 +1066,7 @@ Window::_CreateObjectMenu() const
 	_AddFilterMenuItem(filterMenu, "Saturation", FILTER_SATURATION);
 	_AddFilterMenuItem(filterMenu, "Brightness", FILTER_BRIGHTNESS);
 	_AddFilterMenuItem(filterMenu, "Contrast", FILTER_CONTRAST);
+	_AddFilterMenuItem(filterMenu, "Denoise", FILTER_DENOISE);
 
 	menu->AddItem(filterMenu);
 
@@ -1211,6 +1214,9 @@ Window::_AddFilter(int32 filterID)
 		case FILTER_CONTRAST:
 			filter = new(std::nothrow) FilterContrast();
 			break;
+		case FILTER_DENOISE:
+			filter = new(std::nothrow) FilterDenoise();
+			break;
 	};
 
 	_AddObject(parentLayer, insertIndex, filter);
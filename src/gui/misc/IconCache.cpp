@@ -0,0 +1,645 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "IconCache.h"
+
+#include <new>
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utime.h>
+
+#include <Bitmap.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <IconUtils.h>
+#include <List.h>
+#include <Path.h>
+#include <Resources.h>
+
+#include "AutoLocker.h"
+#include "support.h"
+#include "support_ui.h"
+
+
+// Renderings on disk are only valid for the icon renderer which produced them.
+static const int32 kDiskCacheVersion = 1;
+
+// The renderings in memory which were used least recently are forgotten
+// once all of them together take more memory than this.
+static const size_t kMaxMemoryBytes = 8 * 1024 * 1024;
+
+// Once the files in the disk cache directory take more space than the
+// first limit, the ones used least recently are removed until they take no
+// more than the second.
+static const off_t kMaxDiskCacheBytes = 32 * 1024 * 1024;
+static const off_t kTrimmedDiskCacheBytes = 24 * 1024 * 1024;
+
+
+struct cache_file {
+	BString	path;
+	time_t	modification_time;
+	off_t	size;
+};
+
+// compare_cache_files
+static int
+compare_cache_files(const void* a, const void* b)
+{
+	const cache_file* fileA = *(const cache_file**)a;
+	const cache_file* fileB = *(const cache_file**)b;
+	if (fileA->modification_time < fileB->modification_time)
+		return -1;
+	if (fileA->modification_time > fileB->modification_time)
+		return 1;
+	return 0;
+}
+
+
+struct IconCache::Key {
+	Key(const uint8* data, size_t size, int32 width, int32 height,
+			float scale)
+		:
+		hash(14695981039346656037ULL),
+		size(size),
+		width(width),
+		height(height),
+		scale((int32)(scale * 100 + 0.5f))
+	{
+		// FNV-1a
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	bool operator==(const Key& other) const
+	{
+		return hash == other.hash && size == other.size
+			&& width == other.width && height == other.height
+			&& scale == other.scale;
+	}
+
+	size_t HashKey() const
+	{
+		return (size_t)(hash ^ (hash >> 32)) ^ (width << 16 | height)
+			^ ((size_t)scale << 24);
+	}
+
+	size_t BytesPerRow() const
+	{
+		return width * 4;
+	}
+
+	size_t BitsLength() const
+	{
+		return BytesPerRow() * height;
+	}
+
+	uint64	hash;
+	size_t	size;
+	int32	width;
+	int32	height;
+	int32	scale;
+		// display scale in percent
+};
+
+
+struct IconCache::Entry {
+	Entry(const Key& key)
+		:
+		key(key),
+		bits(new(std::nothrow) uint8[key.BitsLength()]),
+		previous(NULL),
+		next(NULL)
+	{
+		link.fNext = NULL;
+	}
+
+	~Entry()
+	{
+		delete[] bits;
+	}
+
+	void CopyFrom(const BBitmap* bitmap)
+	{
+		const uint8* src = reinterpret_cast<const uint8*>(bitmap->Bits());
+		for (int32 y = 0; y < key.height; y++) {
+			memcpy(bits + y * key.BytesPerRow(), src, key.BytesPerRow());
+			src += bitmap->BytesPerRow();
+		}
+	}
+
+	void CopyTo(BBitmap* bitmap) const
+	{
+		uint8* dst = reinterpret_cast<uint8*>(bitmap->Bits());
+		for (int32 y = 0; y < key.height; y++) {
+			memcpy(dst, bits + y * key.BytesPerRow(), key.BytesPerRow());
+			dst += bitmap->BytesPerRow();
+		}
+	}
+
+	Key						key;
+	uint8*					bits;
+	HashTableLink<Entry>	link;
+
+	// in the order of their last use, the most recent last
+	Entry*					previous;
+	Entry*					next;
+};
+
+
+struct IconCache::EntryHashDefinition {
+	typedef Key		KeyType;
+	typedef Entry	ValueType;
+
+	size_t HashKey(const KeyType& key) const
+	{
+		return key.HashKey();
+	}
+
+	size_t Hash(ValueType* value) const
+	{
+		return value->key.HashKey();
+	}
+
+	bool Compare(const KeyType& key, ValueType* value) const
+	{
+		return value->key == key;
+	}
+
+	HashTableLink<ValueType>* GetLink(ValueType* value) const
+	{
+		return &value->link;
+	}
+};
+
+
+struct IconCache::PrewarmJob {
+	PrewarmJob*		next;
+	const uint8*	data;
+	size_t			size;
+	int32			iconSize;
+};
+
+
+// #pragma mark -
+
+
+// constructor
+IconCache::IconCache()
+	: fLock("icon cache")
+	, fTable(new(std::nothrow) EntryTable)
+	, fFirstEntry(NULL)
+	, fLastEntry(NULL)
+	, fMemoryBytes(0)
+	, fDiskCacheDirectory()
+	, fDiskCacheBytes(-1)
+	, fTrimmingDiskCache(false)
+	, fFirstJob(NULL)
+	, fLastJob(NULL)
+	, fPrewarmThread(-1)
+{
+	if (fTable != NULL && fTable->Init() != B_OK) {
+		delete fTable;
+		fTable = NULL;
+	}
+}
+
+// destructor
+IconCache::~IconCache()
+{
+	// let the prewarm thread run out of jobs
+	thread_id thread;
+	{
+		AutoLocker<BLocker> locker(fLock);
+		while (fFirstJob != NULL) {
+			PrewarmJob* job = fFirstJob;
+			fFirstJob = job->next;
+			delete job;
+		}
+		fLastJob = NULL;
+		thread = fPrewarmThread;
+	}
+	if (thread >= 0) {
+		status_t result;
+		wait_for_thread(thread, &result);
+	}
+
+	MakeEmpty();
+	delete fTable;
+}
+
+// Default
+/*static*/ IconCache*
+IconCache::Default()
+{
+	static IconCache* defaultCache = NULL;
+	static BLocker defaultCacheLock("default icon cache");
+
+	AutoLocker<BLocker> locker(defaultCacheLock);
+	if (defaultCache == NULL) {
+		defaultCache = new(std::nothrow) IconCache;
+		BString path;
+		if (defaultCache != NULL
+			&& get_cache_directory("icons", path) == B_OK) {
+			defaultCache->SetDiskCacheDirectory(path.String());
+		}
+	}
+	return defaultCache;
+}
+
+// SetDiskCacheDirectory
+status_t
+IconCache::SetDiskCacheDirectory(const char* path)
+{
+	AutoLocker<BLocker> locker(fLock);
+	fDiskCacheDirectory = path;
+	fDiskCacheBytes = -1;
+	return B_OK;
+}
+
+// GetVectorIcon
+status_t
+IconCache::GetVectorIcon(const uint8* data, size_t size, BBitmap* bitmap)
+{
+	if (data == NULL || bitmap == NULL)
+		return B_BAD_VALUE;
+
+	status_t status = bitmap->InitCheck();
+	if (status != B_OK)
+		return status;
+
+	if (bitmap->ColorSpace() != B_RGBA32 || fTable == NULL)
+		return BIconUtils::GetVectorIcon(data, size, bitmap);
+
+	BRect bounds = bitmap->Bounds();
+	Key key(data, size, bounds.IntegerWidth() + 1,
+		bounds.IntegerHeight() + 1, ui_scale());
+
+	{
+		AutoLocker<BLocker> locker(fLock);
+		Entry* entry = _Lookup(key);
+		if (entry != NULL) {
+			entry->CopyTo(bitmap);
+			return B_OK;
+		}
+	}
+
+	// Not in memory, importing and rendering happens without holding the
+	// lock.
+	Entry* entry = _LoadFromDisk(key);
+	if (entry != NULL) {
+		entry->CopyTo(bitmap);
+	} else {
+		status = BIconUtils::GetVectorIcon(data, size, bitmap);
+		if (status != B_OK)
+			return status;
+
+		entry = new(std::nothrow) Entry(key);
+		if (entry == NULL || entry->bits == NULL) {
+			// Not being able to cache the icon is no error.
+			delete entry;
+			return B_OK;
+		}
+		entry->CopyFrom(bitmap);
+		_SaveToDisk(entry);
+	}
+
+	AutoLocker<BLocker> locker(fLock);
+	if (_Lookup(key) == NULL)
+		_Insert(entry);
+	else
+		delete entry;
+
+	return B_OK;
+}
+
+// Prewarm
+status_t
+IconCache::Prewarm(const int32* resourceIDs, int32 count, int32 size)
+{
+	// The resources are looked up here, since BResources may not be
+	// thread safe. The data stays valid as long as the shared resources.
+	BResources* resources = get_app_resources();
+	if (resources == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	AutoLocker<BLocker> locker(fLock);
+
+	for (int32 i = 0; i < count; i++) {
+		size_t dataSize;
+		const void* data = resources->LoadResource(B_VECTOR_ICON_TYPE,
+			resourceIDs[i], &dataSize);
+		if (data == NULL)
+			continue;
+
+		PrewarmJob* job = new(std::nothrow) PrewarmJob;
+		if (job == NULL)
+			return B_NO_MEMORY;
+		job->next = NULL;
+		job->data = reinterpret_cast<const uint8*>(data);
+		job->size = dataSize;
+		job->iconSize = size;
+
+		if (fLastJob != NULL)
+			fLastJob->next = job;
+		else
+			fFirstJob = job;
+		fLastJob = job;
+	}
+
+	if (fPrewarmThread >= 0 || fFirstJob == NULL)
+		return B_OK;
+
+	fPrewarmThread = spawn_thread(_PrewarmEntry, "icon prewarm",
+		B_LOW_PRIORITY, this);
+	if (fPrewarmThread < 0 || resume_thread(fPrewarmThread) != B_OK) {
+		fPrewarmThread = -1;
+		return B_ERROR;
+	}
+
+	return B_OK;
+}
+
+// MakeEmpty
+void
+IconCache::MakeEmpty()
+{
+	AutoLocker<BLocker> locker(fLock);
+
+	if (fTable == NULL)
+		return;
+
+	Entry* entry = fTable->Clear(true);
+	while (entry != NULL) {
+		Entry* next = entry->link.fNext;
+		delete entry;
+		entry = next;
+	}
+	fFirstEntry = NULL;
+	fLastEntry = NULL;
+	fMemoryBytes = 0;
+}
+
+// #pragma mark - private
+
+// _Lookup
+IconCache::Entry*
+IconCache::_Lookup(const Key& key)
+{
+	Entry* entry = fTable->Lookup(key);
+	if (entry != NULL) {
+		_UnlinkEntry(entry);
+		_LinkEntry(entry);
+	}
+	return entry;
+}
+
+// _LoadFromDisk
+IconCache::Entry*
+IconCache::_LoadFromDisk(const Key& key)
+{
+	BString path;
+	_DiskCachePath(key, path);
+	if (path.Length() == 0)
+		return NULL;
+
+	BFile file(path.String(), B_READ_ONLY);
+	off_t fileSize;
+	if (file.InitCheck() != B_OK || file.GetSize(&fileSize) != B_OK
+		|| fileSize != (off_t)key.BitsLength()) {
+		return NULL;
+	}
+
+	Entry* entry = new(std::nothrow) Entry(key);
+	if (entry == NULL || entry->bits == NULL
+		|| file.Read(entry->bits, key.BitsLength())
+			!= (ssize_t)key.BitsLength()) {
+		delete entry;
+		return NULL;
+	}
+
+	// The modification time tells when the rendering was used last.
+	utime(path.String(), NULL);
+
+	return entry;
+}
+
+// _SaveToDisk
+void
+IconCache::_SaveToDisk(const Entry* entry)
+{
+	BString path;
+	_DiskCachePath(entry->key, path);
+	if (path.Length() == 0)
+		return;
+
+	// The rendering is written next to its final place and then moved
+	// there, so that it is never read while only partially written. Both
+	// the UI and the prewarm thread may write the same rendering.
+	BString tempPath(path);
+	tempPath << ".tmp" << (long)find_thread(NULL);
+
+	BFile file(tempPath.String(),
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status_t status = file.InitCheck();
+	if (status == B_OK && file.Write(entry->bits, entry->key.BitsLength())
+			!= (ssize_t)entry->key.BitsLength()) {
+		status = B_IO_ERROR;
+	}
+	file.Unset();
+
+	if (status != B_OK || rename(tempPath.String(), path.String()) != 0) {
+		unlink(tempPath.String());
+		return;
+	}
+
+	bool trim = false;
+	{
+		AutoLocker<BLocker> locker(fLock);
+		if (fDiskCacheBytes >= 0)
+			fDiskCacheBytes += entry->key.BitsLength();
+		if (!fTrimmingDiskCache
+			&& (fDiskCacheBytes < 0 || fDiskCacheBytes > kMaxDiskCacheBytes)) {
+			fTrimmingDiskCache = true;
+			trim = true;
+		}
+	}
+
+	if (trim)
+		_TrimDiskCache();
+}
+
+// _DiskCachePath
+void
+IconCache::_DiskCachePath(const Key& key, BString& path)
+{
+	AutoLocker<BLocker> locker(fLock);
+
+	if (fDiskCacheDirectory.Length() == 0) {
+		path = "";
+		return;
+	}
+
+	char name[64];
+	snprintf(name, sizeof(name), "/%016llx-%lu-%ldx%ld@%ld-v%ld",
+		(unsigned long long)key.hash, (unsigned long)key.size,
+		(long)key.width, (long)key.height, (long)key.scale,
+		(long)kDiskCacheVersion);
+
+	path = fDiskCacheDirectory;
+	path << name;
+}
+
+// _Insert
+void
+IconCache::_Insert(Entry* entry)
+{
+	if (fTable->Insert(entry) != B_OK) {
+		delete entry;
+		return;
+	}
+
+	_LinkEntry(entry);
+	fMemoryBytes += entry->key.BitsLength();
+	_TrimMemory();
+}
+
+// _LinkEntry
+void
+IconCache::_LinkEntry(Entry* entry)
+{
+	entry->previous = fLastEntry;
+	entry->next = NULL;
+	if (fLastEntry != NULL)
+		fLastEntry->next = entry;
+	else
+		fFirstEntry = entry;
+	fLastEntry = entry;
+}
+
+// _UnlinkEntry
+void
+IconCache::_UnlinkEntry(Entry* entry)
+{
+	if (entry->previous != NULL)
+		entry->previous->next = entry->next;
+	else
+		fFirstEntry = entry->next;
+	if (entry->next != NULL)
+		entry->next->previous = entry->previous;
+	else
+		fLastEntry = entry->previous;
+	entry->previous = NULL;
+	entry->next = NULL;
+}
+
+// _TrimMemory
+void
+IconCache::_TrimMemory()
+{
+	// The entry inserted last is kept, even if it alone is too large.
+	while (fMemoryBytes > kMaxMemoryBytes && fFirstEntry != fLastEntry) {
+		Entry* entry = fFirstEntry;
+		_UnlinkEntry(entry);
+		fTable->Remove(entry);
+		fMemoryBytes -= entry->key.BitsLength();
+		delete entry;
+	}
+}
+
+// _TrimDiskCache
+void
+IconCache::_TrimDiskCache()
+{
+	BString directoryPath;
+	{
+		AutoLocker<BLocker> locker(fLock);
+		directoryPath = fDiskCacheDirectory;
+	}
+
+	// Scanning and removing the files happens without holding the lock,
+	// fTrimmingDiskCache keeps other threads from doing the same.
+	BList files;
+	off_t totalBytes = 0;
+
+	BDirectory directory(directoryPath.String());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		BPath path;
+		struct stat st;
+		if (entry.GetPath(&path) != B_OK || stat(path.Path(), &st) != 0
+			|| !S_ISREG(st.st_mode)) {
+			continue;
+		}
+
+		cache_file* file = new(std::nothrow) cache_file;
+		if (file == NULL)
+			break;
+		file->path = path.Path();
+		file->modification_time = st.st_mtime;
+		file->size = st.st_size;
+		if (!files.AddItem(file)) {
+			delete file;
+			break;
+		}
+		totalBytes += st.st_size;
+	}
+
+	if (totalBytes > kMaxDiskCacheBytes) {
+		files.SortItems(compare_cache_files);
+		for (int32 i = 0; totalBytes > kTrimmedDiskCacheBytes
+				&& i < files.CountItems(); i++) {
+			const cache_file* file = (const cache_file*)files.ItemAtFast(i);
+			if (unlink(file->path.String()) == 0)
+				totalBytes -= file->size;
+		}
+	}
+
+	for (int32 i = 0; i < files.CountItems(); i++)
+		delete (cache_file*)files.ItemAtFast(i);
+
+	AutoLocker<BLocker> locker(fLock);
+	fDiskCacheBytes = totalBytes;
+	fTrimmingDiskCache = false;
+}
+
+// _PrewarmEntry
+/*static*/ status_t
+IconCache::_PrewarmEntry(void* cookie)
+{
+	reinterpret_cast<IconCache*>(cookie)->_Prewarm();
+	return B_OK;
+}
+
+// _Prewarm
+void
+IconCache::_Prewarm()
+{
+	while (true) {
+		PrewarmJob* job;
+		{
+			AutoLocker<BLocker> locker(fLock);
+			job = fFirstJob;
+			if (job == NULL) {
+				fPrewarmThread = -1;
+				return;
+			}
+			fFirstJob = job->next;
+			if (fFirstJob == NULL)
+				fLastJob = NULL;
+		}
+
+		BBitmap bitmap(BRect(0, 0, job->iconSize - 1, job->iconSize - 1),
+			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
+		if (bitmap.InitCheck() == B_OK)
+			GetVectorIcon(job->data, job->size, &bitmap);
+
+		delete job;
+	}
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef ICON_CACHE_H
+#define ICON_CACHE_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include "OpenHashTableHugo.h"
+
+class BBitmap;
+
+// A cache of rasterized vector icons. An icon is identified by a hash of its
+// flat icon data, the size of the bitmap it is rendered into and the display
+// scale, so each icon is imported and rendered only once per size and scale.
+// Renderings are kept in memory and, if a disk cache directory is set, also
+// written to disk, so that they survive until the next start of the
+// application. Both caches forget the renderings used least recently once
+// they grow too large.
+//
+// All methods are thread safe. The rendering itself happens outside of the
+// lock, which allows Prewarm() to render icons in the background while the
+// UI keeps asking for others.
+class IconCache {
+public:
+								IconCache();
+	virtual						~IconCache();
+
+	static	IconCache*			Default();
+
+			status_t			SetDiskCacheDirectory(const char* path);
+
+	// Renders the vector icon into the bitmap (scaled to the bitmap bounds),
+	// or copies the cached rendering. Bitmaps which are not B_RGBA32 are
+	// passed on to BIconUtils uncached.
+			status_t			GetVectorIcon(const uint8* data, size_t size,
+									BBitmap* bitmap);
+
+	// Renders the given vector icons of the application resources at the
+	// given size in a background thread, for example the icons of a panel
+	// which is likely to be shown next.
+			status_t			Prewarm(const int32* resourceIDs, int32 count,
+									int32 size);
+
+			void				MakeEmpty();
+
+private:
+			struct Key;
+			struct Entry;
+			struct EntryHashDefinition;
+			struct PrewarmJob;
+
+			typedef OpenHashTable<EntryHashDefinition> EntryTable;
+
+			Entry*				_Lookup(const Key& key);
+			Entry*				_LoadFromDisk(const Key& key);
+			void				_SaveToDisk(const Entry* entry);
+			void				_DiskCachePath(const Key& key,
+									BString& path);
+			void				_Insert(Entry* entry);
+			void				_LinkEntry(Entry* entry);
+			void				_UnlinkEntry(Entry* entry);
+			void				_TrimMemory();
+			void				_TrimDiskCache();
+
+	static	status_t			_PrewarmEntry(void* cookie);
+			void				_Prewarm();
+
+private:
+			BLocker				fLock;
+			EntryTable*			fTable;
+			// in the order of their last use, the most recent last
+			Entry*				fFirstEntry;
+			Entry*				fLastEntry;
+			size_t				fMemoryBytes;
+
+			BString				fDiskCacheDirectory;
+			// unknown (-1) until the disk cache is trimmed the first time
+			off_t				fDiskCacheBytes;
+			bool				fTrimmingDiskCache;
+
+			PrewarmJob*			fFirstJob;
+			PrewarmJob*			fLastJob;
+			thread_id			fPrewarmThread;
+};
+
+#endif // ICON_CACHE_H
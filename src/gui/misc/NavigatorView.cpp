@@ -74,6 +74,11 @@ NavigatorView::MessageReceived(BMessage* message)
 			if (message->FindRect("area", &area) == B_OK) {
 #if NAVIGATOR_VIEW_USE_BEAUTIFUL_DOWN_SCALING
 				BAutolock _(&fRescaleLock);
+				BRect nextArea;
+				for (int32 i = 1;
+					message->FindRect("area", i, &nextArea) == B_OK; i++) {
+					area = area | nextArea;
+				}
 				if (fDirtyDisplayArea.IsValid())
 					fDirtyDisplayArea = fDirtyDisplayArea | area;
 				else
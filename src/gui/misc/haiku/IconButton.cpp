@@ -28,8 +28,8 @@
 #include <Roster.h>
 #include <TranslationUtils.h>
 #include <Window.h>
-#include "IconUtils.h"
 
+#include "IconCache.h"
 #include "support.h"
 #include "support_ui.h"
 
@@ -370,22 +370,21 @@ IconButton::IsPressed() const
 status_t
 IconButton::SetIcon(int32 resourceID, int32 size)
 {
-	BResources resources;
-	status_t status = get_app_resources(resources);
-	if (status != B_OK)
-		return status;
+	BResources* resources = get_app_resources();
+	if (resources == NULL)
+		return B_ENTRY_NOT_FOUND;
 
 	size_t dataSize;
-	const void* data = resources.LoadResource(B_VECTOR_ICON_TYPE, resourceID,
+	const void* data = resources->LoadResource(B_VECTOR_ICON_TYPE, resourceID,
 		&dataSize);
 	if (data != NULL) {
 		BBitmap bitmap(BRect(0, 0, size - 1, size - 1),
 			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
-		status = bitmap.InitCheck();
+		status_t status = bitmap.InitCheck();
 		if (status != B_OK)
 			return status;
-		status = BIconUtils::GetVectorIcon(reinterpret_cast<const uint8*>(data),
-			dataSize, &bitmap);
+		status = IconCache::Default()->GetVectorIcon(
+			reinterpret_cast<const uint8*>(data), dataSize, &bitmap);
 		if (status != B_OK)
 			return status;
 		return SetIcon(&bitmap);
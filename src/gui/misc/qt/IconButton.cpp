@@ -6,9 +6,9 @@
 
 #include <Bitmap.h>
 #include <Control.h>
-#include <IconUtils.h>
 #include <Resources.h>
 
+#include "IconCache.h"
 #include "support.h"
 
 
@@ -123,23 +123,22 @@ IconButton::SetPressed(bool pressed)
 status_t
 IconButton::SetIcon(int32 resourceID, int32 size)
 {
-	BResources resources;
-	status_t status = get_app_resources(resources);
-	if (status != B_OK)
-		return status;
+	BResources* resources = get_app_resources();
+	if (resources == NULL)
+		return B_ENTRY_NOT_FOUND;
 
 	size_t dataSize;
-	const void* data = resources.LoadResource(B_VECTOR_ICON_TYPE, resourceID,
+	const void* data = resources->LoadResource(B_VECTOR_ICON_TYPE, resourceID,
 		&dataSize);
 	if (data != NULL) {
 		BBitmap bitmap(BRect(0, 0, size - 1, size - 1),
 			B_BITMAP_NO_SERVER_LINK, B_RGBA32);
-		status = bitmap.InitCheck();
+		status_t status = bitmap.InitCheck();
 		if (status != B_OK)
 			return status;
 
-		status = BIconUtils::GetVectorIcon(reinterpret_cast<const uint8*>(data),
-			dataSize, &bitmap);
+		status = IconCache::Default()->GetVectorIcon(
+			reinterpret_cast<const uint8*>(data), dataSize, &bitmap);
 		if (status != B_OK)
 			return status;
 		return SetIcon(&bitmap);
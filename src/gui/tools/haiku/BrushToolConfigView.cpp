@@ -9,7 +9,13 @@
 
 #include <CheckBox.h>
 #include <GroupLayoutBuilder.h>
+#include <List.h>
+#include <MenuField.h>
+#include <MenuItem.h>
+#include <Path.h>
+#include <PopUpMenu.h>
 #include <SeparatorView.h>
+#include <String.h>
 
 #include "BrushTool.h"
 #include "DualSlider.h"
@@ -30,6 +36,8 @@ enum {
 	MSG_SUBPIXELS			= 'sbpx',
 	MSG_SOLID				= 'slid',
 	MSG_TILT				= 'tilt',
+
+	MSG_MYPAINT_BRUSH		= 'mpbr',
 };
 
 // constructor
@@ -66,6 +74,31 @@ fSolid->SetEnabled(false);
 	fSubpixels->SetValue(B_CONTROL_ON);
 	fTilt->SetValue(B_CONTROL_ON);
 
+	// The MyPaint brushes replace the brush above, which is used as long
+	// as none of them is chosen.
+	BPopUpMenu* brushMenu = new BPopUpMenu("brush");
+	BMenuItem* item = new BMenuItem("Classic",
+		new BMessage(MSG_MYPAINT_BRUSH));
+	item->SetMarked(true);
+	brushMenu->AddItem(item);
+
+	BList brushPaths;
+	BrushTool::FindMyPaintBrushes(brushPaths);
+	if (!brushPaths.IsEmpty())
+		brushMenu->AddSeparatorItem();
+	for (int32 i = 0; i < brushPaths.CountItems(); i++) {
+		BString* path = (BString*)brushPaths.ItemAtFast(i);
+		BString name(BPath(path->String()).Leaf());
+		name.RemoveLast(".myb");
+		BMessage* message = new BMessage(MSG_MYPAINT_BRUSH);
+		message->AddString("path", *path);
+		brushMenu->AddItem(new BMenuItem(name.String(), message));
+		delete path;
+	}
+
+	fMyPaintBrushField = new BMenuField("mypaint brush", "MyPaint",
+		brushMenu);
+
 	BGroupLayoutBuilder(layout)
 		.Add(fOpacity)
 		.Add(fRadius)
@@ -79,6 +112,8 @@ fSolid->SetEnabled(false);
 			.End()
 			.Add(fSubpixels)
 		.End()
+		.Add(new BSeparatorView(B_VERTICAL, B_PLAIN_BORDER))
+		.Add(fMyPaintBrushField)
 		.SetInsets(5, 5, 5, 5)
 	;
 }
@@ -97,6 +132,7 @@ BrushToolConfigView::AttachedToWindow()
 	fSubpixels->SetTarget(this);
 	fSolid->SetTarget(this);
 	fTilt->SetTarget(this);
+	fMyPaintBrushField->Menu()->SetTargetForItems(this);
 }
 
 // MessageReceived
@@ -152,6 +188,15 @@ BrushToolConfigView::MessageReceived(BMessage* message)
 				fTilt->Value() == B_CONTROL_ON);
 			break;
 
+		case MSG_MYPAINT_BRUSH:
+		{
+			const char* path;
+			if (message->FindString("path", &path) != B_OK)
+				path = "";
+			Tool()->SetOption(BrushTool::MYPAINT_BRUSH, path);
+			break;
+		}
+
 		default:
 			ToolConfigView::MessageReceived(message);
 			break;
@@ -183,6 +228,7 @@ BrushToolConfigView::SetEnabled(bool enable)
 	fSubpixels->SetEnabled(enable);
 //	fSolid->SetEnabled(enable);
 	fTilt->SetEnabled(enable);
+	fMyPaintBrushField->SetEnabled(enable);
 }
 
 // #pragma mark -
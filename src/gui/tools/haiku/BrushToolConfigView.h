@@ -9,6 +9,7 @@
 #include "ToolConfigView.h"
 
 class BCheckBox;
+class BMenuField;
 class DualSlider;
 
 class BrushToolConfigView : public ToolConfigView {
@@ -38,6 +39,8 @@ private:
 			BCheckBox*			fSubpixels;
 			BCheckBox*			fSolid;
 			BCheckBox*			fTilt;
+
+			BMenuField*			fMyPaintBrushField;
 };
 
 #endif // BRUSH_TOOL_CONFIG_VIEW_H
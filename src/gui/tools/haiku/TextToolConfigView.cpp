@@ -24,6 +24,7 @@
 #include "Text.h"
 #include "TextTool.h"
 #include "TextToolState.h"
+#include "ui_defines.h"
 
 enum {
 	MSG_FONT_SELECTED		= 'fnsl',
@@ -168,7 +169,7 @@ TextToolConfigView::TextToolConfigView(::Tool* tool)
 
 	// text align left
 	IconButton* iconButton = new IconButton("text align left", 0);
-	iconButton->SetIcon(601, 16);
+	iconButton->SetIcon(kTextAlignLeftIcon, kToolConfigIconSize);
 	BMessage* alignmentMessage = new BMessage(MSG_SET_TEXT_ALIGNMENT);
 	alignmentMessage->AddInt32("alignment", TEXT_ALIGNMENT_LEFT);
 	iconButton->SetMessage(alignmentMessage);
@@ -176,7 +177,7 @@ TextToolConfigView::TextToolConfigView(::Tool* tool)
 
 	// text align center
 	iconButton = new IconButton("text align center", 1);
-	iconButton->SetIcon(602, 16);
+	iconButton->SetIcon(kTextAlignCenterIcon, kToolConfigIconSize);
 	alignmentMessage = new BMessage(MSG_SET_TEXT_ALIGNMENT);
 	alignmentMessage->AddInt32("alignment", TEXT_ALIGNMENT_CENTER);
 	iconButton->SetMessage(alignmentMessage);
@@ -184,7 +185,7 @@ TextToolConfigView::TextToolConfigView(::Tool* tool)
 
 	// text align right
 	iconButton = new IconButton("text align right", 2);
-	iconButton->SetIcon(603, 16);
+	iconButton->SetIcon(kTextAlignRightIcon, kToolConfigIconSize);
 	alignmentMessage = new BMessage(MSG_SET_TEXT_ALIGNMENT);
 	alignmentMessage->AddInt32("alignment", TEXT_ALIGNMENT_RIGHT);
 	iconButton->SetMessage(alignmentMessage);
@@ -192,7 +193,7 @@ TextToolConfigView::TextToolConfigView(::Tool* tool)
 
 	// text align justify
 	iconButton = new IconButton("text align justify", 3);
-	iconButton->SetIcon(604, 16);
+	iconButton->SetIcon(kTextAlignJustifyIcon, kToolConfigIconSize);
 	alignmentMessage = new BMessage(MSG_SET_TEXT_ALIGNMENT);
 	alignmentMessage->AddInt32("alignment", TEXT_ALIGNMENT_JUSTIFY);
 	iconButton->SetMessage(alignmentMessage);
@@ -1,7 +1,10 @@
 #include "BrushToolConfigView.h"
 #include "ui_BrushToolConfigView.h"
 
+#include <List.h>
 #include <Message.h>
+#include <Path.h>
+#include <String.h>
 
 #include "BrushTool.h"
 
@@ -54,6 +57,25 @@ fUi->spacingSlider->SetEnabled(false);
 		SLOT(_SolidChanged()));
 	connect(fUi->tiltCheckBox, SIGNAL(stateChanged(int)),
 		SLOT(_TiltChanged()));
+
+	// The MyPaint brushes replace the brush above, which is used as long
+	// as none of them is chosen.
+	fUi->myPaintBrushComboBox->addItem(QString::fromUtf8("Classic"),
+		QString());
+
+	BList brushPaths;
+	BrushTool::FindMyPaintBrushes(brushPaths);
+	for (int32 i = 0; i < brushPaths.CountItems(); i++) {
+		BString* path = (BString*)brushPaths.ItemAtFast(i);
+		BString name(BPath(path->String()).Leaf());
+		name.RemoveLast(".myb");
+		fUi->myPaintBrushComboBox->addItem(QString::fromUtf8(name.String()),
+			QString::fromUtf8(path->String()));
+		delete path;
+	}
+
+	connect(fUi->myPaintBrushComboBox, SIGNAL(currentIndexChanged(int)),
+		SLOT(_MyPaintBrushChanged(int)));
 }
 
 
@@ -148,6 +170,7 @@ BrushToolConfigView::SetEnabled(bool enable)
 	fUi->subpixelsCheckBox->setEnabled(enable);
 //	fUi->solidCheckBox->setEnabled(enable);
 	fUi->tiltCheckBox->setEnabled(enable);
+	fUi->myPaintBrushComboBox->setEnabled(enable);
 }
 
 // #pragma mark -
@@ -189,3 +212,12 @@ BrushToolConfigView::_TiltChanged()
 	Tool()->SetOption(BrushTool::TILT_CONTROLLED,
 		fUi->tiltCheckBox->isChecked());
 }
+
+
+void
+BrushToolConfigView::_MyPaintBrushChanged(int index)
+{
+	QByteArray path = fUi->myPaintBrushComboBox->itemData(index)
+		.toString().toUtf8();
+	Tool()->SetOption(BrushTool::MYPAINT_BRUSH, path.constData());
+}
@@ -35,6 +35,7 @@ private slots:
 			void				_SubpixelsChanged();
 			void				_SolidChanged();
 			void				_TiltChanged();
+			void				_MyPaintBrushChanged(int index);
 
 private:
 			Ui::BrushToolConfigView* fUi;
@@ -122,6 +122,23 @@ ArchiveVisitor::VisitFilterContrast(FilterContrast* contrast,
 	return status == B_OK;
 }
 
+bool
+ArchiveVisitor::VisitFilterDenoise(FilterDenoise* denoise, BMessage* context)
+{
+	status = context->AddString(kType, "FilterDenoise");
+	if (status == B_OK)
+		status = context->AddFloat("amplitude", denoise->Amplitude());
+	if (status == B_OK)
+		status = context->AddFloat("sharpness", denoise->Sharpness());
+	if (status == B_OK)
+		status = context->AddFloat("anisotropy", denoise->Anisotropy());
+	if (status == B_OK)
+		status = context->AddFloat("alpha", denoise->Alpha());
+	if (status == B_OK)
+		status = context->AddFloat("sigma", denoise->Sigma());
+	return status == B_OK;
+}
+
 bool
 ArchiveVisitor::VisitFilterDropShadow(FilterDropShadow* dropShadow,
 	BMessage* context)
@@ -176,9 +193,9 @@ ArchiveVisitor::VisitBrushStroke(BrushStroke* brushStroke, BMessage* context)
 	if (status == B_OK) {
 		BMessage strokeArchive;
 		const Stroke& stroke = brushStroke->Stroke();
-		int32 count = stroke.CountObjects();
+		int32 count = stroke.CountPoints();
 		for (int32 i = 0; i < count; i++) {
-			StrokePoint* point = stroke.ObjectAt(i);
+			const StrokePoint* point = stroke.PointAtFast(i);
 			status = strokeArchive.AddPoint("point", point->point);
 			if (status == B_OK) {
 				status = strokeArchive.AddFloat("pressure",
@@ -208,6 +225,49 @@ ArchiveVisitor::VisitImage(Image* image, BMessage* context)
 	return status == B_OK;
 }
 
+bool
+ArchiveVisitor::VisitMyPaintStroke(MyPaintStroke* stroke, BMessage* context)
+{
+	// Only the events are stored, the pixels are painted again when the
+	// stroke is imported.
+	status = context->AddString(kType, "MyPaintStroke");
+	if (status == B_OK)
+		status = context->AddString("brush", stroke->BrushSettings());
+
+	const rgb_color& color = stroke->Color();
+	if (status == B_OK)
+		status = context->AddUInt8("r", color.red);
+	if (status == B_OK)
+		status = context->AddUInt8("g", color.green);
+	if (status == B_OK)
+		status = context->AddUInt8("b", color.blue);
+
+	if (status == B_OK) {
+		BMessage strokeArchive;
+		int32 count = stroke->CountEvents();
+		for (int32 i = 0; i < count; i++) {
+			const MyPaintEvent& event = stroke->EventAtFast(i);
+			status = strokeArchive.AddPoint("point",
+				BPoint(event.x, event.y));
+			if (status == B_OK)
+				status = strokeArchive.AddFloat("pressure", event.pressure);
+			if (status == B_OK)
+				status = strokeArchive.AddFloat("tilt-x", event.tiltX);
+			if (status == B_OK)
+				status = strokeArchive.AddFloat("tilt-y", event.tiltY);
+			if (status == B_OK)
+				status = strokeArchive.AddDouble("dtime", event.deltaTime);
+			if (status != B_OK)
+				break;
+		}
+
+		if (status == B_OK)
+			status = context->AddMessage("stroke", &strokeArchive);
+	}
+
+	return status == B_OK;
+}
+
 bool
 ArchiveVisitor::VisitStyleable(Styleable* styleable, BMessage* context)
 {
@@ -39,6 +39,10 @@ public:
 									FilterContrast* contrast,
 									BMessage* context);
 
+	virtual	bool				VisitFilterDenoise(
+									FilterDenoise* denoise,
+									BMessage* context);
+
 	virtual	bool				VisitFilterDropShadow(
 									FilterDropShadow* dropShadow,
 									BMessage* context);
@@ -52,6 +56,9 @@ public:
 
 	virtual	bool				VisitImage(Image* image, BMessage* context);
 
+	virtual	bool				VisitMyPaintStroke(MyPaintStroke* stroke,
+									BMessage* context);
+
 	virtual	bool				VisitStyleable(Styleable* styleable,
 									BMessage* context);
 
@@ -21,12 +21,14 @@
 #include "Filter.h"
 #include "FilterBrightness.h"
 #include "FilterContrast.h"
+#include "FilterDenoise.h"
 #include "FilterDropShadow.h"
 #include "FilterSaturation.h"
 #include "Font.h"
 #include "Gradient.h"
 #include "Image.h"
 #include "Layer.h"
+#include "MyPaintStroke.h"
 #include "Object.h"
 #include "Paint.h"
 #include "RenderBuffer.h"
@@ -151,6 +153,9 @@ MessageImporter::ImportObject(const BMessage& archive) const
 	if (type == "FilterContrast")
 		return ImportFilterContrast(archive);
 		
+	if (type == "FilterDenoise")
+		return ImportFilterDenoise(archive);
+		
 	if (type == "FilterGaussianBlur")
 		return ImportFilterGaussianBlur(archive);
 		
@@ -166,6 +171,9 @@ MessageImporter::ImportObject(const BMessage& archive) const
 	if (type == "Layer")
 		return ImportLayer(archive);
 
+	if (type == "MyPaintStroke")
+		return ImportMyPaintStroke(archive);
+
 	if (type == "Rect")
 		return ImportRect(archive);
 
@@ -289,6 +297,29 @@ MessageImporter::ImportFilterContrast(const BMessage& archive) const
 	return BaseObjectRef(filter, true);
 }
 
+// ImportFilterDenoise
+BaseObjectRef
+MessageImporter::ImportFilterDenoise(const BMessage& archive) const
+{
+	FilterDenoise* filter = new(std::nothrow) FilterDenoise();
+	if (filter != NULL) {
+		float value;
+		if (archive.FindFloat("amplitude", &value) == B_OK)
+			filter->SetAmplitude(value);
+		if (archive.FindFloat("sharpness", &value) == B_OK)
+			filter->SetSharpness(value);
+		if (archive.FindFloat("anisotropy", &value) == B_OK)
+			filter->SetAnisotropy(value);
+		if (archive.FindFloat("alpha", &value) == B_OK)
+			filter->SetAlpha(value);
+		if (archive.FindFloat("sigma", &value) == B_OK)
+			filter->SetSigma(value);
+
+		_RestoreObject(filter, archive);
+	}
+	return BaseObjectRef(filter, true);
+}
+
 // ImportFilterGaussianBlur
 BaseObjectRef
 MessageImporter::ImportFilterGaussianBlur(const BMessage& archive) const
@@ -380,6 +411,59 @@ MessageImporter::ImportLayer(const BMessage& archive) const
 	return BaseObjectRef(layer, true);
 }
 
+// ImportMyPaintStroke
+BaseObjectRef
+MessageImporter::ImportMyPaintStroke(const BMessage& archive) const
+{
+	MyPaintStroke* stroke = new(std::nothrow) MyPaintStroke();
+	if (stroke != NULL) {
+		if (stroke->InitCheck() != B_OK) {
+			delete stroke;
+			return BaseObjectRef();
+		}
+
+		BString settings;
+		if (archive.FindString("brush", &settings) == B_OK
+			&& stroke->SetBrushSettings(settings.String()) != B_OK) {
+			fprintf(stderr, "MessageImporter::ImportMyPaintStroke() - "
+				"Failed to parse brush settings\n");
+		}
+
+		rgb_color color = kBlack;
+		archive.FindUInt8("r", &color.red);
+		archive.FindUInt8("g", &color.green);
+		archive.FindUInt8("b", &color.blue);
+		stroke->SetColor(color);
+
+		// Painting the events again gives the same pixels.
+		BMessage strokeArchive;
+		if (archive.FindMessage("stroke", &strokeArchive) == B_OK) {
+			for (int32 i = 0;; i++) {
+				BPoint point;
+				MyPaintEvent event;
+				if (strokeArchive.FindPoint("point", i, &point) != B_OK
+					|| strokeArchive.FindFloat("pressure", i,
+						&event.pressure) != B_OK
+					|| strokeArchive.FindFloat("tilt-x", i,
+						&event.tiltX) != B_OK
+					|| strokeArchive.FindFloat("tilt-y", i,
+						&event.tiltY) != B_OK
+					|| strokeArchive.FindDouble("dtime", i,
+						&event.deltaTime) != B_OK) {
+					break;
+				}
+				event.x = point.x;
+				event.y = point.y;
+				if (!stroke->AppendEvent(event))
+					break;
+			}
+		}
+
+		_RestoreBoundedObject(stroke, archive);
+	}
+	return BaseObjectRef(stroke, true);
+}
+
 // ImportRect
 BaseObjectRef
 MessageImporter::ImportRect(const BMessage& archive) const
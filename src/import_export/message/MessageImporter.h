@@ -37,6 +37,8 @@ public:
 									const BMessage& archive) const;
 			BaseObjectRef		ImportFilterContrast(
 									const BMessage& archive) const;
+			BaseObjectRef		ImportFilterDenoise(
+									const BMessage& archive) const;
 			BaseObjectRef		ImportFilterGaussianBlur(
 									const BMessage& archive) const;
 			BaseObjectRef		ImportFilterDropShadow(
@@ -47,6 +49,8 @@ public:
 									const BMessage& archive) const;
 			BaseObjectRef		ImportLayer(
 									const BMessage& archive) const;
+			BaseObjectRef		ImportMyPaintStroke(
+									const BMessage& archive) const;
 			BaseObjectRef		ImportRect(
 									const BMessage& archive) const;
 			BaseObjectRef		ImportShape(
@@ -257,6 +257,13 @@ public:
 		return true;
 	}
 
+	virtual bool VisitFilterDenoise(FilterDenoise* denoise,
+		Indentation* context)
+	{
+		_PrintIndented("Denoise", context);
+		return true;
+	}
+
 	virtual bool VisitFilterDropShadow(FilterDropShadow* dropShadow,
 		Indentation* context)
 	{
@@ -283,6 +290,13 @@ public:
 		return true;
 	}
 
+	virtual bool VisitMyPaintStroke(MyPaintStroke* stroke,
+		Indentation* context)
+	{
+		_PrintIndented("MyPaintStroke", context);
+		return true;
+	}
+
 	virtual bool VisitRect(Rect* rect, Indentation* context)
 	{
 		_PrintIndented("Rect", context);
@@ -11,10 +11,12 @@
 #include "Filter.h"
 #include "FilterBrightness.h"
 #include "FilterContrast.h"
+#include "FilterDenoise.h"
 #include "FilterDropShadow.h"
 #include "FilterSaturation.h"
 #include "Image.h"
 #include "Layer.h"
+#include "MyPaintStroke.h"
 #include "Object.h"
 #include "Styleable.h"
 #include "Shape.h"
@@ -65,6 +67,10 @@ public:
 		if (contrast != NULL)
 			return VisitFilterContrast(contrast, context);
 	
+		FilterDenoise* denoise = dynamic_cast<FilterDenoise*>(object);
+		if (denoise != NULL)
+			return VisitFilterDenoise(denoise, context);
+	
 		FilterDropShadow* dropShadow = dynamic_cast<FilterDropShadow*>(object);
 		if (dropShadow != NULL)
 			return VisitFilterDropShadow(dropShadow, context);
@@ -91,6 +97,11 @@ public:
 		Image* image = dynamic_cast<Image*>(boundedObject);
 		if (image != NULL)
 			return VisitImage(image, context);
+
+		MyPaintStroke* myPaintStroke
+			= dynamic_cast<MyPaintStroke*>(boundedObject);
+		if (myPaintStroke != NULL)
+			return VisitMyPaintStroke(myPaintStroke, context);
 	
 		return true;
 	}
@@ -112,6 +123,11 @@ public:
 		return true;
 	}
 
+	virtual bool VisitFilterDenoise(FilterDenoise* denoise, Context* context)
+	{
+		return true;
+	}
+
 	virtual bool VisitFilterDropShadow(FilterDropShadow* dropShadow,
 		Context* context)
 	{
@@ -134,6 +150,11 @@ public:
 		return true;
 	}
 
+	virtual bool VisitMyPaintStroke(MyPaintStroke* stroke, Context* context)
+	{
+		return true;
+	}
+
 	virtual bool VisitStyleable(Styleable* stylable, Context* context)
 	{
 		// Determine type of Styleable
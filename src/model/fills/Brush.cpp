@@ -397,7 +397,7 @@ Brush::Draw(BPoint where, float pressure, float tiltX, float tiltY,
 	RenderingBuffer buffer;
 	int width = constrainRect.IntegerWidth() + 1;
 	int height = constrainRect.IntegerHeight() + 1;
-	bits += (int32)constrainRect.left + (int32)constrainRect.top * bpr;
+	bits += (int32)constrainRect.left + (int64)constrainRect.top * bpr;
 	buffer.attach(bits, width, height, bpr);
 
 	// Rasterize the ellipse
@@ -407,7 +407,7 @@ Brush::Draw(BPoint where, float pressure, float tiltX, float tiltY,
 	rasterizer.clip_box(0, 0, width, height);
 	rasterizer.add_path(transformedEllipse);
 
-	agg::scanline_u8 scanlineU;
+	agg::scanline32_u8 scanlineU;
 
 	BrushPixelFormat pixelFormat(buffer);
 	pixelFormat.cover_scale(opacity);
@@ -1,5 +1,5 @@
 /*
- * Copyright 2009 Stephan Aßmus <superstippi@gmx.de>
+ * Copyright 2009-2018 Stephan Aßmus <superstippi@gmx.de>
  * All rights reserved.
  */
 
@@ -26,21 +26,24 @@ public:
 	SharedObject()
 		:
 		ObjectType(),
-		fCache(NULL)
+		fCache(NULL),
+		fCacheHash(0)
 	{
 	}
 
 	SharedObject(const ObjectType& object)
 		:
 		ObjectType(object),
-		fCache(NULL)
+		fCache(NULL),
+		fCacheHash(0)
 	{
 	}
 
 	SharedObject(const SharedObject& object)
 		:
 		ObjectType(object),
-		fCache(NULL)
+		fCache(NULL),
+		fCacheHash(0)
 	{
 	}
 
@@ -59,7 +62,7 @@ public:
 	SharedObject& operator=(const SharedObject& object)
 	{
 		ObjectType::operator=(object);
-		// Do not copy the fCache member!
+		// Do not copy the fCache and fCacheHash members!
 		return *this;
 	}
 
@@ -90,6 +93,18 @@ public:
 		return fCache;
 	}
 
+	void SetCacheHash(size_t hash)
+	{
+		fCacheHash = hash;
+	}
+
+	// The hash of the value at the time it was inserted into the cache.
+	// The value does not change while the object is in the cache.
+	size_t CacheHash() const
+	{
+		return fCacheHash;
+	}
+
 	LinkType* SharedObjectCacheLink()
 	{
 		return &fCacheLink;
@@ -98,27 +113,44 @@ public:
 private:
 	LinkType	fCacheLink;
 	CacheType*	fCache;
+	size_t		fCacheHash;
+};
+
+// A value together with its hash, so the hash is computed only once per
+// cache operation.
+template<typename ObjectType>
+struct SharedObjectCacheKey {
+	SharedObjectCacheKey(const ObjectType& object)
+		:
+		object(object),
+		hash(object.HashKey())
+	{
+	}
+
+	const ObjectType&	object;
+	size_t				hash;
 };
 
-template<typename ValueT>
+template<typename ObjectType>
 struct SharedObjectCacheHashDefinition {
-	typedef ValueT							ValueType;
-//	typedef ValueType::KeyType				KeyType;
-	typedef ValueT							KeyType;
+	typedef SharedObject<ObjectType>		ValueType;
+	typedef SharedObjectCacheKey<ObjectType>	KeyType;
 
 	size_t HashKey(const KeyType& key) const
 	{
-		return key.HashKey();
+		return key.hash;
 	}
 
 	size_t Hash(ValueType* value) const
 	{
-		return value->HashKey();
+		return value->CacheHash();
 	}
 
 	bool Compare(const KeyType& key, ValueType* value) const
 	{
-		return *value == key;
+		// Comparing the values can be expensive, gradients compare all
+		// their colors, for example.
+		return value->CacheHash() == key.hash && *value == key.object;
 	}
 
 	HashTableLink<ValueType>* GetLink(ValueType* value) const
@@ -128,34 +160,55 @@ struct SharedObjectCacheHashDefinition {
 };
 
 
+// The objects are distributed over several hash tables by their hash, each
+// with its own lock, so threads which intern different values rarely have
+// to wait for each other.
 template<typename ObjectType>
 class SharedObjectCache {
 public:
 	typedef SharedObject<ObjectType>	SharedObjectType;
 private:
-	typedef OpenHashTable<SharedObjectCacheHashDefinition<SharedObjectType> >
+	typedef OpenHashTable<SharedObjectCacheHashDefinition<ObjectType> >
 		HashTable;
 	typedef ObjectType	KeyType;
+	typedef SharedObjectCacheKey<ObjectType>	HashKeyType;
+
+	enum {
+		STRIPE_SHIFT	= 4,
+		STRIPE_COUNT	= 1 << STRIPE_SHIFT
+	};
+
+	struct Stripe {
+		Stripe()
+			:
+			lock("shared object cache lock")
+		{
+			table.Init();
+		}
+
+		BLocker		lock;
+		HashTable	table;
+	};
+
 public:
 	SharedObjectCache()
-		:
-		fLock("shared object cache lock")
 	{
-		fTable.Init();
 	}
 
 	SharedObjectType* Get(const KeyType& key)
 	{
-		AutoLocker<BLocker> _(fLock);
+		HashKeyType hashKey(key);
+		Stripe& stripe = _StripeFor(hashKey.hash);
+		AutoLocker<BLocker> _(stripe.lock);
 
-		SharedObjectType* object = fTable.Lookup(key);
+		SharedObjectType* object = stripe.table.Lookup(hashKey);
 		if (object != NULL) {
 			object->AddReference();
 			return object;
 		}
 		// Shared entry for this value/key does not yet exist.
 		object = new(std::nothrow) SharedObjectType(key);
-		if (object == NULL || _Insert(object) != B_OK) {
+		if (object == NULL || _Insert(stripe, object, hashKey.hash) != B_OK) {
 			delete object;
 			return NULL;
 		}
@@ -164,20 +217,19 @@ public:
 
 	bool Put(const KeyType& key)
 	{
-		AutoLocker<BLocker> _(fLock);
+		HashKeyType hashKey(key);
+		Stripe& stripe = _StripeFor(hashKey.hash);
+		AutoLocker<BLocker> _(stripe.lock);
 
-		SharedObjectType* object = fTable.Lookup(key);
-		return Put(object);
+		return _Put(stripe, stripe.table.Lookup(hashKey));
 	}
 
 	bool Put(SharedObjectType* object)
 	{
 		if (object != NULL) {
-			AutoLocker<BLocker> _(fLock);
-			if (object->CountReferences() == 1)
-				_Remove(object);
-			object->RemoveReference();
-			return true;
+			Stripe& stripe = _StripeFor(object->CacheHash());
+			AutoLocker<BLocker> _(stripe.lock);
+			return _Put(stripe, object);
 		}
 		return false;
 	}
@@ -185,13 +237,14 @@ public:
 	SharedObjectType* PrepareForModifications(SharedObjectType* object)
 	{
 		// Returns an object that is not part of the table.
-		AutoLocker<BLocker> _(fLock);
+		Stripe& stripe = _StripeFor(object->CacheHash());
+		AutoLocker<BLocker> _(stripe.lock);
 
 		if (object->Cache() != this)
 			debugger("PrepareForModifications(): Object not in cache");
 
 		if (object->CountReferences() == 1) {
-			_Remove(object);
+			_Remove(stripe, object);
 			return object;
 		}
 
@@ -203,8 +256,6 @@ public:
 
 	SharedObjectType* CommitModifications(SharedObjectType* object)
 	{
-		AutoLocker<BLocker> _(fLock);
-
 		if (object->Cache() == this)
 			debugger("CommitModifications(): Trying to insert object twice");
 		if (object->Cache() != NULL) {
@@ -212,12 +263,16 @@ public:
 				"belongs to another cache");
 		}
 
+		HashKeyType hashKey(*object);
+		Stripe& stripe = _StripeFor(hashKey.hash);
+		AutoLocker<BLocker> _(stripe.lock);
+
 		// Returns an object of the same value that is in the cache.
 		// If such an object was not already in the cache, the passed
 		// object is inserted.
-		SharedObjectType* cachedObject = fTable.Lookup(*object);
+		SharedObjectType* cachedObject = stripe.table.Lookup(hashKey);
 		if (cachedObject == NULL) {
-			if (_Insert(object) == B_OK)
+			if (_Insert(stripe, object, hashKey.hash) == B_OK)
 				return object;
 			// Return NULL on error.
 			return NULL;
@@ -231,12 +286,32 @@ public:
 
 	SharedObjectType* Lookup(const KeyType& key) const
 	{
-		AutoLocker<BLocker> _(fLock);
-		return fTable.Lookup(key);
+		HashKeyType hashKey(key);
+		Stripe& stripe = _StripeFor(hashKey.hash);
+		AutoLocker<BLocker> _(stripe.lock);
+		return stripe.table.Lookup(hashKey);
 	}
 
 private:
-	status_t _Insert(SharedObjectType* object)
+	Stripe& _StripeFor(size_t hash) const
+	{
+		// The hashes of the cached types don't use all of their bits,
+		// mix them before picking the stripe.
+		uint32 mixed = (uint32)hash * 2654435761U;
+		return fStripes[mixed >> (32 - STRIPE_SHIFT)];
+	}
+
+	bool _Put(Stripe& stripe, SharedObjectType* object)
+	{
+		if (object == NULL)
+			return false;
+		if (object->CountReferences() == 1 && object->Cache() == this)
+			_Remove(stripe, object);
+		object->RemoveReference();
+		return true;
+	}
+
+	status_t _Insert(Stripe& stripe, SharedObjectType* object, size_t hash)
 	{
 		if (object->Cache() == this)
 			debugger("Insert(): Trying to insert object twice");
@@ -245,20 +320,20 @@ private:
 				"another cache");
 		}
 
-		status_t ret = fTable.Insert(object);
+		object->SetCacheHash(hash);
+		status_t ret = stripe.table.Insert(object);
 		if (ret == B_OK)
 			object->SetCache(this);
 		return ret;
 	}
 
-	void _Remove(SharedObjectType* object)
+	void _Remove(Stripe& stripe, SharedObjectType* object)
 	{
-		fTable.Remove(object);
+		stripe.table.Remove(object);
 		object->SetCache(NULL);
 	}
 
-	HashTable	fTable;
-	BLocker		fLock;
+	mutable Stripe	fStripes[STRIPE_COUNT];
 };
 
 #endif // SHARED_OBJECT_CACHE_H
@@ -11,67 +11,17 @@
 #include "RenderBuffer.h"
 #include "RenderEngine.h"
 
-// constructor
-StrokePoint::StrokePoint()
-	: point(0.0f, 0.0f)
-	, pressure(1.0f)
-	, tiltX(0.0f)
-	, tiltY(0.0f)
-{
-}
-
-// constructor
-StrokePoint::StrokePoint(const BPoint& point, float pressure,
-		float tiltX, float tiltY)
-	: point(point)
-	, pressure(pressure)
-	, tiltX(tiltX)
-	, tiltY(tiltY)
-{
-}
-
-// constructor
-StrokePoint::StrokePoint(const StrokePoint& other)
-{
-	*this = other;
-}
-
-// operator=
-StrokePoint&
-StrokePoint::operator=(const StrokePoint& other)
-{
-	point = other.point;
-	pressure = other.pressure;
-	tiltX = other.tiltX;
-	tiltY = other.tiltY;
-
-	return *this;
-}
-
-// operator==
-bool
-StrokePoint::operator==(const StrokePoint& other) const
-{
-	return point == other.point
-		&& pressure == other.pressure
-		&& tiltX == other.tiltX
-		&& tiltY == other.tiltY;
-}
-
-// operator!=
-bool
-StrokePoint::operator!=(const StrokePoint& other) const
-{
-	return !(*this == other);
-}
-
-// #pragma mark -
-
 // constructor
 BrushStroke::BrushStroke()
 	: BoundedObject()
 	, fBrush(new(std::nothrow) ::Brush(), true)
 	, fPaint(new(std::nothrow) ::Paint((rgb_color){ 0, 0, 0, 255 }), true)
+	, fStroke()
+	, fBounds(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN)
+	, fBoundsPointCount(0)
+	, fBoundsMinRadius(0.0f)
+	, fBoundsMaxRadius(0.0f)
+	, fBoundsFlags(0)
 {
 	if (fPaint.Get() != NULL)
 		fPaint->AddListener(this);
@@ -83,6 +33,11 @@ BrushStroke::BrushStroke(const BrushStroke& other, CloneContext& context)
 	, fBrush()
 	, fPaint()
 	, fStroke(other.fStroke)
+	, fBounds(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN)
+	, fBoundsPointCount(0)
+	, fBoundsMinRadius(0.0f)
+	, fBoundsMaxRadius(0.0f)
+	, fBoundsFlags(0)
 {
 	context.Clone(other.fBrush.Get(), fBrush);
 	context.Clone(other.fPaint.Get(), fPaint);
@@ -150,18 +105,33 @@ BrushStroke::SetToPropertyObject(const PropertyObject* object, uint32 flags)
 bool
 BrushStroke::HitTest(const BPoint& canvasPoint)
 {
-	int32 count = fStroke.CountObjects();
+	int32 count = fStroke.CountPoints();
 	if (count == 0 || !TransformedBounds().Contains(canvasPoint))
 		return false;
 
 	BPoint objectPoint(canvasPoint);
 	Transformation().InverseTransform(&objectPoint);
 
-	const StrokePoint* previous = fStroke.ObjectAt(0);
 	const float radius = max_c(fBrush->MinRadius(), fBrush->MaxRadius());
-	if (count > 1) {
-		for (int32 i = 1; i < count; i++) {
-			const StrokePoint* current = fStroke.ObjectAt(i);
+	if (count == 1) {
+		float dist = point_point_distance(fStroke.PointAtFast(0)->point,
+			objectPoint);
+		return dist < radius;
+	}
+
+	// Only look at the segments of chunks which can contain the point.
+	int32 chunkCount = fStroke.CountChunks();
+	for (int32 chunk = 0; chunk < chunkCount; chunk++) {
+		BRect chunkBounds = fStroke.ChunkBounds(chunk);
+		chunkBounds.InsetBy(-radius, -radius);
+		if (!chunkBounds.Contains(objectPoint))
+			continue;
+
+		int32 first = max_c(1, chunk << Stroke::CHUNK_SIZE_SHIFT);
+		int32 last = min_c(count, (chunk + 1) << Stroke::CHUNK_SIZE_SHIFT);
+		const StrokePoint* previous = fStroke.PointAtFast(first - 1);
+		for (int32 i = first; i < last; i++) {
+			const StrokePoint* current = fStroke.PointAtFast(i);
 
 			float dist = point_stroke_distance(previous->point, current->point,
 				objectPoint, radius);
@@ -170,10 +140,6 @@ BrushStroke::HitTest(const BPoint& canvasPoint)
 
 			previous = current;
 		}
-	} else if (previous != NULL) {
-		float dist = point_point_distance(previous->point, objectPoint);
-		if (dist < radius)
-			return true;
 	}
 
 	return false;
@@ -185,14 +151,23 @@ BrushStroke::HitTest(const BPoint& canvasPoint)
 BRect
 BrushStroke::Bounds()
 {
-	BRect bounds(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
-
 	if (fBrush.Get() == NULL)
-		return bounds;
+		return BRect(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+
+	int32 count = fStroke.CountPoints();
+	if (fBoundsPointCount > count
+		|| fBoundsMinRadius != fBrush->MinRadius()
+		|| fBoundsMaxRadius != fBrush->MaxRadius()
+		|| fBoundsFlags != fBrush->Flags()) {
+		fBounds.Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+		fBoundsPointCount = 0;
+		fBoundsMinRadius = fBrush->MinRadius();
+		fBoundsMaxRadius = fBrush->MaxRadius();
+		fBoundsFlags = fBrush->Flags();
+	}
 
-	uint32 count = fStroke.CountObjects();
-	for (uint32 i = 0; i < count; i++) {
-		StrokePoint* point = fStroke.ObjectAtFast(i);
+	for (int32 i = fBoundsPointCount; i < count; i++) {
+		const StrokePoint* point = fStroke.PointAtFast(i);
 
 		float radius = fBrush->Radius(point->pressure);
 		BRect brushBounds(
@@ -201,9 +176,11 @@ BrushStroke::Bounds()
 			point->point.x + radius,
 			point->point.y + radius);
 
-		bounds = bounds | brushBounds;
+		fBounds = fBounds | brushBounds;
 	}
-	return bounds;
+	fBoundsPointCount = count;
+
+	return fBounds;
 }
 
 // #pragma mark -
@@ -253,14 +230,14 @@ bool
 BrushStroke::AppendPoint(const StrokePoint& point)
 {
 	BRect invalid(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
-	if (StrokePoint* lastPoint = fStroke.LastObject()) {
+	if (const StrokePoint* lastPoint = fStroke.LastPoint()) {
 		invalid.Set(lastPoint->point.x, lastPoint->point.y,
 			lastPoint->point.x, lastPoint->point.y);
 		float radius = fBrush->Radius(lastPoint->pressure);
 		invalid.InsetBy(-radius, -radius);
 	}
 
-	if (!fStroke.AppendObject(point)) {
+	if (!fStroke.AppendPoint(point)) {
 		fprintf(stderr, "BrushStroke::AppendPoint(): Failed to add "
 			"tracking point to BrushStroke. Out of memory\n");
 		return false;
@@ -275,7 +252,7 @@ BrushStroke::AppendPoint(const StrokePoint& point)
 			.InsetBySelf(-radius, -radius));
 
 	// Reset transformed bounds without invalidation, invalidate only
-	// changed region.
+	// changed region. Bounds() only needs to add the new point.
 	InitBounds();
 	UpdateChangeCounter();
 	Notify();
@@ -8,27 +8,8 @@
 #include "BoundedObject.h"
 #include "Brush.h"
 #include "Listener.h"
-#include "ObjectCache.h"
 #include "Paint.h"
-
-class StrokePoint {
-public:
-								StrokePoint();
-								StrokePoint(const BPoint& point,
-									float pressure, float tiltX, float tiltY);
-								StrokePoint(const StrokePoint& other);
-
-			StrokePoint&		operator=(const StrokePoint& other);
-			bool				operator==(const StrokePoint& other) const;
-			bool				operator!=(const StrokePoint& other) const;
-
-			BPoint				point;
-			float				pressure;
-			float				tiltX;
-			float				tiltY;
-};
-
-typedef ObjectCache<StrokePoint, false> Stroke;
+#include "Stroke.h"
 
 class BrushStroke : public BoundedObject, public Listener {
 public:
@@ -68,8 +49,6 @@ public:
 
 	inline	const ::Stroke&		Stroke() const
 									{ return fStroke; }
-	inline	::Stroke&			Stroke()
-									{ return fStroke; }
 
 			bool				AppendPoint(const StrokePoint& point);
 
@@ -77,6 +56,14 @@ private:
 			Reference< ::Brush>	fBrush;
 			Reference< ::Paint>	fPaint;
 			::Stroke			fStroke;
+
+			// Bounds() only adds the points appended since the last time,
+			// as long as the brush radius did not change.
+			BRect				fBounds;
+			int32				fBoundsPointCount;
+			float				fBoundsMinRadius;
+			float				fBoundsMaxRadius;
+			uint32				fBoundsFlags;
 };
 
 #endif // BRUSH_STROKE_H
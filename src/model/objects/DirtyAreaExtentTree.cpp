@@ -0,0 +1,137 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#include "DirtyAreaExtentTree.h"
+
+#include <new>
+
+static const int32 kMinCapacity = 16;
+
+// constructor
+DirtyAreaExtentTree::DirtyAreaExtentTree()
+	: fNodes(NULL)
+	, fCapacity(0)
+	, fCount(0)
+{
+}
+
+// destructor
+DirtyAreaExtentTree::~DirtyAreaExtentTree()
+{
+	delete[] fNodes;
+}
+
+// AddItem
+bool
+DirtyAreaExtentTree::AddItem(const DirtyAreaExtent& extent, int32 index)
+{
+	if (index < 0 || index > fCount)
+		return false;
+
+	if (fCount == fCapacity && !_Resize(max_c(kMinCapacity, fCapacity * 2)))
+		return false;
+
+	DirtyAreaExtent* leaves = fNodes + fCapacity;
+	for (int32 i = fCount; i > index; i--)
+		leaves[i] = leaves[i - 1];
+	leaves[index] = extent;
+	fCount++;
+
+	_UpdateParents(index, fCount - 1);
+	return true;
+}
+
+// RemoveItem
+void
+DirtyAreaExtentTree::RemoveItem(int32 index)
+{
+	if (index < 0 || index >= fCount)
+		return;
+
+	DirtyAreaExtent* leaves = fNodes + fCapacity;
+	for (int32 i = index; i < fCount - 1; i++)
+		leaves[i] = leaves[i + 1];
+	leaves[fCount - 1] = DirtyAreaExtent();
+
+	_UpdateParents(index, fCount - 1);
+	fCount--;
+}
+
+// SetItem
+void
+DirtyAreaExtentTree::SetItem(int32 index, const DirtyAreaExtent& extent)
+{
+	if (index < 0 || index >= fCount)
+		return;
+
+	fNodes[fCapacity + index] = extent;
+	_UpdateParents(index, index);
+}
+
+// MakeEmpty
+void
+DirtyAreaExtentTree::MakeEmpty()
+{
+	for (int32 i = 0; i < 2 * fCapacity; i++)
+		fNodes[i] = DirtyAreaExtent();
+	fCount = 0;
+}
+
+// SumFrom
+DirtyAreaExtent
+DirtyAreaExtentTree::SumFrom(int32 index) const
+{
+	DirtyAreaExtent sum;
+	if (index < 0)
+		index = 0;
+
+	int32 left = fCapacity + index;
+	int32 right = fCapacity + fCount;
+	while (left < right) {
+		if ((left & 1) != 0)
+			sum += fNodes[left++];
+		if ((right & 1) != 0)
+			sum += fNodes[--right];
+		left >>= 1;
+		right >>= 1;
+	}
+	return sum;
+}
+
+// #pragma mark -
+
+// _Resize
+bool
+DirtyAreaExtentTree::_Resize(int32 capacity)
+{
+	DirtyAreaExtent* nodes = new(std::nothrow) DirtyAreaExtent[2 * capacity];
+	if (nodes == NULL)
+		return false;
+
+	for (int32 i = 0; i < fCount; i++)
+		nodes[capacity + i] = fNodes[fCapacity + i];
+
+	delete[] fNodes;
+	fNodes = nodes;
+	fCapacity = capacity;
+
+	if (fCount > 0)
+		_UpdateParents(0, fCount - 1);
+	return true;
+}
+
+// _UpdateParents
+void
+DirtyAreaExtentTree::_UpdateParents(int32 first, int32 last)
+{
+	first += fCapacity;
+	last += fCapacity;
+	while (first > 1) {
+		first >>= 1;
+		last >>= 1;
+		for (int32 i = first; i <= last; i++)
+			fNodes[i] = fNodes[2 * i] + fNodes[2 * i + 1];
+	}
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#ifndef DIRTY_AREA_EXTENT_TREE_H
+#define DIRTY_AREA_EXTENT_TREE_H
+
+#include "Object.h"
+
+// A segment tree over the DirtyAreaExtents of the objects in a Layer. The
+// summed extent of all objects from some index to the top is available in
+// O(log n), changing the extent of one object costs O(log n) as well.
+// Inserting and removing costs O(n - index) just like for the object list.
+class DirtyAreaExtentTree {
+public:
+								DirtyAreaExtentTree();
+								~DirtyAreaExtentTree();
+
+			int32				CountItems() const
+									{ return fCount; }
+
+			bool				AddItem(const DirtyAreaExtent& extent,
+									int32 index);
+			void				RemoveItem(int32 index);
+			void				SetItem(int32 index,
+									const DirtyAreaExtent& extent);
+			void				MakeEmpty();
+
+	// The sum of the extents from index to the last one.
+			DirtyAreaExtent		SumFrom(int32 index) const;
+
+private:
+			bool				_Resize(int32 capacity);
+			void				_UpdateParents(int32 first, int32 last);
+
+			DirtyAreaExtent*	fNodes;
+				// fNodes[1] is the root, the children of fNodes[i] are at
+				// fNodes[2 * i] and fNodes[2 * i + 1], the leaves start at
+				// fNodes[fCapacity].
+			int32				fCapacity;
+			int32				fCount;
+};
+
+#endif // DIRTY_AREA_EXTENT_TREE_H
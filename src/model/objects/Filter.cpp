@@ -91,20 +91,14 @@ Filter::IsRegularTransformable() const
 	return false;
 }
 
-// ExtendDirtyArea
-void
-Filter::ExtendDirtyArea(BRect& area) const
+// GetDirtyAreaExtent
+DirtyAreaExtent
+Filter::GetDirtyAreaExtent() const
 {
-	// "area" is the dirty area "below" this object.
-	// This function should change the area so that
-	// it includes other pixels in the bitmap that are
-	// affected by this object, if pixels in the given
-	// "area" change.
-
 	float extend = ceilf(fFilterRadius * Transformation().Scale()) + 3;
 		// + 1 to be on the save side with regards
 		// to pixel indices versus areas...
-	area.InsetBy(-extend, -extend);
+	return DirtyAreaExtent(extend, extend, extend, extend);
 }
 
 // SetFilterRadius
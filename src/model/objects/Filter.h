@@ -28,7 +28,7 @@ public:
 
 	virtual	bool				IsRegularTransformable() const;
 
-	virtual	void				ExtendDirtyArea(BRect& area) const;
+	virtual	DirtyAreaExtent		GetDirtyAreaExtent() const;
 
 	// Filter
 			void				SetFilterRadius(float filterRadius);
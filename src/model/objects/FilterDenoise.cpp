@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#include "FilterDenoise.h"
+
+#include <new>
+
+#include "DenoiseFilter.h"
+#include "FilterDenoiseSnapshot.h"
+
+// constructor
+FilterDenoise::FilterDenoise()
+	: Object()
+{
+	DenoiseParameters parameters;
+	fAmplitude = parameters.amplitude;
+	fSharpness = parameters.sharpness;
+	fAnisotropy = parameters.anisotropy;
+	fAlpha = parameters.alpha;
+	fSigma = parameters.sigma;
+}
+
+// constructor
+FilterDenoise::FilterDenoise(const FilterDenoise& other)
+	: Object(other)
+	, fAmplitude(other.fAmplitude)
+	, fSharpness(other.fSharpness)
+	, fAnisotropy(other.fAnisotropy)
+	, fAlpha(other.fAlpha)
+	, fSigma(other.fSigma)
+{
+}
+
+// destructor
+FilterDenoise::~FilterDenoise()
+{
+}
+
+// #pragma mark - BaseObject
+
+// Clone
+BaseObject*
+FilterDenoise::Clone(CloneContext& context) const
+{
+	return new(std::nothrow) FilterDenoise(*this);
+}
+
+// DefaultName
+const char*
+FilterDenoise::DefaultName() const
+{
+	return "Denoise";
+}
+
+// AddProperties
+void
+FilterDenoise::AddProperties(PropertyObject* object, uint32 flags) const
+{
+	Object::AddProperties(object, flags);
+
+	object->AddProperty(new (std::nothrow) FloatProperty(
+		PROPERTY_DENOISE_AMPLITUDE, fAmplitude, 0.0f, 500.0f));
+	object->AddProperty(new (std::nothrow) FloatProperty(
+		PROPERTY_DENOISE_SHARPNESS, fSharpness, 0.0f, 5.0f));
+	object->AddProperty(new (std::nothrow) FloatProperty(
+		PROPERTY_DENOISE_ANISOTROPY, fAnisotropy, 0.0f, 1.0f));
+	object->AddProperty(new (std::nothrow) FloatProperty(
+		PROPERTY_DENOISE_ALPHA, fAlpha, 0.0f, 20.0f));
+	object->AddProperty(new (std::nothrow) FloatProperty(
+		PROPERTY_DENOISE_SIGMA, fSigma, 0.0f, 20.0f));
+}
+
+// SetToPropertyObject
+bool
+FilterDenoise::SetToPropertyObject(const PropertyObject* object, uint32 flags)
+{
+	AutoNotificationSuspender _(this);
+	Object::SetToPropertyObject(object, flags);
+
+	SetAmplitude(object->Value(PROPERTY_DENOISE_AMPLITUDE, fAmplitude));
+	SetSharpness(object->Value(PROPERTY_DENOISE_SHARPNESS, fSharpness));
+	SetAnisotropy(object->Value(PROPERTY_DENOISE_ANISOTROPY, fAnisotropy));
+	SetAlpha(object->Value(PROPERTY_DENOISE_ALPHA, fAlpha));
+	SetSigma(object->Value(PROPERTY_DENOISE_SIGMA, fSigma));
+
+	return HasPendingNotifications();
+}
+
+// #pragma mark -
+
+// Snapshot
+ObjectSnapshot*
+FilterDenoise::Snapshot() const
+{
+	return new (std::nothrow) FilterDenoiseSnapshot(this);
+}
+
+// #pragma mark -
+
+// IsRegularTransformable
+bool
+FilterDenoise::IsRegularTransformable() const
+{
+	return false;
+}
+
+// GetDirtyAreaExtent
+DirtyAreaExtent
+FilterDenoise::GetDirtyAreaExtent() const
+{
+	DenoiseParameters parameters;
+	parameters.amplitude = fAmplitude;
+	parameters.alpha = fAlpha;
+	parameters.sigma = fSigma;
+
+	float extend = DenoiseFilter::ExtentFor(
+		parameters.Scaled(Transformation().Scale())) + 3;
+		// + 1 to be on the save side with regards
+		// to pixel indices versus areas...
+	return DirtyAreaExtent(extend, extend, extend, extend);
+}
+
+// SetAmplitude
+void
+FilterDenoise::SetAmplitude(float amplitude)
+{
+	_SetMember(fAmplitude, amplitude);
+}
+
+// SetSharpness
+void
+FilterDenoise::SetSharpness(float sharpness)
+{
+	_SetMember(fSharpness, sharpness);
+}
+
+// SetAnisotropy
+void
+FilterDenoise::SetAnisotropy(float anisotropy)
+{
+	_SetMember(fAnisotropy, anisotropy);
+}
+
+// SetAlpha
+void
+FilterDenoise::SetAlpha(float alpha)
+{
+	_SetMember(fAlpha, alpha);
+}
+
+// SetSigma
+void
+FilterDenoise::SetSigma(float sigma)
+{
+	_SetMember(fSigma, sigma);
+}
+
+// #pragma mark -
+
+// _SetMember
+void
+FilterDenoise::_SetMember(float& member, float value)
+{
+	if (member == value)
+		return;
+
+	member = value;
+
+	UpdateChangeCounter();
+	InvalidateParent();
+	Notify();
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#ifndef FILTER_DENOISE_H
+#define FILTER_DENOISE_H
+
+#include "Object.h"
+
+class FilterDenoise : public Object {
+public:
+								FilterDenoise();
+								FilterDenoise(const FilterDenoise& other);
+	virtual						~FilterDenoise();
+
+	// BaseObject interface
+	virtual	BaseObject*			Clone(CloneContext& context) const;
+	virtual	const char*			DefaultName() const;
+	virtual	void				AddProperties(PropertyObject* object,
+									uint32 flags = 0) const;
+	virtual	bool				SetToPropertyObject(
+									const PropertyObject* object,
+									uint32 flags = 0);
+
+	// Object interface
+	virtual	ObjectSnapshot*		Snapshot() const;
+
+	virtual	bool				IsRegularTransformable() const;
+
+	virtual	DirtyAreaExtent		GetDirtyAreaExtent() const;
+
+	// FilterDenoise
+			void				SetAmplitude(float amplitude);
+	inline	float				Amplitude() const
+									{ return fAmplitude; }
+
+			void				SetSharpness(float sharpness);
+	inline	float				Sharpness() const
+									{ return fSharpness; }
+
+			void				SetAnisotropy(float anisotropy);
+	inline	float				Anisotropy() const
+									{ return fAnisotropy; }
+
+			void				SetAlpha(float alpha);
+	inline	float				Alpha() const
+									{ return fAlpha; }
+
+			void				SetSigma(float sigma);
+	inline	float				Sigma() const
+									{ return fSigma; }
+
+private:
+			void				_SetMember(float& member, float value);
+
+private:
+ 			float				fAmplitude;
+ 			float				fSharpness;
+ 			float				fAnisotropy;
+ 			float				fAlpha;
+ 			float				fSigma;
+};
+
+#endif // FILTER_DENOISE_H
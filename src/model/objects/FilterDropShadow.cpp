@@ -136,25 +136,22 @@ FilterDropShadow::IsRegularTransformable() const
 	return false;
 }
 
-// ExtendDirtyArea
-void
-FilterDropShadow::ExtendDirtyArea(BRect& area) const
+// GetDirtyAreaExtent
+DirtyAreaExtent
+FilterDropShadow::GetDirtyAreaExtent() const
 {
-	// "area" is the dirty area "below" this object.
-	// This function should change the area so that
-	// it includes other pixels in the bitmap that are
-	// affected by this object, if pixels in the given
-	// "area" change.
 	if (fOpacity <= 0.0f)
-		return;
+		return DirtyAreaExtent();
 
 	float extend = ceilf(fFilterRadius * Transformation().Scale()) + 3;
 		// + 1 to be on the save side with regards
 		// to pixel indices versus areas...
-	BRect target(area);
-	target.OffsetBy(fOffsetX, fOffsetY);
-	target.InsetBy(-extend, -extend);
-	area = area | target;
+
+	// The area united with the shadow of the area, which is the area
+	// offset and then extended by the blur.
+	return DirtyAreaExtent(max_c(0.0f, extend - fOffsetX),
+		max_c(0.0f, extend - fOffsetY), max_c(0.0f, extend + fOffsetX),
+		max_c(0.0f, extend + fOffsetY));
 }
 
 // SetFilterRadius
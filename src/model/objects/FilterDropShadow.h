@@ -31,7 +31,7 @@ public:
 
 	virtual	bool				IsRegularTransformable() const;
 
-	virtual	void				ExtendDirtyArea(BRect& area) const;
+	virtual	DirtyAreaExtent		GetDirtyAreaExtent() const;
 
 	// FilterDropShadow
 			void				SetFilterRadius(float filterRadius);
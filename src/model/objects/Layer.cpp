@@ -88,13 +88,56 @@ Layer::Listener::ListenerAttached(Layer* layer)
 
 // #pragma mark -
 
+// Iterates the listeners of a layer without copying the list. Listeners
+// which are removed while a dispatch is in progress leave a NULL slot, which
+// is compacted when the last dispatch is done. Listeners which are added
+// while dispatching are not notified in the running dispatch.
+class Layer::ListenerDispatch {
+public:
+	ListenerDispatch(Layer* layer)
+		: fLayer(layer)
+		, fCount(layer->fListeners.CountItems())
+	{
+		fLayer->fListenerDispatchDepth++;
+	}
+
+	~ListenerDispatch()
+	{
+		if (--fLayer->fListenerDispatchDepth > 0 || !fLayer->fListenersRemoved)
+			return;
+
+		while (fLayer->fListeners.RemoveItem((void*)NULL)) {
+		}
+		fLayer->fListenersRemoved = false;
+	}
+
+	int32 CountListeners() const
+	{
+		return fCount;
+	}
+
+	Listener* ListenerAt(int32 index) const
+	{
+		// NULL if the listener has been removed in the meantime
+		return (Listener*)fLayer->fListeners.ItemAtFast(index);
+	}
+
+private:
+	Layer*	fLayer;
+	int32	fCount;
+};
+
 // constructor
 Layer::Layer(const BRect& bounds)
 	: fBounds(bounds)
 	, fGlobalAlpha(255)
 	, fBlendingMode(CompOpSrcOver)
 	, fObjects(64)
+	, fDirtyAreaExtents()
+	, fDirtyAreaExtentsValid(true)
 	, fListeners(8)
+	, fListenerDispatchDepth(0)
+	, fListenersRemoved(false)
 {
 }
 
@@ -103,6 +146,7 @@ Layer::~Layer()
 {
 	for (int32 i = fObjects.CountItems() - 1; i >= 0; i--) {
 		Object* object = (Object*)fObjects.ItemAtFast(i);
+		object->fIndex = -1;
 		object->RemoveReference();
 	}
 }
@@ -214,6 +258,8 @@ void
 Layer::TransformationChanged()
 {
 	NotifyListeners();
+	// The extents of the objects depend on the scale of the transformation.
+	fDirtyAreaExtentsValid = false;
 	// Override the Object version, which invalidates the whole parent,
 	// to invalidate ourselves
 	UpdateChangeCounter();
@@ -279,28 +325,33 @@ bool
 Layer::AddObject(Object* object, int32 index)
 {
 //printf("%p->Layer::AddObject(%p, %ld)\n", this, object, index);
-	if (object && fObjects.AddItem(object, index)) {
-		object->AddReference();
+	if (object == NULL || !fObjects.AddItem(object, index))
+		return false;
+
+	if (!fDirtyAreaExtents.AddItem(DirtyAreaExtent(), index))
+		fDirtyAreaExtentsValid = false;
+	_UpdateObjectIndices(index);
+
+	object->AddReference();
 
-		BList listeners(fListeners);
-		int32 count = listeners.CountItems();
-		for (int32 i = 0; i < count; i++) {
-			Listener* listener = (Listener*)listeners.ItemAtFast(i);
+	ListenerDispatch dispatch(this);
+	for (int32 i = 0; i < dispatch.CountListeners(); i++) {
+		if (Listener* listener = dispatch.ListenerAt(i))
 			listener->ObjectAdded(this, object, index);
-		}
+	}
 
-		UpdateChangeCounter();
-		object->SetParent(this);
+	UpdateChangeCounter();
+	object->SetParent(this);
+	// The extent may depend on the transformation inherited from us.
+	fDirtyAreaExtents.SetItem(index, object->GetDirtyAreaExtent());
 
-		BoundedObject* boundedObject = dynamic_cast<BoundedObject*>(object);
-		if (boundedObject != NULL)
-			boundedObject->UpdateBounds();
-		else
-			Invalidate(Bounds(), index);
+	BoundedObject* boundedObject = dynamic_cast<BoundedObject*>(object);
+	if (boundedObject != NULL)
+		boundedObject->UpdateBounds();
+	else
+		Invalidate(Bounds(), index);
 
-		return true;
-	}
-	return false;
+	return true;
 }
 
 // RemoveObject
@@ -326,11 +377,14 @@ Layer::RemoveObject(int32 index)
 			return NULL;
 		}
 
-		BList listeners(fListeners);
-		int32 count = listeners.CountItems();
-		for (int32 i = 0; i < count; i++) {
-			Listener* listener = (Listener*)listeners.ItemAtFast(i);
-			listener->ObjectRemoved(this, object, index);
+		object->fIndex = -1;
+		fDirtyAreaExtents.RemoveItem(index);
+		_UpdateObjectIndices(index);
+
+		ListenerDispatch dispatch(this);
+		for (int32 i = 0; i < dispatch.CountListeners(); i++) {
+			if (Listener* listener = dispatch.ListenerAt(i))
+				listener->ObjectRemoved(this, object, index);
 		}
 
 		Invalidate(invalidArea, index);
@@ -364,6 +418,13 @@ Layer::ObjectAtFast(int32 index) const
 int32
 Layer::IndexOf(Object* object) const
 {
+	if (object == NULL)
+		return -1;
+	// The index is maintained for our own objects, but an object may be
+	// removed from us before its parent is reset.
+	int32 index = object->fIndex;
+	if (index >= 0 && index < CountObjects() && ObjectAtFast(index) == object)
+		return index;
 	return fObjects.IndexOf(object);
 }
 
@@ -378,7 +439,7 @@ Layer::CountObjects() const
 bool
 Layer::HasObject(Object* object) const
 {
-	return fObjects.HasItem(object);
+	return IndexOf(object) >= 0;
 }
 
 // CloneObjects
@@ -402,11 +463,10 @@ Layer::CloneObjects(Layer* target, CloneContext& context) const
 void
 Layer::SuspendUpdates(bool suspend)
 {
-	BList listeners(fListeners);
-	int32 count = listeners.CountItems();
-	for (int32 i = 0; i < count; i++) {
-		Listener* listener = (Listener*)listeners.ItemAtFast(i);
-		listener->SuspendUpdates(suspend);
+	ListenerDispatch dispatch(this);
+	for (int32 i = 0; i < dispatch.CountListeners(); i++) {
+		if (Listener* listener = dispatch.ListenerAt(i))
+			listener->SuspendUpdates(suspend);
 	}
 }
 
@@ -417,28 +477,36 @@ Layer::Invalidate(const BRect& area, int32 objectIndex)
 	// calculate the *visually changed area* from the lowest
 	// changed object to the top object, giving each object
 	// a chance to extend the area
-	BRect visuallyChangedArea = area;
-	int32 count = CountObjects();
-	for (int32 i = objectIndex; i < count; i++) {
-		Object* object = ObjectAtFast(i);
-		object->ExtendDirtyArea(visuallyChangedArea);
+	if (objectIndex < 0)
+		objectIndex = 0;
+
+	_ValidateDirtyAreaExtents();
+	if (objectIndex < CountObjects()) {
+		// The object at the index is usually the one which changed and
+		// invalidates, so its extent may have changed, too.
+		fDirtyAreaExtents.SetItem(objectIndex,
+			ObjectAtFast(objectIndex)->GetDirtyAreaExtent());
 	}
 
+	BRect visuallyChangedArea = area;
+	fDirtyAreaExtents.SumFrom(objectIndex).ExtendArea(visuallyChangedArea);
+
 	// notify listeners
-	BList listeners(fListeners);
-	count = listeners.CountItems();
+	ListenerDispatch dispatch(this);
+	int32 count = dispatch.CountListeners();
 	for (int32 i = 0; i < count; i++) {
-		Listener* listener = (Listener*)listeners.ItemAtFast(i);
-		listener->SuspendUpdates(true);
-		listener->AreaInvalidated(this, visuallyChangedArea);
+		if (Listener* listener = dispatch.ListenerAt(i)) {
+			listener->SuspendUpdates(true);
+			listener->AreaInvalidated(this, visuallyChangedArea);
+		}
 	}
 
 	if (Parent())
 		Parent()->Invalidate(visuallyChangedArea, Parent()->IndexOf(this));
 
 	for (int32 i = 0; i < count; i++) {
-		Listener* listener = (Listener*)listeners.ItemAtFast(i);
-		listener->SuspendUpdates(false);
+		if (Listener* listener = dispatch.ListenerAt(i))
+			listener->SuspendUpdates(false);
 	}
 }
 
@@ -449,12 +517,15 @@ Layer::ObjectChanged(Object* object)
 	int32 index = IndexOf(object);
 	if (index < 0)
 		return;
+
+	if (fDirtyAreaExtentsValid)
+		fDirtyAreaExtents.SetItem(index, object->GetDirtyAreaExtent());
+
 	// notify listeners
-	BList listeners(fListeners);
-	int32 count = listeners.CountItems();
-	for (int32 i = 0; i < count; i++) {
-		Listener* listener = (Listener*)listeners.ItemAtFast(i);
-		listener->ObjectChanged(this, object, index);
+	ListenerDispatch dispatch(this);
+	for (int32 i = 0; i < dispatch.CountListeners(); i++) {
+		if (Listener* listener = dispatch.ListenerAt(i))
+			listener->ObjectChanged(this, object, index);
 	}
 }
 
@@ -489,7 +560,7 @@ Layer::HitTest(const BPoint& canvasPoint, Layer** _layer, Object** _object,
 bool
 Layer::AddListener(Listener* listener)
 {
-	if (!listener || fListeners.HasItem(listener))
+	if (listener == NULL || fListeners.HasItem(listener))
 		return false;
 	if (!fListeners.AddItem(listener))
 		return false;
@@ -501,7 +572,17 @@ Layer::AddListener(Listener* listener)
 void
 Layer::RemoveListener(Listener* listener)
 {
-	fListeners.RemoveItem(listener);
+	if (fListenerDispatchDepth == 0) {
+		fListeners.RemoveItem(listener);
+		return;
+	}
+
+	// Keep the indices stable for the running dispatches.
+	int32 index = fListeners.IndexOf(listener);
+	if (index >= 0) {
+		fListeners.ReplaceItem(index, NULL);
+		fListenersRemoved = true;
+	}
 }
 
 // AddListenerRecursive
@@ -600,3 +681,32 @@ Layer::SetBlendingMode(::BlendingMode blendingMode)
 	Notify();
 }
 
+// #pragma mark - private
+
+// _UpdateObjectIndices
+void
+Layer::_UpdateObjectIndices(int32 first)
+{
+	int32 count = CountObjects();
+	for (int32 i = first; i < count; i++)
+		ObjectAtFast(i)->fIndex = i;
+}
+
+// _ValidateDirtyAreaExtents
+void
+Layer::_ValidateDirtyAreaExtents()
+{
+	int32 count = CountObjects();
+	if (fDirtyAreaExtentsValid && fDirtyAreaExtents.CountItems() == count)
+		return;
+
+	fDirtyAreaExtents.MakeEmpty();
+	fDirtyAreaExtentsValid = true;
+	for (int32 i = 0; i < count; i++) {
+		if (!fDirtyAreaExtents.AddItem(ObjectAtFast(i)->GetDirtyAreaExtent(),
+				i)) {
+			fDirtyAreaExtentsValid = false;
+			break;
+		}
+	}
+}
@@ -10,6 +10,7 @@
 #include <Rect.h>
 
 #include "BlendingMode.h"
+#include "DirtyAreaExtentTree.h"
 #include "Object.h"
 
 class Layer : public Object {
@@ -105,13 +106,25 @@ public:
 			::BlendingMode		BlendingMode() const
 									{ return fBlendingMode; }
 
+private:
+			class ListenerDispatch;
+			friend class ListenerDispatch;
+
+			void				_UpdateObjectIndices(int32 first);
+			void				_ValidateDirtyAreaExtents();
+
 private:
 			BRect				fBounds;
 			uint8				fGlobalAlpha;
 			::BlendingMode		fBlendingMode;
 
 			BList				fObjects;
+			DirtyAreaExtentTree	fDirtyAreaExtents;
+			bool				fDirtyAreaExtentsValid;
+
 			BList				fListeners;
+			int32				fListenerDispatchDepth;
+			bool				fListenersRemoved;
 };
 
 #endif // LAYER_H
@@ -0,0 +1,353 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#include "MyPaintStroke.h"
+
+#include <new>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Color.h"
+#include "CommonPropertyIDs.h"
+#include "MyPaintBrush.h"
+#include "MyPaintStrokeSnapshot.h"
+#include "TiledSurface.h"
+#include "ui_defines.h"
+
+// constructor
+MyPaintStroke::MyPaintStroke()
+	: BoundedObject()
+	, fBrushSettings()
+	, fColorProvider(new(std::nothrow) ::Color(kBlack), true)
+	, fColor(kBlack)
+	, fBrush(new(std::nothrow) MyPaintBrush())
+	, fSurface(new(std::nothrow) TiledSurface())
+	, fEvents(NULL)
+	, fEventCount(0)
+	, fEventsAllocated(0)
+{
+	if (fColorProvider.Get() != NULL)
+		fColorProvider->AddListener(this);
+	if (fBrush != NULL)
+		fBrush->SetColor(fColor);
+}
+
+// constructor
+MyPaintStroke::MyPaintStroke(const MyPaintStroke& other,
+		CloneContext& context)
+	: BoundedObject(other)
+	, fBrushSettings(other.fBrushSettings)
+	, fColorProvider()
+	, fColor(other.fColor)
+	, fBrush(new(std::nothrow) MyPaintBrush())
+	, fSurface(NULL)
+	, fEvents(NULL)
+	, fEventCount(0)
+	, fEventsAllocated(0)
+{
+	// The copy shares the tiles with the other surface. The brush starts
+	// with a new stroke, should events be appended to the copy.
+	if (other.fSurface != NULL)
+		fSurface = new(std::nothrow) TiledSurface(*other.fSurface);
+
+	// The color is shared or copied as the context decides, the tiles
+	// stay valid as long as it gives the same color.
+	if (other.fColorProvider.Get() != NULL)
+		context.Clone(other.fColorProvider.Get(), fColorProvider);
+	if (fColorProvider.Get() != NULL) {
+		fColorProvider->AddListener(this);
+		fColor = fColorProvider->GetColor();
+	}
+
+	if (fBrush != NULL) {
+		fBrush->SetTo(fBrushSettings.String());
+		fBrush->SetColor(fColor);
+	}
+
+	if (other.fEventCount > 0) {
+		fEvents = (MyPaintEvent*)malloc(
+			other.fEventCount * sizeof(MyPaintEvent));
+		if (fEvents != NULL) {
+			memcpy(fEvents, other.fEvents,
+				other.fEventCount * sizeof(MyPaintEvent));
+			fEventCount = other.fEventCount;
+			fEventsAllocated = other.fEventCount;
+		}
+	}
+}
+
+// destructor
+MyPaintStroke::~MyPaintStroke()
+{
+	if (fColorProvider.Get() != NULL)
+		fColorProvider->RemoveListener(this);
+
+	delete fBrush;
+	delete fSurface;
+	free(fEvents);
+}
+
+// #pragma mark -
+
+// Clone
+BaseObject*
+MyPaintStroke::Clone(CloneContext& context) const
+{
+	return new(std::nothrow) MyPaintStroke(*this, context);
+}
+
+// DefaultName
+const char*
+MyPaintStroke::DefaultName() const
+{
+	return "Paint stroke";
+}
+
+// #pragma mark -
+
+// Snapshot
+ObjectSnapshot*
+MyPaintStroke::Snapshot() const
+{
+	return new(std::nothrow) MyPaintStrokeSnapshot(this);
+}
+
+// AddProperties
+void
+MyPaintStroke::AddProperties(PropertyObject* object, uint32 flags) const
+{
+	BoundedObject::AddProperties(object, flags);
+
+	if (fColorProvider.Get() != NULL) {
+		fColorProvider->AddProperties(object,
+			flags | BaseObject::DONT_ADD_NAME);
+	}
+}
+
+// SetToPropertyObject
+bool
+MyPaintStroke::SetToPropertyObject(const PropertyObject* object, uint32 flags)
+{
+	AutoNotificationSuspender _(this);
+
+	BoundedObject::SetToPropertyObject(object, flags);
+
+	// The provider notifies this stroke when its color changes.
+	if (fColorProvider.Get() != NULL) {
+		fColorProvider->SetToPropertyObject(object,
+			flags | BaseObject::DONT_ADD_NAME);
+	}
+
+	return HasPendingNotifications();
+}
+
+// HitTest
+bool
+MyPaintStroke::HitTest(const BPoint& canvasPoint)
+{
+	if (fSurface == NULL || !TransformedBounds().Contains(canvasPoint))
+		return false;
+
+	BPoint objectPoint(canvasPoint);
+	Transformation().InverseTransform(&objectPoint);
+
+	int32 x = (int32)floorf(objectPoint.x);
+	int32 y = (int32)floorf(objectPoint.y);
+	const RenderBuffer* tile = fSurface->TileAt(x >> TiledSurface::TILE_SHIFT,
+		y >> TiledSurface::TILE_SHIFT);
+	if (tile == NULL)
+		return false;
+
+	const uint16* pixel = (const uint16*)(tile->Bits()
+		+ (int64)(y - tile->Top()) * tile->BytesPerRow()
+		+ (x - tile->Left()) * 8);
+	return pixel[3] > 0;
+}
+
+// #pragma mark -
+
+// Bounds
+BRect
+MyPaintStroke::Bounds()
+{
+	if (fSurface == NULL)
+		return BRect(0, 0, -1, -1);
+	return fSurface->Bounds();
+}
+
+// #pragma mark -
+
+// ObjectChanged
+void
+MyPaintStroke::ObjectChanged(const Notifier* object)
+{
+	if (object == fColorProvider.Get())
+		_UpdateColor();
+}
+
+// #pragma mark -
+
+// InitCheck
+status_t
+MyPaintStroke::InitCheck() const
+{
+	if (fBrush == NULL || fSurface == NULL)
+		return B_NO_MEMORY;
+	return fBrush->InitCheck();
+}
+
+// SetBrushSettings
+status_t
+MyPaintStroke::SetBrushSettings(const char* settings)
+{
+	if (fBrush == NULL)
+		return B_NO_MEMORY;
+
+	if (fBrushSettings == settings)
+		return B_OK;
+
+	status_t status = fBrush->SetTo(settings);
+	if (status != B_OK) {
+		fBrush->SetTo(fBrushSettings.String());
+		fBrush->SetColor(fColor);
+		return status;
+	}
+
+	fBrushSettings = settings;
+	fBrush->SetColor(fColor);
+	_Repaint();
+
+	return B_OK;
+}
+
+// SetColorProvider
+void
+MyPaintStroke::SetColorProvider(const ColorProviderRef& provider)
+{
+	if (fColorProvider == provider)
+		return;
+
+	if (fColorProvider.Get() != NULL)
+		fColorProvider->RemoveListener(this);
+
+	fColorProvider = provider;
+
+	if (fColorProvider.Get() != NULL)
+		fColorProvider->AddListener(this);
+
+	_UpdateColor();
+}
+
+// SetColor
+void
+MyPaintStroke::SetColor(const rgb_color& color)
+{
+	if (fColorProvider.Get() != NULL && fColor == color)
+		return;
+
+	ColorProviderRef provider(new(std::nothrow) ::Color(color), true);
+	if (provider.Get() != NULL)
+		SetColorProvider(provider);
+}
+
+// AppendEvent
+bool
+MyPaintStroke::AppendEvent(const MyPaintEvent& event)
+{
+	if (fBrush == NULL || fSurface == NULL)
+		return false;
+
+	if (fEventCount == fEventsAllocated) {
+		int32 allocate = fEventsAllocated > 0 ? fEventsAllocated * 2 : 256;
+		MyPaintEvent* events = (MyPaintEvent*)realloc(fEvents,
+			allocate * sizeof(MyPaintEvent));
+		if (events == NULL) {
+			fprintf(stderr, "MyPaintStroke::AppendEvent(): Failed to add "
+				"event to MyPaintStroke. Out of memory\n");
+			return false;
+		}
+		fEvents = events;
+		fEventsAllocated = allocate;
+	}
+
+	fEvents[fEventCount++] = event;
+
+	fBrush->StrokeTo(fSurface, event.x, event.y, event.pressure,
+		event.tiltX, event.tiltY, event.deltaTime);
+
+	_InvalidateDirtyTiles();
+
+	return true;
+}
+
+// #pragma mark - private
+
+// _UpdateColor
+void
+MyPaintStroke::_UpdateColor()
+{
+	rgb_color color = kBlack;
+	if (fColorProvider.Get() != NULL)
+		color = fColorProvider->GetColor();
+
+	if (fColor == color)
+		return;
+
+	fColor = color;
+	if (fBrush != NULL) {
+		fBrush->SetColor(fColor);
+		_Repaint();
+	}
+}
+
+// _Repaint
+void
+MyPaintStroke::_Repaint()
+{
+	if (fSurface == NULL)
+		return;
+
+	fSurface->MakeEmpty();
+	fBrush->NewStroke();
+	for (int32 i = 0; i < fEventCount; i++) {
+		const MyPaintEvent& event = fEvents[i];
+		fBrush->StrokeTo(fSurface, event.x, event.y,
+			event.pressure, event.tiltX, event.tiltY, event.deltaTime);
+	}
+	fSurface->ClearDirty();
+
+	NotifyAndUpdate();
+}
+
+// _InvalidateDirtyTiles
+void
+MyPaintStroke::_InvalidateDirtyTiles()
+{
+	int32 count = fSurface->DirtyTileCount();
+	if (count == 0)
+		return;
+
+	// Reset transformed bounds without invalidation, invalidate only
+	// the changed part of each tile the brush has painted on.
+	InitBounds();
+	UpdateChangeCounter();
+	Notify();
+
+	Transformable transformation = Transformation();
+	for (int32 i = 0; i < count; i++) {
+		BRect area = fSurface->DirtyTileArea(i);
+		// pixel indices to the area covered by the pixels
+		area.right++;
+		area.bottom++;
+		area = transformation.TransformBounds(area);
+		area.InsetBy(-1, -1);
+		InvalidateParent(area);
+	}
+
+	fSurface->ClearDirty();
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#ifndef MY_PAINT_STROKE_H
+#define MY_PAINT_STROKE_H
+
+#include <GraphicsDefs.h>
+#include <String.h>
+
+#include "BoundedObject.h"
+#include "ColorProvider.h"
+#include "Listener.h"
+
+class MyPaintBrush;
+class TiledSurface;
+
+// An input event of a MyPaintStroke, the time is relative to the
+// previous event, in seconds.
+struct MyPaintEvent {
+			float				x;
+			float				y;
+			float				pressure;
+			float				tiltX;
+			float				tiltY;
+			double				deltaTime;
+};
+
+// A stroke painted by a MyPaint brush. The brush is configured by the
+// contents of a MyPaint brush file. Only the events are part of the
+// document, the pixels on the TiledSurface are painted as the events are
+// appended, and painted again from the events when the brush or the color
+// changes. The color comes from a ColorProvider, which may be shared with
+// other objects of the document.
+class MyPaintStroke : public BoundedObject, public Listener {
+public:
+								MyPaintStroke();
+								MyPaintStroke(const MyPaintStroke& other,
+									CloneContext& context);
+	virtual						~MyPaintStroke();
+
+	// BaseObject interface
+	virtual	BaseObject*			Clone(CloneContext& context) const;
+	virtual	const char*			DefaultName() const;
+
+	// Object interface
+	virtual	ObjectSnapshot*		Snapshot() const;
+
+	virtual	void				AddProperties(PropertyObject* object,
+									uint32 flags = 0) const;
+	virtual	bool				SetToPropertyObject(
+									const PropertyObject* object,
+									uint32 flags = 0);
+	virtual	bool				HitTest(const BPoint& canvasPoint);
+
+	// BoundedObject interface
+	virtual	BRect				Bounds();
+
+	// Listener interface
+	virtual	void				ObjectChanged(const Notifier* object);
+
+	// MyPaintStroke
+			status_t			InitCheck() const;
+
+			status_t			SetBrushSettings(const char* settings);
+	inline	const char*			BrushSettings() const
+									{ return fBrushSettings.String(); }
+
+			void				SetColorProvider(
+									const ColorProviderRef& provider);
+	inline	const ColorProviderRef& GetColorProvider() const
+									{ return fColorProvider; }
+
+	// Paints the stroke with a color of its own.
+			void				SetColor(const rgb_color& color);
+	inline	rgb_color			Color() const
+									{ return fColor; }
+
+	// Paints the event and invalidates the changed tiles.
+			bool				AppendEvent(const MyPaintEvent& event);
+
+	inline	int32				CountEvents() const
+									{ return fEventCount; }
+	inline	const MyPaintEvent&	EventAtFast(int32 index) const
+									{ return fEvents[index]; }
+
+	inline	const TiledSurface&	Surface() const
+									{ return *fSurface; }
+
+private:
+			void				_UpdateColor();
+			void				_Repaint();
+			void				_InvalidateDirtyTiles();
+
+private:
+			BString				fBrushSettings;
+			ColorProviderRef	fColorProvider;
+			// The color the surface is painted with.
+			rgb_color			fColor;
+
+			MyPaintBrush*		fBrush;
+			TiledSurface*		fSurface;
+
+			MyPaintEvent*		fEvents;
+			int32				fEventCount;
+			int32				fEventsAllocated;
+};
+
+#endif // MY_PAINT_STROKE_H
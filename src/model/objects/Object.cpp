@@ -16,6 +16,7 @@ Object::Object()
 	BaseObject(),
 	fChangeCounter(0),
 	fParent(NULL),
+	fIndex(-1),
 	fIsVisible(true)
 {
 }
@@ -27,6 +28,7 @@ Object::Object(const Object& other)
 	BaseObject(other),
 	fChangeCounter(0),
 	fParent(NULL),
+	fIndex(-1),
 	fIsVisible(other.fIsVisible)
 {
 }
@@ -103,15 +105,15 @@ Object::IsRegularTransformable() const
 
 // #pragma mark -
 
-// ExtendDirtyArea
-void
-Object::ExtendDirtyArea(BRect& area) const
+// GetDirtyAreaExtent
+DirtyAreaExtent
+Object::GetDirtyAreaExtent() const
 {
-	// "area" is the dirty area "below" this object.
-	// This function should change the area so that
-	// it includes other pixels in the bitmap that are
-	// affected by this object, if pixels in the given
-	// "area" change.
+	// If pixels in a dirty area "below" this object change,
+	// the returned extent should grow the area so that it
+	// includes other pixels in the bitmap that are affected
+	// by this object.
+	return DirtyAreaExtent();
 }
 
 // InvalidateParent
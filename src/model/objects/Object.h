@@ -20,6 +20,49 @@ class ObjectSnapshot;
 
 typedef List<BaseObjectRef, false> AssetList;
 
+// By how much an object extends a dirty area below it on each side. Extents
+// of objects stacked on top of each other simply add up, which allows Layer
+// to keep sums for ranges of objects.
+struct DirtyAreaExtent {
+	DirtyAreaExtent()
+		: left(0.0f), top(0.0f), right(0.0f), bottom(0.0f)
+	{
+	}
+
+	DirtyAreaExtent(float left, float top, float right, float bottom)
+		: left(left), top(top), right(right), bottom(bottom)
+	{
+	}
+
+	DirtyAreaExtent& operator+=(const DirtyAreaExtent& other)
+	{
+		left += other.left;
+		top += other.top;
+		right += other.right;
+		bottom += other.bottom;
+		return *this;
+	}
+
+	DirtyAreaExtent operator+(const DirtyAreaExtent& other) const
+	{
+		DirtyAreaExtent result(*this);
+		return result += other;
+	}
+
+	void ExtendArea(BRect& area) const
+	{
+		area.left -= left;
+		area.top -= top;
+		area.right += right;
+		area.bottom += bottom;
+	}
+
+	float	left;
+	float	top;
+	float	right;
+	float	bottom;
+};
+
 class Object : public Transformable, public BaseObject {
 public:
 								Object();
@@ -47,7 +90,11 @@ public:
 									{ return *this; }
 	virtual	bool				IsRegularTransformable() const;
 
-	virtual	void				ExtendDirtyArea(BRect& area) const;
+	// If pixels in an area "below" this object change, the object may
+	// change pixels in a larger area.
+	virtual	DirtyAreaExtent		GetDirtyAreaExtent() const;
+			void				ExtendDirtyArea(BRect& area) const
+									{ GetDirtyAreaExtent().ExtendArea(area); }
 
 			void				InvalidateParent(const BRect& area);
 			void				InvalidateParent();
@@ -66,8 +113,12 @@ protected:
 	virtual	void				TransformationChanged();
 
 private:
+	friend class Layer;
+
 			uint32				fChangeCounter;
 			Layer*				fParent;
+			int32				fIndex;
+				// index in fParent, maintained by Layer
 			bool				fIsVisible;
 };
 
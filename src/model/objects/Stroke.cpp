@@ -0,0 +1,280 @@
+/*
+ * Copyright 2010-2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#include "Stroke.h"
+
+#include <new>
+
+// constructor
+StrokePoint::StrokePoint()
+	: point(0.0f, 0.0f)
+	, pressure(1.0f)
+	, tiltX(0.0f)
+	, tiltY(0.0f)
+{
+}
+
+// constructor
+StrokePoint::StrokePoint(const BPoint& point, float pressure,
+		float tiltX, float tiltY)
+	: point(point)
+	, pressure(pressure)
+	, tiltX(tiltX)
+	, tiltY(tiltY)
+{
+}
+
+// constructor
+StrokePoint::StrokePoint(const StrokePoint& other)
+{
+	*this = other;
+}
+
+// operator=
+StrokePoint&
+StrokePoint::operator=(const StrokePoint& other)
+{
+	point = other.point;
+	pressure = other.pressure;
+	tiltX = other.tiltX;
+	tiltY = other.tiltY;
+
+	return *this;
+}
+
+// operator==
+bool
+StrokePoint::operator==(const StrokePoint& other) const
+{
+	return point == other.point
+		&& pressure == other.pressure
+		&& tiltX == other.tiltX
+		&& tiltY == other.tiltY;
+}
+
+// operator!=
+bool
+StrokePoint::operator!=(const StrokePoint& other) const
+{
+	return !(*this == other);
+}
+
+// #pragma mark - Chunk
+
+// constructor
+Stroke::Chunk::Chunk()
+	: Referenceable()
+	, count(0)
+	, bounds(0, 0, -1, -1)
+{
+}
+
+// extend_bounds
+static inline void
+extend_bounds(BRect& bounds, const BPoint& point)
+{
+	BRect pointRect(point.x, point.y, point.x, point.y);
+	if (bounds.IsValid())
+		bounds = bounds | pointRect;
+	else
+		bounds = pointRect;
+}
+
+// #pragma mark - Stroke
+
+// constructor
+Stroke::Stroke()
+	: fChunks(16)
+	, fCount(0)
+{
+}
+
+// constructor
+Stroke::Stroke(const Stroke& other)
+	: fChunks(16)
+	, fCount(0)
+{
+	*this = other;
+}
+
+// destructor
+Stroke::~Stroke()
+{
+	MakeEmpty();
+}
+
+// operator=
+Stroke&
+Stroke::operator=(const Stroke& other)
+{
+	if (this == &other)
+		return *this;
+
+	// Chunks are only ever appended, so if our last chunk is shared with
+	// the other Stroke, all the chunks before it are, too. Typically, we are
+	// a copy which is synchronized with the original, and only the chunks
+	// added since the last time need to be referenced.
+	int32 chunkCount = CountChunks();
+	if (chunkCount == 0 || chunkCount > other.CountChunks()
+		|| _ChunkAt(chunkCount - 1) != other._ChunkAt(chunkCount - 1)) {
+		MakeEmpty();
+		chunkCount = 0;
+	}
+
+	for (int32 i = chunkCount; i < other.CountChunks(); i++) {
+		Chunk* chunk = other._ChunkAt(i);
+		if (!fChunks.AddItem(chunk))
+			break;
+		chunk->AddReference();
+	}
+
+	fCount = other.fCount;
+	if (fCount > CountChunks() * CHUNK_SIZE)
+		fCount = CountChunks() * CHUNK_SIZE;
+
+	return *this;
+}
+
+// operator==
+bool
+Stroke::operator==(const Stroke& other) const
+{
+	if (this == &other)
+		return true;
+
+	if (fCount != other.fCount)
+		return false;
+
+	for (int32 i = 0; i < CountChunks(); i++) {
+		// Shared chunks contain the same points for both of us.
+		if (_ChunkAt(i) == other._ChunkAt(i))
+			continue;
+
+		int32 first = i << CHUNK_SIZE_SHIFT;
+		int32 last = min_c(first + CHUNK_SIZE, fCount);
+		for (int32 j = first; j < last; j++) {
+			if (*PointAtFast(j) != *other.PointAtFast(j))
+				return false;
+		}
+	}
+	return true;
+}
+
+// operator!=
+bool
+Stroke::operator!=(const Stroke& other) const
+{
+	return !(*this == other);
+}
+
+// PointAt
+const StrokePoint*
+Stroke::PointAt(int32 index) const
+{
+	if (index < 0 || index >= fCount)
+		return NULL;
+	return PointAtFast(index);
+}
+
+// LastPoint
+const StrokePoint*
+Stroke::LastPoint() const
+{
+	return PointAt(fCount - 1);
+}
+
+// AppendPoint
+bool
+Stroke::AppendPoint(const StrokePoint& point)
+{
+	int32 indexInChunk = fCount & (CHUNK_SIZE - 1);
+
+	Chunk* chunk;
+	if (indexInChunk == 0) {
+		chunk = new(std::nothrow) Chunk();
+		if (chunk == NULL)
+			return false;
+		if (!fChunks.AddItem(chunk)) {
+			chunk->RemoveReference();
+			return false;
+		}
+		_InitChunkBounds(chunk, CountChunks() - 1);
+	} else {
+		chunk = _ChunkAt(CountChunks() - 1);
+		if (chunk->count != indexInChunk) {
+			// Another Stroke sharing the chunk has already appended
+			// points of its own.
+			chunk = _CopyLastChunk(indexInChunk);
+			if (chunk == NULL)
+				return false;
+		}
+	}
+
+	chunk->points[indexInChunk] = point;
+	chunk->count = indexInChunk + 1;
+	extend_bounds(chunk->bounds, point.point);
+
+	fCount++;
+	return true;
+}
+
+// MakeEmpty
+void
+Stroke::MakeEmpty()
+{
+	for (int32 i = CountChunks() - 1; i >= 0; i--)
+		_ChunkAt(i)->RemoveReference();
+	fChunks.MakeEmpty();
+	fCount = 0;
+}
+
+// ChunkBounds
+BRect
+Stroke::ChunkBounds(int32 chunkIndex) const
+{
+	if (chunkIndex < 0 || chunkIndex >= CountChunks())
+		return BRect(0, 0, -1, -1);
+	return _ChunkAt(chunkIndex)->bounds;
+}
+
+// #pragma mark - private
+
+// _CopyLastChunk
+Stroke::Chunk*
+Stroke::_CopyLastChunk(int32 count)
+{
+	int32 chunkIndex = CountChunks() - 1;
+	Chunk* original = _ChunkAt(chunkIndex);
+
+	Chunk* chunk = new(std::nothrow) Chunk();
+	if (chunk == NULL)
+		return NULL;
+
+	for (int32 i = 0; i < count; i++)
+		chunk->points[i] = original->points[i];
+	chunk->count = count;
+
+	fChunks.ReplaceItem(chunkIndex, chunk);
+	original->RemoveReference();
+
+	_InitChunkBounds(chunk, chunkIndex);
+	for (int32 i = 0; i < count; i++)
+		extend_bounds(chunk->bounds, chunk->points[i].point);
+
+	return chunk;
+}
+
+// _InitChunkBounds
+void
+Stroke::_InitChunkBounds(Chunk* chunk, int32 chunkIndex) const
+{
+	if (chunkIndex > 0) {
+		const StrokePoint* previous = PointAtFast(
+			(chunkIndex << CHUNK_SIZE_SHIFT) - 1);
+		chunk->bounds.Set(previous->point.x, previous->point.y,
+			previous->point.x, previous->point.y);
+	} else
+		chunk->bounds = BRect(0, 0, -1, -1);
+}
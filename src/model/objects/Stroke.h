@@ -0,0 +1,104 @@
+/*
+ * Copyright 2010-2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#ifndef STROKE_H
+#define STROKE_H
+
+#include <List.h>
+#include <Point.h>
+#include <Rect.h>
+
+#include "Referenceable.h"
+
+class StrokePoint {
+public:
+								StrokePoint();
+								StrokePoint(const BPoint& point,
+									float pressure, float tiltX, float tiltY);
+								StrokePoint(const StrokePoint& other);
+
+			StrokePoint&		operator=(const StrokePoint& other);
+			bool				operator==(const StrokePoint& other) const;
+			bool				operator!=(const StrokePoint& other) const;
+
+			BPoint				point;
+			float				pressure;
+			float				tiltX;
+			float				tiltY;
+};
+
+// The points of a stroke, stored in chunks of a fixed size. Points are only
+// ever appended, and a point which has been written to a chunk never changes.
+// This allows copies of a Stroke (like the one in the BrushStrokeSnapshot) to
+// share the chunks. Assigning a Stroke to a copy of itself only takes
+// references to the chunks which have been added since, and appending to a
+// Stroke does not touch the points visible to any of its copies. If several
+// copies append to the same shared chunk, all but the first copy the chunk.
+//
+// Like the rest of the model, a Stroke is to be modified with the document
+// locked only.
+class Stroke {
+public:
+	enum {
+		CHUNK_SIZE_SHIFT	= 7,
+		CHUNK_SIZE			= 1 << CHUNK_SIZE_SHIFT
+	};
+
+								Stroke();
+								Stroke(const Stroke& other);
+								~Stroke();
+
+			Stroke&				operator=(const Stroke& other);
+			bool				operator==(const Stroke& other) const;
+			bool				operator!=(const Stroke& other) const;
+
+	inline	int32				CountPoints() const
+									{ return fCount; }
+			const StrokePoint*	PointAt(int32 index) const;
+	inline	const StrokePoint*	PointAtFast(int32 index) const;
+			const StrokePoint*	LastPoint() const;
+
+			bool				AppendPoint(const StrokePoint& point);
+			void				MakeEmpty();
+
+	// The points are grouped into chunks of CHUNK_SIZE points. The bounds of
+	// a chunk enclose its points, as well as the last point of the previous
+	// chunk, so they enclose all line segments ending in the chunk.
+	inline	int32				CountChunks() const
+									{ return fChunks.CountItems(); }
+			BRect				ChunkBounds(int32 chunkIndex) const;
+
+private:
+			class Chunk;
+
+	inline	Chunk*				_ChunkAt(int32 chunkIndex) const
+									{ return (Chunk*)fChunks.ItemAtFast(
+										chunkIndex); }
+			Chunk*				_CopyLastChunk(int32 count);
+			void				_InitChunkBounds(Chunk* chunk,
+									int32 chunkIndex) const;
+
+			BList				fChunks;
+			int32				fCount;
+};
+
+class Stroke::Chunk : public Referenceable {
+public:
+								Chunk();
+
+			StrokePoint			points[CHUNK_SIZE];
+			int32				count;
+				// the number of points written so far, by any Stroke
+			BRect				bounds;
+};
+
+// PointAtFast
+inline const StrokePoint*
+Stroke::PointAtFast(int32 index) const
+{
+	return &_ChunkAt(index >> CHUNK_SIZE_SHIFT)
+		->points[index & (CHUNK_SIZE - 1)];
+}
+
+#endif // STROKE_H
@@ -120,6 +120,22 @@ name_for_id(int32 id)
 			name = "Center";
 			break;
 
+		case PROPERTY_DENOISE_AMPLITUDE:
+			name = "Amplitude";
+			break;
+		case PROPERTY_DENOISE_SHARPNESS:
+			name = "Sharpness";
+			break;
+		case PROPERTY_DENOISE_ANISOTROPY:
+			name = "Anisotropy";
+			break;
+		case PROPERTY_DENOISE_ALPHA:
+			name = "Pre-blur";
+			break;
+		case PROPERTY_DENOISE_SIGMA:
+			name = "Regularity";
+			break;
+
 		case PROPERTY_GROUP_STROKE_PAINT:
 			name = "Stroke";
 			break;
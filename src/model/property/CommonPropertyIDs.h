@@ -52,6 +52,12 @@ enum {
 	PROPERTY_CONTRAST					= 'ctst',
 	PROPERTY_CENTER						= 'cntr',
 
+	PROPERTY_DENOISE_AMPLITUDE			= 'dnam',
+	PROPERTY_DENOISE_SHARPNESS			= 'dnsh',
+	PROPERTY_DENOISE_ANISOTROPY			= 'dnan',
+	PROPERTY_DENOISE_ALPHA				= 'dnal',
+	PROPERTY_DENOISE_SIGMA				= 'dnsg',
+
 	PROPERTY_GROUP_STROKE_PAINT			= 'strk',
 	PROPERTY_GROUP_FILL_PAINT			= 'fill',
 
@@ -69,12 +69,12 @@ BrushStrokeSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
 
 	// traverse lines
 	float stepDistLeftOver = 0.0f;
-	const StrokePoint* previous = fStroke.ObjectAt(0);
-	int32 count = fStroke.CountObjects();
+	const StrokePoint* previous = fStroke.PointAt(0);
+	int32 count = fStroke.CountPoints();
 	bool drawnAnything = false;
 	if (count > 1) {
 		for (int32 i = 1; i < count; i++) {
-			const StrokePoint* current = fStroke.ObjectAt(i);
+			const StrokePoint* current = fStroke.PointAtFast(i);
 			drawnAnything |= _StrokeLine(previous, current, dest, bpr,
 				area, stepDistLeftOver);
 			previous = current;
@@ -110,6 +110,8 @@ BrushStrokeSnapshot::_Sync()
 		fPaint = NULL;
 	}
 
+	// Shares the point chunks with the original, only the chunks added
+	// since the last sync need to be referenced.
 	fStroke = fOriginal->Stroke();
 }
 
@@ -7,19 +7,13 @@
 #include <algorithm>
 #include <stdio.h>
 
-#include <Bitmap.h>
-
-#include "rgb_hsv.h"
-#include "support.h"
-
 #include "FilterBrightness.h"
-#include "RenderBuffer.h"
 
 
 // constructor
 FilterBrightnessSnapshot::FilterBrightnessSnapshot(
 		const FilterBrightness* filter)
-	: ObjectSnapshot(filter)
+	: FilterColorSnapshot(filter)
 	, fOriginal(filter)
 	, fOffset(filter->Offset())
 	, fFactor(filter->Factor())
@@ -44,7 +38,7 @@ FilterBrightnessSnapshot::Original() const
 bool
 FilterBrightnessSnapshot::Sync()
 {
-	if (ObjectSnapshot::Sync()) {
+	if (FilterColorSnapshot::Sync()) {
 		fOffset = fOriginal->Offset();
 		fFactor = fOriginal->Factor();
 		return true;
@@ -52,63 +46,71 @@ FilterBrightnessSnapshot::Sync()
 	return false;
 }
 
-// Render
+// IsIdentity
+bool
+FilterBrightnessSnapshot::IsIdentity() const
+{
+	return fOffset == 0 && fFactor == 1.0f;
+}
+
+// FilterSpan
 void
-FilterBrightnessSnapshot::Render(RenderEngine& engine,
-	RenderBuffer* bitmap, BRect area) const
+FilterBrightnessSnapshot::FilterSpan(uint16* p, int32 count) const
 {
-	if (fOffset == 0 && fFactor == 1.0f)
-		return;
-
-	area = bitmap->Bounds() & area;
-
-	const int top = (int)area.top;
-	const int bottom = (int)area.bottom;
-	const int left = (int)area.left;
-	const int right = (int)area.right;
-
-	uint8* bits = bitmap->Bits();
-	bits += top * bitmap->BytesPerRow();
-	bits += left * 8;
-
-	for (int y = top; y <= bottom; y++) {
-		uint16* p = (uint16*)bits;
-		for (int x = left; x <= right; x++) {
-			float b = p[0] / (256.0f * 256.0f);
-			float g = p[1] / (256.0f * 256.0f);
-			float r = p[2] / (256.0f * 256.0f);
-
-			float h;
-			float s;
-			float v;
-
-			RGB_to_HSV(r, g, b, h, s, v);
-
-			v = std::max(0.0f, std::min(1.0f,
-				v * fFactor + fOffset / 256.0f));
-
-			HSV_to_RGB(h, s, v, r, g, b);
-
-			p[0] = constrain_int32_0_65535(
-				(int32)(b * (256.0f * 256.0f)));
-			p[1] = constrain_int32_0_65535(
-				(int32)(g * (256.0f * 256.0f)));
-			p[2] = constrain_int32_0_65535(
-				(int32)(r * (256.0f * 256.0f)));
-
-			// TODO: Confirm/improve this code which is supposed
-			// to implement the pre-multiplication of the alpha-channel
-			// (which results in the restriction that no color-channel
-			// has a higher value than the alpha-channel).
-			if (p[0] > p[3])
-				p[0] = p[3];
-			if (p[1] > p[3])
-				p[1] = p[3];
-			if (p[2] > p[3])
-				p[2] = p[3];
-
-			p += 4;
-		}
-		bits += bitmap->BytesPerRow();
+	// Changing the HSV value while keeping hue and saturation is the
+	// same as scaling all channels by newValue / value, which saves the
+	// round trip through HSV.
+	const float offset = fOffset * 256.0f;
+
+	int32 i = 0;
+#if defined(__SSE2__)
+	const __m128 factor4 = _mm_set1_ps(fFactor);
+	const __m128 offset4 = _mm_set1_ps(offset);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 maximum = _mm_set1_ps(65535.0f);
+	for (; i + 4 <= count; i += 4) {
+		PixelQuad quad;
+		LoadPixels(p, quad);
+
+		const __m128 value = _mm_max_ps(quad.b, _mm_max_ps(quad.g, quad.r));
+		const __m128 newValue = _mm_max_ps(zero, _mm_min_ps(maximum,
+			_mm_add_ps(_mm_mul_ps(value, factor4), offset4)));
+
+		const __m128 scale = _mm_mul_ps(newValue,
+			Reciprocal(_mm_max_ps(value, one)));
+		const __m128 gray = _mm_and_ps(_mm_cmpeq_ps(value, zero),
+			newValue);
+
+		// Keep the color channels within the premultiplied alpha
+		quad.b = _mm_min_ps(quad.a, _mm_add_ps(_mm_mul_ps(quad.b, scale),
+			gray));
+		quad.g = _mm_min_ps(quad.a, _mm_add_ps(_mm_mul_ps(quad.g, scale),
+			gray));
+		quad.r = _mm_min_ps(quad.a, _mm_add_ps(_mm_mul_ps(quad.r, scale),
+			gray));
+
+		StorePixels(p, quad);
+		p += 16;
+	}
+#endif
+
+	for (; i < count; i++) {
+		const int32 value = std::max(p[0], std::max(p[1], p[2]));
+		const float newValue = std::max(0.0f, std::min(65535.0f,
+			value * fFactor + offset));
+
+		// Black has no hue, it becomes gray. Its channels are all zero,
+		// so it gets the new value from "gray" alone.
+		const float scale = newValue / std::max(value, (int32)1);
+		const float gray = value == 0 ? newValue : 0.0f;
+
+		// Keep the color channels within the premultiplied alpha
+		const int32 alpha = p[3];
+		p[0] = std::min((int32)(p[0] * scale + gray), alpha);
+		p[1] = std::min((int32)(p[1] * scale + gray), alpha);
+		p[2] = std::min((int32)(p[2] * scale + gray), alpha);
+
+		p += 4;
 	}
 }
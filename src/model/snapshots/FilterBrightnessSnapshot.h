@@ -5,11 +5,11 @@
 #ifndef FILTER_BRIGHTNESS_SNAPSHOT_H
 #define FILTER_BRIGHTNESS_SNAPSHOT_H
 
-#include "ObjectSnapshot.h"
+#include "FilterColorSnapshot.h"
 
 class FilterBrightness;
 
-class FilterBrightnessSnapshot : public ObjectSnapshot {
+class FilterBrightnessSnapshot : public FilterColorSnapshot {
  public:
 								FilterBrightnessSnapshot(
 									const FilterBrightness* filter);
@@ -18,8 +18,10 @@ class FilterBrightnessSnapshot : public ObjectSnapshot {
 	virtual	const Object*		Original() const;
 	virtual	bool				Sync();
 
-	virtual	void				Render(RenderEngine& engine,
-									RenderBuffer* bitmap, BRect area) const;
+	// FilterColorSnapshot interface
+	virtual	bool				IsIdentity() const;
+	virtual	void				FilterSpan(uint16* pixels,
+									int32 count) const;
 
  private:
 			const FilterBrightness*		fOriginal;
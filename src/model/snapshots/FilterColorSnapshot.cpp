@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "FilterColorSnapshot.h"
+
+#include <algorithm>
+
+#include "RenderBuffer.h"
+#include "RenderTrace.h"
+
+// The buffer is processed in spans of this many pixels, each of which is
+// passed through all fused filters while it still sits in the L1 cache.
+// 8 KB per span still fit there, while the call to each filter is spread
+// over enough pixels not to matter.
+static const int32 kSpanPixels = 1024;
+
+// constructor
+FilterColorSnapshot::FilterColorSnapshot(const Object* object)
+	: ObjectSnapshot(object)
+{
+}
+
+// destructor
+FilterColorSnapshot::~FilterColorSnapshot()
+{
+}
+
+// #pragma mark -
+
+// Render
+void
+FilterColorSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
+	BRect area) const
+{
+	if (IsIdentity())
+		return;
+
+	const FilterColorSnapshot* filter = this;
+	RenderFused(&filter, 1, bitmap, area);
+}
+
+// RenderFused
+void
+FilterColorSnapshot::RenderFused(const FilterColorSnapshot* const* filters,
+	int32 count, RenderBuffer* bitmap, BRect area)
+{
+	if (count <= 0)
+		return;
+
+	area = bitmap->Bounds() & area;
+	if (!area.IsValid())
+		return;
+
+	// Traced as the first of the fused filters.
+	RenderTraceSpan span("RenderFused", "object");
+	span.SetObject(filters[0]->Name());
+	span.SetArea(area);
+
+	const int top = (int)area.top;
+	const int bottom = (int)area.bottom;
+	const int left = (int)area.left;
+	const int width = (int)area.right - left + 1;
+
+	const uint32 bpr = bitmap->BytesPerRow();
+	uint8* bits = bitmap->Bits();
+	bits += (int64)top * bpr;
+	bits += left * 8;
+
+	for (int y = top; y <= bottom; y++) {
+		uint16* p = (uint16*)bits;
+		for (int x = 0; x < width; x += kSpanPixels) {
+			int32 pixels = std::min(kSpanPixels, (int32)(width - x));
+			for (int32 i = 0; i < count; i++)
+				filters[i]->FilterSpan(p, pixels);
+			p += pixels * 4;
+		}
+		bits += bpr;
+	}
+}
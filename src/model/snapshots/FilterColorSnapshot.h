@@ -0,0 +1,118 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef FILTER_COLOR_SNAPSHOT_H
+#define FILTER_COLOR_SNAPSHOT_H
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+#include "ObjectSnapshot.h"
+
+// Base class for filters which compute each output pixel from the same
+// input pixel only (brightness, contrast, saturation...). Such filters never
+// extend the dirty area, so LayerSnapshot can run several consecutive ones
+// in a single pass over the buffer via RenderFused().
+class FilterColorSnapshot : public ObjectSnapshot {
+ public:
+								FilterColorSnapshot(const Object* object);
+	virtual						~FilterColorSnapshot();
+
+	virtual	void				Render(RenderEngine& engine,
+									RenderBuffer* bitmap, BRect area) const;
+
+	// FilterColorSnapshot
+	virtual	bool				IsIdentity() const = 0;
+
+	// Filters "count" premultiplied BGRA pixels (four uint16 per pixel)
+	// in place. Implementations work on four pixels at a time where SSE2
+	// is available, see LoadPixels() and StorePixels().
+	virtual	void				FilterSpan(uint16* pixels,
+									int32 count) const = 0;
+
+	// Applies all given filters, in order, to the area. Identity filters
+	// are expected to be left out by the caller.
+	static	void				RenderFused(
+									const FilterColorSnapshot* const* filters,
+									int32 count, RenderBuffer* bitmap,
+									BRect area);
+
+ protected:
+#if defined(__SSE2__)
+	// Four pixels, one vector per channel.
+	struct PixelQuad {
+		__m128	b;
+		__m128	g;
+		__m128	r;
+		__m128	a;
+	};
+
+	static	inline void			LoadPixels(const uint16* p, PixelQuad& quad);
+	// The channels are truncated and saturated to 0...65535.
+	static	inline void			StorePixels(uint16* p, const PixelQuad& quad);
+	// 1 / x without a division, accurate to about 22 bits.
+	static	inline __m128		Reciprocal(__m128 x);
+#endif
+};
+
+
+#if defined(__SSE2__)
+
+// LoadPixels
+inline void
+FilterColorSnapshot::LoadPixels(const uint16* p, PixelQuad& quad)
+{
+	__m128i first = _mm_loadu_si128((const __m128i*)p);
+	__m128i second = _mm_loadu_si128((const __m128i*)(p + 8));
+	// b0 b2 g0 g2 r0 r2 a0 a2 and b1 b3 g1 g3 r1 r3 a1 a3
+	__m128i even = _mm_unpacklo_epi16(first, second);
+	__m128i odd = _mm_unpackhi_epi16(first, second);
+	// b0 b1 b2 b3 g0 g1 g2 g3 and r0 r1 r2 r3 a0 a1 a2 a3
+	__m128i bg = _mm_unpacklo_epi16(even, odd);
+	__m128i ra = _mm_unpackhi_epi16(even, odd);
+
+	const __m128i zero = _mm_setzero_si128();
+	quad.b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(bg, zero));
+	quad.g = _mm_cvtepi32_ps(_mm_unpackhi_epi16(bg, zero));
+	quad.r = _mm_cvtepi32_ps(_mm_unpacklo_epi16(ra, zero));
+	quad.a = _mm_cvtepi32_ps(_mm_unpackhi_epi16(ra, zero));
+}
+
+// StorePixels
+inline void
+FilterColorSnapshot::StorePixels(uint16* p, const PixelQuad& quad)
+{
+	// There is no unsigned saturating pack before SSE4.1, so the values
+	// are shifted into the signed range and back.
+	const __m128i bias = _mm_set1_epi32(32768);
+	const __m128i flip = _mm_set1_epi16((short)0x8000);
+	__m128i bg = _mm_xor_si128(_mm_packs_epi32(
+		_mm_sub_epi32(_mm_cvttps_epi32(quad.b), bias),
+		_mm_sub_epi32(_mm_cvttps_epi32(quad.g), bias)), flip);
+	__m128i ra = _mm_xor_si128(_mm_packs_epi32(
+		_mm_sub_epi32(_mm_cvttps_epi32(quad.r), bias),
+		_mm_sub_epi32(_mm_cvttps_epi32(quad.a), bias)), flip);
+
+	// b0 r0 b1 r1 b2 r2 b3 r3 and g0 a0 g1 a1 g2 a2 g3 a3
+	__m128i br = _mm_unpacklo_epi16(bg, ra);
+	__m128i ga = _mm_unpackhi_epi16(bg, ra);
+	_mm_storeu_si128((__m128i*)p, _mm_unpacklo_epi16(br, ga));
+	_mm_storeu_si128((__m128i*)(p + 8), _mm_unpackhi_epi16(br, ga));
+}
+
+// Reciprocal
+inline __m128
+FilterColorSnapshot::Reciprocal(__m128 x)
+{
+	// One Newton-Raphson step on the 12 bit estimate.
+	__m128 estimate = _mm_rcp_ps(x);
+	return _mm_mul_ps(estimate, _mm_sub_ps(_mm_set1_ps(2.0f),
+		_mm_mul_ps(x, estimate)));
+}
+
+#endif // __SSE2__
+
+
+#endif // FILTER_COLOR_SNAPSHOT_H
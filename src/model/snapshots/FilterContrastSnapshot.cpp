@@ -7,19 +7,13 @@
 #include <algorithm>
 #include <stdio.h>
 
-#include <Bitmap.h>
-
-#include "rgb_hsv.h"
-#include "support.h"
-
 #include "FilterContrast.h"
-#include "RenderBuffer.h"
 
 
 // constructor
 FilterContrastSnapshot::FilterContrastSnapshot(
 		const FilterContrast* filter)
-	: ObjectSnapshot(filter)
+	: FilterColorSnapshot(filter)
 	, fOriginal(filter)
 	, fContrast(filter->Contrast())
 	, fCenter(filter->Center())
@@ -44,7 +38,7 @@ FilterContrastSnapshot::Original() const
 bool
 FilterContrastSnapshot::Sync()
 {
-	if (ObjectSnapshot::Sync()) {
+	if (FilterColorSnapshot::Sync()) {
 		fContrast = fOriginal->Contrast();
 		fCenter = fOriginal->Center();
 		return true;
@@ -52,56 +46,57 @@ FilterContrastSnapshot::Sync()
 	return false;
 }
 
-// Render
+// IsIdentity
+bool
+FilterContrastSnapshot::IsIdentity() const
+{
+	// A contrast of 0 leaves the pixels alone instead of flattening them
+	// to the center, documents have always been rendered that way.
+	return fContrast == 0.0f || fContrast == 1.0f;
+}
+
+// FilterSpan
 void
-FilterContrastSnapshot::Render(RenderEngine& engine,
-	RenderBuffer* bitmap, BRect area) const
+FilterContrastSnapshot::FilterSpan(uint16* p, int32 count) const
 {
-	if (fContrast == 0.0f)
-		return;
-
-	area = bitmap->Bounds() & area;
-
-	const int top = (int)area.top;
-	const int bottom = (int)area.bottom;
-	const int left = (int)area.left;
-	const int right = (int)area.right;
-
-	uint8* bits = bitmap->Bits();
-	bits += top * bitmap->BytesPerRow();
-	bits += left * 8;
-
-	for (int y = top; y <= bottom; y++) {
-		uint16* p = (uint16*)bits;
-		for (int x = left; x <= right; x++) {
-			float b = p[0] / 256.0f;
-			float g = p[1] / 256.0f;
-			float r = p[2] / 256.0f;
-
-			b = fCenter + (b - fCenter) * fContrast;
-			g = fCenter + (g - fCenter) * fContrast;
-			r = fCenter + (r - fCenter) * fContrast;
-
-			p[0] = constrain_int32_0_65535(
-				(int32)(b * 256.0f));
-			p[1] = constrain_int32_0_65535(
-				(int32)(g * 256.0f));
-			p[2] = constrain_int32_0_65535(
-				(int32)(r * 256.0f));
-
-			// TODO: Confirm/improve this code which is supposed
-			// to implement the pre-multiplication of the alpha-channel
-			// (which results in the restriction that no color-channel
-			// has a higher value than the alpha-channel).
-			if (p[0] > p[3])
-				p[0] = p[3];
-			if (p[1] > p[3])
-				p[1] = p[3];
-			if (p[2] > p[3])
-				p[2] = p[3];
-
-			p += 4;
-		}
-		bits += bitmap->BytesPerRow();
+	// center + (value - center) * contrast, folded into a single
+	// multiply-add per channel.
+	const float scale = fContrast;
+	const float offset = fCenter * 256.0f * (1.0f - fContrast);
+
+	int32 i = 0;
+#if defined(__SSE2__)
+	const __m128 scale4 = _mm_set1_ps(scale);
+	const __m128 offset4 = _mm_set1_ps(offset);
+	const __m128 zero = _mm_setzero_ps();
+	for (; i + 4 <= count; i += 4) {
+		PixelQuad quad;
+		LoadPixels(p, quad);
+
+		// Keep the color channels within the premultiplied alpha
+		quad.b = _mm_max_ps(zero, _mm_min_ps(quad.a,
+			_mm_add_ps(_mm_mul_ps(quad.b, scale4), offset4)));
+		quad.g = _mm_max_ps(zero, _mm_min_ps(quad.a,
+			_mm_add_ps(_mm_mul_ps(quad.g, scale4), offset4)));
+		quad.r = _mm_max_ps(zero, _mm_min_ps(quad.a,
+			_mm_add_ps(_mm_mul_ps(quad.r, scale4), offset4)));
+
+		StorePixels(p, quad);
+		p += 16;
+	}
+#endif
+
+	for (; i < count; i++) {
+		int32 b = (int32)(p[0] * scale + offset);
+		int32 g = (int32)(p[1] * scale + offset);
+		int32 r = (int32)(p[2] * scale + offset);
+
+		// Keep the color channels within the premultiplied alpha
+		const int32 alpha = p[3];
+		p[0] = std::max(0, std::min(b, alpha));
+		p[1] = std::max(0, std::min(g, alpha));
+		p[2] = std::max(0, std::min(r, alpha));
+
+		p += 4;
 	}
 }
@@ -5,11 +5,11 @@
 #ifndef FILTER_CONTRAST_SNAPSHOT_H
 #define FILTER_CONTRAST_SNAPSHOT_H
 
-#include "ObjectSnapshot.h"
+#include "FilterColorSnapshot.h"
 
 class FilterContrast;
 
-class FilterContrastSnapshot : public ObjectSnapshot {
+class FilterContrastSnapshot : public FilterColorSnapshot {
  public:
 								FilterContrastSnapshot(
 									const FilterContrast* filter);
@@ -18,8 +18,10 @@ class FilterContrastSnapshot : public ObjectSnapshot {
 	virtual	const Object*		Original() const;
 	virtual	bool				Sync();
 
-	virtual	void				Render(RenderEngine& engine,
-									RenderBuffer* bitmap, BRect area) const;
+	// FilterColorSnapshot interface
+	virtual	bool				IsIdentity() const;
+	virtual	void				FilterSpan(uint16* pixels,
+									int32 count) const;
 
  private:
 			const FilterContrast*		fOriginal;
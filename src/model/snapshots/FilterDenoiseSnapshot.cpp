@@ -0,0 +1,91 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#include "FilterDenoiseSnapshot.h"
+
+#include "FilterDenoise.h"
+#include "LayoutContext.h"
+#include "RenderBuffer.h"
+#include "RenderEngine.h"
+
+// constructor
+FilterDenoiseSnapshot::FilterDenoiseSnapshot(const FilterDenoise* filter)
+	: ObjectSnapshot(filter)
+	, fOriginal(filter)
+	, fParameters()
+	, fFilter()
+{
+	_SyncParameters();
+}
+
+// destructor
+FilterDenoiseSnapshot::~FilterDenoiseSnapshot()
+{
+}
+
+// #pragma mark -
+
+// Original
+const Object*
+FilterDenoiseSnapshot::Original() const
+{
+	return fOriginal;
+}
+
+// Sync
+bool
+FilterDenoiseSnapshot::Sync()
+{
+	if (ObjectSnapshot::Sync()) {
+		_SyncParameters();
+		return true;
+	}
+	return false;
+}
+
+// Layout
+void
+FilterDenoiseSnapshot::Layout(LayoutContext& context, uint32 flags)
+{
+	ObjectSnapshot::Layout(context, flags);
+
+	// The filter forgets the denoised tiles only when the parameters
+	// at the current zoom level have changed.
+	fFilter.SetParameters(fParameters.Scaled(LayoutedState().Matrix.Scale()));
+}
+
+// Render
+void
+FilterDenoiseSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
+	BRect area) const
+{
+	fFilter.Filter(bitmap, area, engine.ThreadCount());
+}
+
+// RebuildAreaForDirtyArea
+void
+FilterDenoiseSnapshot::RebuildAreaForDirtyArea(BRect& area) const
+{
+	// "area" is the area requested to be rendered by this
+	// object.
+	// This function should change the area so that
+	// it includes all pixels outside the given area which
+	// are required by this object to render the given area
+	// correctly.
+	area = fFilter.SourceAreaFor(area);
+}
+
+// #pragma mark -
+
+// _SyncParameters
+void
+FilterDenoiseSnapshot::_SyncParameters()
+{
+	fParameters.amplitude = fOriginal->Amplitude();
+	fParameters.sharpness = fOriginal->Sharpness();
+	fParameters.anisotropy = fOriginal->Anisotropy();
+	fParameters.alpha = fOriginal->Alpha();
+	fParameters.sigma = fOriginal->Sigma();
+}
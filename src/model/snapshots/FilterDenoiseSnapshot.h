@@ -0,0 +1,41 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+
+#ifndef FILTER_DENOISE_SNAPSHOT_H
+#define FILTER_DENOISE_SNAPSHOT_H
+
+#include "DenoiseFilter.h"
+#include "ObjectSnapshot.h"
+
+class FilterDenoise;
+
+class FilterDenoiseSnapshot : public ObjectSnapshot {
+ public:
+								FilterDenoiseSnapshot(
+									const FilterDenoise* filter);
+	virtual						~FilterDenoiseSnapshot();
+
+	virtual	const Object*		Original() const;
+	virtual	bool				Sync();
+
+	virtual	void				Layout(LayoutContext& context, uint32 flags);
+
+	virtual	void				Render(RenderEngine& engine,
+									RenderBuffer* bitmap, BRect area) const;
+	virtual	void				RebuildAreaForDirtyArea(BRect& area) const;
+
+ private:
+			void				_SyncParameters();
+
+ private:
+			const FilterDenoise* fOriginal;
+			DenoiseParameters	fParameters;
+
+			// Keeps the denoised tiles, so that only the tiles with
+			// changed pixels are denoised again.
+	mutable	DenoiseFilter		fFilter;
+};
+
+#endif // FILTER_DENOISE_SNAPSHOT_H
@@ -6,23 +6,107 @@
 #include "FilterDropShadowSnapshot.h"
 
 #include <algorithm>
+#include <new>
 #include <stdio.h>
+#include <string.h>
 
 #include <Bitmap.h>
 
-#include <agg_blur.h>
-#include <agg_pixfmt_gray.h>
-#include <agg_rendering_buffer.h>
-
 #include "AlphaBuffer.h"
+#include "AutoLocker.h"
 #include "FilterDropShadow.h"
 #include "GaussFilter.h"
 #include "LayoutContext.h"
 #include "RenderBuffer.h"
 #include "RenderEngine.h"
-#include "StackBlurFilter.h"
+#include "ScratchArena.h"
 #include "ui_defines.h"
 
+// div_65535
+static inline uint32
+div_65535(uint32 value)
+{
+	// Exact for all values up to 65535 * 65535
+	return (value + (value >> 16) + 1) >> 16;
+}
+
+
+// Every strip rendered in parallel needs its own entry. The oldest entries
+// are dropped when there are more or they use more memory than this.
+static const int32 kMaxShadowAlphas = 16;
+static const size_t kMaxShadowAlphaBytes = 32 * 1024 * 1024;
+
+
+// The blurred alpha of the shadow, together with the unblurred alpha it was
+// computed from. As long as the unblurred alpha within the same bounds and
+// the radius stay the same, the shadow can be composited at any offset
+// without blurring again. The pixel memory of both buffers comes from the
+// BufferPool.
+class FilterDropShadowSnapshot::ShadowAlpha : public Referenceable {
+public:
+	ShadowAlpha(const AlphaBuffer* source, float radius)
+		: fSource(source->Bounds())
+		, fBlurred(source->Bounds())
+		, fRadius(radius)
+	{
+		if (IsValid()) {
+			source->CopyTo(&fSource, source->Bounds());
+			source->CopyTo(&fBlurred, source->Bounds());
+		}
+	}
+
+	bool IsValid() const
+	{
+		return fSource.IsValid() && fBlurred.IsValid();
+	}
+
+	// Only a shadow blurred from the same alpha within the same bounds is
+	// what blurring "source" gives. Blurred from a larger source, the tail
+	// of the kernel would reach in from pixels which may have changed since.
+	bool CanProvide(const AlphaBuffer* source, float radius) const
+	{
+		if (radius != fRadius || source->Bounds() != fSource.Bounds())
+			return false;
+
+		const uint8* cached = fSource.Bits();
+		const uint8* bits = source->Bits();
+		const uint32 bytes = source->Width() * 2;
+		for (uint32 y = 0; y < source->Height(); y++) {
+			if (memcmp(cached, bits, bytes) != 0)
+				return false;
+			cached += fSource.BytesPerRow();
+			bits += source->BytesPerRow();
+		}
+		return true;
+	}
+
+	BRect Bounds() const
+	{
+		return fSource.Bounds();
+	}
+
+	float Radius() const
+	{
+		return fRadius;
+	}
+
+	size_t Bytes() const
+	{
+		return fSource.BitsLength() + fBlurred.BitsLength();
+	}
+
+	AlphaBuffer* Blurred()
+	{
+		return &fBlurred;
+	}
+
+private:
+	AlphaBuffer		fSource;
+	AlphaBuffer		fBlurred;
+	float			fRadius;
+};
+
+
 // constructor
 FilterDropShadowSnapshot::FilterDropShadowSnapshot(
 		const FilterDropShadow* filter)
@@ -37,16 +121,23 @@ FilterDropShadowSnapshot::FilterDropShadowSnapshot(
 	, fLayoutedFilterRadius(fFilterRadius)
 	, fLayoutedOffsetX(fOffsetX)
 	, fLayoutedOffsetY(fOffsetY)
+
+	, fShadowAlphaLock("shadow alpha")
+	, fShadowAlphas(kMaxShadowAlphas)
+	, fShadowAlphaBytes(0)
 {
 	if (fOriginal->Color().Get() != NULL)
 		fColor = fOriginal->Color()->GetColor();
 	else
 		fColor = kBlack;
+	_UpdateLinearColor();
 }
 
 // destructor
 FilterDropShadowSnapshot::~FilterDropShadowSnapshot()
 {
+	while (!fShadowAlphas.IsEmpty())
+		_RemoveShadowAlpha(0);
 }
 
 // #pragma mark -
@@ -71,6 +162,7 @@ FilterDropShadowSnapshot::Sync()
 			fColor = fOriginal->Color()->GetColor();
 		else
 			fColor = kBlack;
+		_UpdateLinearColor();
 		return true;
 	}
 	return false;
@@ -96,139 +188,254 @@ void
 FilterDropShadowSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
 	BRect area) const
 {
-	int32 extend = (int32)ceilf(fLayoutedFilterRadius) + 3;
+	if (fOpacity <= 0.0f)
+		return;
+
+	area = area & bitmap->Bounds();
+	if (!area.IsValid())
+		return;
+
+	int32 extend = GaussFilter::ExtentForRadius(fLayoutedFilterRadius);
+	int32 offsetX = (int32)fLayoutedOffsetX;
+	int32 offsetY = (int32)fLayoutedOffsetY;
+
+	// The shadow in "area" is the blurred alpha of the pixels at the
+	// offset, which depends on "extend" more pixels around them.
 	BRect source(area);
+	source.OffsetBy(-offsetX, -offsetY);
 	source.InsetBy(-extend, -extend);
-	source.OffsetBy(-fLayoutedOffsetX, -fLayoutedOffsetY);
 
-	if (source.Width() <= 0 || source.Height() <= 0)
+	// The alpha is only copied out of scratch memory when it is not
+	// cached yet.
+	ScratchArena& scratch = engine.Scratch();
+	ScratchArena::Scope scope(scratch);
+
+	uint32 bpr = (source.IntegerWidth() + 1) * 2;
+	uint8* bits = (uint8*)scratch.Allocate(
+		(size_t)bpr * (source.IntegerHeight() + 1));
+	if (bits == NULL)
 		return;
 
-	AlphaBuffer alphaBuffer(source);
-	
-	source = source & bitmap->Bounds();
+	AlphaBuffer alphaBuffer(bits, source, bpr);
+	_ExtractAlpha(bitmap, &alphaBuffer);
+
+	ShadowAlphaRef shadowAlpha = _BlurAlpha(engine, &alphaBuffer);
+	const AlphaBuffer* blurred = shadowAlpha.Get() != NULL
+		? shadowAlpha->Blurred() : &alphaBuffer;
+
+	_Composite(bitmap, blurred, area, offsetX, offsetY);
+}
+
+// RebuildAreaForDirtyArea
+void
+FilterDropShadowSnapshot::RebuildAreaForDirtyArea(BRect& area) const
+{
+	// "area" is the area requested to be rendered by this
+	// object.
+	// This function should change the area so that
+	// it includes all pixels outside the given area which
+	// are required by this object to render the given area
+	// correctly.
+	if (fOpacity <= 0.0f)
+		return;
 
-	int32 left = (int32)floorf(source.left);
-	int32 top = (int32)floorf(source.top);
-	int32 right = (int32)ceilf(source.right);
-	int32 bottom = (int32)ceilf(source.bottom);
+	BRect source(area);
+	source.OffsetBy(-(int32)fLayoutedOffsetX, -(int32)fLayoutedOffsetY);
 
-	// handles and byte lengths
-	uint8* dst = alphaBuffer.Bits();
-	uint32 dstBPR = alphaBuffer.BytesPerRow();
+	float extend = GaussFilter::ExtentForRadius(fLayoutedFilterRadius);
+	source.InsetBy(-extend, -extend);
+	
+	area = area | source;
+}
 
-	// Clear alpha buffer
-	memset(dst, 0, dstBPR * alphaBuffer.Height());
+// #pragma mark -
 
-	uint8* src = bitmap->Bits();
-	uint32 srcBPR = bitmap->BytesPerRow();
+// _UpdateLinearColor
+void
+FilterDropShadowSnapshot::_UpdateLinearColor()
+{
+	fLinearColor[0] = RenderEngine::GammaToLinear(fColor.blue);
+	fLinearColor[1] = RenderEngine::GammaToLinear(fColor.green);
+	fLinearColor[2] = RenderEngine::GammaToLinear(fColor.red);
+}
 
-	// offsets into bitmaps
-	src += left * 8 + top * srcBPR;
-	dst += (left - alphaBuffer.Left()) * 2
-		+ (top - alphaBuffer.Top()) * dstBPR;
+// _ExtractAlpha
+void
+FilterDropShadowSnapshot::_ExtractAlpha(const RenderBuffer* bitmap,
+	AlphaBuffer* alpha) const
+{
+	uint8* dst = alpha->Bits();
+	uint32 dstBPR = alpha->BytesPerRow();
 
-	uint16 opacity = std::max((uint16)0, std::min((uint16)65535,
-		(uint16)(fOpacity * 65535.0 / 255.0)));
+	// Pixels outside the bitmap are transparent
+	memset(dst, 0, (size_t)dstBPR * alpha->Height());
 
-	// first pass:
-	// copy alpha channel of bitmap and blur it
-	for (int32 y = top; y <= bottom; y++) {
+	BRect source = alpha->Bounds() & bitmap->Bounds();
+	if (!source.IsValid())
+		return;
 
-		uint16* dstHandle = (uint16*)dst;
-		uint16* srcHandle = (uint16*)src;
+	int32 left = (int32)source.left;
+	int32 top = (int32)source.top;
+	int32 width = source.IntegerWidth() + 1;
+	int32 height = source.IntegerHeight() + 1;
 
-		for (int32 x = left; x <= right; x++) {
+	const uint8* src = bitmap->Bits();
+	uint32 srcBPR = bitmap->BytesPerRow();
 
-//			dstHandle[0] = INT_MULT(srcHandle[3], fOpacity, t);
-			dstHandle[0] = (uint16)((uint32)srcHandle[3] * opacity / 65535);
+	src += (left - bitmap->Left()) * 8 + (int64)(top - bitmap->Top()) * srcBPR;
+	dst += (left - alpha->Left()) * 2 + (int64)(top - alpha->Top()) * dstBPR;
 
-			dstHandle += 1;
-			srcHandle += 4;
-		}
-		dst += dstBPR;
+	for (int32 y = 0; y < height; y++) {
+		const uint16* s = (const uint16*)src;
+		uint16* d = (uint16*)dst;
+		for (int32 x = 0; x < width; x++)
+			d[x] = s[x * 4 + 3];
 		src += srcBPR;
+		dst += dstBPR;
 	}
+}
 
-//	StackBlurFilter filter;
-//	filter.FilterGray16(&alphaBuffer, fLayoutedFilterRadius);
+// _BlurAlpha
+FilterDropShadowSnapshot::ShadowAlphaRef
+FilterDropShadowSnapshot::_BlurAlpha(RenderEngine& engine,
+	AlphaBuffer* alpha) const
+{
+	ShadowAlphaRef shadowAlpha = _FindShadowAlpha(alpha);
+	if (shadowAlpha.Get() != NULL)
+		return shadowAlpha;
 
-	agg::rendering_buffer aggBuffer;
-	aggBuffer.attach(alphaBuffer.Bits(), alphaBuffer.Width(),
-		alphaBuffer.Height(), alphaBuffer.BytesPerRow());
-	agg::pixfmt_gray16 pixelFormat(aggBuffer);
-	
-	agg::stack_blur<agg::gray16, agg::stack_blur_calc_gray<> > stackBlur;
-	stackBlur.blur(pixelFormat, agg::uround(fLayoutedFilterRadius));
-//
-
-	source = alphaBuffer.Bounds();
-	source.InsetBy(extend, extend);
-	source.OffsetBy(fLayoutedOffsetX, fLayoutedOffsetY);
-	source = source & bitmap->Bounds();
-
-	left = (int32)floorf(source.left);
-	top = (int32)floorf(source.top);
-	right = (int32)ceilf(source.right);
-	bottom = (int32)ceilf(source.bottom);
-
-	// reset offsets into bitmaps
-	dst = bitmap->Bits();
-	dstBPR = bitmap->BytesPerRow();
-	src = alphaBuffer.Bits();
-	srcBPR = alphaBuffer.BytesPerRow();
-	dst += (left - bitmap->Left()) * 8 + (top - bitmap->Top()) * dstBPR;
-	src += ((left - (int32)fLayoutedOffsetX) - alphaBuffer.Left()) * 2
-		+ ((top - (int32)fLayoutedOffsetY) - alphaBuffer.Top()) * srcBPR;
-	
-	for (int32 y = top; y <= bottom; y++) {
+	shadowAlpha.SetTo(new(std::nothrow) ShadowAlpha(alpha,
+		fLayoutedFilterRadius), true);
 
-		uint16* d = (uint16*)dst;
-		uint16* s = (uint16*)src;
+	GaussFilter filter(&engine.Scratch());
 
-		for (int32 x = left; x <= right; x++) {
-			agg::rgba16 color(
-				RenderEngine::GammaToLinear(fColor.red),
-				RenderEngine::GammaToLinear(fColor.green),
-				RenderEngine::GammaToLinear(fColor.blue),
-				s[0]);
-			color.premultiply();
+	if (shadowAlpha.Get() == NULL || !shadowAlpha->IsValid()) {
+		// Can't cache it, blur the extracted alpha instead
+		filter.FilterGray16(alpha, fLayoutedFilterRadius,
+			engine.ThreadCount());
+		return ShadowAlphaRef();
+	}
 
-			uint16 alpha = 65535 - d[3];
+	filter.FilterGray16(shadowAlpha->Blurred(), fLayoutedFilterRadius,
+		engine.ThreadCount());
 
-			d[0] = (uint16)((((uint32)color.b * alpha) / 65535) + d[0]);
-			d[1] = (uint16)((((uint32)color.g * alpha) / 65535) + d[1]);
-			d[2] = (uint16)((((uint32)color.r * alpha) / 65535) + d[2]);
-			d[3] = (uint16)(65535 - (((uint32)alpha * (65535 - s[0])) / 65535));
+	_AddShadowAlpha(shadowAlpha.Get());
 
-			d += 4;
-			s += 1;
+	return shadowAlpha;
+}
+
+// _FindShadowAlpha
+FilterDropShadowSnapshot::ShadowAlphaRef
+FilterDropShadowSnapshot::_FindShadowAlpha(const AlphaBuffer* alpha) const
+{
+	// The entries are compared without holding the lock, so that strips
+	// rendered in parallel don't wait for each other.
+	ShadowAlphaRef candidates[kMaxShadowAlphas];
+	int32 count = 0;
+	{
+		AutoLocker<BLocker> _(fShadowAlphaLock);
+		for (int32 i = fShadowAlphas.CountItems() - 1; i >= 0; i--) {
+			ShadowAlpha* shadowAlpha = (ShadowAlpha*)fShadowAlphas.ItemAt(i);
+			if (shadowAlpha->Radius() == fLayoutedFilterRadius
+				&& shadowAlpha->Bounds() == alpha->Bounds()
+				&& count < kMaxShadowAlphas) {
+				candidates[count++].SetTo(shadowAlpha);
+			}
 		}
-		dst += dstBPR;
-		src += srcBPR;
 	}
+
+	for (int32 i = 0; i < count; i++) {
+		if (!candidates[i]->CanProvide(alpha, fLayoutedFilterRadius))
+			continue;
+
+		AutoLocker<BLocker> _(fShadowAlphaLock);
+		// Mark it as the most recently used, unless it was dropped meanwhile
+		if (fShadowAlphas.RemoveItem(candidates[i].Get()))
+			fShadowAlphas.AddItem(candidates[i].Get());
+		return candidates[i];
+	}
+	return ShadowAlphaRef();
 }
 
-// RebuildAreaForDirtyArea
+// _AddShadowAlpha
 void
-FilterDropShadowSnapshot::RebuildAreaForDirtyArea(BRect& area) const
+FilterDropShadowSnapshot::_AddShadowAlpha(ShadowAlpha* shadowAlpha) const
 {
-	// "area" is the area requested to be rendered by this
-	// object.
-	// This function should change the area so that
-	// it includes all pixels outside the given area which
-	// are required by this object to render the given area
-	// correctly.
-	if (fOpacity <= 0.0f)
+	AutoLocker<BLocker> _(fShadowAlphaLock);
+
+	// Entries for the same strip, or for another radius, are outdated.
+	for (int32 i = fShadowAlphas.CountItems() - 1; i >= 0; i--) {
+		ShadowAlpha* other = (ShadowAlpha*)fShadowAlphas.ItemAt(i);
+		if (other->Radius() != shadowAlpha->Radius()
+			|| shadowAlpha->Bounds().Contains(other->Bounds())) {
+			_RemoveShadowAlpha(i);
+		}
+	}
+
+	if (!fShadowAlphas.AddItem(shadowAlpha))
 		return;
+	shadowAlpha->AddReference();
+	fShadowAlphaBytes += shadowAlpha->Bytes();
 
-	BRect source(area);
-	source.OffsetBy(-fLayoutedOffsetX, -fLayoutedOffsetY);
+	while (fShadowAlphas.CountItems() > 1
+		&& (fShadowAlphas.CountItems() > kMaxShadowAlphas
+			|| fShadowAlphaBytes > kMaxShadowAlphaBytes)) {
+		_RemoveShadowAlpha(0);
+	}
+}
 
-	float extend = ceilf(fLayoutedFilterRadius) + 3;
-		// + 3 to account for the required 3 edge pixles
-	source.InsetBy(-extend, -extend);
-	
-	area = area | source;
+// _RemoveShadowAlpha
+void
+FilterDropShadowSnapshot::_RemoveShadowAlpha(int32 index) const
+{
+	// Must be called with the lock held.
+	ShadowAlpha* shadowAlpha = (ShadowAlpha*)fShadowAlphas.RemoveItem(index);
+	fShadowAlphaBytes -= shadowAlpha->Bytes();
+	shadowAlpha->RemoveReference();
 }
 
+// _Composite
+void
+FilterDropShadowSnapshot::_Composite(RenderBuffer* bitmap,
+	const AlphaBuffer* alpha, BRect area, int32 offsetX, int32 offsetY) const
+{
+	int32 left = (int32)area.left;
+	int32 top = (int32)area.top;
+	int32 width = area.IntegerWidth() + 1;
+	int32 height = area.IntegerHeight() + 1;
+
+	uint8* dst = bitmap->Bits();
+	uint32 dstBPR = bitmap->BytesPerRow();
+	const uint8* src = alpha->Bits();
+	uint32 srcBPR = alpha->BytesPerRow();
+
+	dst += (left - bitmap->Left()) * 8 + (int64)(top - bitmap->Top()) * dstBPR;
+	src += (left - offsetX - alpha->Left()) * 2
+		+ (int64)(top - offsetY - alpha->Top()) * srcBPR;
+
+	const uint32 opacity = (uint32)std::max(0.0f,
+		std::min(65535.0f, fOpacity * 65535.0f / 255.0f));
+	const uint32 blue = fLinearColor[0];
+	const uint32 green = fLinearColor[1];
+	const uint32 red = fLinearColor[2];
+
+	// The shadow is composited behind the existing pixels
+	for (int32 y = 0; y < height; y++) {
+		uint16* d = (uint16*)dst;
+		const uint16* s = (const uint16*)src;
+
+		for (int32 x = 0; x < width; x++) {
+			uint32 shadowAlpha = div_65535(s[x] * opacity);
+			uint32 cover = div_65535(shadowAlpha * (65535 - d[3]));
+
+			d[0] = (uint16)(d[0] + div_65535(blue * cover));
+			d[1] = (uint16)(d[1] + div_65535(green * cover));
+			d[2] = (uint16)(d[2] + div_65535(red * cover));
+			d[3] = (uint16)(d[3] + cover);
+
+			d += 4;
+		}
+		dst += dstBPR;
+		src += srcBPR;
+	}
+}
@@ -7,9 +7,13 @@
 #define FILTER_DROP_SHADOW_SNAPSHOT_H
 
 #include <GraphicsDefs.h>
+#include <List.h>
+#include <Locker.h>
 
 #include "ObjectSnapshot.h"
+#include "Referenceable.h"
 
+class AlphaBuffer;
 class FilterDropShadow;
 
 class FilterDropShadowSnapshot : public ObjectSnapshot {
@@ -27,6 +31,24 @@ class FilterDropShadowSnapshot : public ObjectSnapshot {
 									RenderBuffer* bitmap, BRect area) const;
 	virtual	void				RebuildAreaForDirtyArea(BRect& area) const;
 
+ private:
+			class ShadowAlpha;
+			typedef Reference<ShadowAlpha> ShadowAlphaRef;
+
+			void				_UpdateLinearColor();
+			void				_ExtractAlpha(const RenderBuffer* bitmap,
+									AlphaBuffer* alpha) const;
+			ShadowAlphaRef		_BlurAlpha(RenderEngine& engine,
+									AlphaBuffer* alpha) const;
+			ShadowAlphaRef		_FindShadowAlpha(
+									const AlphaBuffer* alpha) const;
+			void				_AddShadowAlpha(
+									ShadowAlpha* shadowAlpha) const;
+			void				_RemoveShadowAlpha(int32 index) const;
+			void				_Composite(RenderBuffer* bitmap,
+									const AlphaBuffer* alpha, BRect area,
+									int32 offsetX, int32 offsetY) const;
+
  private:
 			const FilterDropShadow*	fOriginal;
 			float				fFilterRadius;
@@ -37,6 +59,13 @@ class FilterDropShadowSnapshot : public ObjectSnapshot {
 			double				fLayoutedOffsetX;
 			double				fLayoutedOffsetY;
 			rgb_color			fColor;
+			uint16				fLinearColor[3];
+				// blue, green, red, like the pixels
+
+			mutable	BLocker		fShadowAlphaLock;
+			mutable	BList		fShadowAlphas;
+				// one per strip rendered in parallel, most recently used last
+			mutable	size_t		fShadowAlphaBytes;
 };
 
 #endif // FILTER_DROP_SHADOW_SNAPSHOT_H
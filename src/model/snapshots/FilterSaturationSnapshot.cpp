@@ -7,19 +7,13 @@
 #include <algorithm>
 #include <stdio.h>
 
-#include <Bitmap.h>
-
-#include "rgb_hsv.h"
-#include "support.h"
-
 #include "FilterSaturation.h"
-#include "RenderBuffer.h"
 
 
 // constructor
 FilterSaturationSnapshot::FilterSaturationSnapshot(
 		const FilterSaturation* filter)
-	: ObjectSnapshot(filter)
+	: FilterColorSnapshot(filter)
 	, fOriginal(filter)
 	, fSaturation(filter->Saturation())
 {
@@ -43,80 +37,113 @@ FilterSaturationSnapshot::Original() const
 bool
 FilterSaturationSnapshot::Sync()
 {
-	if (ObjectSnapshot::Sync()) {
+	if (FilterColorSnapshot::Sync()) {
 		fSaturation = fOriginal->Saturation();
 		return true;
 	}
 	return false;
 }
 
-// Render
-void
-FilterSaturationSnapshot::Render(RenderEngine& engine,
-	RenderBuffer* bitmap, BRect area) const
+// IsIdentity
+bool
+FilterSaturationSnapshot::IsIdentity() const
 {
-	if (fSaturation == 1.0f)
-		return;
-
-	area = bitmap->Bounds() & area;
-
-	const int top = (int)area.top;
-	const int bottom = (int)area.bottom;
-	const int left = (int)area.left;
-	const int right = (int)area.right;
-
-	uint8* bits = bitmap->Bits();
-	bits += top * bitmap->BytesPerRow();
-	bits += left * 8;
+	return fSaturation == 1.0f;
+}
 
+// FilterSpan
+void
+FilterSaturationSnapshot::FilterSpan(uint16* p, int32 count) const
+{
 	if (fSaturation < 1.0f) {
 		const int coeff = (int)(std::max(0.0f, fSaturation) * 256.0);
 		const int oneMinusCoeff = 256 - coeff;
 
-		for (int y = top; y <= bottom; y++) {
-			uint16* p = (uint16*)bits;
-			for (int x = left; x <= right; x++) {
-				int lum = 28 * p[0];	// B
-				lum += 151 * p[1];		// G
-				lum += 77 * p[2];		// R
-				lum = lum >> 8;
-
-				p[0] = (p[0] * coeff + lum * oneMinusCoeff) >> 8;
-				p[1] = (p[1] * coeff + lum * oneMinusCoeff) >> 8;
-				p[2] = (p[2] * coeff + lum * oneMinusCoeff) >> 8;
-
-				p += 4;
-			}
-			bits += bitmap->BytesPerRow();
+		int32 i = 0;
+#if defined(__SSE2__)
+		// All of the integer math stays below 2^24, so it is exact in
+		// floats as well.
+		const __m128 coeff4 = _mm_set1_ps(coeff / 256.0f);
+		const __m128 oneMinusCoeff4 = _mm_set1_ps(oneMinusCoeff / 256.0f);
+		for (; i + 4 <= count; i += 4) {
+			PixelQuad quad;
+			LoadPixels(p, quad);
+
+			__m128 lum = _mm_add_ps(_mm_mul_ps(quad.b, _mm_set1_ps(28.0f)),
+				_mm_add_ps(_mm_mul_ps(quad.g, _mm_set1_ps(151.0f)),
+					_mm_mul_ps(quad.r, _mm_set1_ps(77.0f))));
+			lum = _mm_cvtepi32_ps(_mm_cvttps_epi32(
+				_mm_mul_ps(lum, _mm_set1_ps(1.0f / 256.0f))));
+			const __m128 gray = _mm_mul_ps(lum, oneMinusCoeff4);
+
+			quad.b = _mm_add_ps(_mm_mul_ps(quad.b, coeff4), gray);
+			quad.g = _mm_add_ps(_mm_mul_ps(quad.g, coeff4), gray);
+			quad.r = _mm_add_ps(_mm_mul_ps(quad.r, coeff4), gray);
+
+			StorePixels(p, quad);
+			p += 16;
 		}
-	} else {
-		for (int y = top; y <= bottom; y++) {
-			uint16* p = (uint16*)bits;
-			for (int x = left; x <= right; x++) {
-				float b = p[0] / (256.0f * 256.0f);
-				float g = p[1] / (256.0f * 256.0f);
-				float r = p[2] / (256.0f * 256.0f);
+#endif
 
-				float h;
-				float s;
-				float v;
+		for (; i < count; i++) {
+			int lum = 28 * p[0];	// B
+			lum += 151 * p[1];		// G
+			lum += 77 * p[2];		// R
+			lum = lum >> 8;
 
-				RGB_to_HSV(r, g, b, h, s, v);
+			p[0] = (p[0] * coeff + lum * oneMinusCoeff) >> 8;
+			p[1] = (p[1] * coeff + lum * oneMinusCoeff) >> 8;
+			p[2] = (p[2] * coeff + lum * oneMinusCoeff) >> 8;
 
-				s = std::min(1.0f, s * fSaturation);
+			p += 4;
+		}
+	} else {
+		// Scaling the HSV saturation while keeping hue and value moves
+		// every channel away from the value (the maximum channel) by the
+		// same factor. The factor is limited so that the minimum channel
+		// does not drop below zero, which is where the saturation in HSV
+		// space reaches 1.0.
+		int32 i = 0;
+#if defined(__SSE2__)
+		const __m128 saturation4 = _mm_set1_ps(fSaturation);
+		const __m128 one = _mm_set1_ps(1.0f);
+		for (; i + 4 <= count; i += 4) {
+			PixelQuad quad;
+			LoadPixels(p, quad);
+
+			const __m128 value = _mm_max_ps(quad.b,
+				_mm_max_ps(quad.g, quad.r));
+			const __m128 minimum = _mm_min_ps(quad.b,
+				_mm_min_ps(quad.g, quad.r));
+			// Gray pixels keep their value with any factor.
+			const __m128 delta = _mm_max_ps(_mm_sub_ps(value, minimum), one);
+			const __m128 factor = _mm_min_ps(saturation4,
+				_mm_mul_ps(value, Reciprocal(delta)));
+
+			quad.b = _mm_sub_ps(value,
+				_mm_mul_ps(_mm_sub_ps(value, quad.b), factor));
+			quad.g = _mm_sub_ps(value,
+				_mm_mul_ps(_mm_sub_ps(value, quad.g), factor));
+			quad.r = _mm_sub_ps(value,
+				_mm_mul_ps(_mm_sub_ps(value, quad.r), factor));
+
+			StorePixels(p, quad);
+			p += 16;
+		}
+#endif
 
-				HSV_to_RGB(h, s, v, r, g, b);
+		for (; i < count; i++) {
+			const int32 value = std::max(p[0], std::max(p[1], p[2]));
+			const int32 minimum = std::min(p[0], std::min(p[1], p[2]));
+			// Gray pixels keep their value with any factor.
+			const float delta = (float)std::max(value - minimum, (int32)1);
+			const float factor = std::min(fSaturation, value / delta);
 
-				p[0] = constrain_int32_0_65535(
-					(int32)(b * (256.0f * 256.0f)));
-				p[1] = constrain_int32_0_65535(
-					(int32)(g * (256.0f * 256.0f)));
-				p[2] = constrain_int32_0_65535(
-					(int32)(r * (256.0f * 256.0f)));
+			p[0] = (uint16)(value - (value - p[0]) * factor);
+			p[1] = (uint16)(value - (value - p[1]) * factor);
+			p[2] = (uint16)(value - (value - p[2]) * factor);
 
-				p += 4;
-			}
-			bits += bitmap->BytesPerRow();
+			p += 4;
 		}
 	}
 }
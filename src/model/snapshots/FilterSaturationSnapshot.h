@@ -5,11 +5,11 @@
 #ifndef FILTER_SATURATION_SNAPSHOT_H
 #define FILTER_SATURATION_SNAPSHOT_H
 
-#include "ObjectSnapshot.h"
+#include "FilterColorSnapshot.h"
 
 class FilterSaturation;
 
-class FilterSaturationSnapshot : public ObjectSnapshot {
+class FilterSaturationSnapshot : public FilterColorSnapshot {
  public:
 								FilterSaturationSnapshot(
 									const FilterSaturation* filter);
@@ -18,8 +18,10 @@ class FilterSaturationSnapshot : public ObjectSnapshot {
 	virtual	const Object*		Original() const;
 	virtual	bool				Sync();
 
-	virtual	void				Render(RenderEngine& engine,
-									RenderBuffer* bitmap, BRect area) const;
+	// FilterColorSnapshot interface
+	virtual	bool				IsIdentity() const;
+	virtual	void				FilterSpan(uint16* pixels,
+									int32 count) const;
 
  private:
 			const FilterSaturation*		fOriginal;
@@ -11,15 +11,12 @@
 
 #include <Bitmap.h>
 
-#include <agg_blur.h>
-#include <agg_pixfmt_rgba.h>
-#include <agg_rendering_buffer.h>
-
 #include "Filter.h"
 #include "GaussFilter.h"
 #include "LayoutContext.h"
 #include "RenderBuffer.h"
-#include "StackBlurFilter.h"
+#include "RenderEngine.h"
+#include "ScratchArena.h"
 
 
 // constructor
@@ -69,42 +66,32 @@ void
 FilterSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
 	BRect area) const
 {
-	float extend = ceilf(fLayoutedFilterRadius) + 3;
+	float extend = GaussFilter::ExtentForRadius(fLayoutedFilterRadius);
 	BRect source = area;
 	source.InsetBy(-extend, -extend);
+	source = source & bitmap->Bounds();
+	if (!source.IsValid())
+		return;
+
+	// Work on a copy of the source pixels in scratch memory
+	ScratchArena& scratch = engine.Scratch();
+	ScratchArena::Scope scope(scratch);
+
+	uint32 bpr = (source.IntegerWidth() + 1) * 8;
+	uint8* bits = (uint8*)scratch.Allocate(
+		(size_t)bpr * (source.IntegerHeight() + 1));
+	if (bits == NULL)
+		return;
+
+	RenderBuffer buffer(bits, source, bpr);
+	bitmap->CopyTo(&buffer, source);
+
+	// The gauss filter is independent of the radius, unlike the stack blur,
+	// which is limited to a radius of 254.
+	GaussFilter filter(&scratch);
+	filter.FilterRGBA64(&buffer, fLayoutedFilterRadius, engine.ThreadCount());
 
-	RenderBuffer buffer(bitmap, source, false);
-
-// TODO: GaussFilter is broken! Using only the StackBlurFilter here means that
-// radius is clamped to 254.
-//	if (fLayoutedFilterRadius < 254) {
-		// stack blur is really fast and independent
-		// of the filter radius, but limited to 254
-		// filter radius maximum
-//		StackBlurFilter filter;
-//		filter.FilterRGBA64(&buffer, fLayoutedFilterRadius);
-//	} else {
-//		// gauss filter supports any radius and is
-//		// independent of the radius as well, but
-//		// uses floating point math/conversion, so
-//		// it is slower
-//		GaussFilter filter;
-//		filter.FilterRGBA64(&buffer, fLayoutedFilterRadius);
-//	}
-
-	agg::rendering_buffer aggBuffer;
-	aggBuffer.attach(buffer.Bits(), buffer.Width(), buffer.Height(),
-		buffer.BytesPerRow());
-	agg::pixfmt_bgra64_pre pixelFormat(aggBuffer);
-	
-	agg::stack_blur<agg::rgba16, agg::stack_blur_calc_rgba<> > stackBlur;
-	stackBlur.blur(pixelFormat, agg::uround(fLayoutedFilterRadius));
-
-//	agg::recursive_blur<agg::rgba16, agg::recursive_blur_calc_rgba<> > recursiveBlur;
-//	recursiveBlur.blur(pixelFormat, fLayoutedFilterRadius);
-
-	source.InsetBy(extend, extend);
-	buffer.CopyTo(bitmap, source);
+	buffer.CopyTo(bitmap, area);
 }
 
 // RebuildAreaForDirtyArea
@@ -118,8 +105,7 @@ FilterSnapshot::RebuildAreaForDirtyArea(BRect& area) const
 	// are required by this object to render the given area
 	// correctly.
 
-	float extend = ceilf(fLayoutedFilterRadius) + 3;
-		// + 3 to account for the required 3 edge pixles
+	float extend = GaussFilter::ExtentForRadius(fLayoutedFilterRadius);
 	area.InsetBy(-extend, -extend);
 }
 
@@ -11,23 +11,59 @@
 
 #include <Region.h>
 
+#include "AutoLocker.h"
+#include "FilterColorSnapshot.h"
 #include "Layer.h"
 #include "LayoutContext.h"
 #include "Object.h"
 #include "RenderBuffer.h"
 #include "RenderEngine.h"
+#include "RenderTrace.h"
+#include "ScratchArena.h"
+#include "WorkerPool.h"
 
 using std::nothrow;
 
+// Consecutive color filters are applied in runs of at most this many.
+static const int32 kMaxFusedColorFilters = 16;
+
+// Sub-layers are laid out in parallel in at most this many jobs.
+static const int32 kMaxLayoutJobs = 16;
+
+// The bitmaps kept for other zoom levels of all layers together take at
+// most this much memory.
+static const size_t kMaxZoomCacheBytes = 256 * 1024 * 1024;
+
+
+struct LayerSnapshot::LayoutJob {
+	const LayoutContext*	context;
+	LayerSnapshot**			layers;
+	int32					count;
+	int32					threadCount;
+	uint32					flags;
+};
+
+BLocker LayerSnapshot::sZoomCacheLock("layer zoom caches");
+LayerSnapshot::ZoomCache* LayerSnapshot::sFirstZoomCache = NULL;
+LayerSnapshot::ZoomCache* LayerSnapshot::sLastZoomCache = NULL;
+size_t LayerSnapshot::sZoomCacheBytes = 0;
+
 // constructor
 LayerSnapshot::LayerSnapshot(const ::Layer* layer)
 	: ObjectSnapshot(layer)
 	, fOriginal(layer)
 	, fObjects(20)
+	, fColorFilters(20)
 	, fBounds()
 	, fBitmap(NULL)
+	, fBitmapZoomLevel(0.0)
+	, fZoomCacheCount(0)
 	, fGlobalAlpha(255)
 	, fBlendingMode(CompOpSrcOver)
+	, fLayoutValid(false)
+	, fLayoutChangeCounter(0)
+	, fLayoutZoomLevel(0.0)
+	, fLayoutInput()
 {
 	_Sync();
 }
@@ -37,6 +73,7 @@ LayerSnapshot::~LayerSnapshot()
 {
 	_MakeEmpty();
 	delete fBitmap;
+	FlushZoomCaches();
 }
 
 // #pragma mark -
@@ -67,26 +104,55 @@ void
 LayerSnapshot::Layout(LayoutContext& context, uint32 flags)
 {
 //printf("%p->LayerSnapshot::Layout()\n", Original());
+	// Nothing in the sub-tree has changed since the last layout, and
+	// neither has the inherited state.
+	if (!_NeedsLayout(context, flags))
+		return;
+
+	fLayoutValid = false;
+	fLayoutChangeCounter = ChangeCounter();
+	fLayoutZoomLevel = context.ZoomLevel();
+	fLayoutInput = *context.State();
+
 	// Allocate or resize bitmap for caching layer contents
-	BRect zoomedBounds(fBounds);
-	zoomedBounds.left = floorf(zoomedBounds.left * context.ZoomLevel());
-	zoomedBounds.top = floorf(zoomedBounds.top * context.ZoomLevel());
-	zoomedBounds.right = ceilf(zoomedBounds.right * context.ZoomLevel());
-	zoomedBounds.bottom = ceilf(zoomedBounds.bottom * context.ZoomLevel());
+	BRect zoomedBounds = _ZoomedBounds(context.ZoomLevel());
 	if (fBitmap == NULL || zoomedBounds != fBitmap->Bounds()) {
 //printf("  resizing bitmap\n");
-		delete fBitmap;
+		if (fBitmap != NULL) {
+			// The layer has changed its size, the bitmaps kept for other
+			// zoom levels are of no use anymore either.
+			delete fBitmap;
+			FlushZoomCaches();
+		}
+		fBitmapZoomLevel = context.ZoomLevel();
 		fBitmap = new (nothrow) RenderBuffer(zoomedBounds);
-		if (!fBitmap->IsValid())
+		if (fBitmap == NULL || !fBitmap->IsValid())
 			return;
 		fBitmap->Clear(zoomedBounds, (rgb_color){ 0, 0, 0, 0 });
 	}
 
 	ObjectSnapshot::Layout(context, flags);
 
+	// Every object is laid out on a copy of the layer state, the order
+	// does not matter. Sub-layers may be laid out by other threads.
+	bool parallel = false;
+	if (context.ThreadCount() > 1) {
+		int32 dirtySubLayers = 0;
+		int32 count = CountObjects();
+		for (int32 i = 0; i < count && dirtySubLayers < 2; i++) {
+			LayerSnapshot* layer = dynamic_cast<LayerSnapshot*>(
+				ObjectAtFast(i));
+			if (layer != NULL && layer->_NeedsLayout(context, flags))
+				dirtySubLayers++;
+		}
+		parallel = dirtySubLayers >= 2;
+	}
+
 	int32 count = CountObjects();
 	for (int32 i = 0; i < count; i++) {
 		ObjectSnapshot* snapshot = ObjectAtFast(i);
+		if (parallel && dynamic_cast<LayerSnapshot*>(snapshot) != NULL)
+			continue;
 
 		LayoutState objectState(context.State());
 		context.PushState(&objectState);
@@ -95,6 +161,11 @@ LayerSnapshot::Layout(LayoutContext& context, uint32 flags)
 
 		context.PopState();
 	}
+
+	if (parallel)
+		_LayoutSubLayersInParallel(context, flags);
+
+	fLayoutValid = true;
 }
 
 // Render
@@ -149,7 +220,12 @@ LayerSnapshot::Render(RenderEngine& engine, BRect area, RenderBuffer* bitmap,
 
 	// calculate the required *rebuild area* at each object
 	// index, from the top object to the lowest object
-	BRect dirtyAreas[count];
+	ScratchArena::Scope scope(engine.Scratch());
+	BRect* dirtyAreas = (BRect*)engine.Scratch().Allocate(
+		count * sizeof(BRect));
+	if (dirtyAreas == NULL)
+		return BRect();
+
 	BRect rebuildArea = visuallyChangedArea;
 	for (int32 i = count - 1; i >= 0; i--) {
 		dirtyAreas[i] = rebuildArea;
@@ -168,7 +244,7 @@ LayerSnapshot::Render(RenderEngine& engine, BRect area, RenderBuffer* bitmap,
 	uint32 height = rebuildArea.IntegerHeight() + 1;
 	uint32 bpr = bitmap->BytesPerRow();
 
-	bits += (int32)rebuildArea.top * bpr;
+	bits += (int64)rebuildArea.top * bpr;
 	bits += (int32)rebuildArea.left * 8;
 
 	// clean out bitmap
@@ -182,17 +258,64 @@ LayerSnapshot::Render(RenderEngine& engine, BRect area, RenderBuffer* bitmap,
 
 	engine.AttachTo(bitmap);
 
+	// Color filters don't extend the dirty area, so a run of them can be
+	// applied in one pass over the buffer instead of one pass each.
+	const FilterColorSnapshot* colorFilters[kMaxFusedColorFilters];
+	int32 colorFilterCount = 0;
+	BRect colorFilterArea;
+
 	for (int32 i = 0; i < count; i++) {
+		if (engine.IsCancelled()) {
+			// The render pass has been abandoned, the result would be
+			// thrown away. The layer bitmap keeps its previous contents.
+			return BRect();
+		}
+
 		ObjectSnapshot* object = ObjectAtFast(i);
 		if (!object->IsVisible())
 			continue;
+
+		RenderTraceSpan prepareSpan("PrepareRendering", "object");
+		prepareSpan.SetObject(object->Name());
 		object->PrepareRendering(layerBounds);
+		prepareSpan.End();
+
+		const FilterColorSnapshot* colorFilter
+			= (const FilterColorSnapshot*)fColorFilters.ItemAt(i);
+		if (colorFilter != NULL) {
+			if (colorFilter->IsIdentity())
+				continue;
+			if (colorFilterCount == kMaxFusedColorFilters
+				|| (colorFilterCount > 0
+					&& colorFilterArea != dirtyAreas[i])) {
+				FilterColorSnapshot::RenderFused(colorFilters,
+					colorFilterCount, bitmap, colorFilterArea);
+				colorFilterCount = 0;
+			}
+			colorFilterArea = dirtyAreas[i];
+			colorFilters[colorFilterCount++] = colorFilter;
+			continue;
+		}
+
+		if (colorFilterCount > 0) {
+			FilterColorSnapshot::RenderFused(colorFilters, colorFilterCount,
+				bitmap, colorFilterArea);
+			colorFilterCount = 0;
+		}
 
 		engine.SetClipping(dirtyAreas[i]);
 
+		RenderTraceSpan renderSpan("Render", "object");
+		renderSpan.SetObject(object->Name());
+		renderSpan.SetArea(dirtyAreas[i]);
 		object->Render(engine, bitmap, dirtyAreas[i]);
 	}
 
+	if (colorFilterCount > 0) {
+		FilterColorSnapshot::RenderFused(colorFilters, colorFilterCount,
+			bitmap, colorFilterArea);
+	}
+
 	// return the final visually changed area
 	visuallyChangedArea = visuallyChangedArea & bitmap->Bounds();
 //printf("transfer: "); largestDirtyArea.PrintToStream();
@@ -200,6 +323,99 @@ LayerSnapshot::Render(RenderEngine& engine, BRect area, RenderBuffer* bitmap,
 	return visuallyChangedArea;
 }
 
+// SwitchZoomLevel
+bool
+LayerSnapshot::SwitchZoomLevel(double zoomLevel, const BRect& staleArea,
+	BRect& restoredStaleArea)
+{
+	// Take out the bitmap kept for the new zoom level first, so that it
+	// is not the one dropped to make room for the current one.
+	AutoLocker<BLocker> locker(sZoomCacheLock);
+
+	RenderBuffer* bitmap = NULL;
+	for (int32 i = 0; i < fZoomCacheCount; i++) {
+		if (fZoomCaches[i]->zoomLevel != zoomLevel)
+			continue;
+		restoredStaleArea = fZoomCaches[i]->staleArea;
+		bitmap = _RemoveZoomCache(i);
+		break;
+	}
+
+	// Keep the current bitmap, the most recently used one goes first.
+	if (fBitmap != NULL && fBitmapZoomLevel != zoomLevel) {
+		if (fZoomCacheCount == MAX_ZOOM_CACHES)
+			delete _RemoveZoomCache(fZoomCacheCount - 1);
+
+		ZoomCache* cache = new(nothrow) ZoomCache;
+		if (cache != NULL) {
+			cache->layer = this;
+			cache->zoomLevel = fBitmapZoomLevel;
+			cache->bitmap = fBitmap;
+			cache->staleArea = staleArea;
+
+			for (int32 i = fZoomCacheCount; i > 0; i--)
+				fZoomCaches[i] = fZoomCaches[i - 1];
+			fZoomCaches[0] = cache;
+			fZoomCacheCount++;
+
+			cache->previous = sLastZoomCache;
+			cache->next = NULL;
+			if (sLastZoomCache != NULL)
+				sLastZoomCache->next = cache;
+			else
+				sFirstZoomCache = cache;
+			sLastZoomCache = cache;
+			sZoomCacheBytes += fBitmap->BitsLength();
+
+			_TrimZoomCaches();
+		} else
+			delete fBitmap;
+		fBitmap = NULL;
+	}
+
+	locker.Unlock();
+
+	if (bitmap == NULL) {
+		if (fBitmap == NULL)
+			return false;
+		// The current bitmap is already for this zoom level.
+		restoredStaleArea = staleArea;
+		return true;
+	}
+
+	// The kept bitmap is only of use while the layer has the same size,
+	// otherwise Layout() would replace it.
+	if (bitmap->Bounds() != _ZoomedBounds(zoomLevel)) {
+		delete bitmap;
+		return false;
+	}
+
+	delete fBitmap;
+	fBitmap = bitmap;
+	fBitmapZoomLevel = zoomLevel;
+	return true;
+}
+
+// InvalidateZoomCaches
+void
+LayerSnapshot::InvalidateZoomCaches(const BRect& area)
+{
+	AutoLocker<BLocker> _(sZoomCacheLock);
+
+	for (int32 i = 0; i < fZoomCacheCount; i++)
+		fZoomCaches[i]->staleArea = fZoomCaches[i]->staleArea | area;
+}
+
+// FlushZoomCaches
+void
+LayerSnapshot::FlushZoomCaches()
+{
+	AutoLocker<BLocker> _(sZoomCacheLock);
+
+	while (fZoomCacheCount > 0)
+		delete _RemoveZoomCache(fZoomCacheCount - 1);
+}
+
 // #pragma mark -
 
 // ObjectAt
@@ -295,6 +511,17 @@ LayerSnapshot::_Sync()
 		delete snapshot;
 	}
 
+	// Which objects can be fused only changes here. Should the list not
+	// be complete, the missing filters are rendered one by one.
+	fColorFilters.MakeEmpty();
+	count = CountObjects();
+	for (int32 i = 0; i < count; i++) {
+		if (!fColorFilters.AddItem(
+				dynamic_cast<FilterColorSnapshot*>(ObjectAtFast(i)))) {
+			break;
+		}
+	}
+
 	fBounds = fOriginal->Bounds();
 	fGlobalAlpha = fOriginal->GlobalAlpha();
 	fBlendingMode = fOriginal->BlendingMode();
@@ -309,5 +536,149 @@ LayerSnapshot::_MakeEmpty()
 	for (int32 i = 0; i < count; i++)
 		delete ObjectAtFast(i);
 	fObjects.MakeEmpty();
+	fColorFilters.MakeEmpty();
+}
+
+// _ZoomedBounds
+BRect
+LayerSnapshot::_ZoomedBounds(double zoomLevel) const
+{
+	BRect zoomedBounds(fBounds);
+	zoomedBounds.left = floorf(zoomedBounds.left * zoomLevel);
+	zoomedBounds.top = floorf(zoomedBounds.top * zoomLevel);
+	zoomedBounds.right = ceilf(zoomedBounds.right * zoomLevel);
+	zoomedBounds.bottom = ceilf(zoomedBounds.bottom * zoomLevel);
+	return zoomedBounds;
+}
+
+// _NeedsLayout
+bool
+LayerSnapshot::_NeedsLayout(const LayoutContext& context, uint32 flags) const
+{
+	// The change counter of a layer changes with any object in its
+	// sub-tree.
+	return !fLayoutValid || flags != 0
+		|| fLayoutChangeCounter != ChangeCounter()
+		|| fLayoutZoomLevel != context.ZoomLevel()
+		|| fLayoutInput != *context.State();
+}
+
+// _LayoutSubLayersInParallel
+void
+LayerSnapshot::_LayoutSubLayersInParallel(LayoutContext& context,
+	uint32 flags)
+{
+	int32 count = CountObjects();
+	LayerSnapshot** layers = new(nothrow) LayerSnapshot*[count];
+	if (layers == NULL) {
+		// Out of memory, lay them out one after the other.
+		for (int32 i = 0; i < count; i++) {
+			LayerSnapshot* layer = dynamic_cast<LayerSnapshot*>(
+				ObjectAtFast(i));
+			if (layer == NULL)
+				continue;
+
+			LayoutState objectState(context.State());
+			context.PushState(&objectState);
+
+			layer->Layout(context, flags);
+
+			context.PopState();
+		}
+		return;
+	}
+
+	int32 layerCount = 0;
+	for (int32 i = 0; i < count; i++) {
+		LayerSnapshot* layer = dynamic_cast<LayerSnapshot*>(ObjectAtFast(i));
+		if (layer != NULL && layer->_NeedsLayout(context, flags))
+			layers[layerCount++] = layer;
+	}
+
+	int32 jobCount = min_c(min_c(context.ThreadCount(), layerCount),
+		kMaxLayoutJobs);
+	jobCount = max_c(1, jobCount);
+
+	// Each job gets a consecutive range of the sub-layers, and its share
+	// of the threads for laying out their sub-layers in turn.
+	LayoutJob jobs[kMaxLayoutJobs];
+	for (int32 i = 0; i < jobCount; i++) {
+		int32 first = i * layerCount / jobCount;
+		int32 last = (i + 1) * layerCount / jobCount;
+		jobs[i].context = &context;
+		jobs[i].layers = layers + first;
+		jobs[i].count = last - first;
+		jobs[i].threadCount = max_c(1, context.ThreadCount() / jobCount);
+		jobs[i].flags = flags;
+	}
+
+	WorkerPool::Default()->Run(&_LayoutJob, jobs, jobCount);
+
+	delete[] layers;
+}
+
+// _LayoutJob
+/*static*/ void
+LayerSnapshot::_LayoutJob(void* cookie, int32 index)
+{
+	_LayoutSubLayers(reinterpret_cast<LayoutJob*>(cookie)[index]);
+}
+
+// _LayoutSubLayers
+/*static*/ void
+LayerSnapshot::_LayoutSubLayers(LayoutJob& job)
+{
+	// The copy shares the current state of the parent layer, which is
+	// only read while the sub-layers push their own states on top of it.
+	LayoutContext context(*job.context);
+	context.SetThreadCount(job.threadCount);
+
+	for (int32 i = 0; i < job.count; i++) {
+		LayoutState objectState(context.State());
+		context.PushState(&objectState);
+
+		job.layers[i]->Layout(context, job.flags);
+
+		context.PopState();
+	}
+}
+
+// _RemoveZoomCache
+RenderBuffer*
+LayerSnapshot::_RemoveZoomCache(int32 index)
+{
+	ZoomCache* cache = fZoomCaches[index];
+	fZoomCacheCount--;
+	for (int32 i = index; i < fZoomCacheCount; i++)
+		fZoomCaches[i] = fZoomCaches[i + 1];
+
+	if (cache->previous != NULL)
+		cache->previous->next = cache->next;
+	else
+		sFirstZoomCache = cache->next;
+	if (cache->next != NULL)
+		cache->next->previous = cache->previous;
+	else
+		sLastZoomCache = cache->previous;
+
+	RenderBuffer* bitmap = cache->bitmap;
+	sZoomCacheBytes -= bitmap->BitsLength();
+	delete cache;
+	return bitmap;
+}
+
+// _TrimZoomCaches
+/*static*/ void
+LayerSnapshot::_TrimZoomCaches()
+{
+	while (sZoomCacheBytes > kMaxZoomCacheBytes && sFirstZoomCache != NULL) {
+		LayerSnapshot* layer = sFirstZoomCache->layer;
+		for (int32 i = layer->fZoomCacheCount - 1; i >= 0; i--) {
+			if (layer->fZoomCaches[i] == sFirstZoomCache) {
+				delete layer->_RemoveZoomCache(i);
+				break;
+			}
+		}
+	}
 }
 
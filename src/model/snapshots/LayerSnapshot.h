@@ -6,8 +6,10 @@
 #define LAYER_SNAPSHOT_H
 
 #include <List.h>
+#include <Locker.h>
 
 #include "BlendingMode.h"
+#include "LayoutState.h"
 #include "ObjectSnapshot.h"
 
 class RenderBuffer;
@@ -42,20 +44,80 @@ public:
 									BRegion& validCacheRegion,
 									int32& cacheLevel) const;
 
+			// The layer bitmaps of the most recently used other zoom
+			// levels are kept, together with the areas (in document
+			// coordinates) which are not up to date in them. Switching
+			// back to such a zoom level returns true and the area which
+			// needs to be rendered again. The kept bitmaps of all layers
+			// share one memory budget, the least recently used ones are
+			// deleted first. Must only be called while nothing is being
+			// rendered.
+			bool				SwitchZoomLevel(double zoomLevel,
+									const BRect& staleArea,
+									BRect& restoredStaleArea);
+			void				InvalidateZoomCaches(const BRect& area);
+			void				FlushZoomCaches();
+
 			ObjectSnapshot*		ObjectAt(int32 index) const;
 			ObjectSnapshot*		ObjectAtFast(int32 index) const;
 			int32				CountObjects() const;
 
  private:
+			struct LayoutJob;
+			struct ZoomCache {
+				LayerSnapshot*	layer;
+				double			zoomLevel;
+				RenderBuffer*	bitmap;
+				BRect			staleArea;
+
+				// of all layers, in the order of their last use, the
+				// most recent last
+				ZoomCache*		previous;
+				ZoomCache*		next;
+			};
+
+			enum {
+				MAX_ZOOM_CACHES	= 2
+			};
+
 			void				_Sync();
 			void				_MakeEmpty();
+			BRect				_ZoomedBounds(double zoomLevel) const;
+
+			bool				_NeedsLayout(const LayoutContext& context,
+									uint32 flags) const;
+			void				_LayoutSubLayersInParallel(
+									LayoutContext& context, uint32 flags);
+	static	void				_LayoutJob(void* cookie, int32 index);
+	static	void				_LayoutSubLayers(LayoutJob& job);
+
+			RenderBuffer*		_RemoveZoomCache(int32 index);
+	static	void				_TrimZoomCaches();
 
 			const ::Layer*		fOriginal;
 			BList				fObjects;
+			// The FilterColorSnapshot at each index of fObjects, or NULL,
+			// as found by the last _Sync().
+			BList				fColorFilters;
 			BRect				fBounds;
 			RenderBuffer*		fBitmap;
+			double				fBitmapZoomLevel;
+			ZoomCache*			fZoomCaches[MAX_ZOOM_CACHES];
+			int32				fZoomCacheCount;
 			uint8				fGlobalAlpha;
 			::BlendingMode		fBlendingMode;
+
+			// What the last Layout() depended on, the layout of the
+			// sub-tree is still valid as long as that did not change.
+			bool				fLayoutValid;
+			uint32				fLayoutChangeCounter;
+			double				fLayoutZoomLevel;
+			LayoutState			fLayoutInput;
+
+	static	BLocker				sZoomCacheLock;
+	static	ZoomCache*			sFirstZoomCache;
+	static	ZoomCache*			sLastZoomCache;
+	static	size_t				sZoomCacheBytes;
 };
 
 #endif // LAYER_SNAPSHOT_H
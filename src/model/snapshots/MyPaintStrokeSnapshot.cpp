@@ -0,0 +1,107 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#include "MyPaintStrokeSnapshot.h"
+
+#include <math.h>
+
+#include "Interpolation.h"
+#include "MyPaintStroke.h"
+#include "RenderBuffer.h"
+#include "RenderEngine.h"
+
+// Above this number of pixels, the tiles are drawn one by one instead of
+// composing them into one buffer first.
+static const int32 kMaxComposedPixels = 1024 * 1024;
+
+// constructor
+MyPaintStrokeSnapshot::MyPaintStrokeSnapshot(const MyPaintStroke* stroke)
+	: BoundedObjectSnapshot(stroke)
+	, fOriginal(stroke)
+	, fSurface(stroke->Surface())
+{
+}
+
+// destructor
+MyPaintStrokeSnapshot::~MyPaintStrokeSnapshot()
+{
+}
+
+// #pragma mark -
+
+// Original
+const Object*
+MyPaintStrokeSnapshot::Original() const
+{
+	return fOriginal;
+}
+
+// Sync
+bool
+MyPaintStrokeSnapshot::Sync()
+{
+	if (BoundedObjectSnapshot::Sync()) {
+		// Only references the tiles which changed.
+		fSurface = fOriginal->Surface();
+		return true;
+	}
+	return false;
+}
+
+// Render
+void
+MyPaintStrokeSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
+	BRect area) const
+{
+	if (!fSurface.Bounds().IsValid())
+		return;
+
+	const Transformable& matrix = LayoutedState().Matrix;
+	engine.SetTransformation(matrix);
+
+	// The pixels of the surface which contribute to the area, with a margin
+	// for the bilinear filter.
+	Transformable inverse(matrix);
+	inverse.Invert();
+	BRect source = inverse.TransformBounds(area);
+	source.left = floorf(source.left) - 2;
+	source.top = floorf(source.top) - 2;
+	source.right = ceilf(source.right) + 2;
+	source.bottom = ceilf(source.bottom) + 2;
+	source = source & fSurface.Bounds();
+	if (!source.IsValid())
+		return;
+
+	int32 width = source.IntegerWidth() + 1;
+	int32 height = source.IntegerHeight() + 1;
+	if ((int64)width * height <= kMaxComposedPixels) {
+		// Compose the tiles, so that the bilinear filter does not leave
+		// seams at the tile borders.
+		ScratchArena::Scope scope(engine.Scratch());
+		uint32 bpr = width * 8;
+		uint8* bits = (uint8*)engine.Scratch().Allocate(bpr * height);
+		if (bits == NULL)
+			return;
+
+		RenderBuffer buffer(bits, source, bpr);
+		fSurface.CopyTo(&buffer, source);
+		engine.DrawImage(&buffer, area, INTERPOLATION_BILINEAR, Opacity());
+		return;
+	}
+
+	// Zoomed out far, the seams are hardly visible and the composed
+	// buffer would be large.
+	int32 firstX = (int32)source.left >> TiledSurface::TILE_SHIFT;
+	int32 firstY = (int32)source.top >> TiledSurface::TILE_SHIFT;
+	int32 lastX = (int32)source.right >> TiledSurface::TILE_SHIFT;
+	int32 lastY = (int32)source.bottom >> TiledSurface::TILE_SHIFT;
+	for (int32 y = firstY; y <= lastY; y++) {
+		for (int32 x = firstX; x <= lastX; x++) {
+			if (const RenderBuffer* tile = fSurface.TileAt(x, y)) {
+				engine.DrawImage(tile, area, INTERPOLATION_BILINEAR,
+					Opacity());
+			}
+		}
+	}
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#ifndef MY_PAINT_STROKE_SNAPSHOT_H
+#define MY_PAINT_STROKE_SNAPSHOT_H
+
+#include "BoundedObjectSnapshot.h"
+#include "TiledSurface.h"
+
+class MyPaintStroke;
+
+class MyPaintStrokeSnapshot : public BoundedObjectSnapshot {
+public:
+								MyPaintStrokeSnapshot(
+									const MyPaintStroke* stroke);
+	virtual						~MyPaintStrokeSnapshot();
+
+	virtual	const Object*		Original() const;
+	virtual	bool				Sync();
+
+	virtual	void				Render(RenderEngine& engine,
+									RenderBuffer* bitmap, BRect area) const;
+
+private:
+			const MyPaintStroke*	fOriginal;
+			// Shares the tiles with the surface of the original.
+			TiledSurface		fSurface;
+};
+
+#endif // MY_PAINT_STROKE_SNAPSHOT_H
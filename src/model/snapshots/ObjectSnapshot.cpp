@@ -9,6 +9,7 @@
 // constructor
 ObjectSnapshot::ObjectSnapshot(const Object* object)
 	: Transformable(object->LocalTransformation())
+	, fName(object->Name())
 	, fChangeCounter(object->ChangeCounter())
 	, fIsVisible(object->IsVisible())
 {
@@ -31,6 +32,7 @@ ObjectSnapshot::Sync()
 	SetTransformable(Original()->LocalTransformation());
 	fChangeCounter = Original()->ChangeCounter();
 	fIsVisible = Original()->IsVisible();
+	fName = Original()->Name();
 	return true;
 }
 
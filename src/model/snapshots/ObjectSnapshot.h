@@ -6,6 +6,7 @@
 #define OBJECT_SNAPSHOT_H
 
 #include <Rect.h>
+#include <String.h>
 
 #include "LayoutContext.h"
 #include "LayoutState.h"
@@ -44,7 +45,17 @@ public:
 	inline	bool				IsVisible() const
 									{ return fIsVisible; }
 
+	// The change counter of the original as of the last Sync().
+	inline	uint32				ChangeCounter() const
+									{ return fChangeCounter; }
+
+	// The name of the original, as of the last time the snapshot changed.
+	// Used to identify the object in render traces.
+	inline	const char*			Name() const
+									{ return fName.String(); }
+
 private:
+			BString				fName;
 			uint32				fChangeCounter;
 			LayoutState			fLayoutedState;
 			bool				fIsVisible;
@@ -10,6 +10,7 @@
 #include <agg_conv_contour.h>
 
 #include "AutoLocker.h"
+#include "RenderTrace.h"
 #include "Shape.h"
 
 // constructor
@@ -73,8 +74,6 @@ ShapeSnapshot::Layout(LayoutContext& context, uint32 flags)
 		atomic_set(&fNeedsRasterizing, 1);
 }
 
-#define PRINT_TIMING 0
-
 // PrepareRendering
 void
 ShapeSnapshot::PrepareRendering(BRect documentBounds)
@@ -82,27 +81,22 @@ ShapeSnapshot::PrepareRendering(BRect documentBounds)
 	if (atomic_get(&fNeedsRasterizing) == 0)
 		return;
 
+	RenderTraceSpan lockSpan("wait for rasterizer", "lock");
+	lockSpan.SetObject(Name());
 	AutoLocker<BLocker> lock(fRasterizerLock);
+	lockSpan.End();
 	if (!lock.IsLocked())
 		return;
 
-	if (atomic_get(&fNeedsRasterizing) == 0) {
-#if PRINT_TIMING
-printf("PrepareRendering(): already prepared\n");
-#endif
+	// Another render thread may have done the work while we were waiting.
+	if (atomic_get(&fNeedsRasterizing) == 0)
 		return;
-	}
 
-#if PRINT_TIMING
-bigtime_t now = system_time();
-#endif
+	RenderTraceSpan span("rasterize", "object");
+	span.SetObject(Name());
 
 	_RasterizeShape(fRasterizer, documentBounds);
 
-#if PRINT_TIMING
-printf("PrepareRendering(): %lld\n", system_time() - now);
-#endif
-
 	atomic_set(&fNeedsRasterizing, 0);
 }
 
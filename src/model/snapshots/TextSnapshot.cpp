@@ -64,6 +64,14 @@ TextSnapshot::Render(RenderEngine& engine, RenderBuffer* bitmap,
 	renderer.setTransformation(LayoutedState().Matrix);
 	renderer.setGrayScale(true);
 
+	// Only the glyphs intersecting the render area are rasterized.
+	area = area & bitmap->Bounds().OffsetToCopy(B_ORIGIN);
+	if (!area.IsValid())
+		return;
+	renderer.setClipping((int)floorf(area.left), (int)floorf(area.top),
+		(int)ceilf(area.right) - (int)floorf(area.left),
+		(int)ceilf(area.bottom) - (int)floorf(area.top));
+
 	if (FontCache::getInstance()->ReadLock()) {
 		renderer.drawText(
 			const_cast<TextLayout*>(&fTextLayout),
@@ -11,7 +11,7 @@ scale_bitmap(const BBitmap* bitmap, BRect newBounds)
 {
 	// create the new bitmap
 	BBitmap* scaledBitmap = new(std::nothrow) BBitmap(newBounds,
-		B_BITMAP_ACCEPTS_VIEWS, B_RGBA32);
+		B_BITMAP_ACCEPTS_VIEWS, bitmap->ColorSpace());
 	if (scaledBitmap == NULL || !scaledBitmap->IsValid()) {
 		delete scaledBitmap;
 		return NULL;
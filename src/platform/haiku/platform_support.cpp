@@ -1,10 +1,15 @@
 #include "support.h"
 
+#include <new>
 #include <stdlib.h>
 
 #include <Application.h>
+#include <Directory.h>
+#include <FindDirectory.h>
+#include <Path.h>
 #include <Resources.h>
 #include <Roster.h>
+#include <String.h>
 #include <UTF8.h>
 
 
@@ -17,15 +22,51 @@ get_optimal_worker_thread_count()
 }
 
 
-status_t
-get_app_resources(BResources& resources)
+static BResources*
+load_app_resources()
 {
 	app_info info;
-	status_t status = be_app->GetAppInfo(&info);
+	if (be_app->GetAppInfo(&info) != B_OK)
+		return NULL;
+
+	BResources* resources = new(std::nothrow) BResources;
+	if (resources == NULL)
+		return NULL;
+
+	if (resources->SetTo(&info.ref) != B_OK) {
+		delete resources;
+		return NULL;
+	}
+
+	return resources;
+}
+
+
+BResources*
+get_app_resources()
+{
+	static BResources* appResources = load_app_resources();
+	return appResources;
+}
+
+
+status_t
+get_cache_directory(const char* name, BString& path)
+{
+	BPath cachePath;
+	status_t status = find_directory(B_USER_CACHE_DIRECTORY, &cachePath,
+		true);
+	if (status == B_OK)
+		status = cachePath.Append("WonderBrush");
+	if (status == B_OK)
+		status = cachePath.Append(name);
+	if (status == B_OK)
+		status = create_directory(cachePath.Path(), 0755);
 	if (status != B_OK)
 		return status;
 
-	return resources.SetTo(&info.ref);
+	path = cachePath.Path();
+	return B_OK;
 }
 
 
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "PlatformResourceBundle.h"
+
+#include <string.h>
+
+#include <Resources.h>
+
+#include <QByteArray>
+#include <QtEndian>
+
+
+static const uint32 kBundleMagic = 'WBRB';
+static const uint32 kBundleVersion = 1;
+
+static const size_t kHeaderFields = 4;
+static const size_t kEntryFields = 6;
+static const size_t kDataAlignment = 8;
+
+
+static inline uint32
+read_uint32(const uint8* data)
+{
+	return qFromLittleEndian<quint32>(data);
+}
+
+
+static inline void
+write_uint32(QByteArray& bundle, size_t offset, uint32 value)
+{
+	qToLittleEndian<quint32>(value, (uchar*)bundle.data() + offset);
+}
+
+
+/*static*/ status_t
+PlatformResourceBundle::Flatten(const BResources& resources,
+	QByteArray& _bundle)
+{
+	int32 count = resources.CountResources();
+
+	// compute the layout
+	size_t stringsOffset = (kHeaderFields + count * kEntryFields)
+		* sizeof(uint32);
+	size_t size = stringsOffset;
+	for (int32 i = 0; i < count; i++) {
+		const char* name;
+		resources.GetResourceInfo(i, NULL, NULL, &name, NULL);
+		size += strlen(name) + 1;
+	}
+	size_t dataOffset = size;
+	for (int32 i = 0; i < count; i++) {
+		size_t dataSize;
+		resources.GetResourceInfo(i, NULL, NULL, NULL, &dataSize);
+		size = (size + kDataAlignment - 1) & ~(kDataAlignment - 1);
+		size += dataSize;
+	}
+
+	try {
+		_bundle.fill('\0', size);
+	} catch (...) {
+		return B_NO_MEMORY;
+	}
+
+	write_uint32(_bundle, 0, kBundleMagic);
+	write_uint32(_bundle, 4, kBundleVersion);
+	write_uint32(_bundle, 8, count);
+
+	size_t entryOffset = kHeaderFields * sizeof(uint32);
+	size_t nameOffset = stringsOffset;
+	for (int32 i = 0; i < count; i++) {
+		type_code type;
+		int32 id;
+		const char* name;
+		size_t dataSize;
+		resources.GetResourceInfo(i, &type, &id, &name, &dataSize);
+		const void* data = const_cast<BResources&>(resources).LoadResource(
+			type, id, NULL);
+
+		size_t nameSize = strlen(name);
+		dataOffset = (dataOffset + kDataAlignment - 1) & ~(kDataAlignment - 1);
+
+		write_uint32(_bundle, entryOffset, type);
+		write_uint32(_bundle, entryOffset + 4, (uint32)id);
+		write_uint32(_bundle, entryOffset + 8, nameOffset);
+		write_uint32(_bundle, entryOffset + 12, nameSize);
+		write_uint32(_bundle, entryOffset + 16, dataOffset);
+		write_uint32(_bundle, entryOffset + 20, dataSize);
+
+		memcpy(_bundle.data() + nameOffset, name, nameSize);
+		if (dataSize > 0)
+			memcpy(_bundle.data() + dataOffset, data, dataSize);
+
+		entryOffset += kEntryFields * sizeof(uint32);
+		nameOffset += nameSize + 1;
+		dataOffset += dataSize;
+	}
+
+	return B_OK;
+}
+
+
+/*static*/ status_t
+PlatformResourceBundle::Unflatten(const void* bundle, size_t size,
+	BResources& resources)
+{
+	const uint8* bytes = reinterpret_cast<const uint8*>(bundle);
+
+	if (size < kHeaderFields * sizeof(uint32)
+		|| read_uint32(bytes) != kBundleMagic
+		|| read_uint32(bytes + 4) != kBundleVersion) {
+		return B_BAD_DATA;
+	}
+
+	uint32 count = read_uint32(bytes + 8);
+	if (count > (size / sizeof(uint32) - kHeaderFields) / kEntryFields)
+		return B_BAD_DATA;
+
+	resources.Unset();
+
+	const uint8* entry = bytes + kHeaderFields * sizeof(uint32);
+	for (uint32 i = 0; i < count; i++, entry += kEntryFields * sizeof(uint32)) {
+		type_code type = read_uint32(entry);
+		int32 id = (int32)read_uint32(entry + 4);
+		uint32 nameOffset = read_uint32(entry + 8);
+		uint32 nameSize = read_uint32(entry + 12);
+		uint32 dataOffset = read_uint32(entry + 16);
+		uint32 dataSize = read_uint32(entry + 20);
+
+		if (nameOffset > size || nameSize >= size - nameOffset
+			|| dataOffset > size || dataSize > size - dataOffset) {
+			resources.Unset();
+			return B_BAD_DATA;
+		}
+
+		// The data is referenced, not copied.
+		status_t status = resources.AddResource(type, id,
+			QByteArray::fromRawData((const char*)bytes + dataOffset, dataSize),
+			QByteArray::fromRawData((const char*)bytes + nameOffset, nameSize));
+		if (status != B_OK) {
+			resources.Unset();
+			return status;
+		}
+	}
+
+	return B_OK;
+}
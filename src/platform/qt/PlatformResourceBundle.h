@@ -0,0 +1,38 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef PLATFORM_RESOURCE_BUNDLE_H
+#define PLATFORM_RESOURCE_BUNDLE_H
+
+
+#include <SupportDefs.h>
+
+
+class BResources;
+class QByteArray;
+
+
+// A resource bundle is the binary form of the application resources. It is
+// produced at build time from the rdef by the rescompiler tool and linked
+// into the application, so that the resources need no parsing at startup.
+//
+// Layout (all numbers little endian uint32):
+//   header:  magic, version, resource count, reserved
+//   index:   type, id, name offset, name size, data offset, data size
+//   strings: null-terminated resource names
+//   data:    resource data, each 8 byte aligned
+// All offsets are relative to the start of the bundle.
+class PlatformResourceBundle {
+public:
+	static	status_t			Flatten(const BResources& resources,
+									QByteArray& _bundle);
+
+	// Adds the resources of the bundle to "resources" without copying the
+	// data. The bundle memory must stay valid as long as "resources" is used.
+	static	status_t			Unflatten(const void* bundle, size_t size,
+									BResources& resources);
+};
+
+
+#endif // PLATFORM_RESOURCE_BUNDLE_H
@@ -312,9 +312,10 @@ PlatformResourceParser::PlatformResourceParser()
 
 
 status_t
-PlatformResourceParser::ParseAppResources(BResources& resources)
+PlatformResourceParser::ParseResources(const QString& fileName,
+	BResources& resources)
 {
-	QFile rdefFile(QString::fromUtf8(":/resources/rdef"));
+	QFile rdefFile(fileName);
 	if (!rdefFile.open(QFile::ReadOnly))
 		return B_ENTRY_NOT_FOUND;
 
@@ -6,13 +6,15 @@
 
 
 class BResources;
+class QString;
 
 
 class PlatformResourceParser {
 public:
 								PlatformResourceParser();
 
-			status_t			ParseAppResources(BResources& resources);
+			status_t			ParseResources(const QString& fileName,
+									BResources& resources);
 
 private:
 			struct Token;
@@ -1,21 +1,30 @@
 #include "support.h"
 
 #include <Resources.h>
+#include <String.h>
 #include <SupportDefs.h>
 
+#include <QDir>
+#include <QStandardPaths>
 #include <QThread>
 
-#include "PlatformResourceParser.h"
+#include "PlatformResourceBundle.h"
+
+
+// generated from WonderBrush.rdef at build time
+extern const unsigned char kAppResourceBundle[];
+extern const size_t kAppResourceBundleSize;
 
 
 static BResources*
-parse_app_resources()
+load_app_resources()
 {
 	BResources* resources = new(std::nothrow) BResources;
 	if (resources == NULL)
 		return NULL;
 
-	if (PlatformResourceParser().ParseAppResources(*resources) != B_OK) {
+	if (PlatformResourceBundle::Unflatten(kAppResourceBundle,
+			kAppResourceBundleSize, *resources) != B_OK) {
 		delete resources;
 		return NULL;
 	}
@@ -31,17 +40,28 @@ get_optimal_worker_thread_count()
 }
 
 
+BResources*
+get_app_resources()
+{
+	static BResources* appResources = load_app_resources();
+	return appResources;
+}
+
+
 status_t
-get_app_resources(BResources& resources)
+get_cache_directory(const char* name, BString& path)
 {
-	static BResources* appResources = parse_app_resources();
+	QString location = QStandardPaths::writableLocation(
+		QStandardPaths::CacheLocation);
+	if (location.isEmpty())
+		return B_ENTRY_NOT_FOUND;
 
-	if (appResources != NULL) {
-		resources = *appResources;
-		return B_OK;
-	}
+	QString directory = location + QLatin1Char('/') + QString::fromUtf8(name);
+	if (!QDir().mkpath(directory))
+		return B_ERROR;
 
-	return B_ENTRY_NOT_FOUND;
+	path = directory.toUtf8().data();
+	return B_OK;
 }
 
 
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+
+// Compiles the resources of an rdef file into a resource bundle and writes
+// it as a C++ source file defining kAppResourceBundle[Size].
+
+#include <stdio.h>
+
+#include <Resources.h>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "PlatformResourceBundle.h"
+#include "PlatformResourceParser.h"
+
+
+static const int kBytesPerLine = 16;
+
+
+int
+main(int argc, const char* argv[])
+{
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s <input.rdef> <output.cpp>\n", argv[0]);
+		return 1;
+	}
+
+	BResources resources;
+	if (PlatformResourceParser().ParseResources(QString::fromLocal8Bit(argv[1]),
+			resources) != B_OK) {
+		fprintf(stderr, "%s: failed to parse \"%s\"\n", argv[0], argv[1]);
+		return 1;
+	}
+
+	QByteArray bundle;
+	if (PlatformResourceBundle::Flatten(resources, bundle) != B_OK) {
+		fprintf(stderr, "%s: failed to create resource bundle\n", argv[0]);
+		return 1;
+	}
+
+	QByteArray source;
+	source.append("// Generated by rescompiler, do not edit.\n\n");
+	source.append("#include <stddef.h>\n\n");
+	source.append("extern const unsigned char kAppResourceBundle[];\n");
+	source.append("extern const size_t kAppResourceBundleSize;\n\n");
+	source.append("alignas(8) const unsigned char kAppResourceBundle[] = {");
+	for (int i = 0; i < bundle.size(); i++) {
+		if (i % kBytesPerLine == 0)
+			source.append("\n\t");
+		source.append(QByteArray::number((uchar)bundle.at(i)));
+		source.append(i % kBytesPerLine == kBytesPerLine - 1 ? "," : ", ");
+	}
+	source.append("\n};\n\n");
+	source.append("const size_t kAppResourceBundleSize = ");
+	source.append(QByteArray::number(bundle.size()));
+	source.append(";\n");
+
+	QFile output(QString::fromLocal8Bit(argv[2]));
+	if (!output.open(QFile::WriteOnly | QFile::Truncate)
+		|| output.write(source) != source.size()) {
+		fprintf(stderr, "%s: failed to write \"%s\"\n", argv[0], argv[2]);
+		return 1;
+	}
+
+	return 0;
+}
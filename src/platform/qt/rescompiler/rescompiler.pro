@@ -0,0 +1,21 @@
+QT       += core
+QT       -= gui
+
+TARGET = rescompiler
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include (../../../src_common.pro)
+
+
+SOURCES += \
+	rescompiler.cpp \
+	../PlatformResourceBundle.cpp \
+	../PlatformResourceParser.cpp \
+	../system/BResources.cpp
+
+HEADERS += \
+	../PlatformResourceBundle.h \
+	../PlatformResourceParser.h \
+	../system/BResources.h
@@ -83,6 +83,7 @@ void BResources::Unset()
 	foreach (Resource* resource, fResources)
 		delete resource;
 	fResources.clear();
+	fKeys.clear();
 }
 
 
@@ -95,15 +96,18 @@ BResources::AddResource(type_code type, int32 id, const QByteArray& data,
 		return B_NO_MEMORY;
 
 	ResourceKey key(type, id);
-	delete fResources.value(key, NULL);
+	Resource* previous = fResources.value(key, NULL);
 
 	try {
+		if (previous == NULL)
+			fKeys.append(key);
 		fResources.insert(key, resource);
 	} catch (...) {
 		delete resource;
 		return B_NO_MEMORY;
 	}
 
+	delete previous;
 	return B_OK;
 }
 
@@ -122,16 +126,45 @@ BResources::LoadResource(type_code type, int32 id, size_t* _outSize)
 }
 
 
+int32
+BResources::CountResources() const
+{
+	return fKeys.size();
+}
+
+
+bool
+BResources::GetResourceInfo(int32 byIndex, type_code* _type, int32* _id,
+	const char** _name, size_t* _size) const
+{
+	if (byIndex < 0 || byIndex >= fKeys.size())
+		return false;
+
+	const ResourceKey& key = fKeys.at(byIndex);
+	const Resource* resource = fResources.value(key, NULL);
+	if (resource == NULL)
+		return false;
+
+	if (_type != NULL)
+		*_type = key.Type();
+	if (_id != NULL)
+		*_id = key.Id();
+	if (_name != NULL)
+		*_name = resource->Name().constData();
+	if (_size != NULL)
+		*_size = resource->Data().size();
+	return true;
+}
+
+
 BResources&
 BResources::operator=(const BResources& other)
 {
 	Unset();
 
-	for (QHash<ResourceKey, Resource*>::const_iterator it
-				= other.fResources.begin();
-			it != other.fResources.end(); ++it) {
-		const ResourceKey& key = it.key();
-		const Resource* resource = it.value();
+	for (int32 i = 0; i < other.fKeys.size(); i++) {
+		const ResourceKey& key = other.fKeys.at(i);
+		const Resource* resource = other.fResources.value(key);
 		AddResource(key.Type(), key.Id(), resource->Data(), resource->Name());
 	}
 
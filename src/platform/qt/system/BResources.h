@@ -6,6 +6,7 @@
 #include <TypeConstants.h>
 
 #include <QHash>
+#include <QVector>
 
 
 class QByteArray;
@@ -26,6 +27,12 @@ public:
 			const void*			LoadResource(type_code type, int32 id,
 									size_t* _outSize);
 
+			int32				CountResources() const;
+			bool				GetResourceInfo(int32 byIndex,
+									type_code* _type, int32* _id,
+									const char** _name,
+									size_t* _size) const;
+
 			BResources&			operator=(const BResources& other);
 
 private:
@@ -34,6 +41,7 @@ private:
 
 private:
 			QHash<ResourceKey, Resource*> fResources;
+			QVector<ResourceKey> fKeys;
 };
 
 
@@ -37,6 +37,13 @@ AlphaBuffer::AlphaBuffer(uint8* buffer, uint32 width, uint32 height,
 {
 }
 
+// constructor
+AlphaBuffer::AlphaBuffer(uint8* buffer, const BRect& bounds,
+		uint32 bytesPerRow)
+	: PixelBuffer(buffer, bounds, 2, bytesPerRow)
+{
+}
+
 // Attach
 void
 AlphaBuffer::Attach(uint8* buffer, uint32 width, uint32 height,
@@ -47,7 +54,7 @@ AlphaBuffer::Attach(uint8* buffer, uint32 width, uint32 height,
 
 // CropUnclipped
 AlphaBufferRef
-AlphaBuffer::CropUnclipped(BRect bounds) const
+AlphaBuffer::CropUnclipped(BRect bounds)
 {
 	AlphaBuffer* buffer = static_cast<AlphaBuffer*>(_CropUnclipped(bounds));
 	return AlphaBufferRef(buffer, true);
@@ -59,3 +66,10 @@ AlphaBuffer::_Create(const BRect bounds) const
 {
 	return new (std::nothrow) AlphaBuffer(bounds);
 }
+
+// _CreateView
+PixelBuffer*
+AlphaBuffer::_CreateView(uint8* bits, const BRect bounds, uint32 bytesPerRow) const
+{
+	return new (std::nothrow) AlphaBuffer(bits, bounds, bytesPerRow);
+}
@@ -19,15 +19,22 @@ public:
 								AlphaBuffer(uint8* buffer,
 									uint32 width, uint32 height,
 									uint32 bytesPerRow, bool adopt);
+								AlphaBuffer(uint8* buffer,
+									const BRect& bounds,
+									uint32 bytesPerRow);
 
 			void				Attach(uint8* buffer, uint32 width,
 									uint32 height, uint32 bytesPerRow,
 									bool adopt);
 
-			AlphaBufferRef		CropUnclipped(BRect bounds) const;
+			// Shares the pixels with this buffer, if the bounds are inside
+			// of it, see RenderBuffer::CropUnclipped().
+			AlphaBufferRef		CropUnclipped(BRect bounds);
 
 protected:
 	virtual PixelBuffer*		_Create(const BRect bounds) const;
+	virtual PixelBuffer*		_CreateView(uint8* bits, const BRect bounds,
+									uint32 bytesPerRow) const;
 };
 
 #endif // ALPHA_BUFFER_H
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "BufferPool.h"
+
+#include <stdlib.h>
+
+#include "AutoLocker.h"
+
+
+static const size_t kAlignment = 64;
+static const size_t kDefaultMaxCachedBytes = 128 * 1024 * 1024;
+
+
+// Kept memory is linked through its first bytes.
+struct BufferPool::Chunk {
+	Chunk*	next;
+};
+
+
+BufferPool::BufferPool(size_t maxCachedBytes)
+	: fLock("buffer pool")
+	, fMaxCachedBytes(maxCachedBytes)
+	, fCachedBytes(0)
+	, fLiveBytes(0)
+	, fPeakLiveBytes(0)
+	, fHeapAllocationCount(0)
+{
+	for (int32 i = 0; i < SIZE_CLASS_COUNT; i++)
+		fChunks[i] = NULL;
+}
+
+
+BufferPool::~BufferPool()
+{
+	Trim();
+}
+
+
+/*static*/ BufferPool*
+BufferPool::Default()
+{
+	static BufferPool pool(kDefaultMaxCachedBytes);
+	return &pool;
+}
+
+
+uint8*
+BufferPool::Allocate(size_t size, size_t& allocatedSize)
+{
+	allocatedSize = 0;
+
+	size_t classSize;
+	int32 sizeClass = _SizeClassFor(size, classSize);
+	if (sizeClass < 0)
+		return NULL;
+
+	AutoLocker<BLocker> locker(fLock);
+
+	void* memory = fChunks[sizeClass];
+	if (memory != NULL) {
+		fChunks[sizeClass] = fChunks[sizeClass]->next;
+		fCachedBytes -= classSize;
+	} else {
+		fHeapAllocationCount++;
+		locker.Unlock();
+
+		if (posix_memalign(&memory, kAlignment, classSize) != 0)
+			return NULL;
+
+		locker.Lock();
+	}
+
+	fLiveBytes += classSize;
+	if (fLiveBytes > fPeakLiveBytes)
+		fPeakLiveBytes = fLiveBytes;
+
+	allocatedSize = classSize;
+	return reinterpret_cast<uint8*>(memory);
+}
+
+
+void
+BufferPool::Free(uint8* memory, size_t allocatedSize)
+{
+	if (memory == NULL)
+		return;
+
+	size_t classSize;
+	int32 sizeClass = _SizeClassFor(allocatedSize, classSize);
+
+	AutoLocker<BLocker> locker(fLock);
+
+	fLiveBytes -= allocatedSize;
+
+	if (sizeClass < 0 || classSize != allocatedSize
+		|| fCachedBytes + classSize > fMaxCachedBytes) {
+		locker.Unlock();
+		free(memory);
+		return;
+	}
+
+	Chunk* chunk = reinterpret_cast<Chunk*>(memory);
+	chunk->next = fChunks[sizeClass];
+	fChunks[sizeClass] = chunk;
+	fCachedBytes += classSize;
+}
+
+
+void
+BufferPool::Trim()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	for (int32 i = 0; i < SIZE_CLASS_COUNT; i++) {
+		while (fChunks[i] != NULL) {
+			Chunk* chunk = fChunks[i];
+			fChunks[i] = chunk->next;
+			free(chunk);
+		}
+	}
+	fCachedBytes = 0;
+}
+
+
+/*static*/ uint32
+BufferPool::BytesPerRowFor(uint32 width, uint32 bytesPerPixel)
+{
+	return (width * bytesPerPixel + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+
+size_t
+BufferPool::LiveBytes() const
+{
+	AutoLocker<BLocker> _(fLock);
+	return fLiveBytes;
+}
+
+
+size_t
+BufferPool::PeakLiveBytes() const
+{
+	AutoLocker<BLocker> _(fLock);
+	return fPeakLiveBytes;
+}
+
+
+size_t
+BufferPool::CachedBytes() const
+{
+	AutoLocker<BLocker> _(fLock);
+	return fCachedBytes;
+}
+
+
+int32
+BufferPool::HeapAllocationCount() const
+{
+	AutoLocker<BLocker> _(fLock);
+	return fHeapAllocationCount;
+}
+
+
+void
+BufferPool::ResetStatistics()
+{
+	AutoLocker<BLocker> _(fLock);
+	fPeakLiveBytes = fLiveBytes;
+	fHeapAllocationCount = 0;
+}
+
+
+/*static*/ int32
+BufferPool::_SizeClassFor(size_t size, size_t& classSize)
+{
+	// The smallest class is one page, above that there are four classes
+	// per power of two, so that at most a fifth of the memory is wasted.
+	if (size == 0)
+		return -1;
+
+	if (size <= ((size_t)1 << MIN_SIZE_SHIFT)) {
+		classSize = (size_t)1 << MIN_SIZE_SHIFT;
+		return 0;
+	}
+
+	// 2^shift < size <= 2^(shift + 1)
+	int32 shift = 0;
+	for (size_t value = size - 1; value > 1; value >>= 1)
+		shift++;
+	if (shift >= MAX_SIZE_SHIFT)
+		return -1;
+
+	int32 stepShift = shift - 2;
+	size_t base = (size_t)1 << shift;
+	size_t step = (size_t)1 << stepShift;
+	size_t steps = (size - base + step - 1) >> stepShift;
+
+	classSize = base + steps * step;
+	return 1 + 4 * (shift - MIN_SIZE_SHIFT) + (int32)steps - 1;
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <Locker.h>
+#include <SupportDefs.h>
+
+// A process wide pool for the pixel memory of PixelBuffers. Sizes are
+// rounded up to size classes, four per power of two, and released memory is
+// kept per class for the next buffer of a similar size. Such a buffer then
+// needs neither the heap nor fresh pages, which matters for the document
+// sized buffers replaced on every zoom and resize. Only up to a budget of
+// memory is kept. All memory is 64 byte aligned, and PixelBuffers pad their
+// rows to 64 bytes as well, so every row starts on a cache line.
+//
+// A BufferPool is thread-safe.
+class BufferPool {
+public:
+								BufferPool(size_t maxCachedBytes);
+								~BufferPool();
+
+	static	BufferPool*			Default();
+
+	// Returns 64 byte aligned memory of at least the given size, or NULL
+	// when out of memory. The size actually allocated is returned in
+	// allocatedSize and needs to be passed to Free().
+			uint8*				Allocate(size_t size, size_t& allocatedSize);
+			void				Free(uint8* memory, size_t allocatedSize);
+
+	// Gives all kept memory back to the heap.
+			void				Trim();
+
+	static	uint32				BytesPerRowFor(uint32 width,
+									uint32 bytesPerPixel);
+
+	// Bytes handed out and not freed yet, and the most there have been
+	// since the last ResetStatistics().
+			size_t				LiveBytes() const;
+			size_t				PeakLiveBytes() const;
+	// Bytes kept for reuse.
+			size_t				CachedBytes() const;
+	// Allocations since the last ResetStatistics() which could not be
+	// served from the kept memory.
+			int32				HeapAllocationCount() const;
+			void				ResetStatistics();
+
+private:
+			struct Chunk;
+
+			enum {
+				MIN_SIZE_SHIFT		= 12,
+				MAX_SIZE_SHIFT		= 48,
+				SIZE_CLASS_COUNT	= 1 + 4 * (MAX_SIZE_SHIFT - MIN_SIZE_SHIFT)
+			};
+
+	static	int32				_SizeClassFor(size_t size,
+									size_t& classSize);
+
+	mutable	BLocker				fLock;
+			Chunk*				fChunks[SIZE_CLASS_COUNT];
+			size_t				fMaxCachedBytes;
+			size_t				fCachedBytes;
+			size_t				fLiveBytes;
+			size_t				fPeakLiveBytes;
+			int32				fHeapAllocationCount;
+};
+
+#endif // BUFFER_POOL_H
@@ -0,0 +1,676 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "DenoiseFilter.h"
+
+#include <algorithm>
+#include <new>
+
+#include <math.h>
+#include <stdio.h>
+
+// Only the filters of CImg are used, without its display, which would need
+// X11.
+#define cimg_display_type 0
+#include <CImg.h>
+
+#include "AutoLocker.h"
+#include "RenderBuffer.h"
+#include "WorkerPool.h"
+
+// The tiles are aligned to a grid in pixel coordinates, so the same pixels
+// end up in the same tiles, whichever area is filtered.
+static const int32 kTileSize = 256;
+// The results of neighboring tiles are blended over this many pixels on
+// each side of the border between them.
+static const int32 kTileBlend = 8;
+
+// The tiles which were used least recently are forgotten once all tiles
+// together take more memory than this.
+static const size_t kMaxTileBytes = 128 * 1024 * 1024;
+
+// tile_index
+static inline int32
+tile_index(int32 coordinate)
+{
+	if (coordinate >= 0)
+		return coordinate / kTileSize;
+	return -((-coordinate - 1) / kTileSize) - 1;
+}
+
+// to_channel
+static inline uint16
+to_channel(float value)
+{
+	value = value * 257.0f + 0.5f;
+	if (!(value > 0.0f))
+		return 0;
+	if (value > 65535.0f)
+		return 65535;
+	return (uint16)value;
+}
+
+// hash_pixels
+static uint64
+hash_pixels(const RenderBuffer* buffer, const BRect& area)
+{
+	int32 left = (int32)area.left - buffer->Left();
+	int32 top = (int32)area.top - buffer->Top();
+	int32 width = area.IntegerWidth() + 1;
+	int32 height = area.IntegerHeight() + 1;
+	uint32 bpr = buffer->BytesPerRow();
+
+	// FNV-1a over the area, which the bounds of the buffer may have cut
+	// off, and then its whole pixels
+	uint64 hash = 0xcbf29ce484222325ULL;
+	int32 coordinates[4] = { (int32)area.left, (int32)area.top,
+		(int32)area.right, (int32)area.bottom };
+	for (int32 i = 0; i < 4; i++)
+		hash = (hash ^ (uint32)coordinates[i]) * 0x100000001b3ULL;
+
+	const uint8* bits = buffer->Bits() + (int64)top * bpr + left * 8;
+	for (int32 y = 0; y < height; y++) {
+		const uint64* pixel = (const uint64*)bits;
+		for (int32 x = 0; x < width; x++)
+			hash = (hash ^ pixel[x]) * 0x100000001b3ULL;
+		bits += bpr;
+	}
+	return hash;
+}
+
+
+// #pragma mark - DenoiseParameters
+
+
+// constructor
+DenoiseParameters::DenoiseParameters()
+	: amplitude(60.0f)
+	, sharpness(0.7f)
+	, anisotropy(0.6f)
+	, alpha(0.6f)
+	, sigma(1.1f)
+	, dl(0.8f)
+	, da(30.0f)
+	, gaussPrecision(2.0f)
+	, interpolationType(0)
+	, fastApproximation(true)
+{
+}
+
+// Scaled
+DenoiseParameters
+DenoiseParameters::Scaled(float scale) const
+{
+	// The length of the smoothing is proportional to the square root of
+	// the amplitude, the pre-blurring of the structure is a distance.
+	DenoiseParameters parameters(*this);
+	parameters.amplitude = amplitude * scale * scale;
+	parameters.alpha = alpha * scale;
+	parameters.sigma = sigma * scale;
+	return parameters;
+}
+
+// operator==
+bool
+DenoiseParameters::operator==(const DenoiseParameters& other) const
+{
+	return amplitude == other.amplitude
+		&& sharpness == other.sharpness
+		&& anisotropy == other.anisotropy
+		&& alpha == other.alpha
+		&& sigma == other.sigma
+		&& dl == other.dl
+		&& da == other.da
+		&& gaussPrecision == other.gaussPrecision
+		&& interpolationType == other.interpolationType
+		&& fastApproximation == other.fastApproximation;
+}
+
+// operator!=
+bool
+DenoiseParameters::operator!=(const DenoiseParameters& other) const
+{
+	return !(*this == other);
+}
+
+
+// #pragma mark - DenoiseFilter
+
+
+// The denoised color channels of the output area of a tile, and the input
+// area they were computed from.
+struct DenoiseFilter::Tile {
+	Tile()
+		: result(NULL)
+		, bytes(0)
+		, key()
+		, users(0)
+		, previous(NULL)
+		, next(NULL)
+	{
+	}
+
+	~Tile()
+	{
+		delete[] result;
+	}
+
+	inline const uint16* ResultAt(int32 x, int32 y) const
+	{
+		return result + ((y - (int32)output.top) * (output.IntegerWidth() + 1)
+			+ x - (int32)output.left) * 3;
+	}
+
+	BRect			input;
+	BRect			output;
+	uint16*			result;
+	size_t			bytes;
+	TileKey			key;
+	// The requests which compose the tile, it is not forgotten before they
+	// are done.
+	int32			users;
+
+	// in the order of their last use, the most recent last
+	Tile*			previous;
+	Tile*			next;
+};
+
+struct DenoiseFilter::TileRequest {
+	int32			column;
+	int32			row;
+	BRect			input;
+	uint64			inputHash;
+	BRect			output;
+	status_t		status;
+	Tile*			tile;
+};
+
+struct DenoiseFilter::TileJob {
+	DenoiseFilter*		filter;
+	const RenderBuffer*	buffer;
+	TileRequest*		requests;
+};
+
+
+// constructor
+DenoiseFilter::DenoiseFilter()
+	: fParameters()
+	, fExtent(ExtentFor(fParameters))
+	, fLock("denoise tiles")
+	, fTiles()
+	, fFirstTile(NULL)
+	, fLastTile(NULL)
+	, fTileBytes(0)
+{
+	fTiles.Init();
+}
+
+// destructor
+DenoiseFilter::~DenoiseFilter()
+{
+	MakeEmpty();
+}
+
+// SetParameters
+void
+DenoiseFilter::SetParameters(const DenoiseParameters& parameters)
+{
+	AutoLocker<BLocker> _(fLock);
+
+	if (fParameters == parameters)
+		return;
+
+	MakeEmpty();
+	fParameters = parameters;
+	fExtent = ExtentFor(fParameters);
+}
+
+// SourceAreaFor
+BRect
+DenoiseFilter::SourceAreaFor(BRect area) const
+{
+	if (!area.IsValid())
+		return area;
+
+	// The input areas of all tiles which contribute to the area
+	int32 firstColumn = tile_index((int32)floorf(area.left) - kTileBlend);
+	int32 lastColumn = tile_index((int32)ceilf(area.right) + kTileBlend);
+	int32 firstRow = tile_index((int32)floorf(area.top) - kTileBlend);
+	int32 lastRow = tile_index((int32)ceilf(area.bottom) + kTileBlend);
+
+	int32 extent = kTileBlend + fExtent;
+	return BRect(firstColumn * kTileSize - extent,
+		firstRow * kTileSize - extent,
+		(lastColumn + 1) * kTileSize - 1 + extent,
+		(lastRow + 1) * kTileSize - 1 + extent);
+}
+
+// Filter
+status_t
+DenoiseFilter::Filter(RenderBuffer* buffer, BRect area, int32 threadCount)
+{
+	BRect bounds = buffer->Bounds();
+	area = area & bounds;
+	if (!area.IsValid() || fParameters.amplitude <= 0.0f)
+		return B_OK;
+
+	// All tiles within the bounds which overlap the area with their blended
+	// border.
+	int32 firstColumn = std::max(tile_index((int32)area.left - kTileBlend),
+		tile_index((int32)bounds.left));
+	int32 lastColumn = std::min(tile_index((int32)area.right + kTileBlend),
+		tile_index((int32)bounds.right));
+	int32 firstRow = std::max(tile_index((int32)area.top - kTileBlend),
+		tile_index((int32)bounds.top));
+	int32 lastRow = std::min(tile_index((int32)area.bottom + kTileBlend),
+		tile_index((int32)bounds.bottom));
+
+	int32 columns = lastColumn - firstColumn + 1;
+	int32 rows = lastRow - firstRow + 1;
+	int32 count = columns * rows;
+
+	TileRequest* requests = new(std::nothrow) TileRequest[count];
+	if (requests == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 row = 0; row < rows; row++) {
+		for (int32 column = 0; column < columns; column++) {
+			TileRequest& request = requests[row * columns + column];
+			request.column = firstColumn + column;
+			request.row = firstRow + row;
+			request.inputHash = 0;
+			request.status = B_OK;
+			request.tile = NULL;
+			_TileAreas(buffer, request.column, request.row, request.input,
+				request.output);
+		}
+	}
+
+	// Every tile is one job, the WorkerPool helpers pick them up while
+	// CPUs are left.
+	TileJob job = { this, buffer, requests };
+	if (threadCount > 1)
+		WorkerPool::Default()->Run(&_TileJob, &job, count);
+	else {
+		for (int32 i = 0; i < count; i++)
+			_TileJob(&job, i);
+	}
+
+	status_t status = B_OK;
+	for (int32 i = 0; i < count; i++) {
+		if (requests[i].status != B_OK) {
+			status = requests[i].status;
+			break;
+		}
+	}
+
+	// The tiles of all requests are kept until they are composed, so the
+	// results can be read without holding the lock.
+	if (status == B_OK) {
+		status = _Compose(buffer, area, requests, firstColumn, firstRow,
+			columns, rows);
+	}
+
+	_ReleaseTiles(requests, count);
+
+	delete[] requests;
+	return status;
+}
+
+// MakeEmpty
+void
+DenoiseFilter::MakeEmpty()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	TileMap::Iterator iterator(&fTiles);
+	while (iterator.HasNext())
+		delete iterator.Next()->Value;
+	fTiles.Clear();
+	fFirstTile = NULL;
+	fLastTile = NULL;
+	fTileBytes = 0;
+}
+
+// ExtentFor
+/*static*/ int32
+DenoiseFilter::ExtentFor(const DenoiseParameters& parameters)
+{
+	if (parameters.amplitude <= 0.0f)
+		return 0;
+
+	// The smoothing follows the structure of the image for up to
+	// gaussPrecision * sqrt(2 * amplitude) pixels, the structure itself is
+	// found on the image blurred by alpha and sigma.
+	float extent = parameters.gaussPrecision
+		* sqrtf(2.0f * parameters.amplitude)
+		+ 3.0f * (parameters.alpha + parameters.sigma);
+	return (int32)ceilf(extent) + 2;
+}
+
+// #pragma mark - private
+
+// _TileAreas
+void
+DenoiseFilter::_TileAreas(const RenderBuffer* buffer, int32 column, int32 row,
+	BRect& input, BRect& output) const
+{
+	BRect bounds = buffer->Bounds();
+
+	output.left = column * kTileSize - kTileBlend;
+	output.top = row * kTileSize - kTileBlend;
+	output.right = (column + 1) * kTileSize - 1 + kTileBlend;
+	output.bottom = (row + 1) * kTileSize - 1 + kTileBlend;
+
+	input = output;
+	input.InsetBy(-fExtent, -fExtent);
+
+	output = output & bounds;
+	input = input & bounds;
+}
+
+// _UpdateTile
+status_t
+DenoiseFilter::_UpdateTile(const RenderBuffer* buffer, TileRequest& request)
+{
+	request.inputHash = hash_pixels(buffer, request.input);
+	TileKey key(request.column, request.row, request.inputHash);
+
+	{
+		AutoLocker<BLocker> _(fLock);
+		Tile* tile = fTiles.Get(key);
+		if (tile != NULL) {
+			tile->users++;
+			_TouchTile(tile);
+			request.tile = tile;
+			return B_OK;
+		}
+	}
+
+	size_t bytes = (size_t)(request.output.IntegerWidth() + 1)
+		* (request.output.IntegerHeight() + 1) * 3 * sizeof(uint16);
+	uint16* result = new(std::nothrow) uint16[bytes / sizeof(uint16)];
+	if (result == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = _Denoise(buffer, request.input, request.output, result);
+	if (status != B_OK) {
+		delete[] result;
+		return status;
+	}
+
+	AutoLocker<BLocker> locker(fLock);
+
+	// Another thread may have denoised the same pixels in the meantime.
+	Tile* tile = fTiles.Get(key);
+	if (tile != NULL) {
+		tile->users++;
+		_TouchTile(tile);
+		request.tile = tile;
+		locker.Unlock();
+
+		delete[] result;
+		return B_OK;
+	}
+
+	tile = new(std::nothrow) Tile();
+	if (tile == NULL || fTiles.Put(key, tile) != B_OK) {
+		delete tile;
+		delete[] result;
+		return B_NO_MEMORY;
+	}
+
+	tile->input = request.input;
+	tile->output = request.output;
+	tile->result = result;
+	tile->bytes = bytes;
+	tile->key = key;
+	tile->users = 1;
+	fTileBytes += bytes;
+	_LinkTile(tile);
+	request.tile = tile;
+	return B_OK;
+}
+
+// _Denoise
+status_t
+DenoiseFilter::_Denoise(const RenderBuffer* buffer, const BRect& input,
+	const BRect& output, uint16* result) const
+{
+	try {
+		uint32 width = input.IntegerWidth() + 1;
+		uint32 height = input.IntegerHeight() + 1;
+
+		// The structure found by blur_anisotropic() depends on the absolute
+		// size of the gradients, and the parameters are meant for 8 bit
+		// channels. The pixels are denoised at that scale, in floating point
+		// to keep the precision.
+		cimg_library::CImg<float> image(width, height, 1, 3);
+
+		uint32 srcBPR = buffer->BytesPerRow();
+		const uint8* src = buffer->Bits()
+			+ (int64)((int32)input.top - buffer->Top()) * srcBPR
+			+ ((int32)input.left - buffer->Left()) * 8;
+		float* dst = image.data;
+
+		// copy input pixels into the planes of the image
+		for (uint32 y = 0; y < height; y++) {
+			const uint16* s = (const uint16*)src;
+			float* d1 = dst;
+			float* d2 = dst + width * height;
+			float* d3 = dst + 2 * width * height;
+			for (uint32 x = 0; x < width; x++) {
+				*d1++ = s[0] / 257.0f;
+				*d2++ = s[1] / 257.0f;
+				*d3++ = s[2] / 257.0f;
+				s += 4;
+			}
+			src += srcBPR;
+			dst += width;
+		}
+
+		image.blur_anisotropic(fParameters.amplitude, fParameters.sharpness,
+			fParameters.anisotropy, fParameters.alpha, fParameters.sigma,
+			fParameters.dl, fParameters.da, fParameters.gaussPrecision,
+			fParameters.interpolationType, fParameters.fastApproximation);
+
+		// copy the output area of the image into the result
+		uint32 outputWidth = output.IntegerWidth() + 1;
+		uint32 outputHeight = output.IntegerHeight() + 1;
+		const float* plane = image.data
+			+ ((int32)output.top - (int32)input.top) * width
+			+ (int32)output.left - (int32)input.left;
+		for (uint32 y = 0; y < outputHeight; y++) {
+			const float* s1 = plane;
+			const float* s2 = plane + width * height;
+			const float* s3 = plane + 2 * width * height;
+			for (uint32 x = 0; x < outputWidth; x++) {
+				result[0] = to_channel(*s1++);
+				result[1] = to_channel(*s2++);
+				result[2] = to_channel(*s3++);
+				result += 3;
+			}
+			plane += width;
+		}
+	} catch (...) {
+		fprintf(stderr, "DenoiseFilter::_Denoise() - caught exception!\n");
+		return B_ERROR;
+	}
+	return B_OK;
+}
+
+// _Compose
+status_t
+DenoiseFilter::_Compose(RenderBuffer* buffer, BRect area,
+	const TileRequest* requests, int32 firstColumn, int32 firstRow,
+	int32 columns, int32 rows) const
+{
+	int32 left = (int32)area.left;
+	int32 top = (int32)area.top;
+	int32 width = area.IntegerWidth() + 1;
+	int32 height = area.IntegerHeight() + 1;
+
+	// Which tiles a column of the area is blended from. Across each border,
+	// the weight of the second tile ramps up linearly over the pixels
+	// within kTileBlend of the border.
+	struct Blend {
+		int32	first;
+		int32	second;
+		float	weight;
+	};
+
+	Blend* columnBlends = new(std::nothrow) Blend[width];
+	if (columnBlends == NULL)
+		return B_NO_MEMORY;
+
+	struct BlendCalculator {
+		static Blend Calculate(int32 coordinate, int32 first, int32 count)
+		{
+			int32 index = tile_index(coordinate) - first;
+			int32 offset = coordinate - (index + first) * kTileSize;
+			Blend blend = { index, -1, 0.0f };
+			if (offset < kTileBlend && index > 0) {
+				blend.first = index - 1;
+				blend.second = index;
+				blend.weight = (offset + kTileBlend + 0.5f)
+					/ (2 * kTileBlend);
+			} else if (offset >= kTileSize - kTileBlend
+				&& index < count - 1) {
+				blend.second = index + 1;
+				blend.weight = (offset - (kTileSize - kTileBlend) + 0.5f)
+					/ (2 * kTileBlend);
+			}
+			return blend;
+		}
+	};
+
+	for (int32 x = 0; x < width; x++) {
+		columnBlends[x] = BlendCalculator::Calculate(left + x, firstColumn,
+			columns);
+	}
+
+	uint32 bpr = buffer->BytesPerRow();
+	uint8* bits = buffer->Bits() + (int64)(top - buffer->Top()) * bpr
+		+ (left - buffer->Left()) * 8;
+
+	for (int32 y = 0; y < height; y++) {
+		Blend rowBlend = BlendCalculator::Calculate(top + y, firstRow, rows);
+		int32 tileRows[2] = { rowBlend.first, rowBlend.second };
+		float rowWeights[2] = { 1.0f - rowBlend.weight, rowBlend.weight };
+
+		uint16* d = (uint16*)bits;
+		for (int32 x = 0; x < width; x++) {
+			const Blend& columnBlend = columnBlends[x];
+			int32 tileColumns[2] = { columnBlend.first, columnBlend.second };
+			float columnWeights[2] = { 1.0f - columnBlend.weight,
+				columnBlend.weight };
+
+			float sum[3] = { 0.0f, 0.0f, 0.0f };
+			for (int32 j = 0; j < 2 && tileRows[j] >= 0; j++) {
+				for (int32 i = 0; i < 2 && tileColumns[i] >= 0; i++) {
+					const uint16* result = requests[tileRows[j] * columns
+						+ tileColumns[i]].tile->ResultAt(left + x, top + y);
+					float weight = rowWeights[j] * columnWeights[i];
+					sum[0] += result[0] * weight;
+					sum[1] += result[1] * weight;
+					sum[2] += result[2] * weight;
+				}
+			}
+
+			// The pixels are premultiplied, the color can not exceed the
+			// alpha, which is left as it is.
+			uint32 alpha = d[3];
+			for (int32 c = 0; c < 3; c++)
+				d[c] = (uint16)std::min(alpha, (uint32)(sum[c] + 0.5f));
+
+			d += 4;
+		}
+		bits += bpr;
+	}
+
+	delete[] columnBlends;
+	return B_OK;
+}
+
+// _ReleaseTiles
+void
+DenoiseFilter::_ReleaseTiles(TileRequest* requests, int32 count)
+{
+	AutoLocker<BLocker> _(fLock);
+
+	for (int32 i = 0; i < count; i++) {
+		if (requests[i].tile != NULL) {
+			requests[i].tile->users--;
+			requests[i].tile = NULL;
+		}
+	}
+
+	// The tiles of this area were used last, they go last if the area alone
+	// takes more memory than all tiles may.
+	_TrimTiles();
+}
+
+// _TouchTile
+void
+DenoiseFilter::_TouchTile(Tile* tile)
+{
+	_UnlinkTile(tile);
+	_LinkTile(tile);
+}
+
+// _LinkTile
+void
+DenoiseFilter::_LinkTile(Tile* tile)
+{
+	tile->previous = fLastTile;
+	tile->next = NULL;
+	if (fLastTile != NULL)
+		fLastTile->next = tile;
+	else
+		fFirstTile = tile;
+	fLastTile = tile;
+}
+
+// _UnlinkTile
+void
+DenoiseFilter::_UnlinkTile(Tile* tile)
+{
+	if (tile->previous != NULL)
+		tile->previous->next = tile->next;
+	else
+		fFirstTile = tile->next;
+	if (tile->next != NULL)
+		tile->next->previous = tile->previous;
+	else
+		fLastTile = tile->previous;
+	tile->previous = NULL;
+	tile->next = NULL;
+}
+
+// _TrimTiles
+void
+DenoiseFilter::_TrimTiles()
+{
+	// The tiles which other threads are still composing are skipped.
+	Tile* tile = fFirstTile;
+	while (fTileBytes > kMaxTileBytes && tile != NULL) {
+		Tile* next = tile->next;
+		if (tile->users == 0) {
+			_UnlinkTile(tile);
+			fTiles.RemoveKey(tile->key);
+			fTileBytes -= tile->bytes;
+			delete tile;
+		}
+		tile = next;
+	}
+}
+
+// _TileJob
+/*static*/ void
+DenoiseFilter::_TileJob(void* cookie, int32 index)
+{
+	TileJob* job = reinterpret_cast<TileJob*>(cookie);
+	TileRequest& request = job->requests[index];
+	request.status = job->filter->_UpdateTile(job->buffer, request);
+}
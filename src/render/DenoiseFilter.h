@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef DENOISE_FILTER_H
+#define DENOISE_FILTER_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <Rect.h>
+#include <SupportDefs.h>
+
+#include "HashMapHugo.h"
+
+class RenderBuffer;
+
+// The parameters of the anisotropic smoothing, see
+// CImg::blur_anisotropic().
+struct DenoiseParameters {
+								DenoiseParameters();
+
+			// The parameters for the image scaled by the given factor.
+			DenoiseParameters	Scaled(float scale) const;
+
+			bool				operator==(
+									const DenoiseParameters& other) const;
+			bool				operator!=(
+									const DenoiseParameters& other) const;
+
+			float				amplitude;
+			float				sharpness;
+			float				anisotropy;
+			float				alpha;
+			float				sigma;
+			float				dl;
+			float				da;
+			float				gaussPrecision;
+			uint32				interpolationType;
+			bool				fastApproximation;
+};
+
+
+// Anisotropic denoising of the color channels of 64 bit RenderBuffers. The
+// image is split into tiles which are smoothed in parallel, each together
+// with the pixels around it. Since the smoothing of a tile depends on the
+// range of values within it, the results of neighboring tiles are blended
+// across their common border. The filter keeps the result of every tile,
+// found by its place in the grid and a hash of the pixels it was computed
+// from, and smoothes only the tiles whose pixels have changed since. Where
+// the buffer cuts off the pixels of a tile differently, as it does for the
+// strips rendered by different threads, the results for both are kept. The
+// tiles used least recently are forgotten once they take too much memory.
+class DenoiseFilter {
+public:
+								DenoiseFilter();
+								~DenoiseFilter();
+
+			// Forgets all tiles when the parameters change.
+			void				SetParameters(
+									const DenoiseParameters& parameters);
+	inline	const DenoiseParameters& Parameters() const
+									{ return fParameters; }
+
+			// The area of pixels which Filter() reads to denoise the
+			// given area.
+			BRect				SourceAreaFor(BRect area) const;
+
+			status_t			Filter(RenderBuffer* buffer, BRect area,
+									int32 threadCount = 1);
+
+			void				MakeEmpty();
+
+	// The number of pixels around a pixel which contribute to its denoised
+	// value in any significant way.
+	static	int32				ExtentFor(
+									const DenoiseParameters& parameters);
+
+private:
+			struct TileKey {
+				TileKey()
+					: column(0)
+					, row(0)
+					, inputHash(0)
+				{
+				}
+
+				TileKey(int32 column, int32 row, uint64 inputHash)
+					: column(column)
+					, row(row)
+					, inputHash(inputHash)
+				{
+				}
+
+				bool operator==(const TileKey& other) const
+				{
+					return column == other.column && row == other.row
+						&& inputHash == other.inputHash;
+				}
+
+				size_t HashKey() const
+				{
+					uint32 hash = (uint32)column * 0x9e3779b1
+						^ (uint32)row * 0x85ebca77;
+					return hash ^ (uint32)(inputHash >> 32)
+						^ (uint32)inputHash;
+				}
+
+				int32	column;
+				int32	row;
+				// of the pixels within the input area, and of the area,
+				// which may be cut off by the buffer
+				uint64	inputHash;
+			};
+
+			struct Tile;
+			struct TileRequest;
+			struct TileJob;
+			typedef HashMap<TileKey, Tile*> TileMap;
+
+			void				_TileAreas(const RenderBuffer* buffer,
+									int32 column, int32 row, BRect& input,
+									BRect& output) const;
+			status_t			_UpdateTile(const RenderBuffer* buffer,
+									TileRequest& request);
+			status_t			_Denoise(const RenderBuffer* buffer,
+									const BRect& input, const BRect& output,
+									uint16* result) const;
+			status_t			_Compose(RenderBuffer* buffer, BRect area,
+									const TileRequest* requests,
+									int32 firstColumn, int32 firstRow,
+									int32 columns, int32 rows) const;
+			void				_ReleaseTiles(TileRequest* requests,
+									int32 count);
+			void				_TouchTile(Tile* tile);
+			void				_LinkTile(Tile* tile);
+			void				_UnlinkTile(Tile* tile);
+			void				_TrimTiles();
+	static	void				_TileJob(void* cookie, int32 index);
+
+private:
+			DenoiseParameters	fParameters;
+			int32				fExtent;
+
+			BLocker				fLock;
+			TileMap				fTiles;
+			Tile*				fFirstTile;
+			Tile*				fLastTile;
+			size_t				fTileBytes;
+};
+
+#endif // DENOISE_FILTER_H
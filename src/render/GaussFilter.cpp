@@ -1,11 +1,49 @@
 #include "GaussFilter.h"
 
-#include <stdio.h>
+#include <algorithm>
+#include <math.h>
+#include <new>
 
+#include "AlphaBuffer.h"
 #include "RenderBuffer.h"
+#include "ScratchArena.h"
+#include "WorkerPool.h"
 
 
-GaussFilter::GaussFilter()
+// Splitting a pass is only worth the overhead for larger buffers.
+static const int32 kMinPixelsPerJob = 128 * 1024;
+static const int32 kMaxJobs = 16;
+
+// The columns pass walks the rows of this many columns at a time.
+static const int32 kColumnStrip = 16;
+
+
+// The standard deviation which gives about the same spread as a stack blur
+// (triangle kernel) of the given radius, so that both look alike.
+static inline double
+sigma_for_radius(double radius)
+{
+	return sqrt(radius * (radius + 2.0) / 6.0);
+}
+
+
+template<typename ChannelType>
+static inline ChannelType
+clamp_channel(double value)
+{
+	static const double kMax = (double)(ChannelType)~0;
+	if (value <= 0.0)
+		return 0;
+	if (value >= kMax)
+		return (ChannelType)~0;
+	return (ChannelType)(value + 0.5);
+}
+
+
+GaussFilter::GaussFilter(ScratchArena* arena)
+	: fArena(arena)
+	, fDirect(false)
+	, fDirectWeight(0)
 {
 }
 
@@ -16,74 +54,66 @@ GaussFilter::~GaussFilter()
 
 
 void
-GaussFilter::FilterRGB32(RenderBuffer* buffer, double sigma)
+GaussFilter::FilterRGB32(RenderBuffer* buffer, double radius)
 {
-	if (!_Init(sigma))
+	if (!_Init(radius))
 		return;
 
-	int32 width = buffer->Width();
-	int32 height = buffer->Height();
-	uint32 bpr = buffer->BytesPerRow();
-	uint8* bits = buffer->Bits();
-
-	for (int32 i = 0; i < height; i++)
-		_FilterRow4<uint8>(bits + i * bpr, width, false);
-	for (int32 i = 0; i < width; i++)
-		_FilterColumn4<uint8>(bits + i * 4, bpr, height, false);
+	_Filter<uint8, 4, 3>(buffer->Bits(), buffer->BytesPerRow(),
+		buffer->Width(), buffer->Height(), 1);
 }
 
 
 void
-GaussFilter::FilterRGBA32(RenderBuffer* buffer, double sigma)
+GaussFilter::FilterRGBA32(RenderBuffer* buffer, double radius)
 {
-	if (!_Init(sigma))
+	if (!_Init(radius))
 		return;
 
-	int32 width = buffer->Width();
-	int32 height = buffer->Height();
-	uint32 bpr = buffer->BytesPerRow();
-	uint8* bits = buffer->Bits();
-
-	for (int32 i = 0; i < height; i++)
-		_FilterRow4<uint8>(bits + i * bpr, width, true);
-	for (int32 i = 0; i < width; i++)
-		_FilterColumn4<uint8>(bits + i * 4, bpr, height, true);
+	_Filter<uint8, 4, 4>(buffer->Bits(), buffer->BytesPerRow(),
+		buffer->Width(), buffer->Height(), 1);
 }
 
 
 void
-GaussFilter::FilterRGBA64(RenderBuffer* buffer, double sigma)
+GaussFilter::FilterRGBA64(RenderBuffer* buffer, double radius,
+	int32 threadCount)
 {
-	if (!_Init(sigma))
+	if (!_Init(radius))
 		return;
 
-	int32 width = buffer->Width();
-	int32 height = buffer->Height();
-	uint32 bpr = buffer->BytesPerRow() / 2;
-	uint16* bits = reinterpret_cast<uint16*>(buffer->Bits());
+	_Filter<uint16, 4, 4>(buffer->Bits(), buffer->BytesPerRow(),
+		buffer->Width(), buffer->Height(), threadCount);
+}
+
 
-	for (int32 i = 0; i < height; i++)
-		_FilterRow4<uint16>(bits + i * bpr, width, true);
-	for (int32 i = 0; i < width; i++)
-		_FilterColumn4<uint16>(bits + i * 4, bpr, height, true);
+void
+GaussFilter::FilterGray8(RenderBuffer* buffer, double radius)
+{
+	if (!_Init(radius))
+		return;
+
+	_Filter<uint8, 1, 1>(buffer->Bits(), buffer->BytesPerRow(),
+		buffer->Width(), buffer->Height(), 1);
 }
 
 
 void
-GaussFilter::FilterGray8(RenderBuffer* buffer, double sigma)
+GaussFilter::FilterGray16(AlphaBuffer* buffer, double radius,
+	int32 threadCount)
 {
-	if (!_Init(sigma))
+	if (!_Init(radius))
 		return;
 
-	int32 width = buffer->Width();
-	int32 height = buffer->Height();
-	uint32 bpr = buffer->BytesPerRow();
-	uint8* bits = buffer->Bits();
+	_Filter<uint16, 1, 1>(buffer->Bits(), buffer->BytesPerRow(),
+		buffer->Width(), buffer->Height(), threadCount);
+}
+
 
-	for (int32 i = 0; i < height; i++)
-		_FilterRow1<uint8>(bits + i * bpr, width);
-	for (int32 i = 0; i < width; i++)
-		_FilterColumn1<uint8>(bits + i * 4, bpr, height);
+/*static*/ int32
+GaussFilter::ExtentForRadius(double radius)
+{
+	return (int32)ceil(3.0 * sigma_for_radius(radius));
 }
 
 
@@ -91,13 +121,21 @@ GaussFilter::FilterGray8(RenderBuffer* buffer, double sigma)
 
 
 bool
-GaussFilter::_Init(double sigma)
+GaussFilter::_Init(double radius)
 {
-	sigma /= 2.0;
+	double sigma = sigma_for_radius(radius);
 
-	if (sigma < 0.5) {
-		printf("GaussFilter::_Init() - radius too small (< 1.0)\n");
+	if (sigma <= 0.0)
 		return false;
+
+	// The recursive filter is not defined for such a small spread, the
+	// weights of a direct kernel of three pixels are taken from the
+	// gaussian itself.
+	fDirect = sigma < 0.5;
+	if (fDirect) {
+		double outer = exp(-1.0 / (2.0 * sigma * sigma));
+		fDirectWeight = (CalcType)(outer / (1.0 + 2.0 * outer));
+		return true;
 	}
 
 	// calculate the weird numbers as instructed in that paper
@@ -127,205 +165,289 @@ GaussFilter::_Init(double sigma)
 }
 
 
+template<typename ChannelType, int32 PixelChannels, int32 FilterChannels>
 void
-GaussFilter::_Filter(CalcType* buffer, int32 count)
+GaussFilter::_Filter(uint8* bits, uint32 bpr, int32 width, int32 height,
+	int32 threadCount) const
 {
-	// forward
-	CalcType* b = buffer + 3;
-	for (int32 i = 3; i < count + 6; i++) {
-		*b = B * b[0] + (b1 * b[-1] + b2 * b[-2] + b3 * b[-3]);
-		b++;
+	if (width <= 0 || height <= 0)
+		return;
+
+	int32 jobCount = (int32)((int64)width * height / kMinPixelsPerJob);
+	jobCount = std::max((int32)1,
+		std::min(jobCount, std::min(threadCount, kMaxJobs)));
+
+	FilterJob jobs[kMaxJobs];
+
+	if (fDirect) {
+		// The direct kernel is a single pass, which needs no scratch.
+		_RunJobs(jobs, std::min(jobCount, height),
+			&_FilterRows<ChannelType, PixelChannels, FilterChannels>,
+			bits, bpr, height, width, NULL, 0);
+		_RunJobs(jobs, std::min(jobCount, width),
+			&_FilterColumns<ChannelType, PixelChannels, FilterChannels>,
+			bits, bpr, width, height, NULL, 0);
+		return;
 	}
 
-	// backward
-	b = buffer + count + 2;
-	for (int32 i = count + 2; i >= 0; i--) {
-		*b = B * b[0] + (b1 * b[1] + b2 * b[2] + b3 * b[3]);
-		b--;
+	// Each job keeps the results of the forward pass over one row, or over
+	// a strip of columns, for the backward pass.
+	size_t scratchPerJob = std::max((size_t)width,
+		(size_t)std::min(width, kColumnStrip) * height) * FilterChannels;
+	size_t scratchSize = scratchPerJob * jobCount * sizeof(CalcType);
+
+	CalcType* scratch;
+	if (fArena != NULL) {
+		ScratchArena::Scope scope(*fArena);
+		scratch = (CalcType*)fArena->Allocate(scratchSize);
+		if (scratch == NULL)
+			return;
+		_FilterPasses<ChannelType, PixelChannels, FilterChannels>(jobs,
+			jobCount, bits, bpr, width, height, scratch, scratchPerJob);
+	} else {
+		scratch = new(std::nothrow) CalcType[scratchSize / sizeof(CalcType)];
+		if (scratch == NULL)
+			return;
+		_FilterPasses<ChannelType, PixelChannels, FilterChannels>(jobs,
+			jobCount, bits, bpr, width, height, scratch, scratchPerJob);
+		delete[] scratch;
 	}
 }
 
-template<typename ChannelType>
+
+template<typename ChannelType, int32 PixelChannels, int32 FilterChannels>
 void
-GaussFilter::_FilterRow4(ChannelType* buffer, int32 count, bool alpha)
+GaussFilter::_FilterPasses(FilterJob* jobs, int32 jobCount, uint8* bits,
+	uint32 bpr, int32 width, int32 height, CalcType* scratch,
+	size_t scratchPerJob) const
 {
-	CalcType temp0[count + 6];
-	CalcType temp1[count + 6];
-	CalcType temp2[count + 6];
-	CalcType temp3[count + 6];
-
-	// copy buffer into temps
-
-	ChannelType* b = buffer;
-	int32 it = 3;
-	if (alpha) {
-		for (int32 i = 0; i < count; i++, it++) {
-			temp0[it] = b[0];
-			temp1[it] = b[1];
-			temp2[it] = b[2];
-			temp3[it] = b[3];
-			b += 4;
-		}
-	} else {
-		for (int32 i = 0; i < count; i++, it++) {
-			temp0[it] = b[0];
-			temp1[it] = b[1];
-			temp2[it] = b[2];
-			b += 4;
-		}
+	_RunJobs(jobs, std::min(jobCount, height),
+		&_FilterRows<ChannelType, PixelChannels, FilterChannels>,
+		bits, bpr, height, width, scratch, scratchPerJob);
+	_RunJobs(jobs, std::min(jobCount, width),
+		&_FilterColumns<ChannelType, PixelChannels, FilterChannels>,
+		bits, bpr, width, height, scratch, scratchPerJob);
+}
+
+
+void
+GaussFilter::_RunJobs(FilterJob* jobs, int32 jobCount, JobFunction function,
+	uint8* bits, uint32 bpr, int32 lines, int32 length, CalcType* scratch,
+	size_t scratchPerJob) const
+{
+	for (int32 i = 0; i < jobCount; i++) {
+		jobs[i].filter = this;
+		jobs[i].function = function;
+		jobs[i].bits = bits;
+		jobs[i].bpr = bpr;
+		jobs[i].length = length;
+		jobs[i].first = i * lines / jobCount;
+		jobs[i].last = (i + 1) * lines / jobCount - 1;
+		jobs[i].scratch = scratch != NULL ? scratch + i * scratchPerJob : NULL;
 	}
-	// copy edge pixels
-	temp0[0] = temp0[1] = temp0[2] = temp0[3];
-	temp0[count + 3] = temp0[count + 4] = temp0[count + 5] = temp0[count + 2];
 
-	temp1[0] = temp1[1] = temp1[2] = temp1[3];
-	temp1[count + 3] = temp1[count + 4] = temp1[count + 5] = temp1[count + 2];
+	WorkerPool::Default()->Run(&_RunJob, jobs, jobCount);
+}
 
-	temp2[0] = temp2[1] = temp2[2] = temp2[3];
-	temp2[count + 3] = temp2[count + 4] = temp2[count + 5] = temp2[count + 2];
 
-	// filter
-	_Filter(temp0, count);
-	_Filter(temp1, count);
-	_Filter(temp2, count);
+/*static*/ void
+GaussFilter::_RunJob(void* cookie, int32 index)
+{
+	FilterJob& job = reinterpret_cast<FilterJob*>(cookie)[index];
+	job.function(job);
+}
 
-	if (alpha) {
-		temp3[0] = temp3[1] = temp3[2] = temp3[3];
-		temp3[count + 3] = temp3[count + 4] = temp3[count + 5] = temp3[count + 2];
-		_Filter(temp3, count);
-	}
 
-	// copy temp back to buffer
-
-	b = buffer;
-	it = 3;
-	if (alpha) {
-		for (int32 i = 0; i < count; i++, it++) {
-			b[0] = (ChannelType)(temp0[it] + 0.5);
-			b[1] = (ChannelType)(temp1[it] + 0.5);
-			b[2] = (ChannelType)(temp2[it] + 0.5);
-			b[3] = (ChannelType)(temp3[it] + 0.5);
-			b += 4;
-		}
-	} else {
-		for (int32 i = 0; i < count; i++, it++) {
-			b[0] = (ChannelType)(temp0[it] + 0.5);
-			b[1] = (ChannelType)(temp1[it] + 0.5);
-			b[2] = (ChannelType)(temp2[it] + 0.5);
-			b += 4;
-		}
+template<typename ChannelType, int32 PixelChannels, int32 FilterChannels>
+/*static*/ void
+GaussFilter::_FilterRows(const FilterJob& job)
+{
+	for (int32 y = job.first; y <= job.last; y++) {
+		_FilterLine<ChannelType, FilterChannels>(job.filter,
+			reinterpret_cast<ChannelType*>(job.bits + (size_t)y * job.bpr),
+			PixelChannels, job.length, job.scratch);
 	}
 }
 
-template<typename ChannelType>
-void
-GaussFilter::_FilterColumn4(ChannelType* buffer, uint32 skip,
-							int32 count, bool alpha)
+
+template<typename ChannelType, int32 PixelChannels, int32 FilterChannels>
+/*static*/ void
+GaussFilter::_FilterColumns(const FilterJob& job)
 {
-	CalcType temp0[count + 6];
-	CalcType temp1[count + 6];
-	CalcType temp2[count + 6];
-	CalcType temp3[count + 6];
-
-	// copy buffer into temps
-
-	ChannelType* b = buffer;
-	int32 it = 3;
-	if (alpha) {
-		for (int32 i = 0; i < count; i++, it++) {
-			temp0[it] = b[0];
-			temp1[it] = b[1];
-			temp2[it] = b[2];
-			temp3[it] = b[3];
-			b += skip;
-		}
-	} else {
-		for (int32 i = 0; i < count; i++, it++) {
-			temp0[it] = b[0];
-			temp1[it] = b[1];
-			temp2[it] = b[2];
-			b += skip;
+	const int32 height = job.length;
+	const int64 step = job.bpr / sizeof(ChannelType);
+
+	if (job.filter->fDirect) {
+		ChannelType* bits = reinterpret_cast<ChannelType*>(job.bits);
+		for (int32 x = job.first; x <= job.last; x++) {
+			_FilterLine<ChannelType, FilterChannels>(job.filter,
+				bits + x * PixelChannels, step, height, NULL);
 		}
+		return;
 	}
 
-	// copy edge pixels
-	temp0[0] = temp0[1] = temp0[2] = temp0[3];
-	temp0[count + 3] = temp0[count + 4] = temp0[count + 5] = temp0[count + 2];
-
-	temp1[0] = temp1[1] = temp1[2] = temp1[3];
-	temp1[count + 3] = temp1[count + 4] = temp1[count + 5] = temp1[count + 2];
-
-	temp2[0] = temp2[1] = temp2[2] = temp2[3];
-	temp2[count + 3] = temp2[count + 4] = temp2[count + 5] = temp2[count + 2];
-
-	// filter
-	_Filter(temp0, count);
-	_Filter(temp1, count);
-	_Filter(temp2, count);
-
-	if (alpha) {
-		temp3[0] = temp3[1] = temp3[2] = temp3[3];
-		temp3[count + 3] = temp3[count + 4] = temp3[count + 5] = temp3[count + 2];
-		_Filter(temp3, count);
-	}
+	const CalcType B = job.filter->B;
+	const CalcType b1 = job.filter->b1;
+	const CalcType b2 = job.filter->b2;
+	const CalcType b3 = job.filter->b3;
+
+	// Filtering column by column would touch a new cache line for every
+	// single pixel. Instead, a strip of columns is filtered together by
+	// walking the rows, keeping the filter history of each column.
+	for (int32 first = job.first; first <= job.last; first += kColumnStrip) {
+		const int32 columns = std::min(kColumnStrip, job.last - first + 1);
+		const int32 values = columns * FilterChannels;
+		ChannelType* bits = reinterpret_cast<ChannelType*>(job.bits)
+			+ first * PixelChannels;
+
+		CalcType history[kColumnStrip * FilterChannels * 3];
+
+		// forward, start with the history of a constant edge
+		for (int32 x = 0; x < columns; x++) {
+			for (int32 c = 0; c < FilterChannels; c++) {
+				CalcType* h = history + (x * FilterChannels + c) * 3;
+				h[0] = h[1] = h[2] = bits[x * PixelChannels + c];
+			}
+		}
+		for (int32 y = 0; y < height; y++) {
+			CalcType* h = history;
+			const ChannelType* p = bits + y * step;
+			CalcType* s = job.scratch + y * values;
+			for (int32 x = 0; x < columns; x++) {
+				for (int32 c = 0; c < FilterChannels; c++) {
+					CalcType w = B * p[c]
+						+ (b1 * h[0] + b2 * h[1] + b3 * h[2]);
+					h[2] = h[1];
+					h[1] = h[0];
+					h[0] = w;
+					*s++ = w;
+					h += 3;
+				}
+				p += PixelChannels;
+			}
+		}
 
-	// copy temp back to buffer
-
-	b = buffer;
-	it = 3;
-	if (alpha) {
-		for (int32 i = 0; i < count; i++, it++) {
-			b[0] = (ChannelType)(temp0[it] + 0.5);
-			b[1] = (ChannelType)(temp1[it] + 0.5);
-			b[2] = (ChannelType)(temp2[it] + 0.5);
-			b[3] = (ChannelType)(temp3[it] + 0.5);
-			b += skip;
+		// backward
+		const CalcType* last = job.scratch + (height - 1) * values;
+		for (int32 i = 0; i < values; i++) {
+			CalcType* h = history + i * 3;
+			h[0] = h[1] = h[2] = last[i];
 		}
-	} else {
-		for (int32 i = 0; i < count; i++, it++) {
-			b[0] = (ChannelType)(temp0[it] + 0.5);
-			b[1] = (ChannelType)(temp1[it] + 0.5);
-			b[2] = (ChannelType)(temp2[it] + 0.5);
-			b += skip;
+		for (int32 y = height - 1; y >= 0; y--) {
+			CalcType* h = history;
+			ChannelType* p = bits + y * step;
+			const CalcType* s = job.scratch + y * values;
+			for (int32 x = 0; x < columns; x++) {
+				for (int32 c = 0; c < FilterChannels; c++) {
+					CalcType w = B * *s++
+						+ (b1 * h[0] + b2 * h[1] + b3 * h[2]);
+					h[2] = h[1];
+					h[1] = h[0];
+					h[0] = w;
+					p[c] = clamp_channel<ChannelType>(w);
+					h += 3;
+				}
+				if (FilterChannels == 4) {
+					// Keep premultiplied colors within alpha
+					p[0] = std::min(p[0], p[3]);
+					p[1] = std::min(p[1], p[3]);
+					p[2] = std::min(p[2], p[3]);
+				}
+				p += PixelChannels;
+			}
 		}
 	}
 }
 
 
-template<typename ChannelType>
-void
-GaussFilter::_FilterRow1(ChannelType* buffer, int32 count)
+template<typename ChannelType, int32 FilterChannels>
+/*static*/ void
+GaussFilter::_FilterLine(const GaussFilter* filter, ChannelType* buffer,
+	int64 step, int32 count, CalcType* scratch)
 {
-	CalcType temp[count + 6];
-
-	for (int32 i = 0; i < count; i++)
-		temp[i + 3] = buffer[i];
-
-	temp[0] = temp[1] = temp[2] = temp[3];
-	temp[count + 3] = temp[count + 4] = temp[count + 5] = temp[count + 2];
+	if (filter->fDirect) {
+		_FilterLineDirect<ChannelType, FilterChannels>(filter, buffer, step,
+			count);
+		return;
+	}
 
-	_Filter(temp, count);
+	const CalcType B = filter->B;
+	const CalcType b1 = filter->b1;
+	const CalcType b2 = filter->b2;
+	const CalcType b3 = filter->b3;
+
+	CalcType h0[FilterChannels];
+	CalcType h1[FilterChannels];
+	CalcType h2[FilterChannels];
+
+	// forward, start with the history of a constant edge
+	for (int32 c = 0; c < FilterChannels; c++)
+		h0[c] = h1[c] = h2[c] = buffer[c];
+
+	for (int32 i = 0; i < count; i++) {
+		const ChannelType* p = buffer + i * step;
+		CalcType* s = scratch + i * FilterChannels;
+		for (int32 c = 0; c < FilterChannels; c++) {
+			CalcType w = B * p[c] + (b1 * h0[c] + b2 * h1[c] + b3 * h2[c]);
+			h2[c] = h1[c];
+			h1[c] = h0[c];
+			h0[c] = w;
+			s[c] = w;
+		}
+	}
 
-	for (int32 i = 0; i < count; i++)
-		buffer[i] = (ChannelType)(temp[i + 3] + 0.5);
+	// backward
+	const CalcType* last = scratch + (count - 1) * FilterChannels;
+	for (int32 c = 0; c < FilterChannels; c++)
+		h0[c] = h1[c] = h2[c] = last[c];
+
+	for (int32 i = count - 1; i >= 0; i--) {
+		ChannelType* p = buffer + i * step;
+		const CalcType* s = scratch + i * FilterChannels;
+		for (int32 c = 0; c < FilterChannels; c++) {
+			CalcType w = B * s[c] + (b1 * h0[c] + b2 * h1[c] + b3 * h2[c]);
+			h2[c] = h1[c];
+			h1[c] = h0[c];
+			h0[c] = w;
+			p[c] = clamp_channel<ChannelType>(w);
+		}
+		if (FilterChannels == 4) {
+			// Keep premultiplied colors within alpha
+			p[0] = std::min(p[0], p[3]);
+			p[1] = std::min(p[1], p[3]);
+			p[2] = std::min(p[2], p[3]);
+		}
+	}
 }
 
-template<typename ChannelType>
-void
-GaussFilter::_FilterColumn1(ChannelType* buffer, uint32 skip, int32 count)
-{
-	CalcType temp[count + 6];
-
-	for (int32 i = 0; i < count; i++)
-		temp[i + 3] = buffer[i * skip];
-
-	temp[0] = temp[1] = temp[2] = temp[3];
-	temp[count + 3] = temp[count + 4] = temp[count + 5] = temp[count + 2];
 
-	_Filter(temp, count);
-
-	for (int32 i = 0; i < count; i++)
-		buffer[i * skip] = (ChannelType)(temp[i + 3] + 0.5);
+template<typename ChannelType, int32 FilterChannels>
+/*static*/ void
+GaussFilter::_FilterLineDirect(const GaussFilter* filter, ChannelType* buffer,
+	int64 step, int32 count)
+{
+	const CalcType outer = filter->fDirectWeight;
+	const CalcType center = 1 - 2 * outer;
+
+	// The pixels beyond the ends repeat the edge pixels.
+	CalcType previous[FilterChannels];
+	for (int32 c = 0; c < FilterChannels; c++)
+		previous[c] = buffer[c];
+
+	for (int32 i = 0; i < count; i++) {
+		ChannelType* p = buffer + i * step;
+		const ChannelType* next = i < count - 1 ? p + step : p;
+		for (int32 c = 0; c < FilterChannels; c++) {
+			CalcType value = p[c];
+			p[c] = clamp_channel<ChannelType>(
+				center * value + outer * (previous[c] + next[c]));
+			previous[c] = value;
+		}
+		if (FilterChannels == 4) {
+			// Keep premultiplied colors within alpha
+			p[0] = std::min(p[0], p[3]);
+			p[1] = std::min(p[1], p[3]);
+			p[2] = std::min(p[2], p[3]);
+		}
+	}
 }
-
-
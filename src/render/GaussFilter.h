@@ -1,40 +1,92 @@
 #ifndef GAUSS_FILTER
 #define GAUSS_FILTER
 
+#include <OS.h>
 #include <SupportDefs.h>
 
+class AlphaBuffer;
 class RenderBuffer;
+class ScratchArena;
 
+// Recursive (IIR) gaussian blur after Young and van Vliet. The cost per
+// pixel is independent of the radius. Radii too small for the recursive
+// filter use a direct kernel of three pixels. The rows and columns passes
+// can each be split into jobs for the default WorkerPool. The results of
+// the forward pass are kept at full precision for the backward pass. If a
+// ScratchArena is given, the working set is taken from it instead of the
+// heap.
 class GaussFilter {
  public:
-								GaussFilter();
+								GaussFilter(ScratchArena* arena = NULL);
 								~GaussFilter();
 
 			void				FilterRGB32(RenderBuffer* buffer, double radius);
 			void				FilterRGBA32(RenderBuffer* buffer, double radius);
-			void				FilterRGBA64(RenderBuffer* buffer, double radius);
+			void				FilterRGBA64(RenderBuffer* buffer, double radius,
+									int32 threadCount = 1);
 			void				FilterGray8(RenderBuffer* buffer, double radius);
+			void				FilterGray16(AlphaBuffer* buffer, double radius,
+									int32 threadCount = 1);
+
+	// The number of pixels around an area which contribute to the blurred
+	// area in any significant way.
+	static	int32				ExtentForRadius(double radius);
 
  private:
-			typedef float CalcType;
+			typedef double CalcType;
+
+			struct FilterJob;
+			typedef void (*JobFunction)(const FilterJob& job);
+
+			struct FilterJob {
+				const GaussFilter*	filter;
+				JobFunction			function;
+				uint8*				bits;
+				uint32				bpr;
+				int32				length;
+				int32				first;
+				int32				last;
+				CalcType*			scratch;
+			};
 
 			bool				_Init(double radius);
 
- 			void				_Filter(CalcType* buffer, int32 count);
-
-			template<typename ChannelType>
-			void				_FilterRow4(ChannelType* buffer, int32 count,
-											bool alpha);
-			template<typename ChannelType>
-			void				_FilterColumn4(ChannelType* buffer,
-									uint32 skip, int32 count,
-									bool alpha);
-
-			template<typename ChannelType>
-			void				_FilterRow1(ChannelType* buffer, int32 count);
-			template<typename ChannelType>
-			void				_FilterColumn1(ChannelType* buffer,
-									uint32 skip, int32 count);
+			template<typename ChannelType, int32 PixelChannels,
+				int32 FilterChannels>
+			void				_Filter(uint8* bits, uint32 bpr, int32 width,
+									int32 height, int32 threadCount) const;
+			template<typename ChannelType, int32 PixelChannels,
+				int32 FilterChannels>
+			void				_FilterPasses(FilterJob* jobs, int32 jobCount,
+									uint8* bits, uint32 bpr, int32 width,
+									int32 height, CalcType* scratch,
+									size_t scratchPerJob) const;
+			void				_RunJobs(FilterJob* jobs, int32 jobCount,
+									JobFunction function, uint8* bits,
+									uint32 bpr, int32 lines, int32 length,
+									CalcType* scratch,
+									size_t scratchPerJob) const;
+	static	void				_RunJob(void* cookie, int32 index);
+
+			template<typename ChannelType, int32 PixelChannels,
+				int32 FilterChannels>
+	static	void				_FilterRows(const FilterJob& job);
+			template<typename ChannelType, int32 PixelChannels,
+				int32 FilterChannels>
+	static	void				_FilterColumns(const FilterJob& job);
+			template<typename ChannelType, int32 FilterChannels>
+	static	void				_FilterLine(const GaussFilter* filter,
+									ChannelType* buffer, int64 step,
+									int32 count, CalcType* scratch);
+			template<typename ChannelType, int32 FilterChannels>
+	static	void				_FilterLineDirect(const GaussFilter* filter,
+									ChannelType* buffer, int64 step,
+									int32 count);
+
+			ScratchArena*		fArena;
+
+			bool				fDirect;
+			CalcType			fDirectWeight;
 
 			CalcType			b0;
 			CalcType			b1;
@@ -0,0 +1,268 @@
+/*
+ * Copyright 2012 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved.
+ */
+#include "GlyphCoverageCache.h"
+
+#include <new>
+
+#include <string.h>
+
+#include "AutoLocker.h"
+
+
+static inline size_t
+hash_double(double value)
+{
+	uint64 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return (size_t)(bits >> 32) ^ (size_t)bits;
+}
+
+
+GlyphCoverageKey::GlyphCoverageKey()
+	:
+	fontPath(),
+	fontHash(0),
+	fontSize(0.0),
+	glyphIndex(0),
+	glyphBoundsX1(0),
+	glyphBoundsX2(0),
+	scale(1.0),
+	widthScale(1.0),
+	fauxWeight(0.0),
+	fauxItalic(0.0),
+	hinting(false),
+	phaseX(0),
+	phaseY(0)
+{
+}
+
+
+GlyphCoverageKey::GlyphCoverageKey(const HashString& fontPath,
+		double fontSize, unsigned glyphIndex, int glyphBoundsX1,
+		int glyphBoundsX2, double scale, double widthScale, double fauxWeight,
+		double fauxItalic, bool hinting, uint8 phaseX, uint8 phaseY)
+	:
+	fontPath(fontPath),
+	fontHash(fontPath.GetHashCode()),
+	fontSize(fontSize),
+	glyphIndex(glyphIndex),
+	glyphBoundsX1(glyphBoundsX1),
+	glyphBoundsX2(glyphBoundsX2),
+	scale(scale),
+	widthScale(widthScale),
+	fauxWeight(fauxWeight),
+	fauxItalic(fauxItalic),
+	hinting(hinting),
+	phaseX(phaseX),
+	phaseY(phaseY)
+{
+}
+
+
+bool
+GlyphCoverageKey::operator==(const GlyphCoverageKey& other) const
+{
+	return fontHash == other.fontHash
+		&& fontSize == other.fontSize
+		&& glyphIndex == other.glyphIndex
+		&& glyphBoundsX1 == other.glyphBoundsX1
+		&& glyphBoundsX2 == other.glyphBoundsX2
+		&& scale == other.scale
+		&& widthScale == other.widthScale
+		&& fauxWeight == other.fauxWeight
+		&& fauxItalic == other.fauxItalic
+		&& hinting == other.hinting
+		&& phaseX == other.phaseX
+		&& phaseY == other.phaseY
+		&& (fontPath.GetString() == other.fontPath.GetString()
+			|| fontPath == other.fontPath);
+}
+
+
+size_t
+GlyphCoverageKey::HashKey() const
+{
+	size_t hash = fontHash;
+	hash = hash * 31 + glyphIndex;
+	hash = hash * 31 + hash_double(fontSize);
+	hash = hash * 31 + hash_double(scale);
+	hash = hash * 31 + hash_double(fauxWeight);
+	hash = hash * 31 + hash_double(fauxItalic);
+	hash = hash * 31 + (hinting << 16 | phaseX << 8 | phaseY);
+	return hash;
+}
+
+
+// #pragma mark - GlyphCoverageMask
+
+
+GlyphCoverageMask::GlyphCoverageMask(const GlyphCoverageKey& key, int left,
+		int top, int width, int height)
+	:
+	Referenceable(),
+	fKey(key),
+	fLeft(left),
+	fTop(top),
+	fWidth(width),
+	fHeight(height),
+	fCovers(NULL),
+	fPrevious(NULL),
+	fNext(NULL)
+{
+	fHashLink.fNext = NULL;
+	if (width > 0 && height > 0) {
+		fCovers = new(std::nothrow) uint8[width * height];
+		if (fCovers != NULL)
+			memset(fCovers, 0, width * height);
+	} else {
+		fWidth = 0;
+		fHeight = 0;
+	}
+}
+
+
+GlyphCoverageMask::~GlyphCoverageMask()
+{
+	delete[] fCovers;
+}
+
+
+bool
+GlyphCoverageMask::isValid() const
+{
+	// Empty masks (for example for the space character) are valid.
+	return fCovers != NULL || fWidth == 0;
+}
+
+
+// #pragma mark - GlyphCoverageCache
+
+
+GlyphCoverageCache::GlyphCoverageCache(size_t maxBytes)
+	:
+	fLock("glyph coverage cache"),
+	fTable(),
+	fFirst(NULL),
+	fLast(NULL),
+	fBytes(0),
+	fMaxBytes(maxBytes)
+{
+	fTable.Init(256);
+}
+
+
+GlyphCoverageCache::~GlyphCoverageCache()
+{
+	clear();
+}
+
+
+GlyphCoverageCache*
+GlyphCoverageCache::getInstance()
+{
+	static GlyphCoverageCache cache(8 * 1024 * 1024);
+	return &cache;
+}
+
+
+GlyphCoverageMask*
+GlyphCoverageCache::get(const GlyphCoverageKey& key)
+{
+	AutoLocker<BLocker> _(fLock);
+
+	GlyphCoverageMask* mask = fTable.Lookup(key);
+	if (mask == NULL)
+		return NULL;
+
+	if (mask != fFirst) {
+		_Unlink(mask);
+		_LinkFront(mask);
+	}
+
+	mask->AddReference();
+	return mask;
+}
+
+
+GlyphCoverageMask*
+GlyphCoverageCache::put(GlyphCoverageMask* mask)
+{
+	if (mask == NULL)
+		return NULL;
+
+	AutoLocker<BLocker> _(fLock);
+
+	GlyphCoverageMask* existing = fTable.Lookup(mask->key());
+	if (existing != NULL) {
+		// Another thread was faster.
+		existing->AddReference();
+		mask->RemoveReference();
+		return existing;
+	}
+
+	if (fTable.Insert(mask) != B_OK)
+		return mask;
+
+	// The cache holds its own reference
+	mask->AddReference();
+	_LinkFront(mask);
+	fBytes += mask->bytes();
+
+	while (fBytes > fMaxBytes && fLast != NULL && fLast != mask)
+		_Evict(fLast);
+
+	return mask;
+}
+
+
+void
+GlyphCoverageCache::clear()
+{
+	AutoLocker<BLocker> _(fLock);
+
+	while (fLast != NULL)
+		_Evict(fLast);
+}
+
+
+void
+GlyphCoverageCache::_Unlink(GlyphCoverageMask* mask)
+{
+	if (mask->fPrevious != NULL)
+		mask->fPrevious->fNext = mask->fNext;
+	else
+		fFirst = mask->fNext;
+
+	if (mask->fNext != NULL)
+		mask->fNext->fPrevious = mask->fPrevious;
+	else
+		fLast = mask->fPrevious;
+
+	mask->fPrevious = NULL;
+	mask->fNext = NULL;
+}
+
+
+void
+GlyphCoverageCache::_LinkFront(GlyphCoverageMask* mask)
+{
+	mask->fPrevious = NULL;
+	mask->fNext = fFirst;
+	if (fFirst != NULL)
+		fFirst->fPrevious = mask;
+	fFirst = mask;
+	if (fLast == NULL)
+		fLast = mask;
+}
+
+
+void
+GlyphCoverageCache::_Evict(GlyphCoverageMask* mask)
+{
+	_Unlink(mask);
+	fTable.Remove(mask);
+	fBytes -= mask->bytes();
+	mask->RemoveReference();
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2012 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved.
+ */
+#ifndef GLYPH_COVERAGE_CACHE_H
+#define GLYPH_COVERAGE_CACHE_H
+
+#include <Locker.h>
+
+#include "HashString.h"
+#include "OpenHashTableHugo.h"
+#include "Referenceable.h"
+
+
+// Identifies the rasterized coverage of one glyph. Besides the glyph and the
+// font, everything that changes the shape of the rasterized glyph is part of
+// the key, including hinting and the sub-pixel phase of the glyph origin.
+// The font is identified by its file path, the hash of the path is only
+// used to pick the bucket.
+struct GlyphCoverageKey {
+	GlyphCoverageKey();
+	GlyphCoverageKey(const HashString& fontPath, double fontSize,
+		unsigned glyphIndex, int glyphBoundsX1, int glyphBoundsX2,
+		double scale, double widthScale, double fauxWeight, double fauxItalic,
+		bool hinting, uint8 phaseX, uint8 phaseY);
+
+	bool operator==(const GlyphCoverageKey& other) const;
+
+	size_t HashKey() const;
+
+	HashString	fontPath;
+	uint32		fontHash;
+	double		fontSize;
+	unsigned	glyphIndex;
+	int			glyphBoundsX1;
+	int			glyphBoundsX2;
+	double		scale;
+	double		widthScale;
+	double		fauxWeight;
+	double		fauxItalic;
+	bool		hinting;
+	uint8		phaseX;
+	uint8		phaseY;
+};
+
+
+// An 8 bit coverage mask of a rasterized glyph. Left() and Top() are relative
+// to the integer pixel containing the glyph origin.
+class GlyphCoverageMask : public Referenceable {
+public:
+	GlyphCoverageMask(const GlyphCoverageKey& key, int left, int top,
+		int width, int height);
+	virtual ~GlyphCoverageMask();
+
+	bool isValid() const;
+
+	inline const GlyphCoverageKey& key() const
+	{
+		return fKey;
+	}
+
+	inline int left() const
+	{
+		return fLeft;
+	}
+
+	inline int top() const
+	{
+		return fTop;
+	}
+
+	inline int width() const
+	{
+		return fWidth;
+	}
+
+	inline int height() const
+	{
+		return fHeight;
+	}
+
+	inline uint8* rowAt(int row) const
+	{
+		return fCovers + row * fWidth;
+	}
+
+	inline size_t bytes() const
+	{
+		return sizeof(GlyphCoverageMask) + fWidth * fHeight;
+	}
+
+private:
+	friend class GlyphCoverageCache;
+	friend struct GlyphCoverageHashDefinition;
+
+	GlyphCoverageKey				fKey;
+	int								fLeft;
+	int								fTop;
+	int								fWidth;
+	int								fHeight;
+	uint8*							fCovers;
+
+	HashTableLink<GlyphCoverageMask> fHashLink;
+	GlyphCoverageMask*				fPrevious;
+	GlyphCoverageMask*				fNext;
+};
+
+
+struct GlyphCoverageHashDefinition {
+	typedef GlyphCoverageKey	KeyType;
+	typedef GlyphCoverageMask	ValueType;
+
+	size_t HashKey(const KeyType& key) const
+	{
+		return key.HashKey();
+	}
+
+	size_t Hash(ValueType* value) const
+	{
+		return value->fKey.HashKey();
+	}
+
+	bool Compare(const KeyType& key, ValueType* value) const
+	{
+		return value->fKey == key;
+	}
+
+	HashTableLink<ValueType>* GetLink(ValueType* value) const
+	{
+		return &value->fHashLink;
+	}
+};
+
+
+// A bounded, thread safe cache of GlyphCoverageMasks. When the cache grows
+// beyond its byte budget, the least recently used masks are dropped. Masks
+// are reference counted, so a render thread may keep using a mask which has
+// already been evicted by another thread.
+class GlyphCoverageCache {
+public:
+	GlyphCoverageCache(size_t maxBytes);
+	virtual ~GlyphCoverageCache();
+
+	static GlyphCoverageCache* getInstance();
+
+	// Returns a referenced mask or NULL if none is cached for the key.
+	GlyphCoverageMask* get(const GlyphCoverageKey& key);
+
+	// Adopts the caller's reference to the mask and returns a referenced
+	// mask for the same key. If another thread cached a mask for the key in
+	// the meantime, that one is returned instead.
+	GlyphCoverageMask* put(GlyphCoverageMask* mask);
+
+	void clear();
+
+	inline size_t bytes() const
+	{
+		return fBytes;
+	}
+
+	static const int	MAX_MASK_SIZE = 256;
+
+private:
+	typedef OpenHashTable<GlyphCoverageHashDefinition> MaskTable;
+
+	void _Unlink(GlyphCoverageMask* mask);
+	void _LinkFront(GlyphCoverageMask* mask);
+	void _Evict(GlyphCoverageMask* mask);
+
+	BLocker					fLock;
+	MaskTable				fTable;
+	GlyphCoverageMask*		fFirst;
+	GlyphCoverageMask*		fLast;
+	size_t					fBytes;
+	size_t					fMaxBytes;
+};
+
+#endif // GLYPH_COVERAGE_CACHE_H
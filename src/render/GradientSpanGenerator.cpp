@@ -0,0 +1,196 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "GradientSpanGenerator.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+#include "Transformable.h"
+
+
+// clamp_index
+static inline int32
+clamp_index(float t, float maxIndex)
+{
+	// Written to also catch NaN, which ends up at the first color.
+	if (!(t > 0.0f))
+		return 0;
+	if (t > maxIndex)
+		return (int32)maxIndex;
+	return (int32)t;
+}
+
+#if defined(__SSE2__)
+// clamp_indices
+static inline __m128i
+clamp_indices(__m128 t, __m128 maxIndex)
+{
+	// _mm_max_ps() returns the second operand for NaN.
+	t = _mm_min_ps(_mm_max_ps(t, _mm_setzero_ps()), maxIndex);
+	return _mm_cvttps_epi32(t);
+}
+
+// gather_colors
+static inline void
+gather_colors(agg::rgba16* span, const agg::rgba16* colors, __m128i indices)
+{
+	int32 index[4];
+	_mm_storeu_si128((__m128i*)index, indices);
+	span[0] = colors[index[0]];
+	span[1] = colors[index[1]];
+	span[2] = colors[index[2]];
+	span[3] = colors[index[3]];
+}
+#endif // __SSE2__
+
+
+// #pragma mark - GradientSpanGenerator
+
+
+// constructor
+GradientSpanGenerator::GradientSpanGenerator(const agg::rgba16* colors,
+		int32 colorCount, const Transformable& inverse, double start,
+		double stop)
+	: fColors(colors)
+	, fMaxIndex((float)(colorCount - 1))
+	, fSx(inverse.sx)
+	, fShy(inverse.shy)
+	, fShx(inverse.shx)
+	, fSy(inverse.sy)
+	, fTx(inverse.tx)
+	, fTy(inverse.ty)
+{
+	// agg::span_gradient works in 1/16 pixel units and uses at least one
+	// unit for the range.
+	double range = stop - start;
+	if (range < 1.0 / 16.0)
+		range = 1.0 / 16.0;
+	fScale = colorCount / range;
+	fOffset = -start * fScale;
+}
+
+
+// #pragma mark - LinearGradientSpanGenerator
+
+
+// constructor
+LinearGradientSpanGenerator::LinearGradientSpanGenerator(
+		const agg::rgba16* colors, int32 colorCount,
+		const Transformable& inverse, double start, double stop)
+	: GradientSpanGenerator(colors, colorCount, inverse, start, stop)
+{
+}
+
+// generate
+void
+LinearGradientSpanGenerator::generate(agg::rgba16* span, int x, int y,
+	unsigned length)
+{
+	// The color index changes linearly along the span.
+	double px = x + 0.5;
+	double py = y + 0.5;
+	float t0 = (float)((fSx * px + fShx * py + fTx) * fScale + fOffset);
+	float dt = (float)(fSx * fScale);
+
+	// When the first and last pixel have the same color, all pixels in
+	// between have it as well. That is always the case when the gradient
+	// is perpendicular to the span, or when the span is outside the range
+	// of the gradient.
+	int32 first = clamp_index(t0, fMaxIndex);
+	int32 last = clamp_index(t0 + dt * (length - 1), fMaxIndex);
+	if (first == last) {
+		agg::rgba16 color = fColors[first];
+		do {
+			*span++ = color;
+		} while (--length);
+		return;
+	}
+
+	// Compute the index from the pixel offset, not by accumulating the
+	// step, so long spans don't drift.
+	float i = 0.0f;
+#if defined(__SSE2__)
+	const __m128 start = _mm_set1_ps(t0);
+	const __m128 step = _mm_set1_ps(dt);
+	const __m128 maxIndex = _mm_set1_ps(fMaxIndex);
+	const __m128 four = _mm_set1_ps(4.0f);
+	__m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	for (; length >= 4; length -= 4) {
+		__m128 t = _mm_add_ps(start, _mm_mul_ps(offsets, step));
+		gather_colors(span, fColors, clamp_indices(t, maxIndex));
+		offsets = _mm_add_ps(offsets, four);
+		span += 4;
+		i += 4.0f;
+	}
+#endif
+	for (; length > 0; length--) {
+		*span++ = fColors[clamp_index(t0 + i * dt, fMaxIndex)];
+		i += 1.0f;
+	}
+}
+
+
+// #pragma mark - RadialGradientSpanGenerator
+
+
+// constructor
+RadialGradientSpanGenerator::RadialGradientSpanGenerator(
+		const agg::rgba16* colors, int32 colorCount,
+		const Transformable& inverse, double start, double stop)
+	: GradientSpanGenerator(colors, colorCount, inverse, start, stop)
+{
+}
+
+// generate
+void
+RadialGradientSpanGenerator::generate(agg::rgba16* span, int x, int y,
+	unsigned length)
+{
+	// The gradient coordinates change linearly along the span, the color
+	// index is the distance from the gradient origin.
+	double px = x + 0.5;
+	double py = y + 0.5;
+	float gx = (float)(fSx * px + fShx * py + fTx);
+	float gy = (float)(fShy * px + fSy * py + fTy);
+	float dx = (float)fSx;
+	float dy = (float)fShy;
+	float scale = (float)fScale;
+	float offset = (float)fOffset;
+
+	float i = 0.0f;
+#if defined(__SSE2__)
+	const __m128 startX = _mm_set1_ps(gx);
+	const __m128 startY = _mm_set1_ps(gy);
+	const __m128 stepX = _mm_set1_ps(dx);
+	const __m128 stepY = _mm_set1_ps(dy);
+	const __m128 scaleVector = _mm_set1_ps(scale);
+	const __m128 offsetVector = _mm_set1_ps(offset);
+	const __m128 maxIndex = _mm_set1_ps(fMaxIndex);
+	const __m128 four = _mm_set1_ps(4.0f);
+	__m128 offsets = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+	for (; length >= 4; length -= 4) {
+		__m128 vx = _mm_add_ps(startX, _mm_mul_ps(offsets, stepX));
+		__m128 vy = _mm_add_ps(startY, _mm_mul_ps(offsets, stepY));
+		__m128 distance = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vx, vx),
+			_mm_mul_ps(vy, vy)));
+		__m128 t = _mm_add_ps(_mm_mul_ps(distance, scaleVector),
+			offsetVector);
+		gather_colors(span, fColors, clamp_indices(t, maxIndex));
+		offsets = _mm_add_ps(offsets, four);
+		span += 4;
+		i += 4.0f;
+	}
+#endif
+	for (; length > 0; length--) {
+		float vx = gx + i * dx;
+		float vy = gy + i * dy;
+		float t = sqrtf(vx * vx + vy * vy) * scale + offset;
+		*span++ = fColors[clamp_index(t, fMaxIndex)];
+		i += 1.0f;
+	}
+}
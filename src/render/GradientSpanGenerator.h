@@ -0,0 +1,74 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef GRADIENT_SPAN_GENERATOR_H
+#define GRADIENT_SPAN_GENERATOR_H
+
+#include <agg_color_rgba.h>
+
+#include <SupportDefs.h>
+
+class Transformable;
+
+// Span generators for linear and radial gradients under an affine
+// transformation. They produce the same colors as agg::span_gradient with
+// agg::gradient_x and agg::gradient_radial, but step the gradient
+// coordinates along the span instead of transforming every pixel, and
+// compute four colors at a time where SSE2 is available. Perspective
+// transformations are not supported, the caller needs to use the generic
+// agg path for those.
+class GradientSpanGenerator {
+public:
+								GradientSpanGenerator(
+									const agg::rgba16* colors,
+									int32 colorCount,
+									const Transformable& inverse,
+									double start, double stop);
+
+			void				prepare() {}
+
+protected:
+			const agg::rgba16*	fColors;
+			float				fMaxIndex;
+
+			// The inverse transformation, pixel to gradient space.
+			double				fSx;
+			double				fShy;
+			double				fShx;
+			double				fSy;
+			double				fTx;
+			double				fTy;
+
+			// The gradient distance to color index.
+			double				fScale;
+			double				fOffset;
+};
+
+
+class LinearGradientSpanGenerator : public GradientSpanGenerator {
+public:
+								LinearGradientSpanGenerator(
+									const agg::rgba16* colors,
+									int32 colorCount,
+									const Transformable& inverse,
+									double start, double stop);
+
+			void				generate(agg::rgba16* span, int x, int y,
+									unsigned length);
+};
+
+
+class RadialGradientSpanGenerator : public GradientSpanGenerator {
+public:
+								RadialGradientSpanGenerator(
+									const agg::rgba16* colors,
+									int32 colorCount,
+									const Transformable& inverse,
+									double start, double stop);
+
+			void				generate(agg::rgba16* span, int x, int y,
+									unsigned length);
+};
+
+#endif // GRADIENT_SPAN_GENERATOR_H
@@ -15,6 +15,7 @@ using std::nothrow;
 LayoutContext::LayoutContext(LayoutState* initialState)
 	: fCurrentState(initialState)
 	, fZoomLevel(1.0)
+	, fThreadCount(1)
 {
 }
 
@@ -53,6 +54,13 @@ LayoutContext::PopState()
 	fCurrentState = fCurrentState->Previous;
 }
 
+// SetThreadCount
+void
+LayoutContext::SetThreadCount(int32 count)
+{
+	fThreadCount = count > 0 ? count : 1;
+}
+
 // SetTransformation
 void
 LayoutContext::SetTransformation(const Transformable& matrix)
@@ -31,9 +31,17 @@ public:
 	inline	double				ZoomLevel() const
 									{ return fZoomLevel; }
 
+			// The number of threads which may layout independent layers
+			// in parallel. A copy of the context can be used by another
+			// thread to layout a sub-tree.
+			void				SetThreadCount(int32 count);
+	inline	int32				ThreadCount() const
+									{ return fThreadCount; }
+
 private:
 			LayoutState*		fCurrentState;
 			double				fZoomLevel;
+			int32				fThreadCount;
 };
 
 #endif // LAYOUT_CONTEXT_H
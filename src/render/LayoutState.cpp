@@ -57,6 +57,25 @@ LayoutState::operator=(const LayoutState& other)
 	return *this;
 }
 
+// operator==
+bool
+LayoutState::operator==(const LayoutState& other) const
+{
+	// The paints and stroke properties are shared via caches, equal
+	// values have the same pointer.
+	return Matrix == other.Matrix
+		&& fFillPaint == other.fFillPaint
+		&& fStrokePaint == other.fStrokePaint
+		&& fStrokeProperties == other.fStrokeProperties;
+}
+
+// operator!=
+bool
+LayoutState::operator!=(const LayoutState& other) const
+{
+	return !(*this == other);
+}
+
 // SetFillPaint
 void
 LayoutState::SetFillPaint(Paint* paint)
@@ -18,6 +18,9 @@ public:
 								~LayoutState();
 
 			LayoutState&		operator=(const LayoutState& other);
+			// Compares the inherited properties, not the opacity.
+			bool				operator==(const LayoutState& other) const;
+			bool				operator!=(const LayoutState& other) const;
 
 			LayoutState*		Previous;
 
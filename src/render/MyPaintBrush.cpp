@@ -0,0 +1,333 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "MyPaintBrush.h"
+
+#include <new>
+
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "TiledSurface.h"
+
+// This is the only place which includes the brushlib implementation,
+// helpers.hpp defines functions which are not inline.
+namespace brushlib {
+#include "helpers.hpp"
+#include "brush.hpp"
+}
+
+
+struct SettingDefault {
+	const char*	name;
+	float		value;
+};
+
+// The names and defaults of brushsettings.py, in the order of the
+// BRUSH_* constants.
+static const SettingDefault kSettings[] = {
+	{ "opaque", 1.0 },
+	{ "opaque_multiply", 0.0 },
+	{ "opaque_linearize", 0.9 },
+	{ "radius_logarithmic", 2.0 },
+	{ "hardness", 0.8 },
+	{ "anti_aliasing", 1.0 },
+	{ "dabs_per_basic_radius", 0.0 },
+	{ "dabs_per_actual_radius", 2.0 },
+	{ "dabs_per_second", 0.0 },
+	{ "radius_by_random", 0.0 },
+	{ "speed1_slowness", 0.04 },
+	{ "speed2_slowness", 0.8 },
+	{ "speed1_gamma", 4.0 },
+	{ "speed2_gamma", 4.0 },
+	{ "offset_by_random", 0.0 },
+	{ "offset_by_speed", 0.0 },
+	{ "offset_by_speed_slowness", 1.0 },
+	{ "slow_tracking", 0.0 },
+	{ "slow_tracking_per_dab", 0.0 },
+	{ "tracking_noise", 0.0 },
+	{ "color_h", 0.0 },
+	{ "color_s", 0.0 },
+	{ "color_v", 0.0 },
+	{ "restore_color", 0.0 },
+	{ "change_color_h", 0.0 },
+	{ "change_color_l", 0.0 },
+	{ "change_color_hsl_s", 0.0 },
+	{ "change_color_v", 0.0 },
+	{ "change_color_hsv_s", 0.0 },
+	{ "smudge", 0.0 },
+	{ "smudge_length", 0.5 },
+	{ "smudge_radius_log", 0.0 },
+	{ "eraser", 0.0 },
+	{ "stroke_threshold", 0.0 },
+	{ "stroke_duration_logarithmic", 4.0 },
+	{ "stroke_holdtime", 0.0 },
+	{ "custom_input", 0.0 },
+	{ "custom_input_slowness", 0.0 },
+	{ "elliptical_dab_ratio", 1.0 },
+	{ "elliptical_dab_angle", 90.0 },
+	{ "direction_filter", 2.0 },
+	{ "lock_alpha", 0.0 }
+};
+
+// In the order of the INPUT_* constants.
+static const char* kInputs[] = {
+	"pressure",
+	"speed1",
+	"speed2",
+	"random",
+	"stroke",
+	"direction",
+	"tilt_declination",
+	"tilt_ascension",
+	"custom"
+};
+
+static const int32 kMaxMappingPoints = 8;
+
+
+// find_setting
+static int32
+find_setting(const char* name)
+{
+	for (int32 i = 0; i < BRUSH_SETTINGS_COUNT; i++) {
+		if (strcmp(kSettings[i].name, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+// find_input
+static int32
+find_input(const char* name)
+{
+	for (int32 i = 0; i < INPUT_COUNT; i++) {
+		if (strcmp(kInputs[i], name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+// skip_space
+static inline char*
+skip_space(char* string)
+{
+	while (isspace(*string))
+		string++;
+	return string;
+}
+
+// terminate_word
+static inline char*
+terminate_word(char* string)
+{
+	while (*string != '\0' && !isspace(*string))
+		string++;
+	if (*string != '\0')
+		*string++ = '\0';
+	return string;
+}
+
+
+// #pragma mark -
+
+
+// constructor
+MyPaintBrush::MyPaintBrush()
+	: fBrush(NULL)
+{
+	SetTo("");
+}
+
+// destructor
+MyPaintBrush::~MyPaintBrush()
+{
+	delete fBrush;
+}
+
+// InitCheck
+status_t
+MyPaintBrush::InitCheck() const
+{
+	return fBrush != NULL ? B_OK : B_NO_MEMORY;
+}
+
+// SetTo
+status_t
+MyPaintBrush::SetTo(const char* settings)
+{
+	delete fBrush;
+	fBrush = new(std::nothrow) brushlib::Brush();
+	if (fBrush == NULL)
+		return B_NO_MEMORY;
+
+	for (int32 i = 0; i < BRUSH_SETTINGS_COUNT; i++)
+		fBrush->set_base_value(i, kSettings[i].value);
+
+	char* text = strdup(settings);
+	if (text == NULL)
+		return B_NO_MEMORY;
+
+	status_t status = B_OK;
+	char* line = text;
+	while (line != NULL && status == B_OK) {
+		char* next = strchr(line, '\n');
+		if (next != NULL)
+			*next++ = '\0';
+		status = _ParseLine(line);
+		line = next;
+	}
+
+	free(text);
+	return status;
+}
+
+// Load
+status_t
+MyPaintBrush::Load(const char* path)
+{
+	FILE* file = fopen(path, "r");
+	if (file == NULL)
+		return B_ENTRY_NOT_FOUND;
+
+	status_t status = B_OK;
+	char* text = NULL;
+	size_t size = 0;
+	while (true) {
+		char* newText = (char*)realloc(text, size + 4096 + 1);
+		if (newText == NULL) {
+			status = B_NO_MEMORY;
+			break;
+		}
+		text = newText;
+		size_t bytesRead = fread(text + size, 1, 4096, file);
+		size += bytesRead;
+		if (bytesRead < 4096)
+			break;
+	}
+	if (status == B_OK && ferror(file))
+		status = B_IO_ERROR;
+	fclose(file);
+
+	if (status == B_OK) {
+		text[size] = '\0';
+		status = SetTo(text);
+	}
+
+	free(text);
+	return status;
+}
+
+// SetColor
+void
+MyPaintBrush::SetColor(const rgb_color& color)
+{
+	if (fBrush == NULL)
+		return;
+
+	float h = color.red / 255.0f;
+	float s = color.green / 255.0f;
+	float v = color.blue / 255.0f;
+	brushlib::rgb_to_hsv_float(&h, &s, &v);
+
+	fBrush->set_base_value(BRUSH_COLOR_H, h);
+	fBrush->set_base_value(BRUSH_COLOR_S, s);
+	fBrush->set_base_value(BRUSH_COLOR_V, v);
+}
+
+// NewStroke
+void
+MyPaintBrush::NewStroke()
+{
+	if (fBrush == NULL)
+		return;
+
+	fBrush->reset();
+	fBrush->new_stroke();
+}
+
+// StrokeTo
+void
+MyPaintBrush::StrokeTo(TiledSurface* surface, float x, float y,
+	float pressure, float tiltX, float tiltY, double deltaTime)
+{
+	if (fBrush == NULL)
+		return;
+
+	fBrush->stroke_to(surface, x, y, pressure, tiltX, tiltY, deltaTime);
+}
+
+// #pragma mark - private
+
+// _ParseLine
+status_t
+MyPaintBrush::_ParseLine(char* line)
+{
+	// name base | input (x y), (x y) | input (x y), ...
+	line = skip_space(line);
+	if (*line == '\0' || *line == '#')
+		return B_OK;
+
+	char* name = line;
+	line = terminate_word(line);
+
+	if (strcmp(name, "version") == 0)
+		return atoi(line) <= 2 ? B_OK : B_BAD_DATA;
+
+	int32 setting = find_setting(name);
+	if (setting < 0) {
+		// Like "parent_brush_name", or settings of newer versions.
+		return B_OK;
+	}
+
+	char* mapping = strchr(line, '|');
+	if (mapping != NULL)
+		*mapping++ = '\0';
+
+	char* end;
+	float baseValue = strtod(line, &end);
+	if (end == line)
+		return B_BAD_DATA;
+	fBrush->set_base_value(setting, baseValue);
+
+	while (mapping != NULL) {
+		char* nextMapping = strchr(mapping, '|');
+		if (nextMapping != NULL)
+			*nextMapping++ = '\0';
+
+		char* inputName = skip_space(mapping);
+		char* point = terminate_word(inputName);
+
+		float x[kMaxMappingPoints];
+		float y[kMaxMappingPoints];
+		int32 count = 0;
+		while ((point = strchr(point, '(')) != NULL) {
+			if (count == kMaxMappingPoints)
+				return B_BAD_DATA;
+			x[count] = strtod(point + 1, &end);
+			y[count] = strtod(end, &point);
+			if (point == end)
+				return B_BAD_DATA;
+			count++;
+		}
+		if (count == 1)
+			return B_BAD_DATA;
+
+		int32 input = find_input(inputName);
+		if (input >= 0) {
+			fBrush->set_mapping_n(setting, input, count);
+			for (int32 i = 0; i < count; i++)
+				fBrush->set_mapping_point(setting, input, i, x[i], y[i]);
+		}
+
+		mapping = nextMapping;
+	}
+
+	return B_OK;
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef MY_PAINT_BRUSH_H
+#define MY_PAINT_BRUSH_H
+
+#include <GraphicsDefs.h>
+#include <SupportDefs.h>
+
+class TiledSurface;
+
+namespace brushlib {
+class Brush;
+}
+
+// A MyPaint brush, configured from the contents of a MyPaint brush file
+// (.myb, version 2). The brush interpolates the events passed to StrokeTo()
+// and paints the dabs onto a TiledSurface. The dynamics are deterministic,
+// painting the same events with a new brush of the same settings gives the
+// same pixels.
+class MyPaintBrush {
+public:
+								MyPaintBrush();
+								~MyPaintBrush();
+
+			status_t			InitCheck() const;
+
+	// Resets the brush to the MyPaint defaults, then applies the settings.
+	// Unknown settings and inputs are ignored.
+			status_t			SetTo(const char* settings);
+			status_t			Load(const char* path);
+
+	// Overrides the color of the brush settings.
+			void				SetColor(const rgb_color& color);
+
+	// Forgets the brush state of the previous stroke.
+			void				NewStroke();
+
+	// The tilt is in the range -1.0 to 1.0, the time is the delta to
+	// the previous event in seconds.
+			void				StrokeTo(TiledSurface* surface, float x,
+									float y, float pressure, float tiltX,
+									float tiltY, double deltaTime);
+
+private:
+			status_t			_ParseLine(char* line);
+
+private:
+			brushlib::Brush*	fBrush;
+};
+
+#endif // MY_PAINT_BRUSH_H
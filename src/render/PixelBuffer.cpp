@@ -12,31 +12,39 @@
 
 #include <debugger.h>
 
+#include "BufferPool.h"
+
 // constructor
 PixelBuffer::PixelBuffer(const BRect& bounds, uint32 bytesPerPixel)
-	: fBits(new (std::nothrow) uint8[(bounds.IntegerWidth() + 1) * bytesPerPixel
-		* (bounds.IntegerHeight() + 1)])
-	, fWidth(bounds.IntegerWidth() + 1)
-	, fHeight(bounds.IntegerHeight() + 1)
-	, fBytesPerRow(fWidth * bytesPerPixel)
-	, fBytesPerPixel(bytesPerPixel)
+	: fBits(NULL)
+	, fWidth(0)
+	, fHeight(0)
+	, fBytesPerRow(0)
+	, fBytesPerPixel(0)
 	, fLeft(static_cast<int32>(bounds.left))
 	, fTop(static_cast<int32>(bounds.top))
 	, fAdopted(false)
+	, fAllocatedSize(0)
+	, fSource(NULL)
 {
+	_Allocate(bounds.IntegerWidth() + 1, bounds.IntegerHeight() + 1,
+		bytesPerPixel);
 }
 
 // constructor
 PixelBuffer::PixelBuffer(uint32 width, uint32 height, uint32 bytesPerPixel)
-	: fBits(new (std::nothrow) uint8[width * bytesPerPixel * height])
-	, fWidth(width)
-	, fHeight(height)
-	, fBytesPerRow(width * bytesPerPixel)
-	, fBytesPerPixel(bytesPerPixel)
+	: fBits(NULL)
+	, fWidth(0)
+	, fHeight(0)
+	, fBytesPerRow(0)
+	, fBytesPerPixel(0)
 	, fLeft(0)
 	, fTop(0)
 	, fAdopted(false)
+	, fAllocatedSize(0)
+	, fSource(NULL)
 {
+	_Allocate(width, height, bytesPerPixel);
 }
 
 // constructor
@@ -49,6 +57,8 @@ PixelBuffer::PixelBuffer(PixelBuffer* bitmap, BRect area, bool adopt)
 	, fLeft(0)
 	, fTop(0)
 	, fAdopted(false)
+	, fAllocatedSize(0)
+	, fSource(NULL)
 {
 	area = area & bitmap->Bounds();
 
@@ -58,8 +68,8 @@ PixelBuffer::PixelBuffer(PixelBuffer* bitmap, BRect area, bool adopt)
 	uint32 bytesPerRow = bitmap->BytesPerRow();
 	uint32 bytesPerPixel = bitmap->BytesPerPixel();
 
-	buffer += (int32)area.left * bytesPerPixel;
-	buffer += (int32)area.top * bytesPerRow;
+	buffer += ((int32)area.left - bitmap->Left()) * bytesPerPixel;
+	buffer += (int64)((int32)area.top - bitmap->Top()) * bytesPerRow;
 
 	_Attach(buffer, width, height, bytesPerPixel, bytesPerRow, adopt);
 
@@ -78,15 +88,34 @@ PixelBuffer::PixelBuffer(uint8* buffer, uint32 width, uint32 height,
 	, fLeft(0)
 	, fTop(0)
 	, fAdopted(false)
+	, fAllocatedSize(0)
+	, fSource(NULL)
 {
 	_Attach(buffer, width, height, bytesPerPixel, bytesPerRow, adopt);
 }
 
+// constructor
+PixelBuffer::PixelBuffer(uint8* buffer, const BRect& bounds,
+		uint32 bytesPerPixel, uint32 bytesPerRow)
+	: fBits(NULL)
+	, fWidth(0)
+	, fHeight(0)
+	, fBytesPerRow(0)
+	, fBytesPerPixel(0)
+	, fLeft(static_cast<int32>(bounds.left))
+	, fTop(static_cast<int32>(bounds.top))
+	, fAdopted(false)
+	, fAllocatedSize(0)
+	, fSource(NULL)
+{
+	_Attach(buffer, bounds.IntegerWidth() + 1, bounds.IntegerHeight() + 1,
+		bytesPerPixel, bytesPerRow, true);
+}
+
 // destructor
 PixelBuffer::~PixelBuffer()
 {
-	if (!fAdopted)
-		delete[] fBits;
+	_Free();
 }
 
 // IsValid()
@@ -119,10 +148,10 @@ PixelBuffer::CopyTo(PixelBuffer* buffer, BRect area) const
 	uint8* dst = buffer->Bits();
 	uint32 dstBPR = buffer->BytesPerRow();
 	dst += ((int32)area.left - buffer->fLeft) * fBytesPerPixel;
-	dst += ((int32)area.top - buffer->fTop) * dstBPR;
+	dst += (int64)((int32)area.top - buffer->fTop) * dstBPR;
 	uint8* src = fBits;
 	src += ((int32)area.left - fLeft) * fBytesPerPixel;
-	src += ((int32)area.top - fTop) * fBytesPerRow;
+	src += (int64)((int32)area.top - fTop) * fBytesPerRow;
 	int32 bytes = (area.IntegerWidth() + 1) * fBytesPerPixel;
 	int32 height = area.IntegerHeight() + 1;
 
@@ -168,24 +197,25 @@ void
 PixelBuffer::_Attach(uint8* buffer, uint32 width, uint32 height,
 	uint32 bytesPerPixel, uint32 bytesPerRow, bool adopt)
 {
-	if (!fAdopted)
-		delete[] fBits;
+	_Free();
 
-	fWidth = width;
-	fHeight = height;
-	fAdopted = adopt;
-	fBytesPerPixel = bytesPerPixel;
 	if (adopt) {
+		fWidth = width;
+		fHeight = height;
+		fAdopted = true;
+		fBytesPerPixel = bytesPerPixel;
 		fBits = buffer;
 		fBytesPerRow = bytesPerRow;
 		if (fBytesPerRow < width * fBytesPerPixel)
 			debugger("Buffer size insufficient for given width.");
 	} else {
-		fBytesPerRow = width * fBytesPerPixel;
-		fBits = new uint8[fBytesPerRow * height];
+		_Allocate(width, height, bytesPerPixel);
+		if (fBits == NULL)
+			return;
 		uint8* dst = fBits;
+		uint32 bytes = width * bytesPerPixel;
 		for (uint32 y = 0; y < height; y++) {
-			memcpy(dst, buffer, fBytesPerRow);
+			memcpy(dst, buffer, bytes);
 			dst += fBytesPerRow;
 			buffer += bytesPerRow;
 		}
@@ -194,7 +224,7 @@ PixelBuffer::_Attach(uint8* buffer, uint32 width, uint32 height,
 
 // _CropUnclipped
 PixelBuffer*
-PixelBuffer::_CropUnclipped(BRect bounds) const
+PixelBuffer::_CropUnclipped(BRect bounds)
 {
 	BRect s(0, 0, Width() - 1, Height() - 1);
 
@@ -208,10 +238,26 @@ PixelBuffer::_CropUnclipped(BRect bounds) const
 	bounds.right = bounds.left + (w + (4 - w % 4)) - 1;
 	bounds.bottom = bounds.top + (h + (4 - h % 4)) - 1;
 
+	if (s.Contains(bounds)) {
+		// No pixels need to be made up, the result can show the pixels
+		// of this buffer, which it keeps alive.
+		uint8* bits = fBits + (int64)bounds.top * fBytesPerRow
+			+ (int32)bounds.left * fBytesPerPixel;
+		PixelBuffer* result = _CreateView(bits,
+			bounds.OffsetToCopy(B_ORIGIN), fBytesPerRow);
+		if (result == NULL || !result->IsValid()) {
+			delete result;
+			return NULL;
+		}
+		result->fSource = this;
+		AddReference();
+		return result;
+	}
+
 	PixelBuffer* result = _Create(bounds.OffsetToCopy(B_ORIGIN));
 	if (result == NULL || !result->IsValid()) {
 		delete result;
-		return result;
+		return NULL;
 	}
 	
 	uint32 emptyStartLines = bounds.top	< 0.0 ? (uint32)-bounds.top : 0;
@@ -234,7 +280,8 @@ PixelBuffer::_CropUnclipped(BRect bounds) const
 	uint32 dstBPR = result->BytesPerRow();
 
 	BRect t = s & bounds;
-	src += (int)(t.left - s.left + (t.top - s.top) * srcBPR);
+	src += (int32)(t.left - s.left) * fBytesPerPixel
+		+ (int64)(t.top - s.top) * srcBPR;
 
 	// make starting lines empty
 	for (uint32 y = 0; y < emptyStartLines; y++) {
@@ -265,3 +312,29 @@ PixelBuffer::_CropUnclipped(BRect bounds) const
 	return result;
 }
 
+// _Allocate
+void
+PixelBuffer::_Allocate(uint32 width, uint32 height, uint32 bytesPerPixel)
+{
+	fWidth = width;
+	fHeight = height;
+	fBytesPerPixel = bytesPerPixel;
+	fBytesPerRow = BufferPool::BytesPerRowFor(width, bytesPerPixel);
+	fAdopted = false;
+	fBits = BufferPool::Default()->Allocate((size_t)fBytesPerRow * height,
+		fAllocatedSize);
+}
+
+// _Free
+void
+PixelBuffer::_Free()
+{
+	if (fSource != NULL) {
+		fSource->RemoveReference();
+		fSource = NULL;
+	} else if (!fAdopted)
+		BufferPool::Default()->Free(fBits, fAllocatedSize);
+
+	fBits = NULL;
+	fAllocatedSize = 0;
+}
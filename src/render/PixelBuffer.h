@@ -10,6 +10,9 @@
 
 #include "Referenceable.h"
 
+// The pixel memory of a PixelBuffer comes from the BufferPool, unless it is
+// attached to memory of someone else. Rows are padded to 64 bytes, clients
+// need to use BytesPerRow() and not assume Width() * BytesPerPixel().
 class PixelBuffer : public Referenceable {
 public:
 								PixelBuffer(const BRect& bounds,
@@ -22,6 +25,10 @@ public:
 									uint32 width, uint32 height,
 									uint32 bytesPerPixel,
 									uint32 bytesPerRow, bool adopt);
+								PixelBuffer(uint8* buffer,
+									const BRect& bounds,
+									uint32 bytesPerPixel,
+									uint32 bytesPerRow);
 	virtual						~PixelBuffer();
 
 			bool				IsValid() const;
@@ -36,8 +43,8 @@ public:
 									{ return fBytesPerRow; }
 	inline	uint32				BytesPerPixel() const
 									{ return fBytesPerPixel; }
-	inline	uint32				BitsLength() const
-									{ return Height() * BytesPerRow(); }
+	inline	size_t				BitsLength() const
+									{ return (size_t)Height() * BytesPerRow(); }
 			BRect				Bounds() const;
 	inline	int32				Left() const
 									{ return fLeft; }
@@ -54,8 +61,18 @@ protected:
 									bool adopt);
 
 	virtual PixelBuffer*		_Create(const BRect bounds) const = 0;
+	virtual PixelBuffer*		_CreateView(uint8* bits, const BRect bounds,
+									uint32 bytesPerRow) const = 0;
 
-			PixelBuffer*		_CropUnclipped(BRect bounds) const;
+			// Returns a view of this buffer, if the bounds are completely
+			// inside, a padded copy otherwise. Writing to a view changes
+			// the pixels of this buffer.
+			PixelBuffer*		_CropUnclipped(BRect bounds);
+
+private:
+			void				_Allocate(uint32 width, uint32 height,
+									uint32 bytesPerPixel);
+			void				_Free();
 
 protected:
 			uint8*				fBits;
@@ -66,6 +83,11 @@ protected:
 			int32				fLeft;
 			int32				fTop;
 			bool				fAdopted;
+
+private:
+			size_t				fAllocatedSize;
+			// A view keeps a reference to the buffer it shows.
+			PixelBuffer*		fSource;
 };
 
 #endif // PIXEL_BUFFER_H
@@ -89,6 +89,13 @@ RenderBuffer::RenderBuffer(uint8* buffer, uint32 width, uint32 height,
 {
 }
 
+// constructor
+RenderBuffer::RenderBuffer(uint8* buffer, const BRect& bounds,
+		uint32 bytesPerRow)
+	: PixelBuffer(buffer, bounds, 8, bytesPerRow)
+{
+}
+
 // Attach
 void
 RenderBuffer::Attach(uint8* buffer, uint32 width, uint32 height,
@@ -110,7 +117,7 @@ RenderBuffer::Clear(BRect area, const rgb_color& color)
 
 	uint8* dst = fBits;
 	dst += (left - fLeft) * 8;
-	dst += ((int32)area.top - fTop) * fBytesPerRow;
+	dst += (int64)((int32)area.top - fTop) * fBytesPerRow;
 
 	agg::rgba16 linearColor(
 		RenderEngine::GammaToLinear(color.red),
@@ -155,10 +162,10 @@ RenderBuffer::CopyTo(BBitmap* bitmap, BRect area) const
 	uint8* dst = reinterpret_cast<uint8*>(bitmap->Bits());
 	uint32 dstBPR = bitmap->BytesPerRow();
 	dst += (left - (int32)bitmap->Bounds().left) * 4;
-	dst += (top - (int32)bitmap->Bounds().top) * dstBPR;
+	dst += (int64)(top - (int32)bitmap->Bounds().top) * dstBPR;
 	uint8* src = fBits;
 	src += (left - fLeft) * 8;
-	src += (top - fTop) * fBytesPerRow;
+	src += (int64)(top - fTop) * fBytesPerRow;
 
 	for (int32 y = 0; y < height; y++) {
 		uint8* d = dst;
@@ -179,9 +186,60 @@ RenderBuffer::CopyTo(BBitmap* bitmap, BRect area) const
 	}
 }
 
+// CompositeTo
+void
+RenderBuffer::CompositeTo(BBitmap* bitmap, BRect area,
+	const rgb_color& background) const
+{
+	// make sure we don't copy out of bounds
+	area = area & bitmap->Bounds();
+	area = area & Bounds();
+	if (!area.IsValid())
+		return;
+
+	int32 left = (int32)area.left;
+	int32 right = (int32)area.right;
+	int32 top = (int32)area.top;
+	int32 height = area.IntegerHeight() + 1;
+
+	uint8* dst = reinterpret_cast<uint8*>(bitmap->Bits());
+	uint32 dstBPR = bitmap->BytesPerRow();
+	dst += (left - (int32)bitmap->Bounds().left) * 4;
+	dst += (int64)(top - (int32)bitmap->Bounds().top) * dstBPR;
+	const uint8* src = fBits;
+	src += (left - fLeft) * 8;
+	src += (int64)(top - fTop) * fBytesPerRow;
+
+	const uint32 blue = RenderEngine::GammaToLinear(background.blue);
+	const uint32 green = RenderEngine::GammaToLinear(background.green);
+	const uint32 red = RenderEngine::GammaToLinear(background.red);
+
+	for (int32 y = 0; y < height; y++) {
+		uint8* d = dst;
+		const uint16* s = reinterpret_cast<const uint16*>(src);
+		for (int32 x = left; x <= right; x++) {
+			// Same as BlendTo() onto the opaque background, the result is
+			// opaque and needs no demultiplying before applying the
+			// inverse gamma.
+			uint32 alpha = 65535 - s[3];
+			d[0] = RenderEngine::LinearToGamma(
+				(uint16)(blue * alpha / 65535 + s[0]));
+			d[1] = RenderEngine::LinearToGamma(
+				(uint16)(green * alpha / 65535 + s[1]));
+			d[2] = RenderEngine::LinearToGamma(
+				(uint16)(red * alpha / 65535 + s[2]));
+			d[3] = 255;
+			d += 4;
+			s += 4;
+		}
+		src += fBytesPerRow;
+		dst += dstBPR;
+	}
+}
+
 // CropUnclipped
 RenderBufferRef
-RenderBuffer::CropUnclipped(BRect bounds) const
+RenderBuffer::CropUnclipped(BRect bounds)
 {
 	RenderBuffer* buffer = static_cast<RenderBuffer*>(_CropUnclipped(bounds));
 	return RenderBufferRef(buffer, true);
@@ -201,10 +259,10 @@ RenderBuffer::BlendTo(RenderBuffer* buffer, BRect area) const
 	uint8* dst = buffer->Bits();
 	uint32 dstBPR = buffer->BytesPerRow();
 	dst += (left - buffer->fLeft) * 8;
-	dst += ((int32)area.top - buffer->fTop) * dstBPR;
+	dst += (int64)((int32)area.top - buffer->fTop) * dstBPR;
 	uint8* src = fBits;
 	src += (left - fLeft) * 8;
-	src += ((int32)area.top - fTop) * fBytesPerRow;
+	src += (int64)((int32)area.top - fTop) * fBytesPerRow;
 	int32 height = area.IntegerHeight() + 1;
 
 	for (int32 y = 0; y < height; y++) {
@@ -239,3 +297,10 @@ RenderBuffer::_Create(const BRect bounds) const
 {
 	return new (std::nothrow) RenderBuffer(bounds);
 }
+
+// _CreateView
+PixelBuffer*
+RenderBuffer::_CreateView(uint8* bits, const BRect bounds, uint32 bytesPerRow) const
+{
+	return new (std::nothrow) RenderBuffer(bits, bounds, bytesPerRow);
+}
@@ -21,6 +21,12 @@ class BBitmap;
 // that both source and target buffers have in common with the provided area.
 // It is not possible/intended to shift the buffer in the coordinate space
 // during the copy process.
+// CropUnclipped() returns a buffer at the origin, which shares the pixels
+// and keeps a reference to this buffer if the bounds are inside of it, and
+// is a copy padded with transparent pixels otherwise. Unlike it used to,
+// the result then aliases this buffer: drawing into it changes this buffer,
+// and changes to this buffer show in it. Clients which need a private copy
+// have to CopyTo() a buffer of their own.
 
 class RenderBuffer;
 typedef Reference<RenderBuffer> RenderBufferRef;
@@ -35,6 +41,9 @@ public:
 								RenderBuffer(uint8* buffer,
 									uint32 width, uint32 height,
 									uint32 bytesPerRow, bool adopt);
+								RenderBuffer(uint8* buffer,
+									const BRect& bounds,
+									uint32 bytesPerRow);
 
 			void				Attach(uint8* buffer, uint32 width,
 									uint32 height, uint32 bytesPerRow,
@@ -44,13 +53,19 @@ public:
 
 			void				CopyTo(RenderBuffer* buffer, BRect area) const;
 			void				CopyTo(BBitmap* bitmap, BRect area) const;
+			// Blends the pixels onto a solid background and converts them
+			// for display, the alpha channel of the bitmap ends up opaque.
+			void				CompositeTo(BBitmap* bitmap, BRect area,
+									const rgb_color& background) const;
 
-			RenderBufferRef		CropUnclipped(BRect bounds) const;
+			RenderBufferRef		CropUnclipped(BRect bounds);
 
 			void				BlendTo(RenderBuffer* buffer, BRect area) const;
 
 protected:
 	virtual PixelBuffer*		_Create(const BRect bounds) const;
+	virtual PixelBuffer*		_CreateView(uint8* bits, const BRect bounds,
+									uint32 bytesPerRow) const;
 };
 
 #endif // RENDER_BUFFER_H
@@ -17,15 +17,40 @@
 #include <agg_span_interpolator_persp.h>
 #include <agg_span_subdiv_adaptor.h>
 
-#include <CImg.h>
-
+#include "DenoiseFilter.h"
 #include "Gradient.h"
+#include "GradientSpanGenerator.h"
 #include "Interpolation.h"
 #include "RenderBuffer.h"
 #include "SetProperty.h"
 
 using std::nothrow;
 
+// clip_span
+// Clips a cached span horizontally, returns false if nothing is left.
+static inline bool
+clip_span(const Span* span, int left, int right, int& x, int& length,
+	const CoverType*& covers)
+{
+	x = span->x;
+	length = span->len < 0 ? -span->len : span->len;
+	covers = span->covers;
+
+	if (x < left) {
+		length -= left - x;
+		if (length <= 0)
+			return false;
+		// Solid spans have only a single cover value.
+		if (span->len > 0)
+			covers += left - x;
+		x = left;
+	}
+	if (x + length - 1 > right)
+		length = right - x + 1;
+
+	return length > 0;
+}
+
 // constructor
 RenderEngine::RenderEngine()
 	: fState()
@@ -45,6 +70,11 @@ RenderEngine::RenderEngine()
 	, fSpanAllocator()
 
 	, fRasterizer()
+
+	, fThreadCount(1)
+	, fCurrentGeneration(NULL)
+	, fGeneration(0)
+	, fScratchArena()
 {
 }
 
@@ -67,6 +97,11 @@ RenderEngine::RenderEngine(const Transformable& transformation)
 	, fSpanAllocator()
 
 	, fRasterizer()
+
+	, fThreadCount(1)
+	, fCurrentGeneration(NULL)
+	, fGeneration(0)
+	, fScratchArena()
 {
 	SetTransformation(transformation);
 }
@@ -174,6 +209,22 @@ RenderEngine::SetOpacity(uint8 opacity)
 	fState.Opacity = opacity;
 }
 
+// SetThreadCount
+void
+RenderEngine::SetThreadCount(int32 count)
+{
+	fThreadCount = count > 1 ? count : 1;
+}
+
+// SetRenderGeneration
+void
+RenderEngine::SetRenderGeneration(const vint32* currentGeneration,
+	int32 generation)
+{
+	fCurrentGeneration = currentGeneration;
+	fGeneration = generation;
+}
+
 // BlendArea
 void
 RenderEngine::BlendArea(const RenderBuffer* source, BRect area, uint8 opacity,
@@ -191,7 +242,7 @@ RenderEngine::BlendArea(const RenderBuffer* source, BRect area, uint8 opacity,
 	int32 left = (int32)area.left;
 	int32 top = (int32)area.top;
 
-	src += top * bpr + left * 8;
+	src += (int64)top * bpr + left * 8;
 
 	RenderingBuffer sourceBuffer;
 	sourceBuffer.attach(src, area.IntegerWidth() + 1,
@@ -300,8 +351,11 @@ RenderEngine::DrawImage(const RenderBuffer* buffer, BRect area,
 
 	PixelFormat srcPixelFormat(srcBuffer);
 
+	// The bounds of the buffer are in the coordinate space of the image,
+	// but the span generators index the pixels of the buffer from 0, 0.
 	Transformable imgMatrix = fState.Matrix;
 	imgMatrix.Invert();
+	imgMatrix.TranslateBy(BPoint(-buffer->Left(), -buffer->Top()));
 
 	// path encloses image
 	BRect imageRect = buffer->Bounds();
@@ -466,58 +520,22 @@ RenderEngine::Denoise(const RenderBuffer* buffer,
 	const float gaussPrecision, const unsigned int interpolationType,
 	const bool fastApproximation)
 {
-	try {
-		uint32 width = buffer->Width();
-		uint32 height = buffer->Height();
-
-		cimg_library::CImg<uint16> image(width, height, 1, 3);
-
-		uint8* src = (uint8*)buffer->Bits();
-		uint16* dst = (uint16*)image.data;
-		uint32 srcBPR = buffer->BytesPerRow();
-
-		// copy dest contents into image
-		for (uint32 y = 0; y < height; y++) {
-			uint16* s = (uint16*)src;
-			uint16* d1 = dst;
-			uint16* d2 = dst + width * height;
-			uint16* d3 = dst + 2 * width * height;
-			for (uint32 x = 0; x < width; x++) {
-				*d1++ = s[0];
-				*d2++ = s[1];
-				*d3++ = s[2];
-				s += 4;
-			}
-			src += srcBPR;
-			dst += width;
-		}
-	
-		image.blur_anisotropic(amplitude, sharpness, anisotropy,
-			alpha, sigma, dl, da, gaussPrecision, interpolationType,
-			fastApproximation);
-
-		// copy result back into dest
-		src = (uint8*)buffer->Bits();
-		dst = (uint16*)image.data;
-		for (uint32 y = 0; y < height; y++) {
-			uint16* s = (uint16*)src;
-			uint16* d1 = dst;
-			uint16* d2 = dst + width * height;
-			uint16* d3 = dst + 2 * width * height;
-			for (uint32 x = 0; x < width; x++) {
-				s[0] = *d1++;
-				s[1] = *d2++;
-				s[2] = *d3++;
-				s += 4;
-			}
-			src += srcBPR;
-			dst += width;
-		}
-	} catch (...) {
-		printf("CImgDeNoise::ProcessBitmap() - caught exception!\n");
-		return B_ERROR;
-	}
-	return B_OK;
+	DenoiseParameters parameters;
+	parameters.amplitude = amplitude;
+	parameters.sharpness = sharpness;
+	parameters.anisotropy = anisotropy;
+	parameters.alpha = alpha;
+	parameters.sigma = sigma;
+	parameters.dl = dl;
+	parameters.da = da;
+	parameters.gaussPrecision = gaussPrecision;
+	parameters.interpolationType = interpolationType;
+	parameters.fastApproximation = fastApproximation;
+
+	DenoiseFilter filter;
+	filter.SetParameters(parameters);
+	return filter.Filter(const_cast<RenderBuffer*>(buffer), buffer->Bounds(),
+		fThreadCount);
 }
 
 // #pragma mark -
@@ -554,8 +572,17 @@ RenderEngine::_RenderScanlines(bool fillPaint,
 		}
 		case Paint::GRADIENT:
 		{
-			// TODO: fState.Opacity!
 			const agg::rgba16* gradientArray = paint->Colors();
+			if (gradientArray == NULL)
+				return;
+
+			// The global opacity is folded into a copy of the color array.
+			ScratchArena::Scope scope(fScratchArena);
+			if (fState.Opacity < 255) {
+				gradientArray = _ApplyOpacity(gradientArray, fState.Opacity);
+				if (gradientArray == NULL)
+					return;
+			}
 
 			const GradientRef& gradient = paint->Gradient();
 			Transformable transform(*gradient.Get());
@@ -565,6 +592,11 @@ RenderEngine::_RenderScanlines(bool fillPaint,
 			switch (gradient->GetType()) {
 				case Gradient::CIRCULAR:
 				{
+					if (!transform.IsPerspective()) {
+						_RenderGradient<RadialGradientSpanGenerator>(
+							gradientArray, transform, scanlineContainer);
+						break;
+					}
 					agg::gradient_radial function;
 					_RenderScanlines(gradientArray, function, transform,
 						scanlineContainer);
@@ -601,6 +633,11 @@ RenderEngine::_RenderScanlines(bool fillPaint,
 				case Gradient::LINEAR:
 				default:
 				{
+					if (!transform.IsPerspective()) {
+						_RenderGradient<LinearGradientSpanGenerator>(
+							gradientArray, transform, scanlineContainer);
+						break;
+					}
 					agg::gradient_x function;
 					_RenderScanlines(gradientArray, function, transform,
 						scanlineContainer);
@@ -641,16 +678,40 @@ RenderEngine::_RenderScanlines(agg::rgba16 color, BaseRenderer& baseRenderer,
 		agg::render_scanlines_aa_solid(fRasterizer, fScanline, baseRenderer,
 			color);
 	} else {
-		// Render cached scanlines from the container
-		int32 top = baseRenderer.ymin();
-		int32 bottom = baseRenderer.ymax();
+		// Render cached scanlines from the container, only those within
+		// the clipping box are visited at all.
+		int left = baseRenderer.xmin();
+		int right = baseRenderer.xmax();
+		int top = baseRenderer.ymin();
+		int bottom = baseRenderer.ymax();
 
 		uint32 count = scanlineContainer->CountObjects();
-		for (uint32 i = 0; i < count; i++) {
+		for (uint32 i = scanlineContainer->FirstIndexAt(top); i < count;
+				i++) {
 			const Scanline* scanline = scanlineContainer->ObjectAtFast(i);
 			int y = scanline->y();
-			if (y >= top && y <= bottom)
-				agg::render_scanline_aa_solid(*scanline, baseRenderer, color);
+			if (y > bottom)
+				break;
+
+			const Span* span = scanline->begin();
+			for (unsigned spans = scanline->num_spans(); spans > 0;
+					spans--, span++) {
+				int x;
+				int length;
+				const CoverType* covers;
+				if (span->x > right)
+					break;
+				if (!clip_span(span, left, right, x, length, covers))
+					continue;
+
+				if (span->len > 0) {
+					baseRenderer.blend_solid_hspan(x, y, length, color,
+						covers);
+				} else {
+					baseRenderer.blend_hline(x, y, x + length - 1, color,
+						*covers);
+				}
+			}
 		}
 	}
 }
@@ -667,17 +728,38 @@ RenderEngine::_RenderScanlines(SpanAllocator& spanAllocator,
 		agg::render_scanlines_aa(fRasterizer, fScanline, baseRenderer,
 			spanAllocator, spanGenerator);
 	} else {
-		// Render cached scanlines from the container
-		int32 top = baseRenderer.ymin();
-		int32 bottom = baseRenderer.ymax();
+		// Render cached scanlines from the container, only those within
+		// the clipping box are visited at all, and colors are generated
+		// only for the visible part of each span.
+		int left = baseRenderer.xmin();
+		int right = baseRenderer.xmax();
+		int top = baseRenderer.ymin();
+		int bottom = baseRenderer.ymax();
 
 		uint32 count = scanlineContainer->CountObjects();
-		for (uint32 i = 0; i < count; i++) {
+		for (uint32 i = scanlineContainer->FirstIndexAt(top); i < count;
+				i++) {
 			const Scanline* scanline = scanlineContainer->ObjectAtFast(i);
 			int y = scanline->y();
-			if (y >= top && y <= bottom) {
-				agg::render_scanline_aa(*scanline, baseRenderer,
-					spanAllocator, spanGenerator);
+			if (y > bottom)
+				break;
+
+			const Span* span = scanline->begin();
+			for (unsigned spans = scanline->num_spans(); spans > 0;
+					spans--, span++) {
+				int x;
+				int length;
+				const CoverType* covers;
+				if (span->x > right)
+					break;
+				if (!clip_span(span, left, right, x, length, covers))
+					continue;
+
+				typename BaseRenderer::color_type* colors
+					= spanAllocator.allocate(length);
+				spanGenerator.generate(colors, x, y, length);
+				baseRenderer.blend_color_hspan(x, y, length, colors,
+					span->len < 0 ? NULL : covers, *covers);
 			}
 		}
 	}
@@ -712,6 +794,45 @@ RenderEngine::_RenderScanlines(const agg::rgba16* gradient,
 }
 
 
+// _RenderGradient
+template<class SpanGenerator>
+void
+RenderEngine::_RenderGradient(const agg::rgba16* gradient,
+	Transformable transform, const ScanlineContainer* scanlines,
+	double start, double stop)
+{
+	if (!transform.IsValid())
+		return;
+
+	transform.invert();
+
+	SpanGenerator gradientGenerator(gradient, kGradientArraySize, transform,
+		start, stop);
+
+	_RenderScanlines(fSpanAllocator, gradientGenerator, fBaseRenderer,
+		scanlines);
+}
+
+// _ApplyOpacity
+const agg::rgba16*
+RenderEngine::_ApplyOpacity(const agg::rgba16* gradient, uint8 opacity)
+{
+	agg::rgba16* colors = (agg::rgba16*)fScratchArena.Allocate(
+		kGradientArraySize * sizeof(agg::rgba16));
+	if (colors == NULL)
+		return NULL;
+
+	// The colors are premultiplied, all channels are scaled.
+	for (int32 i = 0; i < kGradientArraySize; i++) {
+		const agg::rgba16& c = gradient[i];
+		colors[i].r = (c.r * opacity + 127) / 255;
+		colors[i].g = (c.g * opacity + 127) / 255;
+		colors[i].b = (c.b * opacity + 127) / 255;
+		colors[i].a = (c.a * opacity + 127) / 255;
+	}
+	return colors;
+}
+
 // _RenderAlphaScanlines
 void
 RenderEngine::_RenderAlphaScanlines(bool fillPaint)
@@ -21,9 +21,10 @@
 #include <agg_trans_perspective.h>
 
 #include "BlendingMode.h"
-#include "ObjectCache.h"
 #include "LayoutState.h"
 #include "Scanline.h"
+#include "ScanlineContainer.h"
+#include "ScratchArena.h"
 
 class BRect;
 class RenderBuffer;
@@ -41,8 +42,8 @@ typedef agg::renderer_base<PixelFormat>		BaseRenderer;
 typedef agg::renderer_base<CompOpPixelFormat>
 											CompOpBaseRenderer;
 
-typedef agg::scanline_p8					ScanlinePacked;
-typedef agg::scanline_bin					ScanlineBinary;
+typedef agg::scanline32_p8					ScanlinePacked;
+typedef agg::scanline32_bin					ScanlineBinary;
 typedef agg::span_allocator<agg::rgba16>	SpanColorAllocator;
 
 typedef agg::rasterizer_compound_aa
@@ -50,7 +51,6 @@ typedef agg::rasterizer_compound_aa
 typedef agg::rasterizer_scanline_aa
 			<agg::rasterizer_sl_clip_int>	Rasterizer;
 typedef agg::path_storage					PathStorage;
-typedef ObjectCache<Scanline, false>		ScanlineContainer;
 
 typedef agg::trans_perspective				Transformation;
 typedef agg::conv_transform
@@ -95,6 +95,28 @@ public:
 
 			void				SetOpacity(uint8 opacity);
 
+			// The number of threads which expensive operations, like
+			// large blurs, may use for the current render job.
+			void				SetThreadCount(int32 count);
+	inline	int32				ThreadCount() const
+									{ return fThreadCount; }
+
+			// The render pass of the current render job. Once the
+			// current generation no longer matches, the job is stale
+			// and may stop early.
+			void				SetRenderGeneration(
+									const vint32* currentGeneration,
+									int32 generation);
+	inline	bool				IsCancelled() const
+									{ return fCurrentGeneration != NULL
+										&& *fCurrentGeneration
+											!= fGeneration; }
+
+			// Temporary memory for the current render job, see
+			// ScratchArena.
+	inline	ScratchArena&		Scratch()
+									{ return fScratchArena; }
+
 			// Drawing methods
 			void				BlendArea(const RenderBuffer* source,
 									BRect area, uint8 opacity = 255,
@@ -102,6 +124,8 @@ public:
 
 			void				DrawRectangle(BRect rect,
 									BRect area, double xRadius, double yRadius);
+			// The pixels of the buffer are placed at its Bounds(), which
+			// are transformed by the current transformation.
 			void				DrawImage(const RenderBuffer* buffer,
 									BRect area);
 			void				DrawImage(const RenderBuffer* buffer,
@@ -122,6 +146,8 @@ public:
 			bool				HitTest(BRect rect, BPoint point);
 			bool				HitTest(PathStorage& path, BPoint point);
 
+			// Denoises the color channels of the buffer in parallel
+			// tiles, see DenoiseFilter.
 			status_t			Denoise(const RenderBuffer* buffer,
 									const float amplitude,
 									const float sharpness,
@@ -154,6 +180,13 @@ private:
 									Transformable transform,
 									const ScanlineContainer* scanlines,
 									double start = 0.0, double stop = 200.0);
+			template<class SpanGenerator>
+			void				_RenderGradient(const agg::rgba16* gradient,
+									Transformable transform,
+									const ScanlineContainer* scanlines,
+									double start = 0.0, double stop = 200.0);
+			const agg::rgba16*	_ApplyOpacity(const agg::rgba16* gradient,
+									uint8 opacity);
 
 			// Rendering contents of alpha map
 			void				_RenderAlphaScanlines(bool fillPaint);
@@ -193,6 +226,11 @@ private:
 			SpanColorAllocator	fSpanAllocator;
 
 			Rasterizer			fRasterizer;
+
+			int32				fThreadCount;
+			const vint32*		fCurrentGeneration;
+			int32				fGeneration;
+			ScratchArena		fScratchArena;
 };
 
 #endif // RENDER_ENGINE_H
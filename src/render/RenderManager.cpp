@@ -19,16 +19,37 @@
 #include "LayerSnapshot.h"
 #include "RenderBuffer.h"
 #include "RenderThread.h"
+#include "RenderTrace.h"
 #include "support.h"
+#include "WorkerPool.h"
 
 
 using std::nothrow;
 
 
 enum {
-	MIN_AREA_PER_THREAD = 2000
+	MIN_AREA_PER_THREAD = 2000,
+	// More rects are sent as their bounding box.
+	MAX_CLEAN_RECTS = 16
 };
 
+// The bitmap listeners are notified at most once per display frame.
+static const bigtime_t kFrameInterval = 1000000 / 60;
+
+
+// exchange_display_bitmap
+static inline int32
+exchange_display_bitmap(vint32* slot, int32 value)
+{
+	int32 oldValue = atomic_get(slot);
+	while (true) {
+		int32 foundValue = atomic_test_and_set(slot, value, oldValue);
+		if (foundValue == oldValue)
+			return oldValue;
+		oldValue = foundValue;
+	}
+}
+
 
 // RenderInfo
 struct RenderManager::RenderInfo {
@@ -69,7 +90,16 @@ public:
 		RenderInfo& info = fManager->fRenderInfos[index];
 		info.layer = layer;
 		info.dirtyArea = fManager->fSnapshotDirtyMap->Get(layer->Layer());
+		if (info.dirtyArea != NULL && !info.dirtyArea->IsValid()) {
+			// The dirty area of this layer has been deferred to the next
+			// render pass.
+			info.dirtyArea = NULL;
+		}
 		if (info.dirtyArea) {
+			// The layer bitmaps kept for other zoom levels miss what is
+			// rendered now.
+			layer->InvalidateZoomCaches(*info.dirtyArea);
+
 			// determine split strategy
 			int32 width = info.dirtyArea->IntegerWidth() + 1;
 			int32 height = info.dirtyArea->IntegerHeight() + 1;
@@ -135,14 +165,58 @@ private:
 	BRect			fBounds;
 };
 
+class RenderManager::ZoomLevelVisitor : public LayerSnapshotVisitor {
+public:
+	ZoomLevelVisitor(RenderManager* manager, double zoomLevel,
+			const BRect& bounds)
+		: fManager(manager)
+		, fZoomLevel(zoomLevel)
+		, fBounds(bounds)
+	{
+	}
+
+	virtual void Visit(LayerSnapshot* layer, int32 index,
+		int32 lastChildIndex, int32 previousSiblingIndex)
+	{
+		// The current layer bitmap is not up to date where the layer is
+		// dirty, or was dirty in the abandoned render pass.
+		const Layer* original = layer->Layer();
+		BRect staleArea(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+		BRect* dirtyArea = fManager->fDocumentDirtyMap->Get(original);
+		if (dirtyArea != NULL)
+			staleArea = staleArea | *dirtyArea;
+		dirtyArea = fManager->fSnapshotDirtyMap->Get(original);
+		if (dirtyArea != NULL)
+			staleArea = staleArea | *dirtyArea;
+
+		// Only what has changed since needs to be rendered again, if
+		// the layer still has a bitmap for the new zoom level.
+		BRect restoredStaleArea;
+		if (layer->SwitchZoomLevel(fZoomLevel, staleArea, restoredStaleArea))
+			fManager->_IncludeDirtyArea(original, restoredStaleArea);
+		else
+			fManager->_IncludeDirtyArea(original, fBounds);
+	}
+
+private:
+	RenderManager*	fManager;
+	double			fZoomLevel;
+	BRect			fBounds;
+};
+
 // #pragma mark -
 
 // constructor
 RenderManager::RenderManager(Document* document)
 	: Layer::Listener()
 
-	, fDisplayBitmap(NULL)
-	, fRenderBuffer(NULL)
+	, fBackDisplayBitmap(2)
+	, fFrontDisplayBitmap(0)
+	, fReadyDisplayBitmap(1)
+	, fNewestDisplayBitmap(0)
+	, fDisplayLock("display lock")
+
+	, fBounds()
 
 	, fZoomLevel(1.0)
 	, fScrollingDelayed(false)
@@ -168,13 +242,28 @@ RenderManager::RenderManager(Document* document)
 
 	, fWaitingRenderThreadsSem(-1)
 	, fWaitingRenderThreadCount(0)
+	, fPreparingRender(false)
+
+	, fRenderGeneration(0)
+	, fRenderPassGeneration(0)
+
+	, fRenderThreadsIdleSem(-1)
+	, fIdleWaiterCount(0)
+	, fResizePendingCount(0)
 
 	, fRenderQueueLock("render queue lock")
 
 	, fBitmapListeners(2)
 
+	, fCleanRegion()
+	, fFrameSem(-1)
+	, fFrameThread(-1)
+
 	, fLastRenderStartTime(-1)
+	, fScratchBytesAllocated(0)
 {
+	for (int32 i = 0; i < DISPLAY_BITMAP_COUNT; i++)
+		fDisplayBitmaps[i] = NULL;
 }
 
 // Init
@@ -213,6 +302,20 @@ RenderManager::Init()
 	if (fWaitingRenderThreadsSem < 0)
 		return fWaitingRenderThreadsSem;
 
+	fRenderThreadsIdleSem = create_sem(0, "render threads idle");
+	if (fRenderThreadsIdleSem < 0)
+		return fRenderThreadsIdleSem;
+
+	fFrameSem = create_sem(0, "bitmap clean frame");
+	if (fFrameSem < 0)
+		return fFrameSem;
+
+	fFrameThread = spawn_thread(_FrameThreadEntry, "bitmap clean notifier",
+		B_DISPLAY_PRIORITY, this);
+	if (fFrameThread < 0)
+		return fFrameThread;
+	resume_thread(fFrameThread);
+
 	fRenderThreads = new(std::nothrow) RenderThread*[fRenderThreadCount];
 	if (fRenderThreads == NULL)
 		return B_NO_MEMORY;
@@ -241,11 +344,19 @@ RenderManager::~RenderManager()
 {
 	// this will unblock any waiting render threads
 	delete_sem(fWaitingRenderThreadsSem);
+	delete_sem(fRenderThreadsIdleSem);
 
 	for (int32 i = 0; i < fRenderThreadCount; i++)
 		delete fRenderThreads[i];
 	delete[] fRenderThreads;
 
+	// this will stop the frame thread
+	delete_sem(fFrameSem);
+	if (fFrameThread >= 0) {
+		status_t result;
+		while (wait_for_thread(fFrameThread, &result) == B_INTERRUPTED);
+	}
+
 	_DestroyDisplayBitmaps();
 
 	delete fSnapshot;
@@ -360,8 +471,10 @@ RenderManager::ScrollBy(const BPoint& offset)
 	if (!fRenderQueueLock.Lock())
 		return false;
 
-	if (fScrollingDelayed || fWaitingRenderThreadCount < fRenderThreadCount)
+	if (fScrollingDelayed || fPreparingRender
+		|| fWaitingRenderThreadCount < fRenderThreadCount) {
 		fScrollingDelayed = true;
+	}
 
 	fRenderQueueLock.Unlock();
 
@@ -389,11 +502,19 @@ RenderManager::SetCanvasLayout(const BRect& dataRect, const BRect& visibleRect)
 	}
 }
 
+// SetVisibleArea
+void
+RenderManager::SetVisibleArea(const BRect& area)
+{
+	AutoLocker<BLocker> _(fRenderQueueLock);
+	fVisibleArea = area;
+}
+
 // Bounds
 BRect
 RenderManager::Bounds() const
 {
-	return fDisplayBitmap->Bounds();
+	return fBounds;
 }
 
 // AddBitmapListener
@@ -411,21 +532,30 @@ RenderManager::AddBitmapListener(BMessenger* listener)
 bool
 RenderManager::LockDisplay()
 {
-	return fRenderQueueLock.Lock();
+	if (!fDisplayLock.Lock())
+		return false;
+
+	if ((atomic_get(&fReadyDisplayBitmap) & DISPLAY_BITMAP_FRESH) != 0) {
+		// A render pass has completed since, continue with its bitmap.
+		int32 ready = exchange_display_bitmap(&fReadyDisplayBitmap,
+			fFrontDisplayBitmap);
+		fFrontDisplayBitmap = ready & ~DISPLAY_BITMAP_FRESH;
+	}
+	return true;
 }
 
 // UnlockDisplay
 void
 RenderManager::UnlockDisplay()
 {
-	fRenderQueueLock.Unlock();
+	fDisplayLock.Unlock();
 }
 
 // DisplayBitmap
 const BBitmap*
 RenderManager::DisplayBitmap() const
 {
-	return fDisplayBitmap;
+	return fDisplayBitmaps[fFrontDisplayBitmap];
 }
 
 // TransferClean
@@ -433,23 +563,36 @@ void
 RenderManager::TransferClean(const RenderBuffer* bitmap, const BRect& area)
 {
 	// executed in a rendering thread
-	// it is ok to copy bitmap contents without holding the
+	// it is ok to write into the back bitmap without holding the
 	// lock, since "flipping" is only done by which ever thread
 	// happens to be the *last* thread getting hold of the lock
-	if (bitmap->Bounds() != fRenderBuffer->Bounds()) {
+	if (bitmap->Bounds() != fBounds) {
 		// This means the RenderManager is waiting for the render-threads
-		// to finish before it resizes the fRenderBuffer and the
+		// to finish before it resizes the display bitmaps and the
 		// layers already have the new size.
 		printf("RenderManager::TransferClean() - mismatching bitmap sizes!");
 		return;
 	}
 
-	fRenderBuffer->Clear(area, (rgb_color){ 255, 255, 255, 255 });
-	bitmap->BlendTo(fRenderBuffer, area);
+	BBitmap* displayBitmap = fDisplayBitmaps[fBackDisplayBitmap];
+	if (displayBitmap == NULL)
+		return;
+
+	RenderTraceSpan span("TransferClean", "render");
+	span.SetArea(area);
+
+	// The white document background is filled in while converting, each
+	// pixel is read and written only once.
+	bitmap->CompositeTo(displayBitmap, area,
+		(rgb_color){ 255, 255, 255, 255 });
+
+	span.End();
 
 	// hold the lock in as short a time as possible
+	RenderTraceSpan lockSpan("wait for render queue", "lock");
 	if (!fRenderQueueLock.Lock())
 		return;
+	lockSpan.End();
 
 	fCleanArea = fCleanArea | area;
 
@@ -484,9 +627,17 @@ RenderManager::UnlockRenderInfo()
 bool
 RenderManager::DoNextRenderJob(RenderThread* thread)
 {
+	RenderTraceSpan lockSpan("wait for render queue", "lock");
 	AutoLocker<BLocker> locker(fRenderQueueLock);
+	lockSpan.End();
 //printf("RenderManager::DoNextRenderJob(%p)\n", thread);
 
+	int32 generation = fRenderPassGeneration;
+	if (generation != fRenderGeneration) {
+		// The render pass has been abandoned, skip the remaining jobs.
+		fCurrentRenderInfo = fRenderInfoCount;
+	}
+
 	// iterate through the render infos and find the next open task
 	while (fCurrentRenderInfo < fRenderInfoCount) {
 		RenderInfo& info = fRenderInfos[fCurrentRenderInfo];
@@ -524,17 +675,32 @@ RenderManager::DoNextRenderJob(RenderThread* thread)
 //info.splitCount, fCurrentRenderInfo, fRenderInfoCount);
 			info.splitCountStarted++;
 
+			// Expensive operations within the parts may be split into as
+			// many jobs as there are render threads. The WorkerPool only
+			// runs them in parallel on CPUs no render thread keeps busy.
+			int32 threadCount = fRenderThreadCount;
+
 			// render
 			locker.Unlock();
 
-			thread->Render(info.layer, dirtyArea, fZoomLevel);
+			RenderTraceSpan jobSpan("DoNextRenderJob", "render");
+			jobSpan.SetObject(info.layer->Name());
+			jobSpan.SetArea(dirtyArea);
+
+			thread->Render(info.layer, dirtyArea, fZoomLevel, threadCount,
+				generation);
 
 			// If we rendered something for the root layer, we transfer it to
-			// the display bitmap.
-			if (info.layer == fSnapshot)
+			// the display bitmap. A cancelled job may not have rendered all
+			// of it.
+			if (info.layer == fSnapshot && generation == fRenderGeneration)
 				TransferClean(fSnapshot->Bitmap(), dirtyArea);
 
+			jobSpan.End();
+
+			RenderTraceSpan relockSpan("wait for render queue", "lock");
 			locker.Lock();
+			relockSpan.End();
 
 			// post processing
 			info.splitCountDone++;
@@ -566,6 +732,29 @@ RenderManager::DoNextRenderJob(RenderThread* thread)
 	}
 
 	// There's nothing we can do at the moment.
+	if (generation != fRenderGeneration) {
+		// Nothing of an abandoned render pass goes to the display, the
+		// display bitmaps are about to be replaced.
+		fCleanArea.Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+	} else if (fWaitingRenderThreadCount == fRenderThreadCount - 1
+		&& fCleanArea.IsValid()) {
+		// This is the last busy thread, the render pass is complete.
+		// Publish the clean area without holding the lock. As long as
+		// this thread is not counted as waiting, no other render pass
+		// is started and the back bitmap does not change.
+		BRect cleanArea = fCleanArea;
+		fCleanArea.Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+		locker.Unlock();
+
+		_BackToDisplay(cleanArea);
+
+		RenderTraceSpan relockSpan("wait for render queue", "lock");
+		locker.Lock();
+		relockSpan.End();
+
+		_NotifyBitmapListeners(cleanArea);
+	}
+
 	fWaitingRenderThreadCount++;
 	if (fWaitingRenderThreadCount == fRenderThreadCount) {
 		// All the other threads are waiting too, which means everything has
@@ -603,7 +792,8 @@ bool
 RenderManager::RenderingDone()
 {
 	AutoLocker<BLocker> _(fRenderQueueLock);
-	return fWaitingRenderThreadCount == fRenderThreadCount;
+	return !fPreparingRender
+		&& fWaitingRenderThreadCount == fRenderThreadCount;
 }
 
 
@@ -674,7 +864,8 @@ RenderManager::_HasDirtyLayers() const
 void
 RenderManager::_TriggerRenderIfNotBusy()
 {
-	if (fWaitingRenderThreadCount < fRenderThreadCount) {
+	if (fPreparingRender || fResizePendingCount > 0
+		|| fWaitingRenderThreadCount < fRenderThreadCount) {
 //		printf("rendering in progress (%ld/%ld threads waiting)\n",
 //			fWaitingRenderThreadCount, fRenderThreadCount);
 		// rendering in progress
@@ -686,21 +877,113 @@ RenderManager::_TriggerRenderIfNotBusy()
 }
 
 // _TriggerRender
+//
+// fRenderQueueLock must be locked, all render threads must be waiting.
 void
 RenderManager::_TriggerRender()
 {
 //printf("RenderManager::_TriggerRender()\n");
 	fLastRenderStartTime = system_time();
+	fPreparingRender = true;
+	fRenderPassGeneration = fRenderGeneration;
 
 	// move the dirty infos to the front
 	PrepareDirtyInfosForNextRender();
+	_DeferInvisibleDirtyAreas();
+
+	// The render plan is prepared without holding the lock, so the render
+	// queue stays responsive. Areas invalidated meanwhile are collected
+	// for the next render pass, which is not started before this one,
+	// since the render threads stay asleep until the plan is complete.
+	fRenderQueueLock.Unlock();
 
-	// sync document and document clone
+	RenderTraceSpan span("prepare render pass", "render");
+	_PrepareRender();
+	_RestoreStaleDisplayArea();
+	span.End();
+
+	RenderTraceSpan lockSpan("wait for render queue", "lock");
+	fRenderQueueLock.Lock();
+	lockSpan.End();
+
+	fCurrentRenderInfo = 0;
+	fPreparingRender = false;
+
+	// and go
+	WakeUpRenderThreads();
+}
+
+// _DeferInvisibleDirtyAreas
+//
+// fRenderQueueLock must be locked.
+void
+RenderManager::_DeferInvisibleDirtyAreas()
+{
+	if (!fVisibleArea.IsValid())
+		return;
+
+	// Render the visible parts of the dirty areas first, when there are
+	// any, and the complete dirty areas again in the next render pass.
+	// This renders the visible parts twice, but the visible parts are
+	// what the user is waiting for.
+	BRect visibleArea = fVisibleArea;
+	visibleArea.left = floorf(visibleArea.left);
+	visibleArea.top = floorf(visibleArea.top);
+	visibleArea.right = ceilf(visibleArea.right);
+	visibleArea.bottom = ceilf(visibleArea.bottom);
+
+	bool hasVisibleDirtyAreas = false;
+	bool hasInvisibleDirtyAreas = false;
+	DirtyMap::Iterator iterator = fSnapshotDirtyMap->GetIterator();
+	while (iterator.HasNext()) {
+#if USE_OPEN_TRACKER_HASH_MAP
+		const BRect& area = *iterator.Next().value;
+#else
+		const BRect& area = *iterator.Next()->Value;
+#endif
+		if (area.Intersects(visibleArea))
+			hasVisibleDirtyAreas = true;
+		if ((area & visibleArea) != area)
+			hasInvisibleDirtyAreas = true;
+	}
+	if (!hasVisibleDirtyAreas || !hasInvisibleDirtyAreas)
+		return;
+
+	iterator = fSnapshotDirtyMap->GetIterator();
+	while (iterator.HasNext()) {
+#if USE_OPEN_TRACKER_HASH_MAP
+		DirtyMap::Entry entry = iterator.Next();
+		const Layer* layer = entry.key.value;
+		BRect* area = entry.value;
+#else
+		DirtyMap::LinkType* link = iterator.Next();
+		const Layer* layer = link->Key.value;
+		BRect* area = link->Value;
+#endif
+		BRect visibleDirtyArea = *area & visibleArea;
+		if (visibleDirtyArea == *area)
+			continue;
+		_IncludeDirtyArea(layer, *area);
+		// An invalid area leaves the layer out of this render pass.
+		*area = visibleDirtyArea;
+	}
+}
+
+// _PrepareRender
+void
+RenderManager::_PrepareRender()
+{
+	// sync document and document clone, only changed sub-trees are visited
 	fSnapshot->Sync();
 
 	// do a layout pass (will always push at least one more LayoutState,
-	// so the zoom level in the initial state is preserved)
+	// so the zoom level in the initial state is preserved), the render
+	// threads are idle and independent layers can use their share of the
+	// CPUs for laying out their changed sub-trees in parallel, on the
+	// WorkerPool helpers next to this thread.
+	WorkerPool::BusyScope busy;
 	fLayoutContext.Init(fZoomLevel);
+	fLayoutContext.SetThreadCount(fRenderThreadCount);
 
 	LayoutState rootLayerState(fLayoutContext.State());
 	fLayoutContext.PushState(&rootLayerState);
@@ -719,39 +1002,164 @@ RenderManager::_TriggerRender()
 	RenderInfoInitVisitor visitor(this);
 	count = 0;
 	_TraverseLayerSnapshots(&visitor, fSnapshot, count, -1);
-	fCurrentRenderInfo = 0;
+}
 
-	// and go
-	WakeUpRenderThreads();
+// _RestoreStaleDisplayArea
+void
+RenderManager::_RestoreStaleDisplayArea()
+{
+	// Executed while preparing a render pass, when the render threads
+	// don't use the back bitmap. It missed the areas of the previous
+	// passes, which went into the other bitmaps. The newest of them has
+	// all of them, and is at most read by the display in the meantime.
+	int32 back = fBackDisplayBitmap;
+	BRect stale = fDisplayStaleAreas[back] & fBounds;
+	fDisplayStaleAreas[back].Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+
+	const BBitmap* source = fDisplayBitmaps[fNewestDisplayBitmap];
+	BBitmap* target = fDisplayBitmaps[back];
+	if (source == NULL || target == NULL)
+		return;
+
+	stale = stale & source->Bounds() & target->Bounds();
+	if (!stale.IsValid())
+		return;
+
+	RenderTraceSpan span("RestoreStaleDisplayArea", "render");
+	span.SetArea(stale);
+
+	int32 left = (int32)stale.left;
+	int32 top = (int32)stale.top;
+	int32 height = stale.IntegerHeight() + 1;
+	uint32 bytes = (stale.IntegerWidth() + 1) * 4;
+
+	uint32 srcBPR = source->BytesPerRow();
+	uint32 dstBPR = target->BytesPerRow();
+	const uint8* src = (const uint8*)source->Bits()
+		+ (int64)(top - (int32)source->Bounds().top) * srcBPR
+		+ (left - (int32)source->Bounds().left) * 4;
+	uint8* dst = (uint8*)target->Bits()
+		+ (int64)(top - (int32)target->Bounds().top) * dstBPR
+		+ (left - (int32)target->Bounds().left) * 4;
+
+	for (int32 y = 0; y < height; y++) {
+		memcpy(dst, src, bytes);
+		src += srcBPR;
+		dst += dstBPR;
+	}
 }
 
 // _BackToDisplay
 void
 RenderManager::_BackToDisplay(BRect area)
+{
+	// Executed in the render thread which completed the render pass,
+	// without holding the queue lock. The render threads have composited
+	// the area into the back bitmap, the other bitmaps miss it now.
+	int32 back = fBackDisplayBitmap;
+	for (int32 i = 0; i < DISPLAY_BITMAP_COUNT; i++) {
+		if (i != back)
+			fDisplayStaleAreas[i] = fDisplayStaleAreas[i] | area;
+	}
+	fNewestDisplayBitmap = back;
+
+	// Publish the bitmap, the previously ready one becomes the new back
+	// bitmap, unless the display has picked it up in the meantime.
+	int32 ready = exchange_display_bitmap(&fReadyDisplayBitmap,
+		back | DISPLAY_BITMAP_FRESH);
+	fBackDisplayBitmap = ready & ~DISPLAY_BITMAP_FRESH;
+}
+
+// _NotifyBitmapListeners
+void
+RenderManager::_NotifyBitmapListeners(BRect area)
+{
+	// done while holding the queue lock
+	if (fBitmapListeners.CountItems() == 0)
+		return;
+
+	if (fZoomLevel > 0.0) {
+		// Convert clean area back to document space
+		area.left = floorf(area.left / fZoomLevel);
+		area.top = floorf(area.top / fZoomLevel);
+		area.right = ceilf(area.right / fZoomLevel);
+		area.bottom = ceilf(area.bottom / fZoomLevel);
+	}
+
+	// Wake up the frame thread with the first area of a frame, the
+	// following ones are only accumulated.
+	bool frameScheduled = fCleanRegion.CountRects() > 0;
+	fCleanRegion.Include(area);
+	if (!frameScheduled && fCleanRegion.CountRects() > 0)
+		release_sem_etc(fFrameSem, 1, B_DO_NOT_RESCHEDULE);
+}
+
+// _FrameThreadEntry
+status_t
+RenderManager::_FrameThreadEntry(void* data)
+{
+	return static_cast<RenderManager*>(data)->_FrameThread();
+}
+
+// _FrameThread
+status_t
+RenderManager::_FrameThread()
+{
+	bigtime_t nextFrameTime = 0;
+	while (true) {
+		status_t error;
+		do {
+			error = acquire_sem(fFrameSem);
+		} while (error == B_INTERRUPTED);
+
+		// If not OK, the semaphore has been deleted. Our signal to quit.
+		if (error != B_OK)
+			break;
+
+		// Areas which become clean until the next frame is due are
+		// sent along.
+		if (system_time() < nextFrameTime)
+			snooze_until(nextFrameTime, B_SYSTEM_TIMEBASE);
+
+		if (!fRenderQueueLock.Lock())
+			break;
+		_SendBitmapClean();
+		fRenderQueueLock.Unlock();
+
+		nextFrameTime = system_time() + kFrameInterval;
+	}
+
+	return B_OK;
+}
+
+// _SendBitmapClean
+void
+RenderManager::_SendBitmapClean()
 {
 	// done while holding the queue lock
-	fRenderBuffer->CopyTo(fDisplayBitmap, area);
+	int32 rectCount = fCleanRegion.CountRects();
+	if (rectCount == 0)
+		return;
+
+	BMessage message(MSG_BITMAP_CLEAN);
+	if (rectCount > MAX_CLEAN_RECTS)
+		message.AddRect("area", fCleanRegion.Frame());
+	else {
+		for (int32 i = 0; i < rectCount; i++)
+			message.AddRect("area", fCleanRegion.RectAt(i));
+	}
+	fCleanRegion.MakeEmpty();
+
+	if (fScrollingDelayed) {
+		message.AddBool("scrolling delayed", true);
+		fScrollingDelayed = false;
+	}
 
 	int32 listenerCount = fBitmapListeners.CountItems();
-	if (listenerCount > 0) {
-		BMessage message(MSG_BITMAP_CLEAN);
-		if (fZoomLevel > 0.0) {
-			// Convert clean area back to document space
-			area.left = floorf(area.left / fZoomLevel);
-			area.top = floorf(area.top / fZoomLevel);
-			area.right = ceilf(area.right / fZoomLevel);
-			area.bottom = ceilf(area.bottom / fZoomLevel);
-		}
-		message.AddRect("area", area);
-		if (fScrollingDelayed) {
-			message.AddBool("scrolling delayed", true);
-			fScrollingDelayed = false;
-		}
-		for (int32 i = 0; i < listenerCount; i++) {
-			BMessenger* listener = static_cast<BMessenger*>(
-				fBitmapListeners.ItemAtFast(i));
-			listener->SendMessage(&message);
-		}
+	for (int32 i = 0; i < listenerCount; i++) {
+		BMessenger* listener = static_cast<BMessenger*>(
+			fBitmapListeners.ItemAtFast(i));
+		listener->SendMessage(&message);
 	}
 }
 
@@ -828,18 +1236,35 @@ void
 RenderManager::_AllRenderThreadsDone()
 {
 //bool scrollingDelayed = fScrollingDelayed;
-	// executed in a rendering thread
-	if (fCleanArea.IsValid()) {
-		_BackToDisplay(fCleanArea);
-		fCleanArea.Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+	// executed in a rendering thread, the clean area has already been
+	// transferred to the display bitmap
+
+	if (fLastRenderStartTime > 0 && RenderTrace::IsEnabled()) {
+		RenderTrace::AddSpan("render pass", "render", fLastRenderStartTime,
+			system_time(), NULL, NULL);
 	}
 
-//	if (fLastRenderStartTime > 0) {
-//		printf("render pass: %lld (%d)\n",
-//			system_time() - fLastRenderStartTime, scrollingDelayed);
-//	}
+	// All render threads are waiting, their arenas can be inspected.
+	fScratchBytesAllocated = 0;
+	for (int32 i = 0; i < fRenderThreadCount; i++) {
+		ScratchArena& arena = fRenderThreads[i]->Scratch();
+		fScratchBytesAllocated += arena.BytesAllocated();
+		arena.ResetStatistics();
+	}
+
+	if (fIdleWaiterCount > 0) {
+		release_sem_etc(fRenderThreadsIdleSem, fIdleWaiterCount,
+			B_DO_NOT_RESCHEDULE);
+		fIdleWaiterCount = 0;
+	}
+
+	// What is left in the snapshot dirty map has been rendered, unless
+	// the render pass was abandoned.
+	if (fRenderPassGeneration == fRenderGeneration)
+		_ClearDirtyMap(fSnapshotDirtyMap);
 
-	if (_HasDirtyLayers())
+	// A waiting resize triggers the next render pass itself.
+	if (fResizePendingCount == 0 && _HasDirtyLayers())
 		_TriggerRender();
 }
 
@@ -849,20 +1274,42 @@ RenderManager::_AllRenderThreadsDone()
 status_t
 RenderManager::_CreateDisplayBitmaps(double zoomLevel)
 {
-	// Wait for all rendering to finish first.
+	// The running render pass is for the old bitmaps, abandon it and
+	// wait for the render threads to notice.
 	AutoLocker<BLocker> locker(fRenderQueueLock);
-	while (fWaitingRenderThreadCount < fRenderThreadCount) {
+	atomic_add(&fRenderGeneration, 1);
+	fResizePendingCount++;
+	while (fPreparingRender
+		|| fWaitingRenderThreadCount < fRenderThreadCount) {
+		fIdleWaiterCount++;
 		locker.Unlock();
-		// This should switch to the blocked thread...
-		// But just in case the render thread is not blocking, but rendering,
-		// we prevent a busy loop...
-		snooze(1000);
+
+		status_t error;
+		do {
+			error = acquire_sem(fRenderThreadsIdleSem);
+		} while (error == B_INTERRUPTED);
+
 		locker.Lock();
+		if (error != B_OK) {
+			fResizePendingCount--;
+			return error;
+		}
 	}
+	fResizePendingCount--;
+
+	// The display must not use the bitmaps while they are replaced.
+	AutoLocker<BLocker> displayLocker(fDisplayLock);
+
+	// Keep showing the newest contents, scaled, until the new ones are
+	// rendered.
+	int32 newest = fFrontDisplayBitmap;
+	if ((fReadyDisplayBitmap & DISPLAY_BITMAP_FRESH) != 0)
+		newest = fReadyDisplayBitmap & ~DISPLAY_BITMAP_FRESH;
+	BBitmap* oldDisplayBitmap = fDisplayBitmaps[newest];
+	fDisplayBitmaps[newest] = NULL;
+	_DestroyDisplayBitmaps();
 
-	BBitmap* oldDisplayBitmap = fDisplayBitmap;
-	delete fRenderBuffer;
-
+	bool zoomChanged = fZoomLevel != zoomLevel;
 	fZoomLevel = zoomLevel;
 
 	BRect bounds = fDocument->Bounds();
@@ -871,29 +1318,68 @@ RenderManager::_CreateDisplayBitmaps(double zoomLevel)
 	bounds.right = ceilf(bounds.right * fZoomLevel);
 	bounds.bottom = ceilf(bounds.bottom * fZoomLevel);
 
-	if (oldDisplayBitmap != NULL) {
-		fDisplayBitmap = scale_bitmap(oldDisplayBitmap, bounds);
-		delete oldDisplayBitmap;
+	fBounds = bounds;
+
+	// Every layer needs to be rerendered, except for the areas which are
+	// still up to date in the bitmaps the layers kept for the new zoom
+	// level.
+	int32 count = 0;
+	if (zoomChanged) {
+		ZoomLevelVisitor zoomLevelVisitor(this, fZoomLevel,
+			fDocument->Bounds());
+		_TraverseLayerSnapshots(&zoomLevelVisitor, fSnapshot, count, -1);
 	} else {
-		fDisplayBitmap = new(nothrow) BBitmap(bounds, B_BITMAP_ACCEPTS_VIEWS,
-			B_RGBA32);
+		QueueRedrawVisitor queueRedrawVisitor(this, fDocument->Bounds());
+		_TraverseLayerSnapshots(&queueRedrawVisitor, fSnapshot, count, -1);
 	}
 
-	fRenderBuffer = new(nothrow) RenderBuffer(bounds);
+	fFrontDisplayBitmap = 0;
+	fReadyDisplayBitmap = 1;
+	fBackDisplayBitmap = 2;
+	fNewestDisplayBitmap = 0;
+
+	// Keep showing the newest contents until the new ones are rendered.
+	// The root layer bitmap kept for the new zoom level is better than
+	// the old contents scaled, it only differs where it is rendered again.
+	// The display bitmaps are always opaque. B_RGB32 can be drawn without
+	// any conversion, unlike B_RGBA32, which needs to be premultiplied
+	// first.
+	const RenderBuffer* rootBitmap = fSnapshot->Bitmap();
+	bool compositeRootBitmap = rootBitmap != NULL
+		&& rootBitmap->Bounds() == bounds;
+	if (oldDisplayBitmap != NULL && !compositeRootBitmap)
+		fDisplayBitmaps[0] = scale_bitmap(oldDisplayBitmap, bounds);
+	else {
+		fDisplayBitmaps[0] = new(nothrow) BBitmap(bounds,
+			B_BITMAP_ACCEPTS_VIEWS, B_RGB32);
+	}
+	delete oldDisplayBitmap;
+	fDisplayStaleAreas[0].Set(LONG_MAX, LONG_MAX, LONG_MIN, LONG_MIN);
+
+	// The other bitmaps get all their contents when they are first used.
+	for (int32 i = 1; i < DISPLAY_BITMAP_COUNT; i++) {
+		fDisplayBitmaps[i] = new(nothrow) BBitmap(bounds,
+			B_BITMAP_ACCEPTS_VIEWS, B_RGB32);
+		fDisplayStaleAreas[i] = bounds;
+	}
 
-	if (fDisplayBitmap == NULL || !fDisplayBitmap->IsValid()
-		|| fRenderBuffer == NULL || !fRenderBuffer->IsValid()) {
-		return B_NO_MEMORY;
+	for (int32 i = 0; i < DISPLAY_BITMAP_COUNT; i++) {
+		if (fDisplayBitmaps[i] == NULL || !fDisplayBitmaps[i]->IsValid())
+			return B_NO_MEMORY;
 	}
 
-	// clear new bitmap, if there wasn't an old one
-	if (oldDisplayBitmap == NULL)
-		memset(fDisplayBitmap->Bits(), 0, fDisplayBitmap->BitsLength());
+	if (compositeRootBitmap) {
+		rootBitmap->CompositeTo(fDisplayBitmaps[0], bounds,
+			(rgb_color){ 255, 255, 255, 255 });
+	} else if (oldDisplayBitmap == NULL) {
+		// clear new bitmap to the document background, if there wasn't
+		// an old one
+		memset(fDisplayBitmaps[0]->Bits(), 255,
+			fDisplayBitmaps[0]->BitsLength());
+	}
+
+	displayLocker.Unlock();
 
-	// Every layer needs to be rerendered
-	QueueRedrawVisitor queueRedrawVisitor(this, fDocument->Bounds());
-	int32 count = 0;
-	_TraverseLayerSnapshots(&queueRedrawVisitor, fSnapshot, count, -1);
 	_TriggerRender();
 
 	return B_OK;
@@ -903,10 +1389,9 @@ RenderManager::_CreateDisplayBitmaps(double zoomLevel)
 void
 RenderManager::_DestroyDisplayBitmaps()
 {
-	delete fDisplayBitmap;
-	delete fRenderBuffer;
-
-	fDisplayBitmap = NULL;
-	fRenderBuffer = NULL;
+	for (int32 i = 0; i < DISPLAY_BITMAP_COUNT; i++) {
+		delete fDisplayBitmaps[i];
+		fDisplayBitmaps[i] = NULL;
+	}
 }
 
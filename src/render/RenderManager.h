@@ -10,6 +10,7 @@
 #include <List.h>
 #include <Locker.h>
 #include <Rect.h>
+#include <Region.h>
 
 #include "Document.h"
 #include "Layer.h"
@@ -36,7 +37,7 @@ class RenderBuffer;
 class RenderThread;
 
 enum {
-	MSG_BITMAP_CLEAN	= 'bcln',
+	MSG_BITMAP_CLEAN	= 'bcln',	// "area" rects in document coordinates
 	MSG_LAYOUT_CHANGED	= 'lych'
 };
 
@@ -81,12 +82,22 @@ public:
 			const BRect&		VisibleRect() const
 									{ return fVisibleRect; }
 
+			// The part of the document which is visible, in document
+			// coordinates. Dirty areas within it are rendered first,
+			// the rest follows in the next render pass.
+			void				SetVisibleArea(const BRect& area);
+
 			bool				AddBitmapListener(BMessenger* listener);
 
+			// The display bitmap is triple buffered, locking the display
+			// only excludes other readers, never the render threads.
+			// LockDisplay() picks up the newest completed bitmap.
 			bool				LockDisplay();
 			void				UnlockDisplay();
 			const BBitmap*		DisplayBitmap() const;
 
+			// Composites the root layer bitmap straight into the back
+			// display bitmap.
 			void				TransferClean(const RenderBuffer* bitmap,
 									const BRect& area);
 
@@ -99,15 +110,28 @@ public:
 			void				WakeUpRenderThreads();
 			bool				RenderingDone();
 
+			// Changes when the running render pass becomes stale, render
+			// jobs of older generations stop as soon as they notice.
+	inline	const vint32*		CurrentRenderGeneration() const
+									{ return &fRenderGeneration; }
+
+			// Bytes the render threads had to allocate for temporary
+			// buffers during the last complete render pass. Zero in the
+			// steady state.
+			size_t				ScratchBytesAllocated() const
+									{ return fScratchBytesAllocated; }
+
 private:
 			typedef HashMap<HashKey32<const Layer*>, BRect*> DirtyMap;
 			struct RenderInfo;
 			class LayerSnapshotVisitor;
 			class RenderInfoInitVisitor;
 			class QueueRedrawVisitor;
+			class ZoomLevelVisitor;
 
 			friend class RenderInfoInitVisitor;
 			friend class QueueRedrawVisitor;
+			friend class ZoomLevelVisitor;
 
 			status_t			_IncludeDirtyArea(const Layer* layer,
 									BRect area);
@@ -115,7 +139,14 @@ private:
 			bool				_HasDirtyLayers() const;
 			void				_TriggerRenderIfNotBusy();
 			void				_TriggerRender();
+			void				_DeferInvisibleDirtyAreas();
+			void				_PrepareRender();
+			void				_RestoreStaleDisplayArea();
 			void				_BackToDisplay(BRect area);
+			void				_NotifyBitmapListeners(BRect area);
+	static	status_t			_FrameThreadEntry(void* data);
+			status_t			_FrameThread();
+			void				_SendBitmapClean();
 
 			void				_ClearDirtyMap(DirtyMap* map);
 
@@ -131,11 +162,29 @@ private:
 			void				_DestroyDisplayBitmaps();
 
 private:
-			BBitmap*			fDisplayBitmap;
-			RenderBuffer*		fRenderBuffer;
+			enum {
+				DISPLAY_BITMAP_COUNT	= 3,
+				DISPLAY_BITMAP_FRESH	= 1 << 8
+			};
+
+			// The render threads composite into the back bitmap, the one
+			// which finishes a render pass exchanges it with the ready one,
+			// LockDisplay() exchanges the front bitmap with the ready one,
+			// if that is fresh. Before a render pass, the back bitmap gets
+			// the areas it missed from the newest bitmap.
+			BBitmap*			fDisplayBitmaps[DISPLAY_BITMAP_COUNT];
+			BRect				fDisplayStaleAreas[DISPLAY_BITMAP_COUNT];
+			int32				fBackDisplayBitmap;
+			int32				fFrontDisplayBitmap;
+			vint32				fReadyDisplayBitmap;
+			int32				fNewestDisplayBitmap;
+			BLocker				fDisplayLock;
+
+			BRect				fBounds;
 			
 			BRect				fDataRect;
 			BRect				fVisibleRect;
+			BRect				fVisibleArea;
 			double				fZoomLevel;
 			bool				fScrollingDelayed;
 
@@ -161,12 +210,30 @@ private:
 
 			sem_id				fWaitingRenderThreadsSem;
 			int32				fWaitingRenderThreadCount;
+			bool				fPreparingRender;
+
+			vint32				fRenderGeneration;
+			int32				fRenderPassGeneration;
+
+			// Released when all render threads are done, for threads
+			// which wait to replace the display bitmaps.
+			sem_id				fRenderThreadsIdleSem;
+			int32				fIdleWaiterCount;
+			int32				fResizePendingCount;
 
 			BLocker				fRenderQueueLock;
 
 			BList				fBitmapListeners;
 
+			// The clean areas the listeners have not been notified about
+			// yet, in document coordinates. The frame thread notifies
+			// them at most once per display frame.
+			BRegion				fCleanRegion;
+			sem_id				fFrameSem;
+			thread_id			fFrameThread;
+
 			bigtime_t			fLastRenderStartTime;
+			size_t				fScratchBytesAllocated;
 };
 
 // RenderInfoLocking
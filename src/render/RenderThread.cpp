@@ -27,6 +27,7 @@
 #include "ObjectSnapshot.h"
 #include "RenderBuffer.h"
 #include "RenderManager.h"
+#include "WorkerPool.h"
 
 
 using std::nothrow;
@@ -84,7 +85,8 @@ RenderThread::WaitForThread()
 // Called by the RenderManager, but in our own thread
 // (_WorkerLoop() -> RenderManager::DoNextRenderJob() -> Render()).
 void
-RenderThread::Render(LayerSnapshot* layer, BRect area, double zoomLevel)
+RenderThread::Render(LayerSnapshot* layer, BRect area, double zoomLevel,
+	int32 threadCount, int32 generation)
 {
 //printf("RenderThread::Render(%p, (%f, %f, %f, %f))\n", layer,
 //area.left, area.top, area.right, area.bottom);
@@ -97,19 +99,30 @@ RenderThread::Render(LayerSnapshot* layer, BRect area, double zoomLevel)
 	zoomedBounds.right = ceilf(zoomedBounds.right * zoomLevel);
 	zoomedBounds.bottom = ceilf(zoomedBounds.bottom * zoomLevel);
 	if (fScratchBitmap == NULL || fScratchBitmap->Bounds() != zoomedBounds) {
-		// Need to resize the bitmap and render everything
+		// Need to resize the bitmap. The layer renders the area from
+		// scratch anyway, the layer bitmap may still be up to date
+		// everywhere else.
 //printf("  resizing scratch bitmap\n");
 		delete fScratchBitmap;
 		fScratchBitmap = new(std::nothrow) RenderBuffer(zoomedBounds);
 		if (fScratchBitmap == NULL || !fScratchBitmap->IsValid())
 			return;
-		area = zoomedBounds;
 	}
 
+	// Expensive operations within the layer split into jobs for the
+	// WorkerPool, its helpers only join while CPUs are left.
+	WorkerPool::BusyScope busy;
+
+	fEngine.SetThreadCount(threadCount);
+	fEngine.SetRenderGeneration(fRenderManager->CurrentRenderGeneration(),
+		generation);
+
 	BRegion dummyRegion;
 	int32 dummyLevel;
 	layer->Render(fEngine, area, fScratchBitmap, NULL, dummyRegion,
 		dummyLevel);
+
+	fEngine.Scratch().Reset();
 }
 
 // #pragma mark -
@@ -28,7 +28,11 @@ public:
 			thread_id			Run();
 			void				WaitForThread();
 			void				Render(LayerSnapshot* layer, BRect area,
-									double zoomLevel);
+									double zoomLevel, int32 threadCount = 1,
+									int32 generation = 0);
+
+	inline	ScratchArena&		Scratch()
+									{ return fEngine.Scratch(); }
 
 private:
 	static	status_t			_WorkerLoopEntry(void* data);
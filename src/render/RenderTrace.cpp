@@ -0,0 +1,191 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "RenderTrace.h"
+
+#include <new>
+
+#include <string.h>
+
+
+struct RenderTrace::Event {
+	const char*	name;
+	const char*	category;
+	bigtime_t	start;
+	bigtime_t	duration;
+	char		object[MAX_NAME_LENGTH];
+	BRect		area;
+	bool		hasArea;
+};
+
+
+// Written by a single thread only. The count is increased after an event
+// has been written, so that readers can tell which events are complete.
+struct RenderTrace::Buffer {
+	thread_id	thread;
+	vint32		count;
+	Event		events[EVENTS_PER_THREAD];
+};
+
+
+vint32 RenderTrace::sEnabled = 0;
+
+// The threads which have claimed a buffer, 0 marks a free slot.
+static vint32 sThreads[RenderTrace::MAX_THREADS];
+static void* volatile sBuffers[RenderTrace::MAX_THREADS];
+
+
+// write_json_string
+static void
+write_json_string(FILE* file, const char* string)
+{
+	fputc('"', file);
+	for (; *string != '\0'; string++) {
+		uint8 c = (uint8)*string;
+		if (c == '"' || c == '\\')
+			fprintf(file, "\\%c", c);
+		else if (c < 0x20)
+			fprintf(file, "\\u%04x", c);
+		else
+			fputc(c, file);
+	}
+	fputc('"', file);
+}
+
+
+// SetEnabled
+/*static*/ void
+RenderTrace::SetEnabled(bool enabled)
+{
+	atomic_set(&sEnabled, enabled ? 1 : 0);
+}
+
+// Clear
+/*static*/ void
+RenderTrace::Clear()
+{
+	for (int32 i = 0; i < MAX_THREADS; i++) {
+		Buffer* buffer = (Buffer*)sBuffers[i];
+		if (buffer != NULL)
+			atomic_set(&buffer->count, 0);
+	}
+}
+
+// AddSpan
+/*static*/ void
+RenderTrace::AddSpan(const char* name, const char* category, bigtime_t start,
+	bigtime_t end, const char* objectName, const BRect* area)
+{
+	Buffer* buffer = _BufferForCurrentThread();
+	if (buffer == NULL)
+		return;
+
+	Event& event = buffer->events[(uint32)buffer->count % EVENTS_PER_THREAD];
+	event.name = name;
+	event.category = category;
+	event.start = start;
+	event.duration = end - start;
+	if (objectName != NULL) {
+		strncpy(event.object, objectName, MAX_NAME_LENGTH - 1);
+		event.object[MAX_NAME_LENGTH - 1] = '\0';
+	} else
+		event.object[0] = '\0';
+	event.hasArea = area != NULL;
+	if (area != NULL)
+		event.area = *area;
+
+	atomic_add(&buffer->count, 1);
+}
+
+// WriteChromeTrace
+/*static*/ status_t
+RenderTrace::WriteChromeTrace(FILE* file)
+{
+	fprintf(file, "{\"traceEvents\": [\n");
+
+	bool first = true;
+	for (int32 i = 0; i < MAX_THREADS; i++) {
+		const Buffer* buffer = (const Buffer*)sBuffers[i];
+		if (buffer == NULL)
+			continue;
+
+		uint32 count = (uint32)atomic_get((vint32*)&buffer->count);
+		uint32 index = count > EVENTS_PER_THREAD
+			? count - EVENTS_PER_THREAD : 0;
+		for (; index < count; index++) {
+			const Event& event = buffer->events[index % EVENTS_PER_THREAD];
+
+			fprintf(file, "%s\t{\"name\": ", first ? "" : ",\n");
+			write_json_string(file, event.name);
+			fprintf(file, ", \"cat\": ");
+			write_json_string(file, event.category);
+			fprintf(file, ", \"ph\": \"X\", \"ts\": %lld, \"dur\": %lld, "
+				"\"pid\": 1, \"tid\": %ld, \"args\": {",
+				(long long)event.start, (long long)event.duration,
+				(long)buffer->thread);
+			if (event.object[0] != '\0') {
+				fprintf(file, "\"object\": ");
+				write_json_string(file, event.object);
+			}
+			if (event.hasArea) {
+				fprintf(file, "%s\"area\": [%.1f, %.1f, %.1f, %.1f]",
+					event.object[0] != '\0' ? ", " : "",
+					event.area.left, event.area.top, event.area.right,
+					event.area.bottom);
+			}
+			fprintf(file, "}}");
+			first = false;
+		}
+	}
+
+	fprintf(file, "\n], \"displayTimeUnit\": \"ms\"}\n");
+
+	return ferror(file) ? B_IO_ERROR : B_OK;
+}
+
+// WriteChromeTrace
+/*static*/ status_t
+RenderTrace::WriteChromeTrace(const char* path)
+{
+	FILE* file = fopen(path, "w");
+	if (file == NULL)
+		return B_ERROR;
+
+	status_t status = WriteChromeTrace(file);
+	if (fclose(file) != 0 && status == B_OK)
+		status = B_IO_ERROR;
+	return status;
+}
+
+// #pragma mark - private
+
+// _BufferForCurrentThread
+/*static*/ RenderTrace::Buffer*
+RenderTrace::_BufferForCurrentThread()
+{
+	thread_id thread = find_thread(NULL);
+
+	for (int32 i = 0; i < MAX_THREADS; i++) {
+		if (sThreads[i] == thread)
+			return (Buffer*)sBuffers[i];
+		if (sThreads[i] != 0)
+			continue;
+
+		// The slot is free, try to claim it. Only the claiming thread ever
+		// writes to the buffer.
+		if (atomic_test_and_set(&sThreads[i], thread, 0) != 0)
+			continue;
+
+		Buffer* buffer = new(std::nothrow) Buffer;
+		if (buffer == NULL)
+			return NULL;
+		buffer->thread = thread;
+		buffer->count = 0;
+		sBuffers[i] = buffer;
+		return buffer;
+	}
+
+	// All slots are taken.
+	return NULL;
+}
@@ -0,0 +1,124 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef RENDER_TRACE_H
+#define RENDER_TRACE_H
+
+#include <stdio.h>
+
+#include <OS.h>
+#include <Rect.h>
+
+// Records timed spans of the render pipeline, like render jobs, the
+// rendering of each object and lock waits. Every thread writes into a ring
+// buffer of its own, so recording does not take any locks. The recorded
+// spans can be written as Chrome trace JSON, which can be loaded into
+// chrome://tracing or Perfetto.
+//
+// Tracing is always compiled in. While it is disabled, a span costs a
+// single check.
+class RenderTrace {
+public:
+	enum {
+		MAX_THREADS			= 64,
+		EVENTS_PER_THREAD	= 4096,
+		MAX_NAME_LENGTH		= 48
+	};
+
+	static	bool				IsEnabled()
+									{ return sEnabled != 0; }
+	static	void				SetEnabled(bool enabled);
+
+	// Forgets all recorded spans. Spans recorded concurrently may get lost.
+	static	void				Clear();
+
+	// The name and category need to be string constants, the object name
+	// is copied (and truncated to MAX_NAME_LENGTH).
+	static	void				AddSpan(const char* name,
+									const char* category, bigtime_t start,
+									bigtime_t end, const char* objectName,
+									const BRect* area);
+
+	// Writes all spans still held in the ring buffers. Spans recorded
+	// while writing may show up incomplete.
+	static	status_t			WriteChromeTrace(FILE* file);
+	static	status_t			WriteChromeTrace(const char* path);
+
+private:
+			struct Event;
+			struct Buffer;
+
+	static	Buffer*				_BufferForCurrentThread();
+
+	static	vint32				sEnabled;
+};
+
+// Records the time from its construction to End() or its destruction,
+// if tracing is enabled at construction. The object name passed to
+// SetObject() needs to stay valid until then.
+class RenderTraceSpan {
+public:
+								RenderTraceSpan(const char* name,
+									const char* category);
+								~RenderTraceSpan();
+
+			void				SetObject(const char* name);
+			void				SetArea(const BRect& area);
+
+			void				End();
+
+private:
+			const char*			fName;
+			const char*			fCategory;
+			const char*			fObject;
+			BRect				fArea;
+			bool				fHasArea;
+			bigtime_t			fStart;
+};
+
+// constructor
+inline
+RenderTraceSpan::RenderTraceSpan(const char* name, const char* category)
+	: fName(name)
+	, fCategory(category)
+	, fObject(NULL)
+	, fHasArea(false)
+	, fStart(RenderTrace::IsEnabled() ? system_time() : -1)
+{
+}
+
+// destructor
+inline
+RenderTraceSpan::~RenderTraceSpan()
+{
+	End();
+}
+
+// SetObject
+inline void
+RenderTraceSpan::SetObject(const char* name)
+{
+	fObject = name;
+}
+
+// SetArea
+inline void
+RenderTraceSpan::SetArea(const BRect& area)
+{
+	fArea = area;
+	fHasArea = true;
+}
+
+// End
+inline void
+RenderTraceSpan::End()
+{
+	if (fStart < 0)
+		return;
+	RenderTrace::AddSpan(fName, fCategory, fStart, system_time(), fObject,
+		fHasArea ? &fArea : NULL);
+	fStart = -1;
+}
+
+#endif // RENDER_TRACE_H
@@ -36,7 +36,7 @@
 #include "DataBlock.h"
 
 typedef uint8					CoverType;
-typedef int16					CoordType;
+typedef int32					CoordType;
 
 struct Span {
 	CoordType			x;
@@ -0,0 +1,34 @@
+/*
+ * Copyright 2018, Stephan Aßmus <superstippi@gmx.de>.
+ * All rights reserved.
+ */
+#ifndef SCANLINE_CONTAINER_H
+#define SCANLINE_CONTAINER_H
+
+#include "ObjectCache.h"
+#include "Scanline.h"
+
+// Stores the scanlines of a rasterized shape for rendering them again later.
+// The scanlines are expected to be added with increasing y, which is the
+// order in which the rasterizer sweeps them. That allows to find the
+// scanlines of a horizontal strip without looking at any of the others.
+class ScanlineContainer : public ObjectCache<Scanline, false> {
+public:
+	// Returns the index of the first scanline with a y of at least the
+	// given one, or CountObjects() if there is none.
+	uint32 FirstIndexAt(int y) const
+	{
+		uint32 lower = 0;
+		uint32 upper = CountObjects();
+		while (lower < upper) {
+			uint32 middle = (lower + upper) / 2;
+			if (ObjectAtFast(middle)->y() < y)
+				lower = middle + 1;
+			else
+				upper = middle;
+		}
+		return lower;
+	}
+};
+
+#endif // SCANLINE_CONTAINER_H
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2013 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "ScratchArena.h"
+
+#include <new>
+
+#include <stdlib.h>
+
+
+static const size_t kMinBlockSize = 1024 * 1024;
+// Memory beyond this size is given back after each job instead of being
+// kept around for the next one.
+static const size_t kMaxRetainedSize = 64 * 1024 * 1024;
+static const size_t kAlignment = 16;
+
+
+struct ScratchArena::Block {
+	Block*	next;
+	size_t	size;
+	uint8*	data;
+};
+
+
+static inline size_t
+align_size(size_t size)
+{
+	return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+
+// #pragma mark - Scope
+
+
+ScratchArena::Scope::Scope(ScratchArena& arena)
+	: fArena(arena)
+	, fBlock(arena.fCurrentBlock)
+	, fOffset(arena.fOffset)
+{
+}
+
+
+ScratchArena::Scope::~Scope()
+{
+	fArena.fCurrentBlock = fBlock;
+	fArena.fOffset = fOffset;
+}
+
+
+// #pragma mark - ScratchArena
+
+
+ScratchArena::ScratchArena()
+	: fFirstBlock(NULL)
+	, fCurrentBlock(NULL)
+	, fOffset(0)
+	, fBytesAllocated(0)
+{
+}
+
+
+ScratchArena::~ScratchArena()
+{
+	_FreeBlocks();
+}
+
+
+void*
+ScratchArena::Allocate(size_t size)
+{
+	size = align_size(size);
+
+	if (fCurrentBlock != NULL && fOffset + size <= fCurrentBlock->size) {
+		void* memory = fCurrentBlock->data + fOffset;
+		fOffset += size;
+		return memory;
+	}
+
+	// Continue with the next block which is large enough, or insert
+	// a new block after the current one.
+	Block* previous = fCurrentBlock;
+	Block* block = fCurrentBlock != NULL ? fCurrentBlock->next : fFirstBlock;
+	if (block == NULL || block->size < size) {
+		Block* newBlock = new(std::nothrow) Block;
+		if (newBlock == NULL)
+			return NULL;
+		newBlock->size = size > kMinBlockSize ? size : kMinBlockSize;
+		newBlock->data = reinterpret_cast<uint8*>(malloc(newBlock->size));
+		if (newBlock->data == NULL) {
+			delete newBlock;
+			return NULL;
+		}
+		fBytesAllocated += newBlock->size;
+
+		newBlock->next = block;
+		if (previous != NULL)
+			previous->next = newBlock;
+		else
+			fFirstBlock = newBlock;
+		block = newBlock;
+	}
+
+	fCurrentBlock = block;
+	fOffset = size;
+	return block->data;
+}
+
+
+void
+ScratchArena::Reset()
+{
+	fCurrentBlock = NULL;
+	fOffset = 0;
+
+	if (fFirstBlock == NULL)
+		return;
+
+	size_t totalSize = 0;
+	for (Block* block = fFirstBlock; block != NULL; block = block->next)
+		totalSize += block->size;
+
+	if (fFirstBlock->next == NULL && totalSize <= kMaxRetainedSize)
+		return;
+
+	// Replace the blocks by a single block of the combined size, so the
+	// next job of this size finds all it needs in one block.
+	_FreeBlocks();
+	if (totalSize <= kMaxRetainedSize) {
+		Allocate(totalSize);
+		fCurrentBlock = NULL;
+		fOffset = 0;
+	}
+}
+
+
+void
+ScratchArena::ResetStatistics()
+{
+	fBytesAllocated = 0;
+}
+
+
+void
+ScratchArena::_FreeBlocks()
+{
+	while (fFirstBlock != NULL) {
+		Block* block = fFirstBlock;
+		fFirstBlock = block->next;
+		free(block->data);
+		delete block;
+	}
+	fCurrentBlock = NULL;
+	fOffset = 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright 2013 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include <SupportDefs.h>
+
+// A stack-like allocator for temporary memory needed while rendering, like
+// copies of pixel buffers and working sets of filters. Allocations are
+// released in reverse order via Scope objects. Reset() releases everything
+// and merges the memory blocks, so that the next render job of the same
+// size can run without touching the heap at all.
+//
+// A ScratchArena is not thread-safe, each RenderEngine owns one.
+class ScratchArena {
+private:
+			struct Block;
+
+public:
+	class Scope {
+	public:
+								Scope(ScratchArena& arena);
+								~Scope();
+
+	private:
+			ScratchArena&		fArena;
+			Block*				fBlock;
+			size_t				fOffset;
+	};
+
+public:
+								ScratchArena();
+								~ScratchArena();
+
+	// Returns 16 byte aligned memory or NULL when out of memory.
+			void*				Allocate(size_t size);
+
+	// Releases all allocations. Must not be called while Scope objects
+	// are alive.
+			void				Reset();
+
+	// Bytes allocated from the heap since the last ResetStatistics().
+	inline	size_t				BytesAllocated() const
+									{ return fBytesAllocated; }
+			void				ResetStatistics();
+
+private:
+			void				_FreeBlocks();
+
+			Block*				fFirstBlock;
+			Block*				fCurrentBlock;
+			size_t				fOffset;
+			size_t				fBytesAllocated;
+};
+
+#endif // SCRATCH_ARENA_H
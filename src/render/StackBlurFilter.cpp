@@ -230,7 +230,7 @@ StackBlurFilter::_Filter64(uint16* buffer,
 			sum_out_b = 
 			sum_out_a = 0;
 
-			src_pix_ptr = buffer + bpr * y;
+			src_pix_ptr = buffer + (size_t)bpr * y;
 			for (i = 0; i <= rx; i++) {
 				stack_pix_ptr	= &stack[i];
 				stack_pix_ptr->r = src_pix_ptr[2] >> 8;
@@ -268,8 +268,8 @@ StackBlurFilter::_Filter64(uint16* buffer,
 			xp = rx;
 			if (xp > wm)
 				xp = wm;
-			src_pix_ptr = buffer + xp * 4 + y * bpr;
-			dst_pix_ptr = buffer + y * bpr;
+			src_pix_ptr = buffer + xp * 4 + (size_t)y * bpr;
+			dst_pix_ptr = buffer + (size_t)y * bpr;
 			for (x = 0; x < w; x++) {
 				dst_pix_ptr[0] = (sum_b * mul_sum) >> shr_sum;
 				dst_pix_ptr[1] = (sum_g * mul_sum) >> shr_sum;
@@ -392,7 +392,7 @@ StackBlurFilter::_Filter64(uint16* buffer,
 			yp = ry;
 			if (yp > hm)
 				yp = hm;
-			src_pix_ptr = buffer + x * 4 + yp * bpr;
+			src_pix_ptr = buffer + x * 4 + (size_t)yp * bpr;
 			dst_pix_ptr = buffer + x * 4;
 			for (y = 0; y < h; y++) {
 				dst_pix_ptr[0] = (sum_b * mul_sum) >> shr_sum;
@@ -526,7 +526,7 @@ StackBlurFilter::_Filter32(uint8* buffer,
 			sum_out_b = 
 			sum_out_a = 0;
 
-			src_pix_ptr = buffer + bpr * y;
+			src_pix_ptr = buffer + (size_t)bpr * y;
 			for (i = 0; i <= rx; i++) {
 				stack_pix_ptr	= &stack[i];
 				stack_pix_ptr->r = src_pix_ptr[2];
@@ -564,8 +564,8 @@ StackBlurFilter::_Filter32(uint8* buffer,
 			xp = rx;
 			if (xp > wm)
 				xp = wm;
-			src_pix_ptr = buffer + xp * 4 + y * bpr;
-			dst_pix_ptr = buffer + y * bpr;
+			src_pix_ptr = buffer + xp * 4 + (size_t)y * bpr;
+			dst_pix_ptr = buffer + (size_t)y * bpr;
 			for (x = 0; x < w; x++) {
 				dst_pix_ptr[2] = (sum_r * mul_sum) >> shr_sum;
 				dst_pix_ptr[1] = (sum_g * mul_sum) >> shr_sum;
@@ -684,7 +684,7 @@ StackBlurFilter::_Filter32(uint8* buffer,
 			yp = ry;
 			if (yp > hm)
 				yp = hm;
-			src_pix_ptr = buffer + x * 4 + yp * bpr;
+			src_pix_ptr = buffer + x * 4 + (size_t)yp * bpr;
 			dst_pix_ptr = buffer + x * 4;
 			for (y = 0; y < h; y++) {
 				dst_pix_ptr[2] = (sum_r * mul_sum) >> shr_sum;
@@ -790,7 +790,7 @@ StackBlurFilter::_FilterGray(PixelType* buffer,
 		{
 			sum = sum_in = sum_out = 0;
 
-			src_pix_ptr = buffer + y * bpr;
+			src_pix_ptr = buffer + (size_t)y * bpr;
 			pix = *src_pix_ptr;
 			for(i = 0; i <= rx; i++)
 			{
@@ -810,8 +810,8 @@ StackBlurFilter::_FilterGray(PixelType* buffer,
 			stack_ptr = rx;
 			xp = rx;
 			if(xp > wm) xp = wm;
-			src_pix_ptr = buffer + xp + y * bpr;
-			dst_pix_ptr = buffer + y * bpr;
+			src_pix_ptr = buffer + xp + (size_t)y * bpr;
+			dst_pix_ptr = buffer + (size_t)y * bpr;
 			for(x = 0; x < w; x++)
 			{
 				*dst_pix_ptr = (sum * mul_sum) >> shr_sum;
@@ -878,7 +878,7 @@ StackBlurFilter::_FilterGray(PixelType* buffer,
 			stack_ptr = ry;
 			yp = ry;
 			if(yp > hm) yp = hm;
-			src_pix_ptr = buffer + x + yp * bpr;
+			src_pix_ptr = buffer + x + (size_t)yp * bpr;
 			dst_pix_ptr = buffer + x;
 			for(y = 0; y < h; y++)
 			{
@@ -186,6 +186,14 @@ public:
 		return true;
 	}
 
+	inline const Font& getFont(int index) const
+	{
+		StyleRun* style = fGlyphInfoBuffer[index].styleRun;
+		if (style != NULL)
+			return style->font;
+		return fFont;
+	}
+
 	inline void getInfo(int index, const agg::glyph_cache** glyph, double* x,
 		double* y, double* height, double* fauxWeight, double* fauxItalic,
 		TextRenderer::Color& fgColor, bool& strikeOut,
@@ -4,7 +4,13 @@
  */
 #include "TextRenderer.h"
 
+#include <algorithm>
+#include <float.h>
+#include <new>
+
 #include "FontCache.h"
+#include "GlyphCoverageCache.h"
+#include "HashString.h"
 #include "TextLayout.h"
 #include "UTF8Utils.h"
 
@@ -42,6 +48,8 @@ TextRenderer::TextRenderer(FontCache* fontCache)
 
 	fScanline(),
 	fRasterizer(),
+	fMaskScanline(),
+	fMaskRasterizer(),
 	fPath(),
 
 	fFontCache(fontCache),
@@ -55,9 +63,11 @@ TextRenderer::TextRenderer(FontCache* fontCache)
 
 	fHinting(true),
 	fKerning(true),
-	fGrayScale(false)
+	fGrayScale(false),
+	fCacheableTransformation(true)
 {
 	fRasterizer.gamma(agg::gamma_power(fGamma));
+	fMaskRasterizer.gamma(agg::gamma_power(fGamma));
 }
 
 
@@ -140,6 +150,13 @@ TextRenderer::setTransformation(const Transformation& transformation)
 {
 	fBaseMatrix = transformation;
 	fGlyph.approximation_scale(fBaseMatrix.scale());
+
+	fCacheableTransformation = fBaseMatrix.shx == 0.0
+		&& fBaseMatrix.shy == 0.0
+		&& fBaseMatrix.w0 == 0.0 && fBaseMatrix.w1 == 0.0
+		&& fBaseMatrix.w2 == 1.0
+		&& fBaseMatrix.sx == fBaseMatrix.sy
+		&& fBaseMatrix.sx > 0.0;
 }
 
 
@@ -161,6 +178,160 @@ TextRenderer::initPathAdaptor(const agg::glyph_cache* glyph, double x, double y,
 }
 
 
+bool
+TextRenderer::isGlyphVisible(const agg::glyph_cache* glyph, double x, double y,
+	double fauxWeight, double fauxItalic, unsigned subpixelScale,
+	const agg::rect_i& clipRect) const
+{
+	// Glyph bounds relative to the glyph origin
+	double x1 = glyph->bounds.x1 * fGlyphWidthScale / AUTO_HINT_SCALE;
+	double x2 = glyph->bounds.x2 * fGlyphWidthScale / AUTO_HINT_SCALE;
+	double y1 = glyph->bounds.y1;
+	double y2 = glyph->bounds.y2;
+
+	// Extend by the faux italic shearing
+	double italic = fabs(tan(fauxItalic * subpixelScale / 3))
+		* std::max(fabs(y1), fabs(y2));
+	x1 -= italic;
+	x2 += italic;
+
+	double cornersX[4] = { x + x1, x + x2, x + x2, x + x1 };
+	double cornersY[4] = { y + y1, y + y1, y + y2, y + y2 };
+
+	double minX = DBL_MAX;
+	double minY = DBL_MAX;
+	double maxX = -DBL_MAX;
+	double maxY = -DBL_MAX;
+	for (int i = 0; i < 4; i++) {
+		fBaseMatrix.transform(&cornersX[i], &cornersY[i]);
+		minX = std::min(minX, cornersX[i]);
+		minY = std::min(minY, cornersY[i]);
+		maxX = std::max(maxX, cornersX[i]);
+		maxY = std::max(maxY, cornersY[i]);
+	}
+
+	// Faux weight is applied after the transformation, also add one pixel
+	// for anti-aliasing and hinting.
+	double inset = fabs(fauxWeight * glyph->height * subpixelScale / 15) + 1;
+
+	return (maxX + inset) / subpixelScale >= clipRect.x1
+		&& (minX - inset) / subpixelScale <= clipRect.x2 + 1
+		&& maxY + inset >= clipRect.y1
+		&& minY - inset <= clipRect.y2 + 1;
+}
+
+
+bool
+TextRenderer::drawCachedGlyph(const agg::glyph_cache* glyph,
+	const HashString& fontPath, double fontSize, double x, double y, double fauxWeight, double fauxItalic,
+	const Color& color)
+{
+	// The glyph origin in pixel coordinates is split into the integer pixel
+	// and a quantized sub-pixel phase which is part of the cache key.
+	double originX = x * fBaseMatrix.sx + fBaseMatrix.tx;
+	double originY = y * fBaseMatrix.sy + fBaseMatrix.ty;
+	int pixelX = (int)floor(originX);
+	int pixelY = (int)floor(originY);
+	int phaseX = (int)floor((originX - pixelX) * SUBPIXEL_PHASES + 0.5);
+	int phaseY = (int)floor((originY - pixelY) * SUBPIXEL_PHASES + 0.5);
+	if (phaseX >= SUBPIXEL_PHASES) {
+		phaseX = 0;
+		pixelX++;
+	}
+	if (phaseY >= SUBPIXEL_PHASES) {
+		phaseY = 0;
+		pixelY++;
+	}
+
+	GlyphCoverageKey key(fontPath, fontSize, glyph->glyph_index,
+		glyph->bounds.x1, glyph->bounds.x2, fBaseMatrix.sx, fGlyphWidthScale,
+		fauxWeight, fauxItalic, fHinting, phaseX, phaseY);
+
+	GlyphCoverageCache* cache = GlyphCoverageCache::getInstance();
+	GlyphCoverageMask* mask = cache->get(key);
+	if (mask == NULL) {
+		mask = createCoverageMask(glyph, key);
+		if (mask == NULL)
+			return false;
+		mask = cache->put(mask);
+	}
+
+	int left = pixelX + mask->left();
+	int top = pixelY + mask->top();
+	for (int row = 0; row < mask->height(); row++) {
+		// The renderer clips the span against the clipping box
+		fRenderer.blend_solid_hspan(left, top + row, mask->width(), color,
+			mask->rowAt(row));
+	}
+
+	mask->RemoveReference();
+	return true;
+}
+
+
+GlyphCoverageMask*
+TextRenderer::createCoverageMask(const agg::glyph_cache* glyph,
+	const GlyphCoverageKey& key)
+{
+	initPathAdaptor(glyph, 0, 0);
+
+	fMatrix.reset();
+	fMatrix *= agg::trans_affine_scaling(key.widthScale / AUTO_HINT_SCALE, 1);
+	fMatrix *= agg::trans_affine_skewing(key.fauxItalic / 3, 0);
+	fMatrix *= agg::trans_affine_scaling(key.scale);
+	fMatrix *= agg::trans_affine_translation(
+		(double)key.phaseX / SUBPIXEL_PHASES,
+		(double)key.phaseY / SUBPIXEL_PHASES);
+
+	fMaskRasterizer.reset();
+
+	if (fabs(key.fauxWeight) < 0.05) {
+		fMaskRasterizer.add_path(fTransformedGlyph);
+	} else {
+		fFauxWeightGlyph.weight(-key.fauxWeight * glyph->height / 15);
+		fMaskRasterizer.add_path(fFauxWeightGlyph);
+	}
+
+	if (!fMaskRasterizer.rewind_scanlines()) {
+		// Nothing to render, for example a space
+		return new(std::nothrow) GlyphCoverageMask(key, 0, 0, 0, 0);
+	}
+
+	int left = fMaskRasterizer.min_x();
+	int top = fMaskRasterizer.min_y();
+	int width = fMaskRasterizer.max_x() - left + 1;
+	int height = fMaskRasterizer.max_y() - top + 1;
+
+	if (width > GlyphCoverageCache::MAX_MASK_SIZE
+		|| height > GlyphCoverageCache::MAX_MASK_SIZE) {
+		// Huge glyphs are rendered as vectors, caching would not pay off.
+		return NULL;
+	}
+
+	GlyphCoverageMask* mask = new(std::nothrow) GlyphCoverageMask(key,
+		left, top, width, height);
+	if (mask == NULL || !mask->isValid()) {
+		delete mask;
+		return NULL;
+	}
+
+	fMaskScanline.reset(fMaskRasterizer.min_x(), fMaskRasterizer.max_x());
+	while (fMaskRasterizer.sweep_scanline(fMaskScanline)) {
+		uint8* row = mask->rowAt(fMaskScanline.y() - top);
+		unsigned spanCount = fMaskScanline.num_spans();
+		ScanlineUnpacked::iterator span = fMaskScanline.begin();
+		while (true) {
+			memcpy(row + span->x - left, span->covers, span->len);
+			if (--spanCount == 0)
+				break;
+			++span;
+		}
+	}
+
+	return mask;
+}
+
+
 double
 TextRenderer::drawString(const char* text, double x, double y)
 {
@@ -394,6 +565,16 @@ TextRenderer::drawText(RendererType& renderer,
 
 	agg::rect_i clipRect = fRenderer.clip_box();
 
+	// Rasterizing outside the clipping area is wasted work
+	fRasterizer.clip_box(clipRect.x1 * subpixelScale, clipRect.y1,
+		(clipRect.x2 + 1) * subpixelScale, clipRect.y2 + 1);
+
+	// Cached coverage masks can only be used for gray scale rendering
+	// without rotation, shearing or perspective.
+	bool useCoverageCache = subpixelScale == 1 && fCacheableTransformation;
+	const Font* lastFont = NULL;
+	HashString fontPath;
+
 	for (int index = 0; index < count; index++) {
 
 		const agg::glyph_cache* glyph;
@@ -416,40 +597,52 @@ TextRenderer::drawText(RendererType& renderer,
 
 		double ty = fHinting ? floor(yOffset + y + 0.5) : yOffset + y;
 
-		if (glyph != NULL && glyph->data_type == agg::glyph_data_outline
-			&& xOffset + (x + glyph->bounds.x2) / scale >= clipRect.x1
-			&& xOffset + (x + glyph->bounds.x1) / scale <= clipRect.x2
-			&& ty + glyph->bounds.y2 >= clipRect.y1
-			&& ty + glyph->bounds.y1 <= clipRect.y2) {
-			initPathAdaptor(glyph, 0, 0);
-
-			fMatrix.reset();
-			fMatrix *= agg::trans_affine_scaling(
-				fGlyphWidthScale / scaleX, 1);
-			fMatrix *= agg::trans_affine_skewing(
-				fauxItalic * subpixelScale / 3, 0);
-			fMatrix *= agg::trans_affine_translation(
-				xOffsetScaled + x / scaleX, ty);
-			fMatrix *= fBaseMatrix;
-
-			fRasterizer.reset();
+		double glyphX = xOffsetScaled + x / scaleX;
 
-			if (fabs(fauxWeight) < 0.05) {
-				fRasterizer.add_path(fTransformedGlyph);
-			} else {
-				fFauxWeightGlyph.weight(
-					-fauxWeight * glyph->height * subpixelScale / 15);
-				fRasterizer.add_path(fFauxWeightGlyph);
+		if (glyph != NULL && glyph->data_type == agg::glyph_data_outline
+			&& isGlyphVisible(glyph, glyphX, ty, fauxWeight, fauxItalic,
+				subpixelScale, clipRect)) {
+
+			const Color& color = selectionStart >= 0
+					&& selectionEnd >= selectionStart
+					&& index >= selectionStart && index <= selectionEnd
+				? selectionFG : fg;
+
+			bool drawn = false;
+			if (useCoverageCache) {
+				const Font& font = layout->getFont(index);
+				if (&font != lastFont) {
+					lastFont = &font;
+					fontPath.SetTo(font.getFontFilePath());
+				}
+				drawn = drawCachedGlyph(glyph, fontPath, font.getSize(),
+					glyphX, ty, fauxWeight, fauxItalic, color);
 			}
-
-			if (selectionStart >= 0 && selectionEnd >= selectionStart
-				&& index >= selectionStart && index <= selectionEnd) {
-				renderer.color(selectionFG);
-			} else {
-				renderer.color(fg);
+			if (!drawn) {
+				initPathAdaptor(glyph, 0, 0);
+
+				fMatrix.reset();
+				fMatrix *= agg::trans_affine_scaling(
+					fGlyphWidthScale / scaleX, 1);
+				fMatrix *= agg::trans_affine_skewing(
+					fauxItalic * subpixelScale / 3, 0);
+				fMatrix *= agg::trans_affine_translation(glyphX, ty);
+				fMatrix *= fBaseMatrix;
+
+				fRasterizer.reset();
+
+				if (fabs(fauxWeight) < 0.05) {
+					fRasterizer.add_path(fTransformedGlyph);
+				} else {
+					fFauxWeightGlyph.weight(
+						-fauxWeight * glyph->height * subpixelScale / 15);
+					fRasterizer.add_path(fFauxWeightGlyph);
+				}
+
+				renderer.color(color);
+
+				agg::render_scanlines(fRasterizer, fScanline, renderer);
 			}
-
-			agg::render_scanlines(fRasterizer, fScanline, renderer);
 		}
 
 		if (lastStrikeOut) {
@@ -26,6 +26,9 @@
 
 
 class FontCache;
+struct GlyphCoverageKey;
+class GlyphCoverageMask;
+class HashString;
 class TextLayout;
 
 
@@ -35,7 +38,7 @@ public:
 
 	typedef agg::rgba16										Color;
 
-	typedef agg::scanline_u8								ScanlineUnpacked;
+	typedef agg::scanline32_u8								ScanlineUnpacked;
 
 	typedef agg::renderer_base<PixelFormat>					Renderer;
 	typedef agg::renderer_scanline_aa_solid<Renderer>		RendererSolid;
@@ -154,6 +157,16 @@ private:
 	void initPathAdaptor(const agg::glyph_cache* glyph, double x, double y,
 		double scale = 1.0);
 
+	bool isGlyphVisible(const agg::glyph_cache* glyph, double x, double y,
+		double fauxWeight, double fauxItalic, unsigned subpixelScale,
+		const agg::rect_i& clipRect) const;
+
+	bool drawCachedGlyph(const agg::glyph_cache* glyph,
+		const HashString& fontPath, double fontSize, double x, double y, double fauxWeight,
+		double fauxItalic, const Color& color);
+	GlyphCoverageMask* createCoverageMask(const agg::glyph_cache* glyph,
+		const GlyphCoverageKey& key);
+
 	template<class RendererType>
 	double drawString(RendererType& renderer,
 		const char* text, double x, double y, unsigned subpixelScale);
@@ -177,6 +190,7 @@ private:
 
 public:
 	static constexpr double	AUTO_HINT_SCALE = 100.0;
+	static const int		SUBPIXEL_PHASES = 4;
 
 private:
 	RenderingBuffer			fBuffer;
@@ -202,6 +216,10 @@ private:
 	ScanlineUnpacked		fScanline;
 	Rasterizer				fRasterizer;
 
+	// Used to rasterize glyphs into the GlyphCoverageCache
+	ScanlineUnpacked		fMaskScanline;
+	Rasterizer				fMaskRasterizer;
+
 	PathStorage				fPath;
 
 	FontCache*				fFontCache;
@@ -220,6 +238,10 @@ private:
 	bool					fHinting;
 	bool					fKerning;
 	bool					fGrayScale;
+
+	// Whether fBaseMatrix is only translation and uniform scale, which
+	// allows to use cached glyph coverage masks.
+	bool					fCacheableTransformation;
 };
 
 
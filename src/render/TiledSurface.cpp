@@ -0,0 +1,694 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ *
+ * The dab mask and blending follow the tiled surface of MyPaint,
+ * Copyright 2008 Martin Renold.
+ */
+#include "TiledSurface.h"
+
+#include <new>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#	include <emmintrin.h>
+#endif
+
+
+struct TiledSurface::ColorSample {
+	int32	x;
+	int32	y;
+	float	weight;
+};
+
+
+// tile_index
+static inline int32
+tile_index(int32 pixel)
+{
+	return pixel >> TiledSurface::TILE_SHIFT;
+}
+
+// clamp01
+static inline float
+clamp01(float value)
+{
+	if (value < 0.0f)
+		return 0.0f;
+	if (value > 1.0f)
+		return 1.0f;
+	return value;
+}
+
+// pixel_at
+static inline uint16*
+pixel_at(const RenderBuffer* tile, int32 x, int32 y)
+{
+	return (uint16*)(tile->Bits()
+		+ (int64)(y - tile->Top()) * tile->BytesPerRow()
+		+ (x - tile->Left()) * 8);
+}
+
+
+// The dab mask of MyPaint: the opacity falls off linearly with the squared
+// distance from the center, with a kink at the hardness.
+struct DabMask {
+	DabMask(float hardness)
+		: hardness(hardness)
+		, segment1Offset(1.0f)
+		, segment1Slope(-(1.0f / hardness - 1.0f))
+		, segment2Offset(hardness < 1.0f ? hardness / (1.0f - hardness) : 0.0f)
+		, segment2Slope(hardness < 1.0f ? -hardness / (1.0f - hardness) : 0.0f)
+	{
+	}
+
+	// rr is the squared distance from the center relative to the radius,
+	// the pixel is outside the dab for rr > 1.0.
+	inline float Opacity(float rr) const
+	{
+		if (rr <= hardness)
+			return segment1Offset + segment1Slope * rr;
+		return segment2Offset + segment2Slope * rr;
+	}
+
+#if defined(__SSE2__)
+	inline __m128 Opacity(__m128 rr) const
+	{
+		__m128 segment1 = _mm_add_ps(_mm_set1_ps(segment1Offset),
+			_mm_mul_ps(_mm_set1_ps(segment1Slope), rr));
+		__m128 segment2 = _mm_add_ps(_mm_set1_ps(segment2Offset),
+			_mm_mul_ps(_mm_set1_ps(segment2Slope), rr));
+		__m128 first = _mm_cmple_ps(rr, _mm_set1_ps(hardness));
+		return _mm_or_ps(_mm_and_ps(first, segment1),
+			_mm_andnot_ps(first, segment2));
+	}
+#endif
+
+	float	hardness;
+	float	segment1Offset;
+	float	segment1Slope;
+	float	segment2Offset;
+	float	segment2Slope;
+};
+
+
+// Blends the dab color into the 16 bit premultiplied BGRA pixels. The
+// first pass is the normal (or eraser) blending, the second pass paints
+// with the current alpha of the pixel, so it does not change the alpha
+// channel. MyPaint splits the opacity between the passes by lock_alpha.
+struct DabBlender {
+	DabBlender(const float linearColor[3], float opaque, float alphaEraser,
+		float lockAlpha)
+	{
+		opaqueNormal = opaque * (1.0f - lockAlpha);
+		opaqueLocked = opaque * lockAlpha;
+
+		for (int32 i = 0; i < 3; i++) {
+			colorNormal[i] = linearColor[i] * alphaEraser * 65535.0f;
+			colorLocked[i] = linearColor[i];
+		}
+		colorNormal[3] = alphaEraser * 65535.0f;
+		colorLocked[3] = 0.0f;
+
+#if defined(__SSE2__)
+		vectorNormal = _mm_loadu_ps(colorNormal);
+		vectorLocked = _mm_loadu_ps(colorLocked);
+		// all bits set in the color lanes
+		colorLanes = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+#endif
+	}
+
+#if defined(__SSE2__)
+	// Only the four channels of one pixel are processed together, the
+	// pixels are still blended one after the other.
+	inline void Blend(uint16* pixel, float mask) const
+	{
+		const __m128 one = _mm_set1_ps(1.0f);
+
+		__m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+			_mm_loadl_epi64((const __m128i*)pixel), _mm_setzero_si128()));
+
+		if (opaqueNormal > 0.0f) {
+			__m128 opacity = _mm_set1_ps(mask * opaqueNormal);
+			value = _mm_add_ps(_mm_mul_ps(opacity, vectorNormal),
+				_mm_mul_ps(_mm_sub_ps(one, opacity), value));
+		}
+
+		if (opaqueLocked > 0.0f) {
+			__m128 opacity = _mm_set1_ps(mask * opaqueLocked);
+			__m128 alpha = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3));
+			__m128 blended = _mm_add_ps(
+				_mm_mul_ps(_mm_mul_ps(opacity, alpha), vectorLocked),
+				_mm_mul_ps(_mm_sub_ps(one, opacity), value));
+			value = _mm_or_ps(_mm_and_ps(colorLanes, blended),
+				_mm_andnot_ps(colorLanes, value));
+		}
+
+		// There is no unsigned saturating pack before SSE4.1, so the values
+		// are shifted into the signed range and back.
+		__m128i result = _mm_sub_epi32(_mm_cvtps_epi32(value),
+			_mm_set1_epi32(32768));
+		result = _mm_packs_epi32(result, result);
+		result = _mm_xor_si128(result, _mm_set1_epi16((short)0x8000));
+		_mm_storel_epi64((__m128i*)pixel, result);
+	}
+#else
+	inline void Blend(uint16* pixel, float mask) const
+	{
+		float value[4];
+		for (int32 i = 0; i < 4; i++)
+			value[i] = pixel[i];
+
+		if (opaqueNormal > 0.0f) {
+			float opacity = mask * opaqueNormal;
+			for (int32 i = 0; i < 4; i++) {
+				value[i] = opacity * colorNormal[i]
+					+ (1.0f - opacity) * value[i];
+			}
+		}
+
+		if (opaqueLocked > 0.0f) {
+			float opacity = mask * opaqueLocked;
+			for (int32 i = 0; i < 3; i++) {
+				value[i] = opacity * value[3] * colorLocked[i]
+					+ (1.0f - opacity) * value[i];
+			}
+		}
+
+		for (int32 i = 0; i < 4; i++) {
+			int32 v = (int32)lrintf(value[i]);
+			pixel[i] = v < 0 ? 0 : (v > 65535 ? 65535 : v);
+		}
+	}
+#endif
+
+	float	opaqueNormal;
+	float	opaqueLocked;
+	// BGRA order like the pixels
+	float	colorNormal[4];
+	float	colorLocked[4];
+#if defined(__SSE2__)
+	__m128	vectorNormal;
+	__m128	vectorLocked;
+	__m128	colorLanes;
+#endif
+};
+
+
+
+
+// #pragma mark - TiledSurface
+
+
+// constructor
+TiledSurface::TiledSurface()
+	: fSlots()
+	, fBounds(0, 0, -1, -1)
+	, fDirtySlots()
+	, fColorSamples(NULL)
+	, fColorSampleCount(0)
+	, fColorSamplesAllocated(0)
+	, fColorSampleWeight(0.0f)
+	, fColorSampleRadius(-1.0f)
+	, fColorSampleFractionX(0.0f)
+	, fColorSampleFractionY(0.0f)
+{
+}
+
+// constructor
+TiledSurface::TiledSurface(const TiledSurface& other)
+	: fSlots()
+	, fBounds(0, 0, -1, -1)
+	, fDirtySlots()
+	, fColorSamples(NULL)
+	, fColorSampleCount(0)
+	, fColorSamplesAllocated(0)
+	, fColorSampleWeight(0.0f)
+	, fColorSampleRadius(-1.0f)
+	, fColorSampleFractionX(0.0f)
+	, fColorSampleFractionY(0.0f)
+{
+	*this = other;
+}
+
+// destructor
+TiledSurface::~TiledSurface()
+{
+	_Unset();
+	free(fColorSamples);
+}
+
+// operator=
+TiledSurface&
+TiledSurface::operator=(const TiledSurface& other)
+{
+	if (this == &other)
+		return *this;
+
+	ClearDirty();
+
+	// Drop the tiles which the other surface does not have, which is
+	// only the case after it has been emptied.
+	if (fSlots.CountElements() > 0) {
+		BList removed;
+		SlotMap::Iterator iterator(&fSlots);
+		while (iterator.HasNext()) {
+			SlotMap::LinkType* link = iterator.Next();
+			if (other._SlotAt(link->Key.x, link->Key.y) == NULL)
+				removed.AddItem(link);
+		}
+		for (int32 i = 0; i < removed.CountItems(); i++) {
+			SlotMap::LinkType* link
+				= (SlotMap::LinkType*)removed.ItemAtFast(i);
+			TileKey key = link->Key;
+			link->Value.tile->RemoveReference();
+			fSlots.RemoveKey(key);
+		}
+	}
+
+	// Typically, the other surface is the original which this copy is
+	// synchronized with, and only a few of the tiles have changed.
+	SlotMap::Iterator iterator(&other.fSlots);
+	while (iterator.HasNext()) {
+		SlotMap::LinkType* link = iterator.Next();
+		RenderBuffer* tile = link->Value.tile;
+		Slot* slot = _SlotAt(link->Key.x, link->Key.y);
+		if (slot == NULL) {
+			if (fSlots.Put(link->Key, Slot()) != B_OK)
+				continue;
+			slot = _SlotAt(link->Key.x, link->Key.y);
+		}
+		if (slot->tile == tile)
+			continue;
+		tile->AddReference();
+		if (slot->tile != NULL)
+			slot->tile->RemoveReference();
+		slot->tile = tile;
+	}
+
+	fBounds = other.fBounds;
+
+	return *this;
+}
+
+// #pragma mark - Surface
+
+// draw_dab
+bool
+TiledSurface::draw_dab(float x, float y, float radius, float colorR,
+	float colorG, float colorB, float opaque, float hardness,
+	float alphaEraser, float aspectRatio, float angle, float lockAlpha)
+{
+	opaque = clamp01(opaque);
+	hardness = clamp01(hardness);
+	alphaEraser = clamp01(alphaEraser);
+	lockAlpha = clamp01(lockAlpha);
+	if (opaque == 0.0f || radius < 0.1f || hardness == 0.0f)
+		return false;
+	if (aspectRatio < 1.0f)
+		aspectRatio = 1.0f;
+
+	// The brush works with sRGB colors, the tiles are linear.
+	float linearColor[3] = {
+		powf(clamp01(colorB), 2.2f),
+		powf(clamp01(colorG), 2.2f),
+		powf(clamp01(colorR), 2.2f)
+	};
+	DabBlender blender(linearColor, opaque, alphaEraser, lockAlpha);
+	DabMask mask(hardness);
+
+	// Tiles where nothing has been painted yet only need to be created if
+	// the dab adds any alpha.
+	bool addsAlpha = alphaEraser > 0.0f && lockAlpha < 1.0f;
+
+	float fringeRadius = radius + 1.0f;
+	int32 left = (int32)floorf(x - fringeRadius);
+	int32 top = (int32)floorf(y - fringeRadius);
+	int32 right = (int32)ceilf(x + fringeRadius);
+	int32 bottom = (int32)ceilf(y + fringeRadius);
+	BRect dabRect(left, top, right, bottom);
+
+	const float oneOverRadius2 = 1.0f / (radius * radius);
+	const float angleRad = angle / 360.0f * 2.0f * M_PI;
+	const float cs = cosf(angleRad);
+	const float sn = sinf(angleRad);
+	const float yyrStep = -sn * aspectRatio;
+	const float xxrStep = cs;
+
+	bool painted = false;
+	for (int32 tileY = tile_index(top); tileY <= tile_index(bottom);
+			tileY++) {
+		for (int32 tileX = tile_index(left); tileX <= tile_index(right);
+				tileX++) {
+			if (!addsAlpha && _SlotAt(tileX, tileY) == NULL)
+				continue;
+
+			Slot* slot = _WritableSlotAt(tileX, tileY);
+			if (slot == NULL)
+				continue;
+
+			RenderBuffer* tile = slot->tile;
+			BRect area = dabRect & tile->Bounds();
+			int32 areaLeft = (int32)area.left;
+			int32 areaRight = (int32)area.right;
+			for (int32 py = (int32)area.top; py <= (int32)area.bottom;
+					py++) {
+				float yy = py + 0.5f - y;
+				float xx = areaLeft + 0.5f - x;
+				// rotated into the coordinate system of the ellipse,
+				// stepping one pixel along x changes both linearly
+				float yyr = (yy * cs - xx * sn) * aspectRatio;
+				float xxr = yy * sn + xx * cs;
+
+				uint16* pixel = pixel_at(tile, areaLeft, py);
+				int32 px = areaLeft;
+#if defined(__SSE2__)
+				// The mask is evaluated for four pixels at once, only the
+				// pixels within the dab are blended.
+				const __m128 lanes = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+				__m128 yyr4 = _mm_add_ps(_mm_set1_ps(yyr),
+					_mm_mul_ps(lanes, _mm_set1_ps(yyrStep)));
+				__m128 xxr4 = _mm_add_ps(_mm_set1_ps(xxr),
+					_mm_mul_ps(lanes, _mm_set1_ps(xxrStep)));
+				const __m128 yyrStep4 = _mm_set1_ps(yyrStep * 4.0f);
+				const __m128 xxrStep4 = _mm_set1_ps(xxrStep * 4.0f);
+				const __m128 scale4 = _mm_set1_ps(oneOverRadius2);
+				const __m128 one = _mm_set1_ps(1.0f);
+				for (; px + 3 <= areaRight; px += 4) {
+					__m128 rr = _mm_mul_ps(_mm_add_ps(
+						_mm_mul_ps(yyr4, yyr4), _mm_mul_ps(xxr4, xxr4)),
+						scale4);
+					int inside = _mm_movemask_ps(_mm_cmple_ps(rr, one));
+					if (inside != 0) {
+						float opacity[4];
+						_mm_storeu_ps(opacity, mask.Opacity(rr));
+						for (int32 i = 0; i < 4; i++) {
+							if ((inside & (1 << i)) != 0)
+								blender.Blend(pixel + i * 4, opacity[i]);
+						}
+					}
+					yyr4 = _mm_add_ps(yyr4, yyrStep4);
+					xxr4 = _mm_add_ps(xxr4, xxrStep4);
+					pixel += 16;
+				}
+				yyr += (px - areaLeft) * yyrStep;
+				xxr += (px - areaLeft) * xxrStep;
+#endif
+				for (; px <= areaRight; px++) {
+					float rr = (yyr * yyr + xxr * xxr) * oneOverRadius2;
+					if (rr <= 1.0f)
+						blender.Blend(pixel, mask.Opacity(rr));
+					yyr += yyrStep;
+					xxr += xxrStep;
+					pixel += 4;
+				}
+			}
+
+			if (!slot->dirty.IsValid()) {
+				if (fDirtySlots.AddItem(slot))
+					slot->dirty = area;
+			} else
+				slot->dirty = slot->dirty | area;
+			painted = true;
+		}
+	}
+
+	if (!painted)
+		return false;
+
+	if (addsAlpha)
+		fBounds = fBounds.IsValid() ? fBounds | dabRect : dabRect;
+
+	return true;
+}
+
+// get_color
+void
+TiledSurface::get_color(float x, float y, float radius, float* colorR,
+	float* colorG, float* colorB, float* colorA)
+{
+	if (radius < 1.0f)
+		radius = 1.0f;
+
+	float color[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// The smudging brush asks for the color at whole pixels with the same
+	// radius over and over, so the pixels and their weights are only
+	// computed when that changes.
+	int32 centerX = (int32)floorf(x);
+	int32 centerY = (int32)floorf(y);
+	if (!_PrepareColorSamples(x - centerX, y - centerY, radius)
+		|| fColorSampleWeight <= 0.0f) {
+		*colorB = color[0];
+		*colorG = color[1];
+		*colorR = color[2];
+		*colorA = color[3];
+		return;
+	}
+
+#if defined(__SSE2__)
+	__m128 sumVector = _mm_setzero_ps();
+#else
+	float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+#endif
+
+	const RenderBuffer* tile = NULL;
+	int32 tileX = 0;
+	int32 tileY = 0;
+	bool tileValid = false;
+	for (int32 i = 0; i < fColorSampleCount; i++) {
+		const ColorSample& sample = fColorSamples[i];
+		int32 px = centerX + sample.x;
+		int32 py = centerY + sample.y;
+		if (!tileValid || tile_index(px) != tileX
+			|| tile_index(py) != tileY) {
+			tileX = tile_index(px);
+			tileY = tile_index(py);
+			tile = TileAt(tileX, tileY);
+			tileValid = true;
+		}
+		if (tile == NULL)
+			continue;
+
+		const uint16* pixel = pixel_at(tile, px, py);
+#if defined(__SSE2__)
+		__m128 value = _mm_cvtepi32_ps(_mm_unpacklo_epi16(
+			_mm_loadl_epi64((const __m128i*)pixel), _mm_setzero_si128()));
+		sumVector = _mm_add_ps(sumVector,
+			_mm_mul_ps(_mm_set1_ps(sample.weight), value));
+#else
+		for (int32 c = 0; c < 4; c++)
+			sum[c] += sample.weight * pixel[c];
+#endif
+	}
+
+#if defined(__SSE2__)
+	float sum[4];
+	_mm_storeu_ps(sum, sumVector);
+#endif
+
+	float alpha = sum[3] / fColorSampleWeight;
+	if (alpha > 0.0f) {
+		// un-premultiply and back to sRGB
+		for (int32 i = 0; i < 3; i++)
+			color[i] = powf(clamp01(sum[i] / sum[3]), 1.0f / 2.2f);
+	}
+	color[3] = clamp01(alpha / 65535.0f);
+
+	*colorB = color[0];
+	*colorG = color[1];
+	*colorR = color[2];
+	*colorA = color[3];
+}
+
+// #pragma mark - TiledSurface
+
+// MakeEmpty
+void
+TiledSurface::MakeEmpty()
+{
+	_Unset();
+	fBounds.Set(0, 0, -1, -1);
+}
+
+// TileAt
+const RenderBuffer*
+TiledSurface::TileAt(int32 x, int32 y) const
+{
+	Slot* slot = _SlotAt(x, y);
+	return slot != NULL ? slot->tile : NULL;
+}
+
+// CopyTo
+void
+TiledSurface::CopyTo(RenderBuffer* buffer, BRect area) const
+{
+	area = area & buffer->Bounds();
+	if (!area.IsValid())
+		return;
+
+	int32 left = (int32)area.left;
+	int32 top = (int32)area.top;
+	int32 right = (int32)area.right;
+	int32 bottom = (int32)area.bottom;
+
+	uint8* bits = buffer->Bits()
+		+ (int64)(top - buffer->Top()) * buffer->BytesPerRow()
+		+ (left - buffer->Left()) * 8;
+	for (int32 y = top; y <= bottom; y++) {
+		memset(bits, 0, (right - left + 1) * 8);
+		bits += buffer->BytesPerRow();
+	}
+
+	for (int32 tileY = tile_index(top); tileY <= tile_index(bottom);
+			tileY++) {
+		for (int32 tileX = tile_index(left); tileX <= tile_index(right);
+				tileX++) {
+			if (const RenderBuffer* tile = TileAt(tileX, tileY))
+				tile->CopyTo(buffer, area);
+		}
+	}
+}
+
+// DirtyTileArea
+BRect
+TiledSurface::DirtyTileArea(int32 index) const
+{
+	Slot* slot = (Slot*)fDirtySlots.ItemAt(index);
+	if (slot == NULL)
+		return BRect(0, 0, -1, -1);
+	return slot->dirty;
+}
+
+// ClearDirty
+void
+TiledSurface::ClearDirty()
+{
+	for (int32 i = 0; i < fDirtySlots.CountItems(); i++)
+		((Slot*)fDirtySlots.ItemAtFast(i))->dirty = BRect();
+	fDirtySlots.MakeEmpty();
+}
+
+// #pragma mark - private
+
+// _SlotAt
+TiledSurface::Slot*
+TiledSurface::_SlotAt(int32 x, int32 y) const
+{
+	SlotMap::LinkType* link = fSlots.Lookup(TileKey(x, y));
+	return link != NULL ? &link->Value : NULL;
+}
+
+// _WritableSlotAt
+TiledSurface::Slot*
+TiledSurface::_WritableSlotAt(int32 x, int32 y)
+{
+	Slot* slot = _SlotAt(x, y);
+	RenderBuffer* tile = slot != NULL ? slot->tile : NULL;
+	if (tile != NULL && tile->CountReferences() == 1)
+		return slot;
+
+	// The tile is new or still shared with a copy of the surface.
+	BRect bounds(x << TILE_SHIFT, y << TILE_SHIFT,
+		((x + 1) << TILE_SHIFT) - 1, ((y + 1) << TILE_SHIFT) - 1);
+	RenderBuffer* copy = new(std::nothrow) RenderBuffer(bounds);
+	if (copy == NULL || !copy->IsValid()) {
+		delete copy;
+		return NULL;
+	}
+
+	if (slot == NULL) {
+		if (fSlots.Put(TileKey(x, y), Slot()) != B_OK) {
+			delete copy;
+			return NULL;
+		}
+		slot = _SlotAt(x, y);
+	}
+
+	if (tile != NULL) {
+		memcpy(copy->Bits(), tile->Bits(), copy->BitsLength());
+		tile->RemoveReference();
+	} else
+		memset(copy->Bits(), 0, copy->BitsLength());
+
+	slot->tile = copy;
+	return slot;
+}
+
+// _PrepareColorSamples
+bool
+TiledSurface::_PrepareColorSamples(float fractionX, float fractionY,
+	float radius)
+{
+	if (fColorSamples != NULL && radius == fColorSampleRadius
+		&& fractionX == fColorSampleFractionX
+		&& fractionY == fColorSampleFractionY) {
+		return true;
+	}
+
+	float fringeRadius = radius + 1.0f;
+	int32 left = (int32)floorf(fractionX - fringeRadius);
+	int32 top = (int32)floorf(fractionY - fringeRadius);
+	int32 right = (int32)ceilf(fractionX + fringeRadius);
+	int32 bottom = (int32)ceilf(fractionY + fringeRadius);
+
+	// For large radii, a subset of the pixels gives the same average.
+	int32 step = max_c(1, (int32)(radius / 8.0f));
+
+	int32 columns = (right - left) / step + 1;
+	int32 rows = (bottom - top) / step + 1;
+	if (columns * rows > fColorSamplesAllocated) {
+		ColorSample* samples = (ColorSample*)realloc(fColorSamples,
+			columns * rows * sizeof(ColorSample));
+		if (samples == NULL)
+			return false;
+		fColorSamples = samples;
+		fColorSamplesAllocated = columns * rows;
+	}
+
+	// MyPaint weights the pixels with the mask of a dab of hardness 0.5,
+	// which is 1 - rr. The samples are in rows, so that they are mostly
+	// within the same tile as the one before.
+	const float oneOverRadius2 = 1.0f / (radius * radius);
+	fColorSampleCount = 0;
+	fColorSampleWeight = 0.0f;
+	for (int32 py = top; py <= bottom; py += step) {
+		float yy = py + 0.5f - fractionY;
+		for (int32 px = left; px <= right; px += step) {
+			float xx = px + 0.5f - fractionX;
+			float rr = (yy * yy + xx * xx) * oneOverRadius2;
+			if (rr > 1.0f)
+				continue;
+
+			ColorSample& sample = fColorSamples[fColorSampleCount++];
+			sample.x = px;
+			sample.y = py;
+			sample.weight = 1.0f - rr;
+			fColorSampleWeight += sample.weight;
+		}
+	}
+
+	fColorSampleRadius = radius;
+	fColorSampleFractionX = fractionX;
+	fColorSampleFractionY = fractionY;
+
+	return true;
+}
+
+// _Unset
+void
+TiledSurface::_Unset()
+{
+	ClearDirty();
+
+	SlotMap::Iterator iterator(&fSlots);
+	while (iterator.HasNext()) {
+		SlotMap::LinkType* link = iterator.Next();
+		if (link->Value.tile != NULL)
+			link->Value.tile->RemoveReference();
+	}
+	fSlots.Clear();
+}
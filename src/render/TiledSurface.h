@@ -0,0 +1,149 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef TILED_SURFACE_H
+#define TILED_SURFACE_H
+
+#include <List.h>
+#include <Rect.h>
+
+#include "HashMapHugo.h"
+#include "RenderBuffer.h"
+
+// surface.hpp has no include guard, this header needs to be the only one
+// including it. The brushlib classes are kept in a namespace, since its Brush
+// would clash with ours.
+namespace brushlib {
+#include "surface.hpp"
+}
+
+// The brushlib Surface which a MyPaint brush paints on. The pixels are kept
+// in TILE_SIZE x TILE_SIZE RenderBuffers (linear 16 bit premultiplied BGRA),
+// which are only allocated where the brush has painted. The tiles are found
+// by their coordinates in a hash map, so a few dabs far apart cost no more
+// than a few tiles. A copy of a
+// TiledSurface shares the tiles with the original, a tile is copied before
+// it is changed while it is shared. This way, snapshots of a surface can be
+// rendered while painting continues on the original.
+//
+// The area changed by draw_dab() is tracked per tile, see DirtyTileCount()
+// and DirtyTileArea().
+class TiledSurface : public brushlib::Surface {
+public:
+	enum {
+		TILE_SIZE	= 64,
+		TILE_SHIFT	= 6
+	};
+
+								TiledSurface();
+								TiledSurface(const TiledSurface& other);
+	virtual						~TiledSurface();
+
+			TiledSurface&		operator=(const TiledSurface& other);
+
+	// Surface interface
+	virtual	bool				draw_dab(float x, float y, float radius,
+									float colorR, float colorG, float colorB,
+									float opaque, float hardness = 0.5,
+									float alphaEraser = 1.0,
+									float aspectRatio = 1.0,
+									float angle = 0.0,
+									float lockAlpha = 0.0);
+
+	virtual	void				get_color(float x, float y, float radius,
+									float* colorR, float* colorG,
+									float* colorB, float* colorA);
+
+	// TiledSurface
+			void				MakeEmpty();
+
+	// The area of all pixels ever painted on, invalid when nothing has been
+	// painted yet.
+	inline	BRect				Bounds() const
+									{ return fBounds; }
+
+	// Returns the tile containing the pixel at tile coordinates x, y (the
+	// pixel coordinates shifted by TILE_SHIFT), or NULL if nothing has been
+	// painted there. The Bounds() of a tile are its pixel coordinates.
+			const RenderBuffer*	TileAt(int32 x, int32 y) const;
+
+	// Copies the pixels within area into buffer. Pixels without tile are
+	// cleared to transparent.
+			void				CopyTo(RenderBuffer* buffer, BRect area) const;
+
+	// The tiles changed since the last ClearDirty(), and which part of
+	// each one.
+	inline	int32				DirtyTileCount() const
+									{ return fDirtySlots.CountItems(); }
+			BRect				DirtyTileArea(int32 index) const;
+			void				ClearDirty();
+
+private:
+			struct TileKey {
+				TileKey(int32 x = 0, int32 y = 0)
+					: x(x)
+					, y(y)
+				{
+				}
+
+				bool operator==(const TileKey& other) const
+				{
+					return x == other.x && y == other.y;
+				}
+
+				size_t HashKey() const
+				{
+					// The table uses the low bits, neighbouring tiles need
+					// to spread over all of them.
+					uint32 hash = (uint32)x * 0x9e3779b1
+						^ (uint32)y * 0x85ebca77;
+					return hash ^ (hash >> 16);
+				}
+
+				int32	x;
+				int32	y;
+			};
+
+			struct Slot {
+				Slot()
+					: tile(NULL)
+					, dirty()
+				{
+				}
+
+				RenderBuffer*	tile;
+				BRect			dirty;
+			};
+
+			typedef HashMap<TileKey, Slot> SlotMap;
+
+			struct ColorSample;
+
+			Slot*				_SlotAt(int32 x, int32 y) const;
+			Slot*				_WritableSlotAt(int32 x, int32 y);
+			bool				_PrepareColorSamples(float fractionX,
+									float fractionY, float radius);
+			void				_Unset();
+
+private:
+			SlotMap				fSlots;
+
+			BRect				fBounds;
+
+			// The slots changed since the last ClearDirty().
+			BList				fDirtySlots;
+
+			// The pixels which get_color() averages, relative to the pixel
+			// containing its center, for the last radius and center
+			// fraction it was asked for.
+			ColorSample*		fColorSamples;
+			int32				fColorSampleCount;
+			int32				fColorSamplesAllocated;
+			float				fColorSampleWeight;
+			float				fColorSampleRadius;
+			float				fColorSampleFractionX;
+			float				fColorSampleFractionY;
+};
+
+#endif // TILED_SURFACE_H
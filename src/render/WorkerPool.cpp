@@ -0,0 +1,254 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#include "WorkerPool.h"
+
+#include <new>
+
+#include "AutoLocker.h"
+#include "support.h"
+
+
+// The jobs of one Run() call. It lives on the stack of the calling thread.
+struct WorkerPool::Batch {
+	Batch(JobFunction function, void* cookie, int32 count)
+		: function(function)
+		, cookie(cookie)
+		, count(count)
+		, next(0)
+		, remaining(count)
+		, doneSem(-1)
+	{
+	}
+
+	JobFunction		function;
+	void*			cookie;
+	int32			count;
+	int32			next;
+	int32			remaining;
+	// Released by the helper which finishes the last job, once the calling
+	// thread waits for it.
+	sem_id			doneSem;
+};
+
+
+WorkerPool::BusyScope::BusyScope()
+{
+	WorkerPool::Default()->BeginWork();
+}
+
+
+WorkerPool::BusyScope::~BusyScope()
+{
+	WorkerPool::Default()->EndWork();
+}
+
+
+// #pragma mark -
+
+
+WorkerPool::WorkerPool(int32 cpuCount)
+	: fLock("worker pool")
+	, fWorkSem(-1)
+	, fThreads(NULL)
+	, fThreadCount(0)
+	, fIdleThreadCount(0)
+	, fCPUCount(cpuCount > 1 ? cpuCount : 1)
+	, fBusyCount(0)
+	, fBatches(8)
+	, fQuitting(false)
+{
+	// The calling thread of Run() is always one of the threads at work.
+	if (fCPUCount == 1)
+		return;
+
+	fWorkSem = create_sem(0, "worker pool work");
+	fThreads = new(std::nothrow) thread_id[fCPUCount - 1];
+	if (fWorkSem < 0 || fThreads == NULL)
+		return;
+
+	for (int32 i = 0; i < fCPUCount - 1; i++) {
+		thread_id thread = spawn_thread(_ThreadEntry, "worker pool helper",
+			B_LOW_PRIORITY, this);
+		if (thread < 0)
+			break;
+		fThreads[fThreadCount++] = thread;
+		resume_thread(thread);
+	}
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	AutoLocker<BLocker> locker(fLock);
+	fQuitting = true;
+	if (fThreadCount > 0)
+		release_sem_etc(fWorkSem, fThreadCount, 0);
+	locker.Unlock();
+
+	for (int32 i = 0; i < fThreadCount; i++) {
+		status_t result;
+		while (wait_for_thread(fThreads[i], &result) == B_INTERRUPTED);
+	}
+
+	delete[] fThreads;
+	if (fWorkSem >= 0)
+		delete_sem(fWorkSem);
+}
+
+
+/*static*/ WorkerPool*
+WorkerPool::Default()
+{
+	// Never deleted, the threads wait for work until the process ends.
+	static WorkerPool* pool
+		= new WorkerPool(get_optimal_worker_thread_count());
+	return pool;
+}
+
+
+void
+WorkerPool::Run(JobFunction function, void* cookie, int32 count)
+{
+	if (count <= 0)
+		return;
+
+	if (count == 1 || fThreadCount == 0) {
+		for (int32 i = 0; i < count; i++)
+			function(cookie, i);
+		return;
+	}
+
+	Batch batch(function, cookie, count);
+
+	AutoLocker<BLocker> locker(fLock);
+
+	if (!fBatches.AddItem(&batch)) {
+		locker.Unlock();
+		for (int32 i = 0; i < count; i++)
+			function(cookie, i);
+		return;
+	}
+	_WakeThreads(count - 1);
+
+	while (batch.next < batch.count) {
+		int32 index = _NextJob(&batch);
+		locker.Unlock();
+
+		function(cookie, index);
+
+		locker.Lock();
+		batch.remaining--;
+	}
+
+	if (batch.remaining == 0)
+		return;
+
+	// Helpers are still at work on the last jobs.
+	batch.doneSem = create_sem(0, "worker pool batch");
+	while (batch.doneSem < 0) {
+		locker.Unlock();
+		snooze(1000);
+		locker.Lock();
+		if (batch.remaining == 0)
+			return;
+		batch.doneSem = create_sem(0, "worker pool batch");
+	}
+	locker.Unlock();
+
+	while (acquire_sem(batch.doneSem) == B_INTERRUPTED);
+	delete_sem(batch.doneSem);
+}
+
+
+void
+WorkerPool::BeginWork()
+{
+	AutoLocker<BLocker> _(fLock);
+	fBusyCount++;
+}
+
+
+void
+WorkerPool::EndWork()
+{
+	AutoLocker<BLocker> _(fLock);
+	fBusyCount--;
+	if (!fBatches.IsEmpty())
+		_WakeThreads(1);
+}
+
+
+/*static*/ status_t
+WorkerPool::_ThreadEntry(void* data)
+{
+	static_cast<WorkerPool*>(data)->_Work();
+	return B_OK;
+}
+
+
+void
+WorkerPool::_Work()
+{
+	AutoLocker<BLocker> locker(fLock);
+
+	while (!fQuitting) {
+		Batch* batch = NULL;
+		if (fBusyCount < fCPUCount)
+			batch = (Batch*)fBatches.ItemAt(0);
+
+		if (batch == NULL) {
+			// _WakeThreads() takes us out of the idle count again.
+			fIdleThreadCount++;
+			locker.Unlock();
+			while (acquire_sem(fWorkSem) == B_INTERRUPTED);
+			locker.Lock();
+			continue;
+		}
+
+		int32 index = _NextJob(batch);
+		fBusyCount++;
+		locker.Unlock();
+
+		batch->function(batch->cookie, index);
+
+		locker.Lock();
+		fBusyCount--;
+		_JobDone(batch);
+	}
+}
+
+
+// Must be called with the lock held, the batch must have jobs left.
+int32
+WorkerPool::_NextJob(Batch* batch)
+{
+	int32 index = batch->next++;
+	if (batch->next == batch->count)
+		fBatches.RemoveItem(batch);
+	return index;
+}
+
+
+// Must be called with the lock held. The batch may be gone afterwards.
+void
+WorkerPool::_JobDone(Batch* batch)
+{
+	batch->remaining--;
+	if (batch->remaining == 0 && batch->doneSem >= 0)
+		release_sem(batch->doneSem);
+}
+
+
+// Must be called with the lock held.
+void
+WorkerPool::_WakeThreads(int32 count)
+{
+	count = min_c(count, min_c(fIdleThreadCount, fCPUCount - fBusyCount));
+	if (count <= 0)
+		return;
+
+	fIdleThreadCount -= count;
+	release_sem_etc(fWorkSem, count, 0);
+}
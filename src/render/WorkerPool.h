@@ -0,0 +1,76 @@
+/*
+ * Copyright 2018 Stephan Aßmus <superstippi@gmx.de>
+ * All rights reserved. Distributed under the terms of the MIT License.
+ */
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <List.h>
+#include <Locker.h>
+#include <OS.h>
+
+// A process wide pool of helper threads for operations which are split into
+// jobs, like the passes of a blur or the layout of independent sub-layers.
+// The threads are created once and wait for work.
+//
+// The thread calling Run() takes part and does all the jobs no helper has
+// picked up, so it never waits for a helper to become free, and nested
+// Run() calls can not deadlock. Helpers only pick up jobs while fewer
+// threads are busy than there are CPUs. Threads outside of the pool which
+// keep a CPU busy, like the render threads, report that with BeginWork()
+// and EndWork(). A blur within one of several busy render threads then
+// runs on that thread alone instead of oversubscribing the CPUs.
+//
+// A WorkerPool is thread-safe.
+class WorkerPool {
+public:
+	typedef void (*JobFunction)(void* cookie, int32 index);
+
+	// Reports the calling thread as busy to the default pool for its
+	// lifetime.
+	class BusyScope {
+	public:
+								BusyScope();
+								~BusyScope();
+	};
+
+								WorkerPool(int32 cpuCount);
+								~WorkerPool();
+
+	static	WorkerPool*			Default();
+
+	// The most threads which work on the jobs of a Run() at the same time,
+	// including the calling thread.
+			int32				CountCPUs() const
+									{ return fCPUCount; }
+
+	// Calls function(cookie, index) for every index from 0 to count - 1,
+	// and returns when all calls have returned.
+			void				Run(JobFunction function, void* cookie,
+									int32 count);
+
+			void				BeginWork();
+			void				EndWork();
+
+private:
+			struct Batch;
+
+	static	status_t			_ThreadEntry(void* data);
+			void				_Work();
+
+			int32				_NextJob(Batch* batch);
+			void				_JobDone(Batch* batch);
+			void				_WakeThreads(int32 count);
+
+			BLocker				fLock;
+			sem_id				fWorkSem;
+			thread_id*			fThreads;
+			int32				fThreadCount;
+			int32				fIdleThreadCount;
+			int32				fCPUCount;
+			int32				fBusyCount;
+			BList				fBatches;
+			bool				fQuitting;
+};
+
+#endif // WORKER_POOL_H
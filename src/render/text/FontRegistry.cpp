@@ -10,18 +10,24 @@
 #include <malloc.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <ft2build.h>
 #include FT_SFNT_NAMES_H
 #include <freetype/ttnameid.h>
 
 #include <Directory.h>
+#include <File.h>
 //#include <Menu.h>
 //#include <MenuItem.h>
+#include <Message.h>
 #include <Path.h>
 #include <String.h>
 
 //#include "common.h"
+#include "HashMap.h"
+#include "HashString.h"
 #include "support.h"
 
 //#include "FontPopup.h"
@@ -34,14 +40,47 @@ static const char* threadName = "font scanner";
 
 enum {
 	MSG_UPDATE			= 'updt',
+	MSG_FONT_INDEX		= 'fidx',
 };
 
+// Bump when the information extracted from font files changes, so that old
+// indices are not used anymore.
+static const int32 kFontIndexVersion = 1;
+
+// Files which are new or changed since the last scan are opened by several
+// threads, each with its own FreeType library instance.
+static const int32 kMaxScanThreads = 8;
+static const int32 kMinFilesPerScanThread = 32;
+
+
+class FontRegistry::FontFileMap : public HashMap<HashString, font_file*> {
+};
+
+
+struct FontRegistry::scan_job {
+	const FontRegistry*	registry;
+	const BList*		files;
+	vint32				next;
+};
+
+
+static inline HashString
+family_style_key(const char* family, const char* style)
+{
+	BString key(family);
+	key << '\t' << style;
+	return HashString(key.String());
+}
+
 // constructor
 FontRegistry::FontRegistry()
 	: BLooper(threadName, B_LOW_PRIORITY)
 	, fLibrary(NULL)
 	, fFontDirectories(4)
 	, fFontFiles(1024)
+	, fPathMap(new FontFileMap())
+	, fFamilyStyleMap(new FontFileMap())
+	, fScanning(0)
 {
 	// initialize engine
 	FT_Error error = FT_Init_FreeType(&fLibrary);
@@ -58,6 +97,9 @@ FontRegistry::~FontRegistry()
 
 	for (int32 i = 0; i < fFontDirectories.CountItems(); i++)
 		delete (BString*)fFontDirectories.ItemAtFast(i);
+
+	delete fPathMap;
+	delete fFamilyStyleMap;
 }
 
 // MessageReceived
@@ -121,11 +163,16 @@ FontRegistry::AddFontDirectory(const char* path)
 void
 FontRegistry::Scan()
 {
+	if (atomic_test_and_set(&fScanning, 1, 0) != 0)
+		return;
+
 	// start thread to scan font files
 	thread_id fontScanner = spawn_thread(_UpdateThreadEntry, threadName,
 		B_LOW_PRIORITY, this);
 	if (fontScanner >= 0)
 		resume_thread(fontScanner);
+	else
+		atomic_set(&fScanning, 0);
 }
 
 // FontFileAt
@@ -145,13 +192,8 @@ FontRegistry::FontFileFor(const char* family, const char* style) const
 	if (!family || !style)
 		return NULL;
 
-	int32 count = fFontFiles.CountItems();
-	for (int32 i = 0; i < count; i++) {
-		font_file* ff = (font_file*)fFontFiles.ItemAtFast(i);
-		if (ff->family_name && strcmp(ff->family_name, family) == 0
-			&& ff->style_name && strcmp(ff->style_name, style) == 0)
-			return ff->path.String();
-	}
+	if (font_file* ff = fFamilyStyleMap->Get(family_style_key(family, style)))
+		return ff->path.String();
 
 //	BString missing(family);
 //	missing << '/' << style;
@@ -169,13 +211,9 @@ FontRegistry::IndexFor(const char* family, const char* style) const
 {
 	if (!family || !style)
 		return -1;
-	int32 count = fFontFiles.CountItems();
-	for (int32 i = 0; i < count; i++) {
-		font_file* ff = (font_file*)fFontFiles.ItemAtFast(i);
-		if (ff->family_name && strcmp(ff->family_name, family) == 0
-			&& ff->style_name && strcmp(ff->style_name, style) == 0)
-			return i;
-	}
+
+	if (font_file* ff = fFamilyStyleMap->Get(family_style_key(family, style)))
+		return ff->index;
 	return -1;
 }
 
@@ -330,12 +368,17 @@ FontRegistry::_MakeEmpty()
 		i--;
 	}
 	fFontFiles.MakeEmpty();
+	fPathMap->Clear();
+	fFamilyStyleMap->Clear();
 }
 
 // _DeleteFontFile
 void
 FontRegistry::_DeleteFontFile(font_file* ff) const
 {
+	if (ff == NULL)
+		return;
+
 	free(ff->family_name);
 	free(ff->style_name);
 	free(ff->full_family_name);
@@ -348,26 +391,102 @@ int32
 FontRegistry::_UpdateThreadEntry(void* cookie)
 {
 	FontRegistry* registry = (FontRegistry*)cookie;
-	if (registry != NULL && registry->Lock()) {
+	if (registry != NULL) {
 //bigtime_t now = system_time();
-		for (int32 i = 0; i < registry->fFontDirectories.CountItems(); i++) {
-			BString* path = (BString*)registry->fFontDirectories.ItemAtFast(i);
-			BDirectory fontFolder(path->String());
-			registry->_Update(&fontFolder);
-		}
-/*printf("scanning fonts: %lld µsecs\n", system_time() - now);
-for (int32 i = 0; font_file* ff = (font_file*)fFontFiles.ItemAt(i); i++) {
-	printf("font %ld: \"%s, %s\"\n", i, ff->family_name, ff->style_name);
-}*/
-		registry->Unlock();
+		registry->_Update();
+//printf("scanning fonts: %lld µsecs\n", system_time() - now);
+		atomic_set(&registry->fScanning, 0);
 		registry->PostMessage(MSG_UPDATE, registry);
 	}
 	return 0;
 }
 
-//_Update
+// _Update
+void
+FontRegistry::_Update()
+{
+	// The registry is only locked at the very end to publish the new
+	// font list, so that font lookups are not blocked by the scan.
+	BList directories;
+	if (!Lock())
+		return;
+	for (int32 i = 0; i < fFontDirectories.CountItems(); i++) {
+		BString* path = new(std::nothrow) BString(
+			*(BString*)fFontDirectories.ItemAtFast(i));
+		if (path != NULL && !directories.AddItem(path))
+			delete path;
+	}
+	Unlock();
+
+	FontFileMap indexedFiles;
+	_LoadIndex(indexedFiles);
+
+	// Collect all files, reusing the indexed information of files which
+	// have not changed since.
+	BList files(1024);
+	BList changedFiles;
+	for (int32 i = 0; i < directories.CountItems(); i++) {
+		BString* path = (BString*)directories.ItemAtFast(i);
+		BDirectory fontFolder(path->String());
+		_CollectFiles(&fontFolder, indexedFiles, files, changedFiles);
+		delete path;
+	}
+
+	// What is left in the index belongs to files which have been removed.
+	bool indexChanged = changedFiles.CountItems() > 0
+		|| indexedFiles.Size() > 0;
+	FontFileMap::Iterator iterator = indexedFiles.GetIterator();
+	while (iterator.HasNext())
+		_DeleteFontFile(iterator.Next().value);
+	indexedFiles.Clear();
+
+	_ScanFiles(changedFiles);
+
+	if (indexChanged)
+		_SaveIndex(files);
+
+	// Only usable font files are kept, sorted by family and style. For
+	// duplicates, the first one found wins.
+	BList fontFiles(files.CountItems());
+	for (int32 i = 0; i < files.CountItems(); i++) {
+		font_file* ff = (font_file*)files.ItemAtFast(i);
+		ff->scan_order = i;
+		if (ff->family_name == NULL || ff->style_name == NULL
+			|| !fontFiles.AddItem(ff)) {
+			_DeleteFontFile(ff);
+		}
+	}
+	fontFiles.SortItems(_CompareFontFiles);
+
+	int32 count = 0;
+	font_file* previous = NULL;
+	for (int32 i = 0; i < fontFiles.CountItems(); i++) {
+		font_file* ff = (font_file*)fontFiles.ItemAtFast(i);
+		if (previous != NULL
+			&& strcasecmp(ff->family_name, previous->family_name) == 0
+			&& strcasecmp(ff->style_name, previous->style_name) == 0) {
+			_DeleteFontFile(ff);
+			continue;
+		}
+		fontFiles.ReplaceItem(count++, ff);
+		previous = ff;
+	}
+	while (fontFiles.CountItems() > count)
+		fontFiles.RemoveItem(fontFiles.CountItems() - 1);
+
+	if (Lock()) {
+		_SetFontFiles(fontFiles);
+		Unlock();
+	} else {
+		for (int32 i = 0; i < fontFiles.CountItems(); i++)
+			_DeleteFontFile((font_file*)fontFiles.ItemAtFast(i));
+	}
+}
+
+// _CollectFiles
 void
-FontRegistry::_Update(BDirectory* fontFolder)
+FontRegistry::_CollectFiles(BDirectory* fontFolder, FontFileMap& indexedFiles,
+	BList& files, BList& changedFiles) const
 {
 	fontFolder->Rewind();
 	// scan the entire folder for font files
@@ -376,16 +495,108 @@ FontRegistry::_Update(BDirectory* fontFolder)
 		if (entry.IsDirectory()) {
 			// recursive scan of sub folders
 			BDirectory subFolder(&entry);
-//entry_ref ref;
-//entry.GetRef(&ref);
-//printf("scanning subfolder: %s\n", ref.name);
-			_Update(&subFolder);
-		} else {
-			_AddFont(entry);
+			_CollectFiles(&subFolder, indexedFiles, files, changedFiles);
+			continue;
+		}
+
+		BPath path;
+		struct stat st;
+		if (entry.GetPath(&path) < B_OK || stat(path.Path(), &st) != 0)
+			continue;
+
+		HashString key(path.Path());
+		font_file* ff = indexedFiles.Get(key);
+		if (ff != NULL) {
+			indexedFiles.Remove(key);
+			if (ff->modification_time == (int64)st.st_mtime
+				&& ff->size == (int64)st.st_size) {
+				if (!files.AddItem(ff))
+					_DeleteFontFile(ff);
+				continue;
+			}
+			_DeleteFontFile(ff);
 		}
+
+		ff = new(std::nothrow) font_file;
+		if (ff == NULL)
+			continue;
+		ff->family_name = NULL;
+		ff->style_name = NULL;
+		ff->full_family_name = NULL;
+		ff->ps_name = NULL;
+		ff->path = path.Path();
+		ff->modification_time = st.st_mtime;
+		ff->size = st.st_size;
+		ff->scan_order = 0;
+		ff->index = -1;
+
+		if (!files.AddItem(ff)) {
+			_DeleteFontFile(ff);
+			continue;
+		}
+		changedFiles.AddItem(ff);
 	}
 }
 
+// _ScanFiles
+void
+FontRegistry::_ScanFiles(const BList& files) const
+{
+	int32 count = files.CountItems();
+	if (count == 0)
+		return;
+
+	scan_job job;
+	job.registry = this;
+	job.files = &files;
+	job.next = 0;
+
+	int32 threadCount = min_c(get_optimal_worker_thread_count(),
+		min_c(count / kMinFilesPerScanThread + 1, kMaxScanThreads));
+
+	// The calling thread scans, too.
+	thread_id threads[kMaxScanThreads];
+	for (int32 i = 1; i < threadCount; i++) {
+		threads[i] = spawn_thread(_ScanThreadEntry, "font file scanner",
+			B_LOW_PRIORITY, &job);
+		if (threads[i] >= 0 && resume_thread(threads[i]) != B_OK)
+			threads[i] = -1;
+	}
+
+	_ScanThreadEntry(&job);
+
+	for (int32 i = 1; i < threadCount; i++) {
+		if (threads[i] < 0)
+			continue;
+		status_t result;
+		while (wait_for_thread(threads[i], &result) == B_INTERRUPTED);
+	}
+}
+
+// _ScanThreadEntry
+int32
+FontRegistry::_ScanThreadEntry(void* cookie)
+{
+	scan_job* job = (scan_job*)cookie;
+
+	// A FreeType library instance must not be used by several threads.
+	FT_Library library;
+	if (FT_Init_FreeType(&library) != 0)
+		return B_ERROR;
+
+	int32 count = job->files->CountItems();
+	while (true) {
+		int32 index = atomic_add(&job->next, 1);
+		if (index >= count)
+			break;
+		job->registry->_ScanFontFile(library,
+			(font_file*)job->files->ItemAtFast(index));
+	}
+
+	FT_Done_FreeType(library);
+	return B_OK;
+}
+
 // _ExtractFontNames
 void
 FontRegistry::_ExtractFontNames(FT_Face face, font_file* fontFile,
@@ -523,65 +734,189 @@ FontRegistry::_ImproveStyleNameFromPostScriptName(font_file* fontFile) const
 	}
 }
 
-// _AddFont
+// _ScanFontFile
 void
-FontRegistry::_AddFont(const BEntry& entry)
+FontRegistry::_ScanFontFile(FT_Library library, font_file* fontFile) const
 {
 	// see if this is a usable font file
-	BPath path;
-	if (entry.GetPath(&path) < B_OK)
-		return;
-
 	FT_Face face;
-	FT_Error error = FT_New_Face(fLibrary, path.Path(), 0, &face);
+	FT_Error error = FT_New_Face(library, fontFile->path.String(), 0, &face);
 	if (error || !face->family_name || !face->style_name) {
 		if (!error)
 			FT_Done_Face(face);
 		return;
 	}
 
-	// create font_file object and init it
-	font_file* fontFile = new font_file;
-	fontFile->path = path.Path();
 	fontFile->family_name = strdup(face->family_name);
 	fontFile->style_name = strdup(face->style_name);
-	fontFile->full_family_name = NULL;
-	fontFile->ps_name = strdup(FT_Get_Postscript_Name(face));
+	const char* psName = FT_Get_Postscript_Name(face);
+	if (psName != NULL)
+		fontFile->ps_name = strdup(psName);
 	// iterate over the names we find for this font face
 	int32 nameCount = FT_Get_Sfnt_Name_Count(face);
 	if (nameCount == 0) {
-		_ImproveStyleNameFromPostScriptName(fontFile);
+		if (fontFile->ps_name != NULL)
+			_ImproveStyleNameFromPostScriptName(fontFile);
 	} else {
 		_ExtractFontNames(face, fontFile, nameCount);
 	}
-	// find slot in sorted list and add it
-	int32 index = 0;
-	bool duplicate = false;
-	font_file* ff;
-	while ((ff = (font_file*)fFontFiles.ItemAt(index))
-		   && strcasecmp(fontFile->family_name, ff->family_name) >= 0) {
-		if (strcasecmp(fontFile->family_name, ff->family_name) == 0) {
-			while ((ff = (font_file*)fFontFiles.ItemAt(index))
-				   && strcasecmp(fontFile->family_name, ff->family_name) == 0
-				   && strcasecmp(fontFile->style_name, ff->style_name) >= 0) {
-				if (strcasecmp(fontFile->style_name, ff->style_name) == 0) {
-					duplicate = true;
-					break;
-				} else
-				   index++;
-			}
+
+	FT_Done_Face(face);
+}
+
+// _CompareFontFiles
+/*static*/ int
+FontRegistry::_CompareFontFiles(const void* _a, const void* _b)
+{
+	const font_file* a = *(const font_file**)_a;
+	const font_file* b = *(const font_file**)_b;
+
+	int result = strcasecmp(a->family_name, b->family_name);
+	if (result == 0)
+		result = strcasecmp(a->style_name, b->style_name);
+	if (result == 0)
+		result = a->scan_order - b->scan_order;
+	return result;
+}
+
+// _SetFontFiles
+void
+FontRegistry::_SetFontFiles(BList& files)
+{
+	_MakeEmpty();
+
+	if (!fFontFiles.AddList(&files)) {
+		for (int32 i = 0; i < files.CountItems(); i++)
+			_DeleteFontFile((font_file*)files.ItemAtFast(i));
+		return;
+	}
+
+	for (int32 i = 0; i < fFontFiles.CountItems(); i++) {
+		font_file* ff = (font_file*)fFontFiles.ItemAtFast(i);
+		ff->index = i;
+		fPathMap->Put(HashString(ff->path.String()), ff);
+		fFamilyStyleMap->Put(family_style_key(ff->family_name, ff->style_name),
+			ff);
+	}
+}
+
+// _IndexPath
+status_t
+FontRegistry::_IndexPath(BString& path) const
+{
+	status_t status = get_cache_directory("fonts", path);
+	if (status == B_OK)
+		path << "/index";
+	return status;
+}
+
+// _LoadIndex
+void
+FontRegistry::_LoadIndex(FontFileMap& indexedFiles) const
+{
+	BString path;
+	if (_IndexPath(path) != B_OK)
+		return;
+
+	BFile file(path.String(), B_READ_ONLY);
+	BMessage index;
+	int32 version;
+	if (file.InitCheck() != B_OK || index.Unflatten(&file) != B_OK
+		|| index.what != MSG_FONT_INDEX
+		|| index.FindInt32("version", &version) != B_OK
+		|| version != kFontIndexVersion) {
+		return;
+	}
+
+	const char* filePath;
+	for (int32 i = 0; index.FindString("path", i, &filePath) == B_OK; i++) {
+		int64 modificationTime;
+		int64 size;
+		const char* family;
+		const char* style;
+		const char* fullFamily;
+		const char* psName;
+		if (index.FindInt64("mtime", i, &modificationTime) != B_OK
+			|| index.FindInt64("size", i, &size) != B_OK
+			|| index.FindString("family", i, &family) != B_OK
+			|| index.FindString("style", i, &style) != B_OK
+			|| index.FindString("full family", i, &fullFamily) != B_OK
+			|| index.FindString("ps name", i, &psName) != B_OK) {
+			break;
+		}
+
+		font_file* ff = new(std::nothrow) font_file;
+		if (ff == NULL)
 			break;
-	   }
-	   index++;
+		// Files which are no usable fonts are indexed without names, so
+		// they are not opened again either.
+		bool usable = family[0] != '\0' && style[0] != '\0';
+		ff->family_name = usable ? strdup(family) : NULL;
+		ff->style_name = usable ? strdup(style) : NULL;
+		ff->full_family_name = fullFamily[0] != '\0' ? strdup(fullFamily)
+			: NULL;
+		ff->ps_name = psName[0] != '\0' ? strdup(psName) : NULL;
+		ff->path = filePath;
+		ff->modification_time = modificationTime;
+		ff->size = size;
+		ff->scan_order = 0;
+		ff->index = -1;
+
+		HashString key(filePath);
+		_DeleteFontFile(indexedFiles.Get(key));
+		if (indexedFiles.Put(key, ff) != B_OK)
+			_DeleteFontFile(ff);
 	}
+}
 
-	if (!duplicate) {
-		fFontFiles.AddItem(fontFile, index);
-	} else {
-		_DeleteFontFile(fontFile);
+// _SaveIndex
+void
+FontRegistry::_SaveIndex(const BList& files) const
+{
+	BString path;
+	if (_IndexPath(path) != B_OK)
+		return;
+
+	BMessage index(MSG_FONT_INDEX);
+	status_t status = index.AddInt32("version", kFontIndexVersion);
+	for (int32 i = 0; status == B_OK && i < files.CountItems(); i++) {
+		const font_file* ff = (const font_file*)files.ItemAtFast(i);
+		bool usable = ff->family_name != NULL && ff->style_name != NULL;
+		status = index.AddString("path", ff->path);
+		if (status == B_OK)
+			status = index.AddInt64("mtime", ff->modification_time);
+		if (status == B_OK)
+			status = index.AddInt64("size", ff->size);
+		if (status == B_OK)
+			status = index.AddString("family", usable ? ff->family_name : "");
+		if (status == B_OK)
+			status = index.AddString("style", usable ? ff->style_name : "");
+		if (status == B_OK) {
+			status = index.AddString("full family",
+				ff->full_family_name != NULL ? ff->full_family_name : "");
+		}
+		if (status == B_OK) {
+			status = index.AddString("ps name",
+				ff->ps_name != NULL ? ff->ps_name : "");
+		}
 	}
+	if (status != B_OK)
+		return;
 
-	FT_Done_Face(face);
+	// The index is written next to the old one and then moved into place,
+	// so that it is never read while only partially written.
+	BString tempPath(path);
+	tempPath << ".tmp";
+
+	BFile file(tempPath.String(),
+		B_WRITE_ONLY | B_CREATE_FILE | B_ERASE_FILE);
+	status = file.InitCheck();
+	if (status == B_OK)
+		status = index.Flatten(&file);
+	file.Unset();
+
+	if (status != B_OK || rename(tempPath.String(), path.String()) != 0)
+		unlink(tempPath.String());
 }
 
 
@@ -592,12 +927,5 @@ FontRegistry::_FontFileFor(const char* path) const
 	if (path == NULL)
 		return NULL;
 
-	int32 count = fFontFiles.CountItems();
-	for (int32 i = 0; i < count; i++) {
-		font_file* ff = (font_file*)fFontFiles.ItemAtFast(i);
-		if (ff->path == path)
-			return ff;
-	}
-
-	return NULL;
+	return fPathMap->Get(HashString(path));
 }
@@ -41,6 +41,7 @@ public:
 
 
 			bool				AddFontDirectory(const char* path);
+								// does nothing while a scan is running
 			void				Scan();
 
 								// lock the object!
@@ -74,17 +75,40 @@ private:
 		char*			full_family_name;
 		char*			ps_name;
 		BString			path;
+		int64			modification_time;
+		int64			size;
+		int32			scan_order;
+		int32			index;
 	};
 
+	// Defined in the implementation, since the HashMap does not go along
+	// with other hash table implementations in the same file.
+	class FontFileMap;
+
+	struct scan_job;
+
 			void				_MakeEmpty();
 	static	int32				_UpdateThreadEntry(void* cookie);
-			void				_Update(BDirectory* fontFolder);
-			void				_AddFont(const BEntry& entry);
+			void				_Update();
+			void				_CollectFiles(BDirectory* fontFolder,
+									FontFileMap& indexedFiles, BList& files,
+									BList& changedFiles) const;
+			void				_ScanFiles(const BList& files) const;
+	static	int32				_ScanThreadEntry(void* cookie);
+			void				_ScanFontFile(FT_Library library,
+									font_file* fontFile) const;
 			void				_ExtractFontNames(FT_Face face,
 									font_file* fontFile,
 									int32 nameCount) const;
 			void				_ImproveStyleNameFromPostScriptName(
 									font_file* fontFile) const;
+	static	int					_CompareFontFiles(const void* a,
+									const void* b);
+			void				_SetFontFiles(BList& files);
+
+			status_t			_IndexPath(BString& path) const;
+			void				_LoadIndex(FontFileMap& indexedFiles) const;
+			void				_SaveIndex(const BList& files) const;
 
 			void				_DeleteFontFile(font_file* fontFile) const;
 
@@ -94,6 +118,9 @@ private:
 			FT_Library			fLibrary;			// the FreeType library
 			BList				fFontDirectories;
 			BList				fFontFiles;
+			FontFileMap*		fPathMap;
+			FontFileMap*		fFamilyStyleMap;
+			vint32				fScanning;
 	static	FontRegistry*		sDefaultRegistry;
 };
 
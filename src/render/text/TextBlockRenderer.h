@@ -92,7 +92,7 @@ class TextBlockRenderer {
 	FontCacheEntry::CurveConverter		fCurves;
 	FontCacheEntry::ContourConverter	fContour;
 
-	agg::scanline_u8			fScanline;
+	agg::scanline32_u8			fScanline;
 
 	char*						fUnicodeBuffer;
 	int32						fUnicodeBufferSize;
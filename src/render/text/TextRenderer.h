@@ -71,7 +71,7 @@ class TextRenderer {
 	FontCacheEntry::CurveConverter		fCurves;
 	FontCacheEntry::ContourConverter	fContour;
 
-	agg::scanline_u8			fScanline;
+	agg::scanline32_u8			fScanline;
 
 	char*						fUnicodeBuffer;
 	int32						fUnicodeBufferSize;
@@ -0,0 +1,153 @@
+# Sources of the document model and of the rendering, shared by the
+# application and wb_bench.
+
+SOURCES += \
+	$$PWD/model/property/CommonPropertyIDs.cpp \
+	$$PWD/model/BaseObject.cpp \
+	$$PWD/model/CurrentColor.cpp \
+	$$PWD/model/Selectable.cpp \
+	$$PWD/model/Selection.cpp \
+	$$PWD/model/document/Document.cpp \
+	$$PWD/model/fills/Brush.cpp \
+	$$PWD/model/fills/Color.cpp \
+	$$PWD/model/fills/Gradient.cpp \
+	$$PWD/model/fills/Paint.cpp \
+	$$PWD/model/fills/StrokeProperties.cpp \
+	$$PWD/model/fills/Style.cpp \
+	$$PWD/model/objects/BoundedObject.cpp \
+	$$PWD/model/objects/BrushStroke.cpp \
+	$$PWD/model/objects/DirtyAreaExtentTree.cpp \
+	$$PWD/model/objects/Filter.cpp \
+	$$PWD/model/objects/FilterDenoise.cpp \
+	$$PWD/model/objects/Image.cpp \
+	$$PWD/model/objects/Layer.cpp \
+	$$PWD/model/objects/LayerObserver.cpp \
+	$$PWD/model/objects/MyPaintStroke.cpp \
+	$$PWD/model/objects/Object.cpp \
+	$$PWD/model/objects/Rect.cpp \
+	$$PWD/model/objects/Shape.cpp \
+	$$PWD/model/objects/Stroke.cpp \
+	$$PWD/model/objects/Styleable.cpp \
+	$$PWD/model/objects/Text.cpp \
+	$$PWD/model/property/Property.cpp \
+	$$PWD/model/property/PropertyObject.cpp \
+	$$PWD/model/property/PropertyObjectProperty.cpp \
+	$$PWD/model/property/specific_properties/ColorProperty.cpp \
+	$$PWD/model/property/specific_properties/IconProperty.cpp \
+	$$PWD/model/property/specific_properties/Int64Property.cpp \
+	$$PWD/model/property/specific_properties/OptionProperty.cpp \
+	$$PWD/model/snapshots/BrushStrokeSnapshot.cpp \
+	$$PWD/model/snapshots/FilterColorSnapshot.cpp \
+	$$PWD/model/snapshots/FilterDenoiseSnapshot.cpp \
+	$$PWD/model/snapshots/FilterSnapshot.cpp \
+	$$PWD/model/snapshots/ImageSnapshot.cpp \
+	$$PWD/model/snapshots/LayerSnapshot.cpp \
+	$$PWD/model/snapshots/MyPaintStrokeSnapshot.cpp \
+	$$PWD/model/snapshots/ObjectSnapshot.cpp \
+	$$PWD/model/snapshots/RectSnapshot.cpp \
+	$$PWD/model/snapshots/ShapeSnapshot.cpp \
+	$$PWD/model/snapshots/StyleableSnapshot.cpp \
+	$$PWD/model/snapshots/TextSnapshot.cpp \
+	$$PWD/model/text/CharacterStyle.cpp \
+	$$PWD/model/text/Font.cpp \
+	$$PWD/model/text/StyleRun.cpp \
+	$$PWD/model/text/StyleRunList.cpp \
+	$$PWD/platform/qt/platform_bitmap_support.cpp \
+	$$PWD/platform/qt/platform_support.cpp \
+	$$PWD/platform/qt/platform_support_ui.cpp \
+	$$PWD/platform/qt/PlatformMessageEvent.cpp \
+	$$PWD/platform/qt/PlatformMimeDataManager.cpp \
+	$$PWD/platform/qt/PlatformResourceBundle.cpp \
+	$$PWD/platform/qt/PlatformSemaphoreManager.cpp \
+	$$PWD/platform/qt/PlatformSignalMessageAdapter.cpp \
+	$$PWD/platform/qt/PlatformThread.cpp \
+	$$PWD/platform/qt/system/BApplication.cpp \
+	$$PWD/platform/qt/system/ArchivingManagers.cpp \
+	$$PWD/platform/qt/system/BAlignment.cpp \
+	$$PWD/platform/qt/system/BAppDefs.cpp \
+	$$PWD/platform/qt/system/BArchivable.cpp \
+	$$PWD/platform/qt/system/BBitmap.cpp \
+	$$PWD/platform/qt/system/BByteOrder.cpp \
+	$$PWD/platform/qt/system/BControl.cpp \
+	$$PWD/platform/qt/system/BCursor.cpp \
+	$$PWD/platform/qt/system/BDataIO.cpp \
+	$$PWD/platform/qt/system/BDirectory.cpp \
+	$$PWD/platform/qt/system/BEntry.cpp \
+	$$PWD/platform/qt/system/BFile.cpp \
+	$$PWD/platform/qt/system/BFlattenable.cpp \
+	$$PWD/platform/qt/system/BGradient.cpp \
+	$$PWD/platform/qt/system/BGraphicsDefs.cpp \
+	$$PWD/platform/qt/system/BInterfaceDefs.cpp \
+	$$PWD/platform/qt/system/BInvoker.cpp \
+	$$PWD/platform/qt/system/BHandler.cpp \
+	$$PWD/platform/qt/system/BLayoutUtils.cpp \
+	$$PWD/platform/qt/system/BList.cpp \
+	$$PWD/platform/qt/system/BLocker.cpp \
+	$$PWD/platform/qt/system/BLooper.cpp \
+	$$PWD/platform/qt/system/BMessage.cpp \
+	$$PWD/platform/qt/system/BMessageAdapter.cpp \
+	$$PWD/platform/qt/system/BMessageFilter.cpp \
+	$$PWD/platform/qt/system/BMessageRunner.cpp \
+	$$PWD/platform/qt/system/BMessageUtils.cpp \
+	$$PWD/platform/qt/system/BMessenger.cpp \
+	$$PWD/platform/qt/system/BOS.cpp \
+	$$PWD/platform/qt/system/BPath.cpp \
+	$$PWD/platform/qt/system/BPoint.cpp \
+	$$PWD/platform/qt/system/BPointerList.cpp \
+	$$PWD/platform/qt/system/BRect.cpp \
+	$$PWD/platform/qt/system/BRegion.cpp \
+	$$PWD/platform/qt/system/BRegionSupport.cpp \
+	$$PWD/platform/qt/system/BResources.cpp \
+	$$PWD/platform/qt/system/BShape.cpp \
+	$$PWD/platform/qt/system/BSize.cpp \
+	$$PWD/platform/qt/system/BScreen.cpp \
+	$$PWD/platform/qt/system/BString.cpp \
+	$$PWD/platform/qt/system/BTranslationUtils.cpp \
+	$$PWD/platform/qt/system/BView.cpp \
+	$$PWD/platform/qt/system/BWindow.cpp \
+	$$PWD/render/BufferPool.cpp \
+	$$PWD/render/DenoiseFilter.cpp \
+	$$PWD/render/FontCache.cpp \
+	$$PWD/render/GaussFilter.cpp \
+	$$PWD/render/GradientSpanGenerator.cpp \
+	$$PWD/render/GlyphCoverageCache.cpp \
+	$$PWD/render/LayoutContext.cpp \
+	$$PWD/render/LayoutState.cpp \
+	$$PWD/render/MyPaintBrush.cpp \
+	$$PWD/render/Path.cpp \
+	$$PWD/render/RenderBuffer.cpp \
+	$$PWD/render/RenderEngine.cpp \
+	$$PWD/render/RenderTrace.cpp \
+	$$PWD/render/ScratchArena.cpp \
+	$$PWD/render/StackBlurFilter.cpp \
+	$$PWD/render/TextLayout.cpp \
+	$$PWD/render/TextRenderer.cpp \
+	$$PWD/render/TiledSurface.cpp \
+	$$PWD/render/VertexSource.cpp \
+	$$PWD/render/WorkerPool.cpp \
+	$$PWD/render/text/FontRegistry.cpp \
+	$$PWD/support/AbstractLOAdapter.cpp \
+	$$PWD/support/Debug.cpp \
+	$$PWD/support/HashString.cpp \
+	$$PWD/support/Listener.cpp \
+	$$PWD/support/ListenerAdapter.cpp \
+	$$PWD/support/Notifier.cpp \
+	$$PWD/support/ObjectTracker.cpp \
+	$$PWD/support/Referenceable.cpp \
+	$$PWD/support/RWLocker.cpp \
+	$$PWD/support/support.cpp \
+	$$PWD/support/support_ui.cpp \
+	$$PWD/support/Transformable.cpp
+
+# Compile the application resources into a resource bundle which is linked
+# into every target using these sources, platform_support.cpp loads it (see
+# PlatformResourceBundle).
+RESOURCE_COMPILER = $$shadowed($$PWD)/platform/qt/rescompiler/rescompiler
+APP_RESOURCES = $$PWD/WonderBrush.rdef
+
+app_resources.input = APP_RESOURCES
+app_resources.output = ${QMAKE_FILE_BASE}_resources.cpp
+app_resources.commands = $$RESOURCE_COMPILER ${QMAKE_FILE_IN} ${QMAKE_FILE_OUT}
+app_resources.depends = $$RESOURCE_COMPILER
+app_resources.variable_out = SOURCES
+QMAKE_EXTRA_COMPILERS += app_resources
@@ -23,6 +23,7 @@ INCLUDEPATH += icon/include
 #INCLUDEPATH += render
 #INCLUDEPATH += support
 
+QMAKE_CXXFLAGS += -iquote $$PWD/brushlib
 QMAKE_CXXFLAGS += -iquote $$PWD/edits
 QMAKE_CXXFLAGS += -iquote $$PWD/edits/base
 QMAKE_CXXFLAGS += -iquote $$PWD/gui
@@ -58,10 +59,6 @@ QMAKE_CXXFLAGS += -iquote $$PWD/tools/transform/qt
 LIBS += -Lagg -lagg -Lgui/colorpicker -lcolorpicker \
 	-Lgui/scrollview -lscrollview -Licon -licon -ldl -lfreetype
 
-# Weirdly we need to explicitly add libX11, since otherwise the linker complains
-# about symbol XGetWindowAttributes not being defined.
-LIBS += -lX11
-
 TARGETDEPS += agg/libagg.a gui/colorpicker/libcolorpicker.a icon/libicon.a \
 	gui/scrollview/libscrollview.a
 
@@ -74,6 +71,7 @@ SOURCES += \
         edits/base/UndoableEdit.cpp \
         gui/CanvasView.cpp \
 	gui/ToolConfigView.cpp \
+	gui/misc/IconCache.cpp \
 	gui/misc/NavigatorView.cpp \
 	gui/misc/Panel.cpp \
 	gui/misc/SwatchGroup.cpp \
@@ -92,129 +90,9 @@ SOURCES += \
 	gui/tools/qt/BrushToolConfigView.cpp \
 	gui/tools/qt/TextToolConfigView.cpp \
 	gui/tools/qt/TransformToolConfigView.cpp \
-	model/property/CommonPropertyIDs.cpp \
-	model/BaseObject.cpp \
-	model/CurrentColor.cpp \
-	model/Selectable.cpp \
-	model/Selection.cpp \
-	model/document/Document.cpp \
-	model/fills/Brush.cpp \
-	model/fills/Color.cpp \
-	model/fills/Gradient.cpp \
-	model/fills/Paint.cpp \
-	model/fills/StrokeProperties.cpp \
-	model/fills/Style.cpp \
-	model/objects/BoundedObject.cpp \
-	model/objects/BrushStroke.cpp \
-	model/objects/Filter.cpp \
-	model/objects/Image.cpp \
-	model/objects/Layer.cpp \
-	model/objects/LayerObserver.cpp \
-	model/objects/Object.cpp \
-	model/objects/Rect.cpp \
-	model/objects/Shape.cpp \
-	model/objects/Styleable.cpp \
-	model/objects/Text.cpp \
-	model/property/Property.cpp \
-	model/property/PropertyObject.cpp \
-	model/property/PropertyObjectProperty.cpp \
-	model/property/specific_properties/ColorProperty.cpp \
-	model/property/specific_properties/IconProperty.cpp \
-	model/property/specific_properties/Int64Property.cpp \
-	model/property/specific_properties/OptionProperty.cpp \
-	model/snapshots/BrushStrokeSnapshot.cpp \
-	model/snapshots/FilterSnapshot.cpp \
-	model/snapshots/ImageSnapshot.cpp \
-	model/snapshots/LayerSnapshot.cpp \
-	model/snapshots/ObjectSnapshot.cpp \
-	model/snapshots/RectSnapshot.cpp \
-	model/snapshots/ShapeSnapshot.cpp \
-	model/snapshots/StyleableSnapshot.cpp \
-	model/snapshots/TextSnapshot.cpp \
-	model/text/CharacterStyle.cpp \
-	model/text/Font.cpp \
-	model/text/StyleRun.cpp \
-	model/text/StyleRunList.cpp \
-	platform/qt/platform_bitmap_support.cpp \
-	platform/qt/platform_support.cpp \
-	platform/qt/platform_support_ui.cpp \
-	platform/qt/PlatformMessageEvent.cpp \
-	platform/qt/PlatformMimeDataManager.cpp \
-	platform/qt/PlatformResourceParser.cpp \
 	platform/qt/PlatformScrollArea.cpp \
-	platform/qt/PlatformSemaphoreManager.cpp \
-	platform/qt/PlatformSignalMessageAdapter.cpp \
-	platform/qt/PlatformThread.cpp \
-	platform/qt/system/BApplication.cpp \
-	platform/qt/system/ArchivingManagers.cpp \
-	platform/qt/system/BAlignment.cpp \
-	platform/qt/system/BAppDefs.cpp \
-	platform/qt/system/BArchivable.cpp \
-	platform/qt/system/BBitmap.cpp \
-	platform/qt/system/BByteOrder.cpp \
-	platform/qt/system/BControl.cpp \
-	platform/qt/system/BCursor.cpp \
-	platform/qt/system/BDataIO.cpp \
-	platform/qt/system/BDirectory.cpp \
-	platform/qt/system/BEntry.cpp \
-	platform/qt/system/BFile.cpp \
-	platform/qt/system/BFlattenable.cpp \
-	platform/qt/system/BGradient.cpp \
-	platform/qt/system/BGraphicsDefs.cpp \
-	platform/qt/system/BInterfaceDefs.cpp \
-	platform/qt/system/BInvoker.cpp \
-	platform/qt/system/BHandler.cpp \
-	platform/qt/system/BLayoutUtils.cpp \
-	platform/qt/system/BList.cpp \
-	platform/qt/system/BLocker.cpp \
-	platform/qt/system/BLooper.cpp \
-	platform/qt/system/BMessage.cpp \
-	platform/qt/system/BMessageAdapter.cpp \
-	platform/qt/system/BMessageFilter.cpp \
-	platform/qt/system/BMessageRunner.cpp \
-	platform/qt/system/BMessageUtils.cpp \
-	platform/qt/system/BMessenger.cpp \
-	platform/qt/system/BOS.cpp \
-	platform/qt/system/BPath.cpp \
-	platform/qt/system/BPoint.cpp \
-	platform/qt/system/BPointerList.cpp \
-	platform/qt/system/BRect.cpp \
-	platform/qt/system/BRegion.cpp \
-	platform/qt/system/BRegionSupport.cpp \
-	platform/qt/system/BResources.cpp \
-	platform/qt/system/BShape.cpp \
-	platform/qt/system/BSize.cpp \
-	platform/qt/system/BScreen.cpp \
-	platform/qt/system/BString.cpp \
-	platform/qt/system/BTranslationUtils.cpp \
-	platform/qt/system/BView.cpp \
-	platform/qt/system/BWindow.cpp \
-	render/FontCache.cpp \
-	render/GaussFilter.cpp \
-	render/LayoutContext.cpp \
-	render/LayoutState.cpp \
-	render/Path.cpp \
-	render/RenderBuffer.cpp \
-	render/RenderEngine.cpp \
 	render/RenderManager.cpp \
 	render/RenderThread.cpp \
-	render/StackBlurFilter.cpp \
-	render/TextLayout.cpp \
-	render/TextRenderer.cpp \
-	render/VertexSource.cpp \
-	render/text/FontRegistry.cpp \
-	support/AbstractLOAdapter.cpp \
-	support/Debug.cpp \
-	support/HashString.cpp \
-	support/Listener.cpp \
-	support/ListenerAdapter.cpp \
-	support/Notifier.cpp \
-	support/ObjectTracker.cpp \
-	support/Referenceable.cpp \
-	support/RWLocker.cpp \
-	support/support.cpp \
-	support/support_ui.cpp \
-	support/Transformable.cpp \
 	tools/DragStateViewState.cpp \
 	tools/Tool.cpp \
 	tools/TransformViewState.cpp \
@@ -227,6 +105,8 @@ SOURCES += \
 	tools/transform/TransformTool.cpp \
 	tools/transform/TransformToolState.cpp
 
+include (render_core.pri)
+
 HEADERS  += \
 	WonderBrush.h \
 	cimg/CImg.h \
@@ -246,6 +126,7 @@ HEADERS  += \
         edits/base/UndoableEdit.h \
         gui/CanvasView.h \
 	gui/ToolConfigView.h \
+	gui/misc/IconCache.h \
 	gui/misc/NavigatorView.h \
 	gui/misc/Panel.h \
 	gui/misc/SwatchGroup.h \
@@ -287,13 +168,17 @@ HEADERS  += \
 	model/fills/Style.h \
 	model/objects/BoundedObject.h \
 	model/objects/BrushStroke.h \
+	model/objects/DirtyAreaExtentTree.h \
 	model/objects/Filter.h \
+	model/objects/FilterDenoise.h \
 	model/objects/Image.h \
 	model/objects/Layer.h \
 	model/objects/LayerObserver.h \
+	model/objects/MyPaintStroke.h \
 	model/objects/Object.h \
 	model/objects/Rect.h \
 	model/objects/Shape.h \
+	model/objects/Stroke.h \
 	model/objects/Styleable.h \
 	model/objects/Text.h \
 	model/property/CommonPropertyIDs.h \
@@ -305,9 +190,12 @@ HEADERS  += \
 	model/property/specific_properties/Int64Property.h \
 	model/property/specific_properties/OptionProperty.h \
 	model/snapshots/BrushStrokeSnapshot.h \
+	model/snapshots/FilterColorSnapshot.h \
+	model/snapshots/FilterDenoiseSnapshot.h \
 	model/snapshots/FilterSnapshot.h \
 	model/snapshots/ImageSnapshot.h \
 	model/snapshots/LayerSnapshot.h \
+	model/snapshots/MyPaintStrokeSnapshot.h \
 	model/snapshots/ObjectSnapshot.h \
 	model/snapshots/RectSnapshot.h \
 	model/snapshots/ShapeSnapshot.h \
@@ -320,7 +208,7 @@ HEADERS  += \
 	platform/qt/platform_support_ui.h \
 	platform/qt/PlatformMessageEvent.h \
 	platform/qt/PlatformMimeDataManager.h \
-	platform/qt/PlatformResourceParser.h \
+	platform/qt/PlatformResourceBundle.h \
 	platform/qt/PlatformScrollArea.h \
 	platform/qt/PlatformSemaphoreManager.h \
 	platform/qt/PlatformSignalMessageAdapter.h \
@@ -444,21 +332,31 @@ HEADERS  += \
 	platform/qt/system/include/utf8_functions.h \
 	platform/qt/system/include/View.h \
 	platform/qt/system/include/Window.h \
+	render/BufferPool.h \
+	render/DenoiseFilter.h \
 	render/FauxWeight.h \
 	render/FontCache.h \
 	render/GaussFilter.h \
+	render/GradientSpanGenerator.h \
+	render/GlyphCoverageCache.h \
 	render/LayoutContext.h \
 	render/LayoutState.h \
+	render/MyPaintBrush.h \
 	render/Path.h \
 	render/RenderBuffer.h \
 	render/RenderEngine.h \
 	render/RenderManager.h \
 	render/RenderThread.h \
+	render/RenderTrace.h \
 	render/Scanline.h \
+	render/ScanlineContainer.h \
+	render/ScratchArena.h \
 	render/StackBlurFilter.h \
 	render/TextLayout.h \
 	render/TextRenderer.h \
+	render/TiledSurface.h \
 	render/VertexSource.h \
+	render/WorkerPool.h \
 	render/text/FontRegistry.h \
 	support/AbstractLOAdapter.h \
 	support/AutoLocker.h \
@@ -500,6 +398,3 @@ FORMS += \
     gui/tools/qt/BrushToolConfigView.ui \
 	gui/tools/qt/TextToolConfigView.ui \
 	gui/tools/qt/TransformToolConfigView.ui
-
-RESOURCES += \
-    wonderbrush2.qrc
@@ -118,9 +118,10 @@ HashString &
 HashString::operator=(const HashString& other)
 {
 	if (&other != this) {
+		atomic_add(&other.fData->refCount, 1);
+		_Unset();
 		fData = other.fData;
 		fLength = other.fLength;
-		atomic_add(&fData->refCount, 1);
 	}
 
 	return *this;
@@ -187,7 +187,13 @@ status_t write_string(BPositionIO* stream, BString& string);
 
 int32 get_optimal_worker_thread_count();
 
-status_t get_app_resources(BResources& resources);
+// Returns the resources of the application, loaded once and shared by all
+// callers, or NULL if they could not be loaded. Must not be modified.
+BResources* get_app_resources();
+
+// Returns the path of the named sub directory in the cache directory of the
+// application, creating it if necessary.
+status_t get_cache_directory(const char* name, BString& path);
 
 char* convert_utf16_to_utf8(const void* string, size_t length);
 
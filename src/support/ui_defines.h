@@ -34,5 +34,16 @@ const pattern kDotted			= { { 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa, 0x55, 0xaa } }
 const pattern kDottedBigger		= { { 0x33, 0x33, 0xcc, 0xcc, 0x33, 0x33, 0xcc, 0xcc } };
 const pattern kDottedBig		= { { 0x0f, 0x0f, 0x0f, 0x0f, 0xf0, 0xf0, 0xf0, 0xf0 } };
 
+// Vector icons of the application resources
+enum {
+	kTextAlignLeftIcon			= 601,
+	kTextAlignCenterIcon		= 602,
+	kTextAlignRightIcon			= 603,
+	kTextAlignJustifyIcon		= 604,
+};
+
+// Size of the icons in the tool config views
+const int32 kToolConfigIconSize	= 16;
+
 
 #endif // UI_DEFINES_H
@@ -6,6 +6,17 @@
 #include "BrushTool.h"
 
 #include <stdio.h>
+#include <string.h>
+
+#include <new>
+
+#include <Application.h>
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <List.h>
+#include <Path.h>
+#include <Roster.h>
 
 #include "BrushIcon.h"
 #include "BrushToolConfigView.h"
@@ -56,7 +67,7 @@ BrushTool::MakeViewState(StateView* view, Document* document,
 	Selection* selection, CurrentColor* color)
 {
 	return new(std::nothrow) BrushToolState(view, document, selection, color,
-		fBrush);
+		fBrush, fMyPaintBrushSettings);
 }
 
 // MakeConfigView
@@ -142,5 +153,70 @@ BrushTool::SetOption(uint32 option, int32 value)
 void
 BrushTool::SetOption(uint32 option, const char* value)
 {
+	switch (option) {
+		case MYPAINT_BRUSH:
+		{
+			fMyPaintBrushSettings = "";
+			if (value == NULL || value[0] == '\0')
+				break;
+
+			BFile file(value, B_READ_ONLY);
+			off_t size;
+			if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK
+				|| size <= 0 || size > 1024 * 1024) {
+				fprintf(stderr, "BrushTool::SetOption(): Failed to read "
+					"MyPaint brush '%s'\n", value);
+				break;
+			}
+
+			char* buffer = fMyPaintBrushSettings.LockBuffer(size + 1);
+			ssize_t read = buffer != NULL ? file.Read(buffer, size) : -1;
+			fMyPaintBrushSettings.UnlockBuffer(read > 0 ? read : 0);
+			break;
+		}
+	}
+}
+
+// #pragma mark -
+
+// compare_paths
+static int
+compare_paths(const void* a, const void* b)
+{
+	const BString* pathA = *(const BString**)a;
+	const BString* pathB = *(const BString**)b;
+	return pathA->Compare(*pathB);
+}
+
+// FindMyPaintBrushes
+/*static*/ void
+BrushTool::FindMyPaintBrushes(BList& paths)
+{
+	app_info info;
+	if (be_app == NULL || be_app->GetAppInfo(&info) != B_OK)
+		return;
+
+	BPath path(&info.ref);
+	if (path.GetParent(&path) != B_OK || path.Append("data") != B_OK)
+		return;
+
+	BDirectory directory(path.Path());
+	BEntry entry;
+	while (directory.GetNextEntry(&entry) == B_OK) {
+		BPath entryPath;
+		if (entry.GetPath(&entryPath) != B_OK)
+			continue;
+
+		const char* leaf = entryPath.Leaf();
+		size_t length = strlen(leaf);
+		if (length <= 4 || strcmp(leaf + length - 4, ".myb") != 0)
+			continue;
+
+		BString* brushPath = new(std::nothrow) BString(entryPath.Path());
+		if (brushPath == NULL || !paths.AddItem(brushPath))
+			delete brushPath;
+	}
+
+	paths.SortItems(&compare_paths);
 }
 
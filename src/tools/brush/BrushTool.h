@@ -6,9 +6,13 @@
 #ifndef BRUSH_TOOL_H
 #define BRUSH_TOOL_H
 
+#include <String.h>
+
 #include "Brush.h"
 #include "Tool.h"
 
+class BList;
+
 class BrushTool : public Tool {
 public:
 								BrushTool();
@@ -37,6 +41,10 @@ public:
 				SOLID,
 				SUBPIXELS,
 				TILT_CONTROLLED,
+
+				MYPAINT_BRUSH,
+					// the path of a MyPaint brush file, or an empty
+					// string to paint with the Brush again
 			};
 
 	virtual	void				SetOption(uint32 option, bool value);
@@ -44,6 +52,10 @@ public:
 	virtual	void				SetOption(uint32 option, int32 value);
 	virtual	void				SetOption(uint32 option, const char* value);
 
+	// Adds the paths (as BString*) of the MyPaint brush files (.myb) in
+	// the data folder next to the application, sorted by name.
+	static	void				FindMyPaintBrushes(BList& paths);
+
 private:
 	virtual	ViewState*			MakeViewState(StateView* view,
 									Document* document, Selection* selection,
@@ -53,6 +65,7 @@ private:
 
 private:
 			Brush				fBrush;
+			BString				fMyPaintBrushSettings;
 };
 
 #endif	// BRUSH_TOOL_H
@@ -6,6 +6,7 @@
 #include "BrushToolState.h"
 
 #include <Cursor.h>
+#include <OS.h>
 
 #include <new>
 
@@ -16,12 +17,14 @@
 #include "CurrentColor.h"
 #include "Document.h"
 #include "Layer.h"
+#include "MyPaintStroke.h"
 #include "ObjectAddedEdit.h"
 #include "support.h"
 
 // constructor
 BrushToolState::BrushToolState(StateView* view, Document* document,
-		Selection* selection, CurrentColor* color, Brush& brush)
+		Selection* selection, CurrentColor* color, Brush& brush,
+		const BString& myPaintBrushSettings)
 	: TransformViewState(view)
 	, fDocument(document)
 	, fSelection(selection)
@@ -29,7 +32,11 @@ BrushToolState::BrushToolState(StateView* view, Document* document,
 	, fInsertionLayer(NULL)
 	, fInsertionIndex(-1)
 	, fBrush(brush)
+	, fMyPaintBrushSettings(myPaintBrushSettings)
+	, fStroke(NULL)
 	, fBrushStroke(NULL)
+	, fMyPaintStroke(NULL)
+	, fLastEventTime(0)
 {
 	// TODO: Find a way to change this later...
 	SetInsertionInfo(fDocument->RootLayer(),
@@ -61,7 +68,7 @@ BrushToolState::MessageReceived(BMessage* message, UndoableEdit** _command)
 void
 BrushToolState::MouseDown(const MouseInfo& info)
 {
-	if (fBrushStroke != NULL)
+	if (fStroke != NULL)
 		return;
 	if (fInsertionLayer == NULL) {
 		fprintf(stderr, "BrushToolState::MouseDown(): No insertion layer "
@@ -69,51 +76,31 @@ BrushToolState::MouseDown(const MouseInfo& info)
 		return;
 	}
 
-	Brush* brush = new(std::nothrow) Brush(fBrush);
-	Paint* paint = new(std::nothrow) Paint(fCurrentColor->Color());
-
-	if (brush == NULL || paint == NULL) {
-		fprintf(stderr, "BrushToolState::MouseDown(): Failed to allocate "
-			"Brush or Paint. Out of memory\n");
-		delete brush;
-		delete paint;
+	fStroke = _CreateStroke();
+	if (fStroke == NULL)
 		return;
-	}
-
-	fBrushStroke = new(std::nothrow)BrushStroke();
-	if (fBrushStroke == NULL) {
-		fprintf(stderr, "BrushToolState::MouseDown(): Failed to allocate "
-			"BrushStroke. Out of memory\n");
-		delete brush;
-		return;
-	}
-
-	// transfer ownership of brush
-	fBrushStroke->SetBrush(brush);
-	brush->RemoveReference();
-
-	// transfer ownership of paint
-	fBrushStroke->SetPaint(paint);
-	paint->RemoveReference();
 
 	if (fInsertionIndex < 0)
 		fInsertionIndex = 0;
 	if (fInsertionIndex > fInsertionLayer->CountObjects())
 		fInsertionIndex = fInsertionLayer->CountObjects();
 
-	if (!fInsertionLayer->AddObject(fBrushStroke, fInsertionIndex)) {
+	if (!fInsertionLayer->AddObject(fStroke, fInsertionIndex)) {
 		fprintf(stderr, "BrushToolState::MouseDown(): Failed to add "
-			"BrushStroke to Layer. Out of memory\n");
-		fBrushStroke->RemoveReference();
+			"stroke to Layer. Out of memory\n");
+		fStroke->RemoveReference();
+		fStroke = NULL;
 		fBrushStroke = NULL;
+		fMyPaintStroke = NULL;
 		return;
 	}
 
 	fInsertionIndex++;
 
-	// We keep the initial reference to the BrushStroke while we will
+	// We keep the initial reference to the stroke while we will
 	// still mess with it.
 
+	fLastEventTime = system_time();
 	_AppendPoint(info);
 }
 
@@ -128,14 +115,16 @@ BrushToolState::MouseMoved(const MouseInfo& info)
 UndoableEdit*
 BrushToolState::MouseUp()
 {
-	if (fBrushStroke == NULL)
+	if (fStroke == NULL)
 		return NULL;
 
-	UndoableEdit* edit = new(std::nothrow) ObjectAddedEdit(fBrushStroke,
+	UndoableEdit* edit = new(std::nothrow) ObjectAddedEdit(fStroke,
 		fSelection);
 
-	fBrushStroke->RemoveReference();
+	fStroke->RemoveReference();
+	fStroke = NULL;
 	fBrushStroke = NULL;
+	fMyPaintStroke = NULL;
 
 	return edit;
 }
@@ -191,17 +180,82 @@ BrushToolState::SetInsertionInfo(Layer* layer, int32 index)
 	fInsertionIndex = index;
 }
 
+// _CreateStroke
+Object*
+BrushToolState::_CreateStroke()
+{
+	if (fMyPaintBrushSettings.Length() > 0) {
+		fMyPaintStroke = new(std::nothrow) MyPaintStroke();
+		if (fMyPaintStroke == NULL || fMyPaintStroke->InitCheck() != B_OK
+			|| fMyPaintStroke->SetBrushSettings(
+				fMyPaintBrushSettings.String()) != B_OK) {
+			fprintf(stderr, "BrushToolState::_CreateStroke(): Failed to "
+				"create MyPaintStroke\n");
+			if (fMyPaintStroke != NULL)
+				fMyPaintStroke->RemoveReference();
+			fMyPaintStroke = NULL;
+			return NULL;
+		}
+		fMyPaintStroke->SetColor(fCurrentColor->Color());
+		return fMyPaintStroke;
+	}
+
+	Brush* brush = new(std::nothrow) Brush(fBrush);
+	Paint* paint = new(std::nothrow) Paint(fCurrentColor->Color());
+
+	if (brush == NULL || paint == NULL) {
+		fprintf(stderr, "BrushToolState::_CreateStroke(): Failed to allocate "
+			"Brush or Paint. Out of memory\n");
+		delete brush;
+		delete paint;
+		return NULL;
+	}
+
+	fBrushStroke = new(std::nothrow)BrushStroke();
+	if (fBrushStroke == NULL) {
+		fprintf(stderr, "BrushToolState::_CreateStroke(): Failed to allocate "
+			"BrushStroke. Out of memory\n");
+		delete brush;
+		delete paint;
+		return NULL;
+	}
+
+	// transfer ownership of brush
+	fBrushStroke->SetBrush(brush);
+	brush->RemoveReference();
+
+	// transfer ownership of paint
+	fBrushStroke->SetPaint(paint);
+	paint->RemoveReference();
+
+	return fBrushStroke;
+}
+
 // _AppendPoint
 void
 BrushToolState::_AppendPoint(const MouseInfo& info)
 {
-	if (fBrushStroke == NULL)
+	if (fStroke == NULL)
 		return;
 
 	BPoint position = info.position;
 	TransformViewToObject(&position);
 
+	if (fMyPaintStroke != NULL) {
+		// The brush dynamics depend on the speed of the pointer.
+		bigtime_t now = system_time();
+		MyPaintEvent event;
+		event.x = position.x;
+		event.y = position.y;
+		event.pressure = info.pressure;
+		event.tiltX = info.tilt.x;
+		event.tiltY = info.tilt.y;
+		event.deltaTime = (now - fLastEventTime) / 1000000.0;
+		fLastEventTime = now;
+		fMyPaintStroke->AppendEvent(event);
+		return;
+	}
+
 	StrokePoint point(position, info.pressure, info.tilt.x, info.tilt.y);
 	fBrushStroke->AppendPoint(point);
 }
-
@@ -6,6 +6,8 @@
 #ifndef BRUSH_TOOL_STATE_H
 #define BRUSH_TOOL_STATE_H
 
+#include <String.h>
+
 #include "Brush.h"
 #include "Selection.h"
 #include "TransformViewState.h"
@@ -14,13 +16,16 @@ class BrushStroke;
 class CurrentColor;
 class Document;
 class Layer;
+class MyPaintStroke;
+class Object;
 
 class BrushToolState : public TransformViewState,
 	public Selection::Controller {
 public:
 								BrushToolState(StateView* view,
 									Document* document, Selection* selection,
-									CurrentColor* color, Brush& brush);
+									CurrentColor* color, Brush& brush,
+									const BString& myPaintBrushSettings);
 	virtual						~BrushToolState();
 
 	// ViewState interface
@@ -38,6 +43,7 @@ public:
 			void				SetInsertionInfo(Layer* layer, int32 index);
 
 private:
+			Object*				_CreateStroke();
 			void				_AppendPoint(const MouseInfo& info);
 
 			Document*			fDocument;
@@ -48,7 +54,14 @@ private:
 			int32				fInsertionIndex;
 
 			Brush&				fBrush;
+			const BString&		fMyPaintBrushSettings;
+
+			// Only one of them is set while painting, fStroke is the same
+			// object.
+			Object*				fStroke;
 			BrushStroke*		fBrushStroke;
+			MyPaintStroke*		fMyPaintStroke;
+			bigtime_t			fLastEventTime;
 };
 
 #endif // BRUSH_TOOL_STATE_H
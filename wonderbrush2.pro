@@ -3,12 +3,20 @@ TEMPLATE = subdirs
 SUBDIRS += \
     src/agg \
     src \
+    bench \
 	src/gui/colorpicker \
 	src/gui/scrollview \
-	src/icon
+	src/icon \
+	src/platform/qt/rescompiler
 
 src.depends = \
 	src/agg \
 	src/gui/colorpicker \
 	src/gui/scrollview \
-	src/icon
+	src/icon \
+	src/platform/qt/rescompiler
+
+bench.subdir = src/bench
+bench.depends = \
+	src/agg \
+	src/platform/qt/rescompiler